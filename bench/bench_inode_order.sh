@@ -0,0 +1,100 @@
+#!/bin/bash
+#
+# Cold-cache benchmark for the order in which `lister -l` stats entries.
+#
+# Builds an ext4 image on a loop device (direct I/O, so the backing file's page
+# cache does not hide the reads), fills one directory with many files, and times
+# `lister -l` with entries stat'ed in readdir (hash) order and in inode order.
+# The page cache is dropped and the filesystem remounted before every run.
+#
+# Both orders are timed twice. The default pipelined listing hands entries to
+# its workers in batches of 256 and sorts each batch by inode, so its stats
+# only ascend within a batch. `--threads=0` reads the whole directory first
+# and stats it in one ascending pass. Each inode row is compared with the
+# readdir row of the same mode.
+#
+# Usage: sudo bench/bench_inode_order.sh [FILES] [RUNS]
+#   FILES  Number of files to create (default 200000)
+#   RUNS   Timed runs per order; the median is reported (default 5)
+#
+# Requires root, losetup, mkfs.ext4, awk and a built bin/lister.
+
+set -euo pipefail
+
+FILES=${1:-200000}
+RUNS=${2:-5}
+LISTER=$(cd "$(dirname "$0")/.." && pwd)/bin/lister
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/lister-inode-bench-XXXXXX")
+IMAGE=$WORK/fs.img
+MOUNT=$WORK/mnt
+LOOP=""
+
+if [ "$(id -u)" -ne 0 ]; then
+    echo "Error: This benchmark needs root (loop devices, mount, drop_caches)" >&2
+    exit 1
+fi
+if [ ! -x "$LISTER" ]; then
+    echo "Error: Build lister first (make)" >&2
+    exit 1
+fi
+
+cleanup() {
+    umount "$MOUNT" 2>/dev/null || true
+    [ -n "$LOOP" ] && losetup -d "$LOOP" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+# Image sized for the inodes plus some slack
+truncate -s $(( (FILES / 1000 + 64) * 1024 * 1024 )) "$IMAGE"
+mkfs.ext4 -q -N $(( FILES + 1024 )) "$IMAGE"
+LOOP=$(losetup --find --show --direct-io=on "$IMAGE")
+mkdir -p "$MOUNT"
+mount "$LOOP" "$MOUNT"
+
+# Inode numbers follow creation order; readdir returns hash order
+echo "Creating $FILES files..."
+mkdir "$MOUNT/dir"
+(cd "$MOUNT/dir" && seq -f "file_%.0f" 1 "$FILES" | xargs touch)
+
+cold_cache() {
+    sync
+    umount "$MOUNT"
+    echo 3 > /proc/sys/vm/drop_caches
+    mount "$LOOP" "$MOUNT"
+}
+
+# Median wall-clock time of RUNS cold runs with the given LISTER_STAT_ORDER and
+# any extra lister options
+time_order() {
+    local order=$1
+    shift
+    local times=()
+    for _ in $(seq 1 "$RUNS"); do
+        cold_cache
+        local start end
+        start=$(date +%s.%N)
+        LISTER_STAT_ORDER=$order "$LISTER" -l "$@" "$MOUNT/dir" > /dev/null
+        end=$(date +%s.%N)
+        times+=("$(awk -v s="$start" -v e="$end" 'BEGIN { printf "%.6f", e - s }')")
+    done
+    printf '%s\n' "${times[@]}" | sort -n | sed -n "$(( (RUNS + 1) / 2 ))p"
+}
+
+echo "Timing $RUNS cold runs per order..."
+PIPELINED_READDIR=$(time_order readdir)
+PIPELINED_INODE=$(time_order inode)
+SERIAL_READDIR=$(time_order readdir --threads=0)
+SERIAL_INODE=$(time_order inode --threads=0)
+
+# Speedup of inode order over readdir order in the same mode
+row() {
+    awk -v label="$1" -v base="$2" -v t="$3" \
+        'BEGIN { printf "%-22s %10.3f %7.2fx\n", label, t, base / t }'
+}
+
+printf '%-22s %10s %8s\n' "order" "median (s)" "speedup"
+row "readdir" "$PIPELINED_READDIR" "$PIPELINED_READDIR"
+row "inode, per batch" "$PIPELINED_READDIR" "$PIPELINED_INODE"
+row "readdir, --threads=0" "$SERIAL_READDIR" "$SERIAL_READDIR"
+row "inode, --threads=0" "$SERIAL_READDIR" "$SERIAL_INODE"
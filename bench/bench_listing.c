@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "directory_reader.h"
+#include "file_info.h"
+#include "sort/sort.h"
+#include "utils/arena.h"
+
+/*
+ * Listing allocation benchmark.
+ *
+ * Builds directories of 1k, 10k and 100k empty files and performs the work of
+ * `lister -lt` on each (read, sort by mtime, gather long-format information)
+ * twice: with heap-allocated entries and with a single arena. Heap calls made
+ * by lister code are counted by wrapping malloc/calloc/realloc at link time
+ * (see `make bench`); allocations inside libc itself are not wrapped.
+ */
+
+static size_t g_heap_calls = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    g_heap_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    g_heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    g_heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+/**
+ * @brief Monotonic time in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Create count empty files in a fresh temporary directory
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int populate(char *dir_path, int count) {
+    if (mkdtemp(dir_path) == NULL) {
+        return -1;
+    }
+
+    char name[64];
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "%s/file_%06d", dir_path, i);
+        int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+/**
+ * @brief Remove the files created by populate() and the directory itself
+ */
+static void cleanup(const char *dir_path, int count) {
+    char name[64];
+    for (int i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "%s/file_%06d", dir_path, i);
+        unlink(name);
+    }
+    rmdir(dir_path);
+}
+
+/**
+ * @brief Read, sort and gather long-format information for one directory
+ *
+ * @param arena Arena for the whole listing, or NULL for per-entry heap allocation
+ * @return int Number of entries listed, or -1 on error
+ */
+static int list_once(const char *dir_path, Arena *arena) {
+    DirectoryContent content = read_directory_filtered(dir_path, 0, NULL, arena);
+    if (content.entries == NULL) {
+        return -1;
+    }
+    sort_directory_content(&content, SORT_MODE_MTIME, dir_path, 0);
+
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+    size_t infos_size = content.count * sizeof(FileInfo);
+    FileInfo *infos = (FileInfo *)(arena != NULL ? arena_alloc(arena, infos_size)
+                                                 : malloc(infos_size));
+    if (dir_fd < 0 || infos == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < content.count; i++) {
+        infos[i] = get_file_info_at(dir_fd, content.entries[i], arena);
+    }
+    close(dir_fd);
+
+    int count = content.count;
+    if (arena == NULL) {
+        for (int i = 0; i < count; i++) {
+            free_file_info(infos[i]);
+        }
+        free(infos);
+        free_directory_content(content);
+    }
+    return count;
+}
+
+int main(void) {
+    const int sizes[] = {1000, 10000, 100000};
+
+    // Warm the passwd/group lookups so their one-time allocations are not counted
+    struct stat self;
+    if (stat(".", &self) == 0) {
+        free_file_info(file_info_from_stat(&self, ".", NULL));
+    }
+
+    printf("%8s  %-6s  %12s  %10s  %7s  %9s\n",
+           "entries", "mode", "heap calls", "per entry", "blocks", "time (s)");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        char dir_path[] = "/tmp/lister-bench-XXXXXX";
+        if (populate(dir_path, sizes[s]) != 0) {
+            fprintf(stderr, "Error: Cannot create benchmark directory\n");
+            return 1;
+        }
+
+        // Heap: every name, path and FileInfo string is its own allocation
+        g_heap_calls = 0;
+        double start = now_seconds();
+        int listed = list_once(dir_path, NULL);
+        double heap_time = now_seconds() - start;
+        size_t heap_calls = g_heap_calls;
+
+        // Arena: the whole listing comes from a few mappings
+        Arena arena;
+        arena_init(&arena);
+        g_heap_calls = 0;
+        start = now_seconds();
+        int arena_listed = list_once(dir_path, &arena);
+        size_t blocks = arena.block_count;
+        arena_destroy(&arena);
+        double arena_time = now_seconds() - start;
+        size_t arena_calls = g_heap_calls;
+
+        cleanup(dir_path, sizes[s]);
+        if (listed != sizes[s] || arena_listed != sizes[s]) {
+            fprintf(stderr, "Error: Listed %d/%d of %d entries\n", listed, arena_listed,
+                    sizes[s]);
+            return 1;
+        }
+
+        printf("%8d  %-6s  %12zu  %10.2f  %7s  %9.4f\n", sizes[s], "heap", heap_calls,
+               (double)heap_calls / sizes[s], "-", heap_time);
+        printf("%8d  %-6s  %12zu  %10.4f  %7zu  %9.4f\n", sizes[s], "arena", arena_calls,
+               (double)arena_calls / sizes[s], blocks, arena_time);
+    }
+    return 0;
+}
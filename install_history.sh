@@ -4,7 +4,7 @@
 
 SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 WRAPPER_SCRIPT="$SCRIPT_DIR/lister_history.sh"
-HISTORY_FILE="$SCRIPT_DIR/src/history.txt"
+HISTORY_FILE="$SCRIPT_DIR/src/history.log"
 
 # Detect shell from $SHELL environment variable or check which rc file exists
 if [ -n "$SHELL" ]; then
@@ -54,5 +54,6 @@ echo "Added to: $SHELL_RC"
 echo "History file: $HISTORY_FILE"
 echo ""
 echo "To use, restart your shell or run: source $SHELL_RC"
-echo "Then use 'lister' command as usual - it will automatically log to history.txt"
+echo "Then use 'lister' command as usual - it will automatically log to history.log"
+echo "Show the log with: lister --history-query"
 
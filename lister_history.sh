@@ -15,8 +15,8 @@ fi
 # Path to lister executable (can be overridden)
 LISTER_BIN="${LISTER_BIN:-${SCRIPT_DIR}/bin/lister}"
 
-# History file path (can be overridden)
-HISTORY_FILE="${LISTER_HISTORY_FILE:-${SCRIPT_DIR}/src/history.txt}"
+# History file path (can be overridden); lister appends to it with --history
+HISTORY_FILE="${LISTER_HISTORY_FILE:-${SCRIPT_DIR}/src/history.log}"
 
 # Check if lister binary exists
 if [ ! -x "$LISTER_BIN" ]; then
@@ -25,47 +25,21 @@ if [ ! -x "$LISTER_BIN" ]; then
     return 1 2>/dev/null || exit 1
 fi
 
-# Wrapper function to log command and output
+# Wrapper function: lister records the command and its output itself, while
+# the output goes straight to the terminal. Runs that are not one-off listings
+# are not recorded: --watch never ends, --serve and --connect hand commands to a
+# server, and --history-query reads the log (the wrapper's, through
+# LISTER_HISTORY_FILE) instead of adding to it.
 lister() {
-    # Build command string for logging
-    local cmd="lister"
     local arg
     for arg in "$@"; do
-        # Quote argument if it contains spaces or special characters
-        if [[ "$arg" =~ [[:space:]$'\n'\"\'\`] ]]; then
-            # Escape quotes and wrap in double quotes
-            local escaped_arg="${arg//\"/\\\"}"
-            cmd+=" \"$escaped_arg\""
-        else
-            cmd+=" $arg"
-        fi
+        case "$arg" in
+            --watch | --serve | --serve=* | --connect | --connect=* | \
+            --history-query | --history-query=*)
+                LISTER_HISTORY_FILE="$HISTORY_FILE" "$LISTER_BIN" "$@"
+                return
+                ;;
+        esac
     done
-
-    # Get timestamp
-    local timestamp
-    timestamp=$(date '+%Y-%m-%d %H:%M:%S' 2>/dev/null || date '+%Y-%m-%d %H:%M:%S')
-
-    # Capture output and exit code
-    local output
-    local exit_code
-    output=$("$LISTER_BIN" "$@" 2>&1)
-    exit_code=$?
-
-    # Write to history file
-    {
-        echo "=== [$timestamp] ==="
-        echo "Command: $cmd"
-        echo "Exit Code: $exit_code"
-        echo "Result:"
-        echo "$output"
-        echo ""
-    } >> "$HISTORY_FILE" 2>/dev/null || {
-        echo "Warning: Could not write to history file: $HISTORY_FILE" >&2
-    }
-
-    # Print output to user
-    echo "$output"
-
-    return $exit_code
+    "$LISTER_BIN" --history="$HISTORY_FILE" "$@"
 }
-
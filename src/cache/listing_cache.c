@@ -0,0 +1,344 @@
+#define _POSIX_C_SOURCE 200809L
+#include "listing_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "LSTCACHE"
+#define CACHE_VERSION 3
+
+// Header flags
+#define CACHE_FLAG_SHOW_ALL 0x1u
+
+/**
+ * @brief On-disk header, followed by count records and names_size bytes of names
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t names_size;
+} CacheHeader;
+
+/**
+ * @brief On-disk entry record
+ *
+ * Only names and types are kept: rewriting a file does not change the
+ * directory's mtime or ctime, so cached metadata could not be trusted.
+ */
+typedef struct {
+    uint32_t name_offset;
+    uint16_t name_length;
+    uint8_t type;
+    uint8_t reserved;
+} CacheRecord;
+
+static int64_t timespec_to_ns(struct timespec ts) {
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Check that every record names a NUL-terminated string inside the names section
+ */
+static int records_in_bounds(const CacheRecord *records, uint32_t count, const char *names,
+                             uint64_t names_size) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t end = (uint64_t)records[i].name_offset + records[i].name_length;
+        if (records[i].name_length == 0 || end >= names_size || names[end] != '\0' ||
+            memchr(names + records[i].name_offset, '\0', records[i].name_length) != NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Build the cache directory path ($XDG_CACHE_HOME/lister or ~/.cache/lister)
+ *
+ * @param buffer Output buffer
+ * @param buffer_size Size of the buffer
+ * @param create If non-zero, create the directories if missing
+ * @return int 0 on success, -1 if no cache location is available
+ */
+static int get_cache_dir(char *buffer, size_t buffer_size, int create) {
+    const char *base = getenv("XDG_CACHE_HOME");
+    int written;
+
+    if (base != NULL && base[0] != '\0') {
+        if (create) {
+            mkdir(base, 0700);
+        }
+        written = snprintf(buffer, buffer_size, "%s/lister", base);
+    } else {
+        const char *home = getenv("HOME");
+        if (home == NULL || home[0] == '\0') {
+            return -1;
+        }
+        if (create) {
+            char parent[PATH_MAX];
+            snprintf(parent, sizeof(parent), "%s/.cache", home);
+            mkdir(parent, 0700);
+        }
+        written = snprintf(buffer, buffer_size, "%s/.cache/lister", home);
+    }
+
+    if (written < 0 || (size_t)written >= buffer_size) {
+        return -1;
+    }
+    if (create && mkdir(buffer, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+int listing_cache_file_path(const struct stat *dir_stat, const char *suffix, char *buffer,
+                            size_t buffer_size, int create) {
+    char cache_dir[PATH_MAX];
+    if (get_cache_dir(cache_dir, sizeof(cache_dir), create) != 0) {
+        return -1;
+    }
+
+    int written = snprintf(buffer, buffer_size, "%s/%llx-%llx%s", cache_dir,
+                           (unsigned long long)dir_stat->st_dev,
+                           (unsigned long long)dir_stat->st_ino, suffix);
+    return (written < 0 || (size_t)written >= buffer_size) ? -1 : 0;
+}
+
+/**
+ * @brief Build the cache file path for a directory, named after its (dev, ino)
+ */
+static int get_cache_file(const struct stat *dir_stat, char *buffer, size_t buffer_size,
+                          int create) {
+    return listing_cache_file_path(dir_stat, ".cache", buffer, buffer_size, create);
+}
+
+CacheStatus listing_cache_open(const char *dir_path, int show_all, ListingCache *cache) {
+    memset(cache, 0, sizeof(ListingCache));
+    cache->status = CACHE_MISS;
+
+    if (dir_path == NULL || stat(dir_path, &cache->dir_stat) != 0) {
+        return cache->status;
+    }
+    cache->dir_stat_valid = 1;
+
+    char cache_file[PATH_MAX];
+    if (get_cache_file(&cache->dir_stat, cache_file, sizeof(cache_file), 0) != 0) {
+        return cache->status;
+    }
+
+    int fd = open(cache_file, O_RDONLY);
+    if (fd < 0) {
+        return cache->status;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return cache->status;
+    }
+
+    size_t map_size = (size_t)file_stat.st_size;
+    void *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return cache->status;
+    }
+
+    const CacheHeader *header = (const CacheHeader *)map;
+    size_t records_size = (size_t)header->count * sizeof(CacheRecord);
+    const CacheRecord *records = (const CacheRecord *)((const char *)map + sizeof(CacheHeader));
+    const char *names = (const char *)map + sizeof(CacheHeader) + records_size;
+    int valid = memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version == CACHE_VERSION &&
+                header->names_size <= map_size &&
+                sizeof(CacheHeader) + records_size + header->names_size == map_size &&
+                ((header->flags & CACHE_FLAG_SHOW_ALL) != 0) == (show_all != 0) &&
+                header->dev == (uint64_t)cache->dir_stat.st_dev &&
+                header->ino == (uint64_t)cache->dir_stat.st_ino &&
+                header->mtime_ns == timespec_to_ns(cache->dir_stat.st_mtim) &&
+                records_in_bounds(records, header->count, names, header->names_size);
+    if (!valid) {
+        munmap(map, map_size);
+        return cache->status;
+    }
+
+    cache->map = map;
+    cache->map_size = map_size;
+    cache->records = records;
+    cache->names = names;
+    cache->count = header->count;
+
+    // A changed ctime with an unchanged mtime means the directory inode itself
+    // changed (e.g. chmod) but no entry was added, removed or renamed
+    if (header->ctime_ns == timespec_to_ns(cache->dir_stat.st_ctim)) {
+        cache->status = CACHE_HIT;
+    } else {
+        cache->status = CACHE_NAMES_VALID;
+    }
+    return cache->status;
+}
+
+/**
+ * @brief Allocate from the arena if there is one, otherwise from the heap
+ */
+static void *content_alloc(Arena *arena, size_t size) {
+    return arena != NULL ? arena_alloc(arena, size) : malloc(size);
+}
+
+DirectoryContent listing_cache_content(const ListingCache *cache, Arena *arena) {
+    DirectoryContent content;
+    content.entries = NULL;
+    content.types = NULL;
+    content.inodes = NULL;
+    content.count = 0;
+    content.arena = arena;
+
+    if (cache == NULL || cache->status == CACHE_MISS || cache->count == 0) {
+        return content;
+    }
+
+    const CacheRecord *records = (const CacheRecord *)cache->records;
+    content.entries = (char **)content_alloc(arena, cache->count * sizeof(char *));
+    content.types = (unsigned char *)content_alloc(arena, cache->count * sizeof(unsigned char));
+    if (content.entries == NULL || content.types == NULL) {
+        if (arena == NULL) {
+            free(content.entries);
+            free(content.types);
+        }
+        content.entries = NULL;
+        content.types = NULL;
+        return content;
+    }
+
+    for (uint32_t i = 0; i < cache->count; i++) {
+        size_t name_len = records[i].name_length;
+        content.entries[i] = (char *)content_alloc(arena, (name_len + 1) * sizeof(char));
+        if (content.entries[i] == NULL) {
+            content.count = (int)i;
+            free_directory_content(content);
+            content.entries = NULL;
+            content.types = NULL;
+            content.count = 0;
+            return content;
+        }
+        memcpy(content.entries[i], cache->names + records[i].name_offset, name_len);
+        content.entries[i][name_len] = '\0';
+        content.types[i] = records[i].type;
+    }
+
+    content.count = (int)cache->count;
+    return content;
+}
+
+// Entry names for the qsort callback below
+static char *const *g_store_names = NULL;
+
+static int compare_indices_by_name(const void *a, const void *b) {
+    return strcmp(g_store_names[*(const int *)a], g_store_names[*(const int *)b]);
+}
+
+int listing_cache_store(const char *dir_path, int show_all, const ListingCache *cache,
+                        const DirectoryContent *content) {
+    if (dir_path == NULL || cache == NULL || !cache->dir_stat_valid || content == NULL) {
+        return -1;
+    }
+
+    char cache_file[PATH_MAX];
+    char temp_file[PATH_MAX + 32];
+    if (get_cache_file(&cache->dir_stat, cache_file, sizeof(cache_file), 1) != 0) {
+        return -1;
+    }
+    snprintf(temp_file, sizeof(temp_file), "%s.%ld.tmp", cache_file, (long)getpid());
+
+    // Records are written in name order so lookups can binary search
+    int count = content->entries != NULL ? content->count : 0;
+    int *order = (int *)malloc((count > 0 ? count : 1) * sizeof(int));
+    CacheRecord *records = (CacheRecord *)calloc(count > 0 ? count : 1, sizeof(CacheRecord));
+    if (order == NULL || records == NULL) {
+        free(order);
+        free(records);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    g_store_names = content->entries;
+    qsort(order, count, sizeof(int), compare_indices_by_name);
+    g_store_names = NULL;
+
+    uint64_t names_size = 0;
+    for (int i = 0; i < count; i++) {
+        int index = order[i];
+        size_t name_len = strlen(content->entries[index]);
+        CacheRecord *record = &records[i];
+
+        record->name_offset = (uint32_t)names_size;
+        record->name_length = (uint16_t)name_len;
+        record->type = content->types != NULL ? content->types[index] : 0;
+        names_size += name_len + 1;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.flags = show_all ? CACHE_FLAG_SHOW_ALL : 0;
+    header.dev = (uint64_t)cache->dir_stat.st_dev;
+    header.ino = (uint64_t)cache->dir_stat.st_ino;
+    header.mtime_ns = timespec_to_ns(cache->dir_stat.st_mtim);
+    header.ctime_ns = timespec_to_ns(cache->dir_stat.st_ctim);
+    header.count = (uint32_t)count;
+    header.names_size = names_size;
+
+    FILE *file = fopen(temp_file, "wb");
+    int status = file != NULL ? 0 : -1;
+    if (status == 0 && fwrite(&header, sizeof(CacheHeader), 1, file) != 1) {
+        status = -1;
+    }
+    if (status == 0 && count > 0 &&
+        fwrite(records, sizeof(CacheRecord), (size_t)count, file) != (size_t)count) {
+        status = -1;
+    }
+    for (int i = 0; status == 0 && i < count; i++) {
+        const char *name = content->entries[order[i]];
+        if (fwrite(name, 1, strlen(name) + 1, file) != strlen(name) + 1) {
+            status = -1;
+        }
+    }
+    if (file != NULL && fclose(file) != 0) {
+        status = -1;
+    }
+
+    // Publish atomically so concurrent readers never see a partial record
+    if (status == 0 && rename(temp_file, cache_file) != 0) {
+        status = -1;
+    }
+    if (status != 0 && file != NULL) {
+        unlink(temp_file);
+    }
+
+    free(order);
+    free(records);
+    return status;
+}
+
+void listing_cache_close(ListingCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    if (cache->map != NULL) {
+        munmap(cache->map, cache->map_size);
+    }
+    memset(cache, 0, sizeof(ListingCache));
+}
@@ -0,0 +1,95 @@
+#ifndef LISTING_CACHE_H
+#define LISTING_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "directory_reader.h"
+
+/**
+ * @brief How much of a cached listing can be trusted
+ */
+typedef enum {
+    CACHE_MISS,         // No usable record: read the directory
+    CACHE_NAMES_VALID,  // Directory mtime matches: names and types are valid, the record needs rewriting
+    CACHE_HIT           // Full key matches: names and types are valid and the record is current
+} CacheStatus;
+
+/**
+ * @brief An open, memory-mapped cache record for one directory
+ */
+typedef struct {
+    CacheStatus status;
+    void *map;               // Mapped cache file (NULL on miss)
+    size_t map_size;
+    const void *records;     // Fixed-size entry records, sorted by name
+    const char *names;       // NUL-terminated names referenced by the records
+    uint32_t count;          // Number of records
+    struct stat dir_stat;    // Stat of the directory when the cache was opened
+    int dir_stat_valid;
+} ListingCache;
+
+/**
+ * @brief Look up the cache record for a directory
+ *
+ * The record is keyed by the directory's (dev, ino, mtime_ns, ctime_ns). A
+ * record written with a different show_all setting counts as a miss, and so
+ * does one with a record pointing outside the file (truncated or corrupt).
+ * Only names and types are cached; metadata is always stat'ed again, since
+ * revalidating a cached stat against the entry's mtime would take the same
+ * stat() call.
+ *
+ * @param dir_path Directory path
+ * @param show_all Whether hidden entries are part of the listing
+ * @param cache Receives the open cache (always initialized; close with listing_cache_close)
+ * @return CacheStatus Result of the lookup (also stored in cache->status)
+ */
+CacheStatus listing_cache_open(const char *dir_path, int show_all, ListingCache *cache);
+
+/**
+ * @brief Build a DirectoryContent from a cache record, skipping read_directory()
+ *
+ * @param cache Open cache with status other than CACHE_MISS
+ * @param arena Arena to allocate the entries from, or NULL to use the heap
+ * @return DirectoryContent Entries in name order (free with free_directory_content)
+ */
+DirectoryContent listing_cache_content(const ListingCache *cache, Arena *arena);
+
+/**
+ * @brief Build the path of a per-directory file in the cache directory
+ *
+ * Files live in $XDG_CACHE_HOME/lister (or ~/.cache/lister) and are named
+ * after the directory's (dev, ino), so other caches can sit next to the
+ * listing cache.
+ *
+ * @param dir_stat Stat of the listed directory
+ * @param suffix File name suffix, e.g. ".cache"
+ * @param buffer Output buffer
+ * @param buffer_size Size of the buffer
+ * @param create If non-zero, create the cache directory if missing
+ * @return int 0 on success, -1 if no cache location is available
+ */
+int listing_cache_file_path(const struct stat *dir_stat, const char *suffix, char *buffer,
+                            size_t buffer_size, int create);
+
+/**
+ * @brief Write (or replace) the cache record for a directory
+ *
+ * @param dir_path Directory path
+ * @param show_all Whether hidden entries are part of the listing
+ * @param cache Cache previously opened for dir_path (provides the directory key)
+ * @param content Entries to store
+ * @return int 0 on success, -1 on error
+ */
+int listing_cache_store(const char *dir_path, int show_all, const ListingCache *cache,
+                        const DirectoryContent *content);
+
+/**
+ * @brief Unmap a cache opened with listing_cache_open
+ *
+ * @param cache Cache to close
+ */
+void listing_cache_close(ListingCache *cache);
+
+#endif
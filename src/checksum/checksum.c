@@ -0,0 +1,567 @@
+#define _POSIX_C_SOURCE 200809L
+#include "checksum.h"
+#include "cache/listing_cache.h"
+#include "utils/sha256.h"
+#include "utils/xxh64.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Files below this size are batched into shared jobs
+#define SMALL_FILE_LIMIT (256 * 1024)
+#define BATCH_BYTES (1024 * 1024)
+#define BATCH_FILES 64
+
+// Files at least this large are mapped; smaller ones are read with pread()
+#define MMAP_THRESHOLD (1024 * 1024)
+#define READ_BUFFER_SIZE (1024 * 1024)
+
+#define MAX_HASH_WORKERS 16
+
+#define SUMS_MAGIC "LSTSUMS"
+#define SUMS_VERSION 1
+
+/**
+ * @brief On-disk header of a digest cache, followed by count records sorted by (dev, ino)
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t algorithm;
+    uint64_t count;
+} SumsHeader;
+
+/**
+ * @brief On-disk digest cache record
+ */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint8_t digest[CHECKSUM_MAX_DIGEST];
+} SumsRecord;
+
+/**
+ * @brief Range of pending files hashed by one worker in one go
+ */
+typedef struct {
+    int start;
+    int end;
+} HashJob;
+
+/**
+ * @brief Shared state of the hashing pool
+ */
+typedef struct {
+    int dir_fd;
+    ChecksumAlgorithm algorithm;
+    const FileInfo *file_infos;
+    const int *pending;        // Indices into file_infos of the files to hash
+    SumsRecord *results;       // Key and digest per pending file
+    unsigned char *hashed;     // Non-zero where results[k] holds a digest
+    HashJob *jobs;
+    int job_count;
+    int next_job;              // Next job to claim (atomic)
+} HashPool;
+
+int checksum_parse(const char *name) {
+    if (strcmp(name, "xxh64") == 0) {
+        return CHECKSUM_XXH64;
+    }
+    if (strcmp(name, "sha256") == 0) {
+        return CHECKSUM_SHA256;
+    }
+    return -1;
+}
+
+static size_t digest_size(ChecksumAlgorithm algorithm) {
+    return algorithm == CHECKSUM_SHA256 ? SHA256_DIGEST_SIZE : XXH64_DIGEST_SIZE;
+}
+
+static int64_t timespec_to_ns(struct timespec ts) {
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Fill a record's key from a stat structure
+ */
+static void set_key(SumsRecord *record, const struct stat *stat_info) {
+    record->dev = (uint64_t)stat_info->st_dev;
+    record->ino = (uint64_t)stat_info->st_ino;
+    record->size = (int64_t)stat_info->st_size;
+    record->mtime_ns = timespec_to_ns(stat_info->st_mtim);
+    record->ctime_ns = timespec_to_ns(stat_info->st_ctim);
+}
+
+/**
+ * @brief Either hash state, picked by the algorithm
+ */
+typedef struct {
+    ChecksumAlgorithm algorithm;
+    Xxh64 xxh;
+    Sha256 sha;
+} HashState;
+
+static void hash_init(HashState *state, ChecksumAlgorithm algorithm) {
+    state->algorithm = algorithm;
+    if (algorithm == CHECKSUM_SHA256) {
+        sha256_init(&state->sha);
+    } else {
+        xxh64_init(&state->xxh);
+    }
+}
+
+static void hash_update(HashState *state, const void *data, size_t size) {
+    if (state->algorithm == CHECKSUM_SHA256) {
+        sha256_update(&state->sha, data, size);
+    } else {
+        xxh64_update(&state->xxh, data, size);
+    }
+}
+
+static void hash_final(HashState *state, uint8_t *digest) {
+    if (state->algorithm == CHECKSUM_SHA256) {
+        sha256_final(&state->sha, digest);
+        return;
+    }
+
+    // Big-endian, so the hex reads like xxhsum's output
+    uint64_t hash = xxh64_final(&state->xxh);
+    for (int i = 0; i < XXH64_DIGEST_SIZE; i++) {
+        digest[i] = (uint8_t)(hash >> (56 - 8 * i));
+    }
+}
+
+/**
+ * @brief Hash one file: large files through a read-only mapping, others with pread()
+ *
+ * @param buffer Read buffer of READ_BUFFER_SIZE bytes
+ * @param record Receives the key (from the opened file) and the digest
+ * @return int 0 on success, -1 if the file is not a readable regular file
+ */
+static int hash_file(int dir_fd, const char *name, ChecksumAlgorithm algorithm,
+                     unsigned char *buffer, SumsRecord *record) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // The key comes from the file actually read, not the earlier stat
+    struct stat stat_info;
+    if (fstat(fd, &stat_info) != 0 || !S_ISREG(stat_info.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    set_key(record, &stat_info);
+
+    HashState state;
+    hash_init(&state, algorithm);
+    off_t offset = 0;
+    if (stat_info.st_size >= MMAP_THRESHOLD) {
+        void *map = mmap(NULL, (size_t)stat_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, (size_t)stat_info.st_size, POSIX_MADV_SEQUENTIAL);
+            hash_update(&state, map, (size_t)stat_info.st_size);
+            munmap(map, (size_t)stat_info.st_size);
+            offset = stat_info.st_size;
+        }
+    }
+
+    // Whatever was not mapped (or was appended since the fstat) is read in large chunks
+    for (;;) {
+        ssize_t result = pread(fd, buffer, READ_BUFFER_SIZE, offset);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            close(fd);
+            return -1;
+        }
+        if (result == 0) {
+            break;
+        }
+        hash_update(&state, buffer, (size_t)result);
+        offset += result;
+    }
+
+    close(fd);
+    hash_final(&state, record->digest);
+    return 0;
+}
+
+/**
+ * @brief Write a digest in lowercase hex
+ */
+static void digest_to_hex(const uint8_t *digest, size_t size, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0xf];
+    }
+    hex[size * 2] = '\0';
+}
+
+int checksum_file_at(int dir_fd, const char *name, ChecksumAlgorithm algorithm, char *hex) {
+    unsigned char *buffer = (unsigned char *)malloc(READ_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    SumsRecord record;
+    int status = hash_file(dir_fd, name, algorithm, buffer, &record);
+    free(buffer);
+    if (status == 0) {
+        digest_to_hex(record.digest, digest_size(algorithm), hex);
+    }
+    return status;
+}
+
+/**
+ * @brief Worker: claim jobs until none are left
+ */
+static void *hash_worker(void *arg) {
+    HashPool *pool = (HashPool *)arg;
+    unsigned char *buffer = (unsigned char *)malloc(READ_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        int job = __atomic_fetch_add(&pool->next_job, 1, __ATOMIC_RELAXED);
+        if (job >= pool->job_count) {
+            break;
+        }
+        for (int k = pool->jobs[job].start; k < pool->jobs[job].end; k++) {
+            const char *name = pool->file_infos[pool->pending[k]].name;
+            pool->hashed[k] = hash_file(pool->dir_fd, name, pool->algorithm, buffer,
+                                        &pool->results[k]) == 0;
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Split the pending files into jobs: one per large file, batches of small ones
+ *
+ * @return int Number of jobs written to jobs (room for count jobs is needed)
+ */
+static int plan_jobs(const FileInfo *file_infos, const int *pending, int count, HashJob *jobs) {
+    int job_count = 0;
+    int batch_start = -1;
+    long long batch_bytes = 0;
+
+    for (int k = 0; k < count; k++) {
+        long long size = file_infos[pending[k]].size;
+        if (size >= SMALL_FILE_LIMIT) {
+            jobs[job_count].start = k;
+            jobs[job_count].end = k + 1;
+            job_count++;
+            continue;
+        }
+
+        if (batch_start >= 0 && (batch_bytes + size > BATCH_BYTES ||
+                                 k - batch_start >= BATCH_FILES || jobs[job_count - 1].end != k)) {
+            batch_start = -1;
+        }
+        if (batch_start < 0) {
+            batch_start = k;
+            batch_bytes = 0;
+            jobs[job_count].start = k;
+            jobs[job_count].end = k;
+            job_count++;
+        }
+        jobs[job_count - 1].end = k + 1;
+        batch_bytes += size;
+    }
+    return job_count;
+}
+
+/**
+ * @brief Run the jobs on a pool of threads (or inline when one thread is enough)
+ */
+static void run_pool(HashPool *pool) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cpus > 0 ? (int)cpus : 1;
+    if (workers > MAX_HASH_WORKERS) {
+        workers = MAX_HASH_WORKERS;
+    }
+    if (workers > pool->job_count) {
+        workers = pool->job_count;
+    }
+
+    pthread_t threads[MAX_HASH_WORKERS];
+    int started = 0;
+    while (workers > 1 && started < workers &&
+           pthread_create(&threads[started], NULL, hash_worker, pool) == 0) {
+        started++;
+    }
+
+    // The calling thread always takes part, so the work gets done even without threads
+    hash_worker(pool);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/**
+ * @brief qsort/bsearch comparator ordering cache records by (dev, ino)
+ */
+static int compare_records(const void *a, const void *b) {
+    const SumsRecord *record_a = (const SumsRecord *)a;
+    const SumsRecord *record_b = (const SumsRecord *)b;
+    if (record_a->dev != record_b->dev) {
+        return record_a->dev < record_b->dev ? -1 : 1;
+    }
+    if (record_a->ino != record_b->ino) {
+        return record_a->ino < record_b->ino ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Cache file of a directory for one algorithm
+ */
+static int get_sums_file(const struct stat *dir_stat, ChecksumAlgorithm algorithm, char *buffer,
+                         size_t buffer_size, int create) {
+    const char *suffix = algorithm == CHECKSUM_SHA256 ? ".sha256.sums" : ".xxh64.sums";
+    return listing_cache_file_path(dir_stat, suffix, buffer, buffer_size, create);
+}
+
+/**
+ * @brief Load a directory's digest cache
+ *
+ * @param count Receives the number of records
+ * @return SumsRecord* Records sorted by (dev, ino) (caller frees), or NULL if there are none
+ */
+static SumsRecord *load_sums(const struct stat *dir_stat, ChecksumAlgorithm algorithm,
+                             int *count) {
+    *count = 0;
+    char sums_file[PATH_MAX];
+    if (get_sums_file(dir_stat, algorithm, sums_file, sizeof(sums_file), 0) != 0) {
+        return NULL;
+    }
+
+    FILE *file = fopen(sums_file, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    SumsHeader header;
+    SumsRecord *records = NULL;
+    if (fread(&header, sizeof(SumsHeader), 1, file) == 1 &&
+        memcmp(header.magic, SUMS_MAGIC, sizeof(SUMS_MAGIC)) == 0 &&
+        header.version == SUMS_VERSION && header.algorithm == (uint32_t)algorithm &&
+        header.count > 0 && header.count <= INT_MAX / sizeof(SumsRecord)) {
+        records = (SumsRecord *)malloc(header.count * sizeof(SumsRecord));
+        if (records != NULL &&
+            fread(records, sizeof(SumsRecord), header.count, file) == header.count) {
+            *count = (int)header.count;
+        } else {
+            free(records);
+            records = NULL;
+        }
+    }
+
+    fclose(file);
+    return records;
+}
+
+/**
+ * @brief Replace a directory's digest cache with the given records
+ *
+ * @param records Records to store; sorted here
+ * @return int 0 on success, -1 on error
+ */
+static int store_sums(const struct stat *dir_stat, ChecksumAlgorithm algorithm,
+                      SumsRecord *records, int count) {
+    char sums_file[PATH_MAX];
+    char temp_file[PATH_MAX + 32];
+    if (get_sums_file(dir_stat, algorithm, sums_file, sizeof(sums_file), 1) != 0) {
+        return -1;
+    }
+    snprintf(temp_file, sizeof(temp_file), "%s.%ld.tmp", sums_file, (long)getpid());
+
+    qsort(records, count, sizeof(SumsRecord), compare_records);
+
+    SumsHeader header;
+    memset(&header, 0, sizeof(SumsHeader));
+    memcpy(header.magic, SUMS_MAGIC, sizeof(SUMS_MAGIC));
+    header.version = SUMS_VERSION;
+    header.algorithm = (uint32_t)algorithm;
+    header.count = (uint64_t)count;
+
+    FILE *file = fopen(temp_file, "wb");
+    int status = file != NULL ? 0 : -1;
+    if (status == 0 && fwrite(&header, sizeof(SumsHeader), 1, file) != 1) {
+        status = -1;
+    }
+    if (status == 0 && count > 0 &&
+        fwrite(records, sizeof(SumsRecord), (size_t)count, file) != (size_t)count) {
+        status = -1;
+    }
+    if (file != NULL && fclose(file) != 0) {
+        status = -1;
+    }
+
+    // Publish atomically so concurrent readers never see a partial cache
+    if (status == 0 && rename(temp_file, sums_file) != 0) {
+        status = -1;
+    }
+    if (status != 0 && file != NULL) {
+        unlink(temp_file);
+    }
+    return status;
+}
+
+/**
+ * @brief Copy a string into the arena, or onto the heap without one
+ */
+static char *copy_string(Arena *arena, const char *str) {
+    if (arena != NULL) {
+        return arena_strdup(arena, str);
+    }
+
+    char *copy = (char *)malloc(strlen(str) + 1);
+    if (copy != NULL) {
+        strcpy(copy, str);
+    }
+    return copy;
+}
+
+int checksum_file_infos(const char *dir_path, FileInfo *file_infos, int count,
+                        ChecksumAlgorithm algorithm, int use_cache, Arena *arena) {
+    if (file_infos == NULL || count <= 0 || algorithm == CHECKSUM_NONE) {
+        return 0;
+    }
+
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat dir_stat;
+    if (dir_fd < 0 || fstat(dir_fd, &dir_stat) != 0) {
+        if (dir_fd >= 0) {
+            close(dir_fd);
+        }
+        return -1;
+    }
+
+    int cached_count = 0;
+    SumsRecord *cached = use_cache ? load_sums(&dir_stat, algorithm, &cached_count) : NULL;
+
+    // Every regular file gets a slot: a cached digest, or a place in the pool's work
+    int *pending = (int *)malloc(count * sizeof(int));
+    SumsRecord *results = (SumsRecord *)malloc(count * sizeof(SumsRecord));
+    unsigned char *hashed = (unsigned char *)calloc(count, 1);
+    int *slots = (int *)malloc(count * sizeof(int));
+    int *misses = (int *)malloc(count * sizeof(int));
+    SumsRecord *miss_results = (SumsRecord *)malloc(count * sizeof(SumsRecord));
+    unsigned char *miss_hashed = (unsigned char *)calloc(count, 1);
+    HashJob *jobs = (HashJob *)malloc(count * sizeof(HashJob));
+    int status = 0;
+    if (pending == NULL || results == NULL || hashed == NULL || slots == NULL ||
+        misses == NULL || miss_results == NULL || miss_hashed == NULL || jobs == NULL) {
+        status = -1;
+        count = 0;
+    }
+
+    int pending_count = 0;
+    int hit_count = 0;
+    for (int i = 0; i < count; i++) {
+        slots[i] = -1;
+        if (file_infos[i].name == NULL || !S_ISREG(file_infos[i].stat_info.st_mode)) {
+            continue;
+        }
+
+        SumsRecord key;
+        set_key(&key, &file_infos[i].stat_info);
+        const SumsRecord *hit = NULL;
+        if (cached != NULL) {
+            hit = (const SumsRecord *)bsearch(&key, cached, cached_count, sizeof(SumsRecord),
+                                              compare_records);
+        }
+        slots[i] = pending_count;
+        if (hit != NULL && hit->size == key.size && hit->mtime_ns == key.mtime_ns &&
+            hit->ctime_ns == key.ctime_ns) {
+            results[pending_count] = *hit;
+            hashed[pending_count] = 1;
+            hit_count++;
+        }
+        pending[pending_count++] = i;
+    }
+
+    // Hash the misses on the pool, then slot their digests back in
+    int miss_count = 0;
+    for (int k = 0; k < pending_count; k++) {
+        if (!hashed[k]) {
+            misses[miss_count++] = pending[k];
+        }
+    }
+    if (miss_count > 0) {
+        HashPool pool;
+        pool.dir_fd = dir_fd;
+        pool.algorithm = algorithm;
+        pool.file_infos = file_infos;
+        pool.pending = misses;
+        pool.results = miss_results;
+        pool.hashed = miss_hashed;
+        pool.jobs = jobs;
+        pool.job_count = plan_jobs(file_infos, misses, miss_count, jobs);
+        pool.next_job = 0;
+        run_pool(&pool);
+
+        for (int k = 0, m = 0; k < pending_count; k++) {
+            if (!hashed[k]) {
+                results[k] = miss_results[m];
+                hashed[k] = miss_hashed[m];
+                m++;
+            }
+        }
+    }
+
+    // Hand out the hex digests ("?" where reading failed, "-" for non-regular entries)
+    size_t size = digest_size(algorithm);
+    for (int i = 0; i < count; i++) {
+        char hex[CHECKSUM_HEX_SIZE];
+        const char *text = file_infos[i].metadata_missing ? "?" : "-";
+        if (slots[i] >= 0) {
+            text = "?";
+            if (hashed[slots[i]]) {
+                digest_to_hex(results[slots[i]].digest, size, hex);
+                text = hex;
+            }
+        }
+        file_infos[i].checksum = copy_string(arena, text);
+    }
+
+    // Rewrite the cache when anything was read, keeping only the files still listed
+    if (status == 0 && use_cache && (miss_count > 0 || hit_count != cached_count)) {
+        int stored = 0;
+        for (int k = 0; k < pending_count; k++) {
+            if (hashed[k]) {
+                results[stored++] = results[k];
+            }
+        }
+        store_sums(&dir_stat, algorithm, results, stored);
+    }
+
+    free(pending);
+    free(results);
+    free(hashed);
+    free(slots);
+    free(misses);
+    free(miss_results);
+    free(miss_hashed);
+    free(jobs);
+    free(cached);
+    close(dir_fd);
+    return status;
+}
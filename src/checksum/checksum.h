@@ -0,0 +1,60 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "file_info.h"
+#include "utils/arena.h"
+
+/**
+ * @brief Content hash shown by --checksum
+ */
+typedef enum {
+    CHECKSUM_NONE,
+    CHECKSUM_XXH64,    // 64-bit xxHash (default): fast, not cryptographic
+    CHECKSUM_SHA256    // SHA-256, matches sha256sum
+} ChecksumAlgorithm;
+
+// Longest digest in bytes, and room for it in hex with the terminator
+#define CHECKSUM_MAX_DIGEST 32
+#define CHECKSUM_HEX_SIZE (2 * CHECKSUM_MAX_DIGEST + 1)
+
+/**
+ * @brief Look up an algorithm by name
+ *
+ * @param name "xxh64" or "sha256"
+ * @return int The ChecksumAlgorithm, or -1 if the name is unknown
+ */
+int checksum_parse(const char *name);
+
+/**
+ * @brief Hash one file relative to an open directory, on the calling thread
+ *
+ * @param dir_fd Directory containing the file
+ * @param name File name
+ * @param algorithm Algorithm to use
+ * @param hex Receives the digest in lowercase hex (CHECKSUM_HEX_SIZE bytes)
+ * @return int 0 on success, -1 if the file is not a readable regular file
+ */
+int checksum_file_at(int dir_fd, const char *name, ChecksumAlgorithm algorithm, char *hex);
+
+/**
+ * @brief Fill in the checksum of every entry of a long listing
+ *
+ * Regular files get their digest in hex; files that cannot be read get "?"
+ * and everything else "-". Files are hashed on a pool of worker threads:
+ * large files are mapped and hashed one per job, small ones are batched so a
+ * job is never just one tiny read. Digests are cached per directory, keyed by
+ * each file's (dev, ino, size, mtime_ns, ctime_ns), so unchanged files are not
+ * read again.
+ *
+ * @param dir_path Directory the entries live in
+ * @param file_infos Entries; checksum is set on each
+ * @param count Number of entries
+ * @param algorithm Algorithm to use
+ * @param use_cache If non-zero, read and update the digest cache
+ * @param arena Arena to allocate the strings from, or NULL to use the heap
+ * @return int 0 on success, -1 if the directory cannot be opened
+ */
+int checksum_file_infos(const char *dir_path, FileInfo *file_infos, int count,
+                        ChecksumAlgorithm algorithm, int use_cache, Arena *arena);
+
+#endif
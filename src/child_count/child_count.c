@@ -0,0 +1,217 @@
+#define _GNU_SOURCE
+#include "child_count.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MAX_COUNT_WORKERS 16
+
+/**
+ * @brief Record layout returned by getdents64()
+ */
+typedef struct {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} LinuxDirent64;
+
+/**
+ * @brief Shared state of the counting pool
+ */
+typedef struct {
+    int dir_fd;
+    int show_all;
+    long long limit;
+    FileInfo *file_infos;
+    const int *directories;    // Indices into file_infos of the subdirectories
+    int directory_count;
+    int next;                  // Next directory to claim (atomic)
+} CountPool;
+
+long long child_count_at(int dir_fd, const char *name, int show_all, long long limit,
+                         char *buffer, size_t buffer_size) {
+    // With -L a link to a directory is counted like the directory
+    int nofollow = file_info_stat_flags() != 0 ? O_NOFOLLOW : 0;
+    int fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | nofollow | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    long long count = 0;
+    for (;;) {
+        long length = syscall(SYS_getdents64, fd, buffer, buffer_size);
+        if (length < 0) {
+            count = -1;
+            break;
+        }
+        if (length == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < length;) {
+            const LinuxDirent64 *entry = (const LinuxDirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+
+            // Skip "." and "..", and hidden entries unless they are shown
+            const char *entry_name = entry->d_name;
+            if (entry_name[0] == '.' &&
+                (!show_all || entry_name[1] == '\0' ||
+                 (entry_name[1] == '.' && entry_name[2] == '\0'))) {
+                continue;
+            }
+            count++;
+        }
+
+        // Early exit: the rest of the directory is never read
+        if (limit > 0 && count >= limit) {
+            count = limit;
+            break;
+        }
+    }
+
+    close(fd);
+    return count;
+}
+
+/**
+ * @brief Whether an entry needs counting: its readdir type, or its stat data if unknown
+ *
+ * @return long long The CHILDREN_* value it gets instead, or 0 if it is a directory to count
+ */
+static long long classify_entry(unsigned char type, const FileInfo *info) {
+    if (info->name == NULL || info->metadata_missing) {
+        return CHILDREN_UNKNOWN;
+    }
+    // The stat data of a link only says directory when links are followed (-L)
+    if (type == DT_DIR ||
+        ((type == DT_UNKNOWN || type == DT_LNK) && S_ISDIR(info->stat_info.st_mode))) {
+        return 0;
+    }
+    return CHILDREN_NOT_DIRECTORY;
+}
+
+/**
+ * @brief Count one subdirectory into its FileInfo
+ */
+static void count_into(int dir_fd, int show_all, long long limit, char *buffer,
+                       size_t buffer_size, FileInfo *info) {
+    long long count = child_count_at(dir_fd, info->name, show_all, limit, buffer, buffer_size);
+    info->children = count >= 0 ? count : CHILDREN_UNKNOWN;
+    info->children_capped = limit > 0 && count >= limit;
+}
+
+void child_count_entry(int dir_fd, unsigned char type, int show_all, long long limit,
+                       char *buffer, size_t buffer_size, FileInfo *info) {
+    long long children = classify_entry(type, info);
+    if (children == 0 && buffer == NULL) {
+        children = CHILDREN_UNKNOWN;
+    }
+    if (children != 0) {
+        info->children = children;
+        info->children_capped = 0;
+        return;
+    }
+    count_into(dir_fd, show_all, limit, buffer, buffer_size, info);
+}
+
+/**
+ * @brief Worker: claim subdirectories until none are left
+ */
+static void *count_worker(void *arg) {
+    CountPool *pool = (CountPool *)arg;
+    char *buffer = (char *)malloc(CHILD_COUNT_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        int claimed = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (claimed >= pool->directory_count) {
+            break;
+        }
+        count_into(pool->dir_fd, pool->show_all, pool->limit, buffer, CHILD_COUNT_BUFFER_SIZE,
+                   &pool->file_infos[pool->directories[claimed]]);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+int child_count_file_infos(const char *dir_path, const DirectoryContent *content,
+                           FileInfo *file_infos, int show_all, long long limit) {
+    int count = content->count;
+    if (file_infos == NULL || count <= 0) {
+        return 0;
+    }
+
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int *directories = (int *)malloc(count * sizeof(int));
+    int status = dir_fd >= 0 && directories != NULL ? 0 : -1;
+
+    // The readdir type decides; only DT_UNKNOWN entries need their stat data
+    int directory_count = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned char type = content->types != NULL ? content->types[i] : DT_UNKNOWN;
+        long long children = classify_entry(type, &file_infos[i]);
+        if (children == 0 && status != 0) {
+            children = CHILDREN_UNKNOWN;
+        }
+        file_infos[i].children_capped = 0;
+        if (children != 0) {
+            file_infos[i].children = children;
+        } else {
+            directories[directory_count++] = i;
+        }
+    }
+
+    if (directory_count > 0) {
+        CountPool pool;
+        pool.dir_fd = dir_fd;
+        pool.show_all = show_all;
+        pool.limit = limit;
+        pool.file_infos = file_infos;
+        pool.directories = directories;
+        pool.directory_count = directory_count;
+        pool.next = 0;
+
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int workers = cpus > 0 ? (int)cpus : 1;
+        if (workers > MAX_COUNT_WORKERS) {
+            workers = MAX_COUNT_WORKERS;
+        }
+        if (workers > directory_count) {
+            workers = directory_count;
+        }
+
+        pthread_t threads[MAX_COUNT_WORKERS];
+        int started = 0;
+        while (workers > 1 && started < workers - 1 &&
+               pthread_create(&threads[started], NULL, count_worker, &pool) == 0) {
+            started++;
+        }
+
+        // The calling thread always takes part, so the counts get done even without threads
+        count_worker(&pool);
+        for (int i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        // A worker that could not get its buffer leaves nothing behind; mark what is left
+        for (int k = pool.next; k < directory_count; k++) {
+            file_infos[directories[k]].children = CHILDREN_UNKNOWN;
+        }
+    }
+
+    free(directories);
+    if (dir_fd >= 0) {
+        close(dir_fd);
+    }
+    return status;
+}
@@ -0,0 +1,69 @@
+#ifndef CHILD_COUNT_H
+#define CHILD_COUNT_H
+
+#include <stddef.h>
+
+#include "directory_reader.h"
+#include "file_info.h"
+
+// Size of the buffer each counting thread hands to getdents64()
+#define CHILD_COUNT_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Count the entries of a subdirectory without reading their names into memory
+ *
+ * The directory is read with raw getdents64() calls into the caller's
+ * buffer; entries are only counted, never copied or stat'ed. "." and ".."
+ * are not counted, and hidden entries only with show_all, so the count
+ * matches what listing the subdirectory would show. A symbolic link is only
+ * opened when links are followed (see file_info_set_follow_links()).
+ *
+ * @param dir_fd Directory containing the subdirectory
+ * @param name Subdirectory name
+ * @param show_all Count hidden entries too
+ * @param limit Stop counting at this many entries (0: no limit)
+ * @param buffer Scratch buffer for getdents64()
+ * @param buffer_size Size of the buffer
+ * @return long long Number of entries (at most limit), or -1 if it cannot be read
+ */
+long long child_count_at(int dir_fd, const char *name, int show_all, long long limit,
+                         char *buffer, size_t buffer_size);
+
+/**
+ * @brief Fill in the child count of one entry, on the calling thread
+ *
+ * Sets info->children (and children_capped) the way child_count_file_infos()
+ * does, from the entry's readdir type and, if that is unknown, its stat data.
+ *
+ * @param dir_fd Directory containing the entry
+ * @param type Entry type from readdir (DT_UNKNOWN if not known)
+ * @param show_all Count hidden entries too
+ * @param limit Stop counting at this many entries (0: no limit)
+ * @param buffer Scratch buffer for getdents64(), or NULL (the count is then unknown)
+ * @param buffer_size Size of the buffer
+ * @param info Entry; its name and stat data are used
+ */
+void child_count_entry(int dir_fd, unsigned char type, int show_all, long long limit,
+                       char *buffer, size_t buffer_size, FileInfo *info);
+
+/**
+ * @brief Fill in the child count of every subdirectory of a long listing
+ *
+ * Which entries are directories comes from the listing's readdir types, so
+ * other entries cost nothing; only entries of unknown type fall back on
+ * their stat data. Symbolic links are not followed. The subdirectories are
+ * counted on a pool of worker threads, each with its own getdents64() buffer.
+ * Every entry gets a children value: a count, CHILDREN_NOT_DIRECTORY or
+ * CHILDREN_UNKNOWN; counts that reached the limit are marked children_capped.
+ *
+ * @param dir_path Directory the entries live in
+ * @param content Listing the file_infos were built from (for the entry types)
+ * @param file_infos Entries, parallel to content->entries
+ * @param show_all Count hidden entries too
+ * @param limit Stop counting a subdirectory at this many entries (0: no limit)
+ * @return int 0 on success, -1 if the directory cannot be opened
+ */
+int child_count_file_infos(const char *dir_path, const DirectoryContent *content,
+                           FileInfo *file_infos, int show_all, long long limit);
+
+#endif
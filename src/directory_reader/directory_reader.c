@@ -1,13 +1,50 @@
+#define _DEFAULT_SOURCE
 #include "directory_reader.h"
+#include "filter/filter.h"
 #include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
 DirectoryContent read_directory(const char *path, int show_all) {
+    return read_directory_filtered(path, show_all, NULL, NULL);
+}
+
+/**
+ * @brief Decide whether a readdir entry belongs in the listing
+ *
+ * @return int Non-zero to keep the entry
+ */
+static int keep_entry(const struct dirent *entry, int show_all, const struct Filter *filter) {
+    // Skip '.' and '..' entries
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        return 0;
+    }
+
+    // Skip hidden files if show_all is false
+    if (!show_all && entry->d_name[0] == '.') {
+        return 0;
+    }
+
+    // Skip entries the filter rejects on name and type alone
+    return filter_match_name(filter, entry->d_name, entry->d_type) != FILTER_REJECT;
+}
+
+/**
+ * @brief Allocate from the arena if there is one, otherwise from the heap
+ */
+static void *content_alloc(Arena *arena, size_t size) {
+    return arena != NULL ? arena_alloc(arena, size) : malloc(size);
+}
+
+DirectoryContent read_directory_filtered(const char *path, int show_all,
+                                         const struct Filter *filter, Arena *arena) {
     DirectoryContent content;
     content.entries = NULL;
+    content.types = NULL;
+    content.inodes = NULL;
     content.count = 0;
+    content.arena = arena;
 
     if (path == NULL) {
         return content;
@@ -22,27 +59,28 @@ DirectoryContent read_directory(const char *path, int show_all) {
     struct dirent *entry;
     int count = 0;
     while ((entry = readdir(dir)) != NULL) {
-        // Skip '.' and '..' entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        // Skip hidden files if show_all is false
-        if (!show_all && entry->d_name[0] == '.') {
+        if (!keep_entry(entry, show_all, filter)) {
             continue;
         }
 
         count++;
     }
 
-    // Allocate memory for entries
-    if (count == 0) {
-        closedir(dir);
-        return content;
-    }
-
-    content.entries = (char **)malloc(count * sizeof(char *));
-    if (content.entries == NULL) {
+    // Allocate memory for entries (at least one slot, so an empty or all-filtered
+    // listing is still non-NULL and only an unreadable directory has no entries)
+    size_t slots = count > 0 ? (size_t)count : 1;
+    content.entries = (char **)content_alloc(arena, slots * sizeof(char *));
+    content.types = (unsigned char *)content_alloc(arena, slots * sizeof(unsigned char));
+    content.inodes = (ino_t *)content_alloc(arena, slots * sizeof(ino_t));
+    if (content.entries == NULL || content.types == NULL || content.inodes == NULL) {
+        if (arena == NULL) {
+            free(content.entries);
+            free(content.types);
+            free(content.inodes);
+        }
+        content.entries = NULL;
+        content.types = NULL;
+        content.inodes = NULL;
         closedir(dir);
         return content;
     }
@@ -50,41 +88,133 @@ DirectoryContent read_directory(const char *path, int show_all) {
     // Second pass: collect entry names
     rewinddir(dir);
     int index = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip '.' and '..' entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        // Skip hidden files if show_all is false
-        if (!show_all && entry->d_name[0] == '.') {
+    while ((entry = readdir(dir)) != NULL && index < count) {
+        if (!keep_entry(entry, show_all, filter)) {
             continue;
         }
 
-        // Allocate memory for entry name and copy it
+        // Copy the entry name (into the arena if there is one)
         size_t name_len = strlen(entry->d_name);
-        content.entries[index] = (char *)malloc((name_len + 1) * sizeof(char));
+        content.entries[index] = (char *)(arena != NULL ? arena_strdup(arena, entry->d_name)
+                                                        : malloc((name_len + 1) * sizeof(char)));
         if (content.entries[index] == NULL) {
             // Clean up allocated memory on error
-            for (int i = 0; i < index; i++) {
-                free(content.entries[i]);
+            if (arena == NULL) {
+                for (int i = 0; i < index; i++) {
+                    free(content.entries[i]);
+                }
+                free(content.entries);
+                free(content.types);
+                free(content.inodes);
             }
-            free(content.entries);
             closedir(dir);
             content.entries = NULL;
+            content.types = NULL;
+            content.inodes = NULL;
             content.count = 0;
             return content;
         }
-        strcpy(content.entries[index], entry->d_name);
+        if (arena == NULL) {
+            strcpy(content.entries[index], entry->d_name);
+        }
+        content.types[index] = entry->d_type;
+        content.inodes[index] = entry->d_ino;
         index++;
     }
 
     closedir(dir);
-    content.count = count;
+    // Entries removed between the two passes shrink the listing
+    content.count = index;
     return content;
 }
 
+int read_directory_each(const char *path, int show_all, const struct Filter *filter,
+                        DirectoryEntryCallback callback, void *context) {
+    if (path == NULL || callback == NULL) {
+        return -1;
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    // Single pass: nothing is kept once the callback returns
+    struct dirent *entry;
+    int status = 0;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (!keep_entry(entry, show_all, filter)) {
+            continue;
+        }
+        status = callback(entry->d_name, entry->d_type, entry->d_ino, context);
+    }
+
+    closedir(dir);
+    return status;
+}
+
+/**
+ * @brief Inode number paired with the entry it belongs to
+ */
+typedef struct {
+    ino_t inode;
+    int index;
+} InodeIndex;
+
+/**
+ * @brief Wrapper for qsort to order entries by inode number
+ */
+static int compare_inodes(const void *a, const void *b) {
+    const InodeIndex *inode_a = (const InodeIndex *)a;
+    const InodeIndex *inode_b = (const InodeIndex *)b;
+    if (inode_a->inode != inode_b->inode) {
+        return inode_a->inode < inode_b->inode ? -1 : 1;
+    }
+    return inode_a->index - inode_b->index;
+}
+
+int *directory_stat_order(const DirectoryContent *content) {
+    if (content == NULL || content->inodes == NULL || content->count <= 1) {
+        return NULL;
+    }
+
+    const char *order = getenv("LISTER_STAT_ORDER");
+    if (order != NULL && strcmp(order, "readdir") == 0) {
+        return NULL;
+    }
+
+    size_t pairs_size = content->count * sizeof(InodeIndex);
+    InodeIndex *pairs = (InodeIndex *)content_alloc(content->arena, pairs_size);
+    int *indices = (int *)content_alloc(content->arena, content->count * sizeof(int));
+    if (pairs == NULL || indices == NULL) {
+        if (content->arena == NULL) {
+            free(pairs);
+            free(indices);
+        }
+        return NULL;
+    }
+
+    for (int i = 0; i < content->count; i++) {
+        pairs[i].inode = content->inodes[i];
+        pairs[i].index = i;
+    }
+    qsort(pairs, content->count, sizeof(InodeIndex), compare_inodes);
+    for (int i = 0; i < content->count; i++) {
+        indices[i] = pairs[i].index;
+    }
+
+    if (content->arena == NULL) {
+        free(pairs);
+    }
+    return indices;
+}
+
 void free_directory_content(DirectoryContent content) {
+    // Arena-backed content is released with its arena
+    if (content.arena != NULL) {
+        return;
+    }
+
     if (content.entries != NULL) {
         for (int i = 0; i < content.count; i++) {
             if (content.entries[i] != NULL) {
@@ -93,4 +223,6 @@ void free_directory_content(DirectoryContent content) {
         }
         free(content.entries);
     }
+    free(content.types);
+    free(content.inodes);
 }
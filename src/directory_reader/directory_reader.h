@@ -1,12 +1,21 @@
 #ifndef DIRECTORY_READER_H
 #define DIRECTORY_READER_H
 
+#include <sys/types.h>
+
+#include "utils/arena.h"
+
+struct Filter;  // Compiled entry filter (filter/filter.h)
+
 /**
  * @brief Structure to hold directory contents
  */
 typedef struct {
-    char **entries;  // Array of entry names
-    int count;       // Number of entries
+    char **entries;         // Array of entry names
+    unsigned char *types;   // Entry types (DT_* from <dirent.h>), parallel to entries; may be NULL
+    ino_t *inodes;          // Inode numbers from readdir, parallel to entries; may be NULL
+    int count;              // Number of entries
+    Arena *arena;           // Arena owning entries, names and types, or NULL if heap-allocated
 } DirectoryContent;
 
 /**
@@ -14,12 +23,80 @@ typedef struct {
  * 
  * @param path Path to the directory to read
  * @param show_all If 1, include hidden files (starting with '.'); if 0, exclude them
- * @return DirectoryContent Structure containing array of entry names and count
+ * @return DirectoryContent Structure containing array of entry names and count;
+ *         entries is NULL only if the directory cannot be read
  */
 DirectoryContent read_directory(const char *path, int show_all);
 
+/**
+ * @brief Read directory contents, dropping entries rejected by a filter
+ *
+ * Name and type tests run on each readdir entry before its name is copied.
+ * Entries whose fate depends on metadata are kept; apply
+ * filter_apply_metadata() afterwards to decide them.
+ *
+ * @param path Path to the directory to read
+ * @param show_all If 1, include hidden files (starting with '.'); if 0, exclude them
+ * @param filter Compiled filter, or NULL to keep every entry
+ * @param arena Arena to allocate the entries from, or NULL to use the heap
+ * @return DirectoryContent Structure containing array of entry names and count;
+ *         entries is NULL only if the directory cannot be read, and an empty or
+ *         all-filtered directory has count 0
+ */
+DirectoryContent read_directory_filtered(const char *path, int show_all,
+                                         const struct Filter *filter, Arena *arena);
+
+/**
+ * @brief Callback receiving one directory entry from read_directory_each()
+ *
+ * @param name Entry name (only valid during the call)
+ * @param type Entry type (DT_* from <dirent.h>)
+ * @param inode Inode number from readdir
+ * @param context Caller data
+ * @return int 0 to continue, non-zero to stop reading
+ */
+typedef int (*DirectoryEntryCallback)(const char *name, unsigned char type, ino_t inode,
+                                      void *context);
+
+/**
+ * @brief Stream directory entries to a callback without keeping them
+ *
+ * Applies the same hidden-file and name/type filter rules as
+ * read_directory_filtered().
+ *
+ * @param path Path to the directory to read
+ * @param show_all If 1, include hidden files (starting with '.'); if 0, exclude them
+ * @param filter Compiled filter, or NULL to keep every entry
+ * @param callback Function called for each kept entry
+ * @param context Passed through to the callback
+ * @return int 0 on success, -1 if the directory cannot be opened, or the callback's
+ *         non-zero return value
+ */
+int read_directory_each(const char *path, int show_all, const struct Filter *filter,
+                        DirectoryEntryCallback callback, void *context);
+
+/**
+ * @brief Order in which to stat a listing's entries: ascending inode number
+ *
+ * On ext4 and XFS, inode numbers follow the inode table, so stat'ing in this
+ * order turns the random inode-table reads of readdir (hash) order into a
+ * mostly sequential scan that the filesystem's own inode readahead can serve.
+ * Results should be stored by index, which scatters them back to listing order.
+ *
+ * Setting LISTER_STAT_ORDER=readdir disables the reordering (for benchmarks).
+ *
+ * @param content Listing to schedule
+ * @return int* Entry indices in stat order, allocated from content->arena if it
+ *         has one (otherwise the caller frees); NULL if the listing has no inode
+ *         numbers, reordering is disabled or allocation fails, in which case
+ *         entries should be stat'ed in listing order
+ */
+int *directory_stat_order(const DirectoryContent *content);
+
 /**
  * @brief Free memory allocated for DirectoryContent structure
+ *
+ * Does nothing for arena-backed content; destroy the arena instead.
  * 
  * @param content DirectoryContent structure to free
  */
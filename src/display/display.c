@@ -1,9 +1,14 @@
+#define _DEFAULT_SOURCE
 #include "display.h"
 #include "file_info.h"
+#include "utils/decimal.h"
 #include "utils/path.h"
+#include "utils/writer.h"
+#include "xattr/xattr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -32,7 +37,8 @@ static int get_terminal_width(void) {
     return 80;
 }
 
-void display_normal(const char **entries, int count, int show_size, const char *dir_path) {
+void display_normal(const char **entries, int count, int show_size, const char *dir_path,
+                    const int *stat_order) {
     if (entries == NULL || count == 0) {
         return;
     }
@@ -53,14 +59,15 @@ void display_normal(const char **entries, int count, int show_size, const char *
             return;
         }
         
-        // First pass: collect all file sizes
-        for (int i = 0; i < count; i++) {
+        // First pass: collect all file sizes (in stat order, stored by index)
+        for (int k = 0; k < count; k++) {
+            int i = stat_order != NULL ? stat_order[k] : k;
             file_blocks[i] = 0;
             if (entries[i] != NULL) {
-                char *full_path = construct_full_path(dir_path, entries[i]);
-                if (full_path != NULL) {
+                char full_path[PATH_BUFFER_SIZE];
+                if (join_path(full_path, sizeof(full_path), dir_path, entries[i]) == 0) {
                     struct stat stat_info;
-                    if (stat(full_path, &stat_info) == 0) {
+                    if (fstatat(AT_FDCWD, full_path, &stat_info, file_info_stat_flags()) == 0) {
                         // Only calculate size for regular files (not directories)
                         // ls -s shows 0 for directories
                         if (S_ISREG(stat_info.st_mode)) {
@@ -69,7 +76,6 @@ void display_normal(const char **entries, int count, int show_size, const char *
                             total_blocks += file_blocks[i];
                         }
                     }
-                    free(full_path);
                 }
             }
         }
@@ -100,139 +106,368 @@ void display_normal(const char **entries, int count, int show_size, const char *
         }
     }
 
+    int column_width;
+    int num_rows;
+    int num_columns = compute_column_layout(max_name_len, count, &column_width, &num_rows);
+
+    // Display in column-major order (like ls command)
+    for (int row = 0; row < num_rows; row++) {
+        for (int col = 0; col < num_columns; col++) {
+            int index = col * num_rows + row;
+
+            if (index < count && entries[index] != NULL) {
+                // Left-align the filename in its column
+                printf("%-*s", column_width, entries[index]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+int compute_column_layout(int max_name_len, int count, int *column_width, int *num_rows) {
     // Get terminal width
     int terminal_width = get_terminal_width();
 
     // Calculate column width: max filename length + 2 spaces for padding
-    int column_width = max_name_len + 2;
+    *column_width = max_name_len + 2;
 
     // Calculate number of columns
-    int num_columns = terminal_width / column_width;
+    int num_columns = terminal_width / *column_width;
     if (num_columns < 1) {
         num_columns = 1;
     }
 
     // Calculate number of rows needed
-    int num_rows = (count + num_columns - 1) / num_columns;  // Ceiling division
+    *num_rows = (count + num_columns - 1) / num_columns;  // Ceiling division
+    return num_columns;
+}
 
-    // Display in column-major order (like ls command)
-    for (int row = 0; row < num_rows; row++) {
-        for (int col = 0; col < num_columns; col++) {
-            int index = col * num_rows + row;
+/**
+ * @brief Numeric fields of one long-format row, formatted once
+ */
+typedef struct {
+    char links[DECIMAL_BUFFER_SIZE];
+    char size[DECIMAL_BUFFER_SIZE];      // Bytes, or a human-readable size
+    char blocks[DECIMAL_BUFFER_SIZE];    // With LONG_FORMAT_BLOCKS
+    char owner_id[DECIMAL_BUFFER_SIZE];  // With LONG_FORMAT_NUMERIC
+    char group_id[DECIMAL_BUFFER_SIZE];
+    const char *owner;                   // Owner column text (a name or owner_id)
+    const char *group;                   // Group column text (a name or group_id)
+    int links_length;
+    int size_length;
+    int blocks_length;
+    int owner_length;
+    int group_length;
+    long long block_count;
+    char children[DECIMAL_BUFFER_SIZE + 1];  // Child count, with a '+' if capped
+    int children_length;                     // 0 without --count-children
+} LongRowCells;
 
-            if (index < count && entries[index] != NULL) {
-                // Left-align the filename in its column
-                printf("%-*s", column_width, entries[index]);
-            }
-        }
-        printf("\n");
+/**
+ * @brief Write position in a row buffer; bytes past capacity are counted, not written
+ */
+typedef struct {
+    char *buffer;
+    size_t capacity;
+    size_t length;
+} RowCursor;
+
+static void row_put(RowCursor *row, const char *text, size_t length) {
+    if (row->length < row->capacity) {
+        size_t room = row->capacity - row->length;
+        memcpy(row->buffer + row->length, text, length < room ? length : room);
     }
+    row->length += length;
 }
 
-void display_long_format(FileInfo *file_infos, int count, int human_readable) {
-    if (file_infos == NULL) {
+static void row_pad(RowCursor *row, int count) {
+    if (count <= 0) {
         return;
     }
+    if (row->length < row->capacity) {
+        size_t room = row->capacity - row->length;
+        memset(row->buffer + row->length, ' ', (size_t)count < room ? (size_t)count : room);
+    }
+    row->length += (size_t)count;
+}
 
-    // First, collect all file info and calculate maximum field widths
-    int max_links = 0;
-    int max_owner_len = 0;
-    int max_group_len = 0;
-    int max_size_str_len = 0;
+long long long_format_blocks(const FileInfo *info) {
+    // Same rule as display_normal(): regular files only
+    if (!S_ISREG(info->stat_info.st_mode)) {
+        return 0;
+    }
+    return (info->size + 511) / 512;
+}
 
-    // Calculate maximum size string length for human-readable or regular format
-    char size_buffer[16];
-    for (int i = 0; i < count; i++) {
-        // Count digits in link count
-        int link_digits = 1;
-        int temp_links = file_infos[i].link_count;
-        while (temp_links >= 10) {
-            link_digits++;
-            temp_links /= 10;
-        }
-        if (link_digits > max_links) {
-            max_links = link_digits;
-        }
+/**
+ * @brief Cells of an entry whose metadata never arrived: '?' throughout
+ */
+static void fill_unknown_cells(const FileInfo *info, LongRowCells *cells) {
+    strcpy(cells->links, "?");
+    strcpy(cells->size, "?");
+    strcpy(cells->blocks, "?");
+    cells->links_length = 1;
+    cells->size_length = 1;
+    cells->blocks_length = 1;
+    cells->block_count = 0;
+    cells->owner = info->owner != NULL ? info->owner : "";
+    cells->group = info->group != NULL ? info->group : "";
+    cells->owner_length = (int)strlen(cells->owner);
+    cells->group_length = (int)strlen(cells->group);
+}
 
-        // Check owner name length
-        if (file_infos[i].owner != NULL) {
-            int owner_len = (int)strlen(file_infos[i].owner);
-            if (owner_len > max_owner_len) {
-                max_owner_len = owner_len;
-            }
+/**
+ * @brief Child count cell: the count, '-' for non-directories, '?' if unreadable
+ */
+static void fill_children_cell(const FileInfo *info, LongRowCells *cells) {
+    if (info->children >= 0) {
+        cells->children_length = format_decimal((unsigned long long)info->children,
+                                                cells->children);
+        if (info->children_capped) {
+            cells->children[cells->children_length++] = '+';
         }
+    } else if (info->children == CHILDREN_NOT_COUNTED) {
+        cells->children_length = 0;
+    } else {
+        cells->children[0] = info->children == CHILDREN_NOT_DIRECTORY ? '-' : '?';
+        cells->children_length = 1;
+    }
+}
 
-        // Check group name length
-        if (file_infos[i].group != NULL) {
-            int group_len = (int)strlen(file_infos[i].group);
-            if (group_len > max_group_len) {
-                max_group_len = group_len;
-            }
-        }
+// One formatter per combination of LONG_FORMAT_* flags
+#define LONG_ROW_SUFFIX plain
+#define LONG_ROW_HUMAN 0
+#define LONG_ROW_BLOCKS 0
+#define LONG_ROW_NUMERIC 0
+#include "long_row_impl.h"
 
-        // Calculate size string length
-        if (human_readable) {
-            format_human_readable_size(file_infos[i].size, size_buffer, sizeof(size_buffer));
-            int size_str_len = (int)strlen(size_buffer);
-            if (size_str_len > max_size_str_len) {
-                max_size_str_len = size_str_len;
-            }
-        } else {
-            // Calculate digits in size
-            int size_digits = 1;
-            long long temp_size = file_infos[i].size;
-            while (temp_size >= 10) {
-                size_digits++;
-                temp_size /= 10;
-            }
-            if (size_digits > max_size_str_len) {
-                max_size_str_len = size_digits;
-            }
+#define LONG_ROW_SUFFIX human
+#define LONG_ROW_HUMAN 1
+#define LONG_ROW_BLOCKS 0
+#define LONG_ROW_NUMERIC 0
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX blocks
+#define LONG_ROW_HUMAN 0
+#define LONG_ROW_BLOCKS 1
+#define LONG_ROW_NUMERIC 0
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX human_blocks
+#define LONG_ROW_HUMAN 1
+#define LONG_ROW_BLOCKS 1
+#define LONG_ROW_NUMERIC 0
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX numeric
+#define LONG_ROW_HUMAN 0
+#define LONG_ROW_BLOCKS 0
+#define LONG_ROW_NUMERIC 1
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX human_numeric
+#define LONG_ROW_HUMAN 1
+#define LONG_ROW_BLOCKS 0
+#define LONG_ROW_NUMERIC 1
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX blocks_numeric
+#define LONG_ROW_HUMAN 0
+#define LONG_ROW_BLOCKS 1
+#define LONG_ROW_NUMERIC 1
+#include "long_row_impl.h"
+
+#define LONG_ROW_SUFFIX human_blocks_numeric
+#define LONG_ROW_HUMAN 1
+#define LONG_ROW_BLOCKS 1
+#define LONG_ROW_NUMERIC 1
+#include "long_row_impl.h"
+
+/**
+ * @brief The two halves of a specialized row formatter
+ */
+typedef struct {
+    void (*fill_cells)(const FileInfo *info, LongRowCells *cells);
+    int (*write_row)(const FileInfo *info, const LongRowCells *cells,
+                     const LongFormatWidths *widths, char *buffer, size_t buffer_size);
+} LongRowFormatter;
+
+// Indexed by the LONG_FORMAT_* flags
+static const LongRowFormatter g_long_row_formatters[8] = {
+    {fill_cells_plain, write_row_plain},
+    {fill_cells_human, write_row_human},
+    {fill_cells_blocks, write_row_blocks},
+    {fill_cells_human_blocks, write_row_human_blocks},
+    {fill_cells_numeric, write_row_numeric},
+    {fill_cells_human_numeric, write_row_human_numeric},
+    {fill_cells_blocks_numeric, write_row_blocks_numeric},
+    {fill_cells_human_blocks_numeric, write_row_human_blocks_numeric}
+};
+
+static const LongRowFormatter *long_row_formatter(int flags) {
+    return &g_long_row_formatters[flags & (LONG_FORMAT_HUMAN | LONG_FORMAT_BLOCKS |
+                                           LONG_FORMAT_NUMERIC)];
+}
+
+/**
+ * @brief Widen the columns to fit one row
+ */
+static void fit_widths(const FileInfo *info, const LongRowCells *cells, LongFormatWidths *widths) {
+    if (cells->links_length > widths->links) {
+        widths->links = cells->links_length;
+    }
+    if (cells->owner_length > widths->owner) {
+        widths->owner = cells->owner_length;
+    }
+    if (cells->group_length > widths->group) {
+        widths->group = cells->group_length;
+    }
+    if (cells->size_length > widths->size) {
+        widths->size = cells->size_length;
+    }
+    if (cells->blocks_length > widths->blocks) {
+        widths->blocks = cells->blocks_length;
+    }
+    if (cells->children_length > widths->children) {
+        widths->children = cells->children_length;
+    }
+    if (info->checksum != NULL) {
+        int checksum_len = (int)strlen(info->checksum);
+        if (checksum_len > widths->checksum) {
+            widths->checksum = checksum_len;
+        }
+    }
+    // Like ls, the marker column is only there if some entry has a marker
+    if (info->xattrs > 0) {
+        widths->marker = 1;
+    }
+    if (info->context != NULL) {
+        int context_len = (int)strlen(info->context);
+        if (context_len > widths->context) {
+            widths->context = context_len;
         }
     }
+}
+
+void compute_long_format_widths(const FileInfo *file_infos, int count, int flags,
+                                LongFormatWidths *widths) {
+    memset(widths, 0, sizeof(LongFormatWidths));
+    if (file_infos == NULL) {
+        return;
+    }
 
-    // Display each file in long format
+    const LongRowFormatter *formatter = long_row_formatter(flags);
+    LongRowCells cells;
+    cells.blocks_length = 0;
     for (int i = 0; i < count; i++) {
-        // Permissions
-        printf("%s ", file_infos[i].permissions);
+        formatter->fill_cells(&file_infos[i], &cells);
+        fit_widths(&file_infos[i], &cells, widths);
+    }
+}
 
-        // Link count
-        printf("%*d ", max_links, file_infos[i].link_count);
+int format_long_row(const FileInfo *info, const LongFormatWidths *widths, int flags,
+                    char *buffer, size_t buffer_size) {
+    const LongRowFormatter *formatter = long_row_formatter(flags);
+    LongRowCells cells;
+    formatter->fill_cells(info, &cells);
+    return formatter->write_row(info, &cells, widths, buffer, buffer_size);
+}
 
-        // Owner (left-aligned)
-        if (file_infos[i].owner != NULL) {
-            printf("%-*s ", max_owner_len, file_infos[i].owner);
-        } else {
-            printf("%-*s ", max_owner_len, "");
+/**
+ * @brief Append one row and its newline to the output, formatting it in place
+ */
+static void output_row(Writer *output, const LongRowFormatter *formatter, const FileInfo *info,
+                       const LongRowCells *cells, const LongFormatWidths *widths) {
+    // The formatter also writes a terminator, so a row needs its length plus 2 bytes
+    size_t room;
+    char *space = writer_space(output, &room);
+    int length = formatter->write_row(info, cells, widths, space, room - 1);
+    if ((size_t)length + 2 > room) {
+        writer_flush(output);
+        space = writer_space(output, &room);
+        length = formatter->write_row(info, cells, widths, space, room - 1);
+        if ((size_t)length + 2 > room) {
+            // Longer than the whole buffer: format it on its own
+            char *long_row = (char *)malloc((size_t)length + 1);
+            if (long_row != NULL) {
+                formatter->write_row(info, cells, widths, long_row, (size_t)length + 1);
+                writer_put(output, long_row, (size_t)length);
+                free(long_row);
+            }
+            writer_put(output, "\n", 1);
+            return;
         }
+    }
+    space[length] = '\n';
+    writer_commit(output, (size_t)length + 1);
+}
 
-        // Group (left-aligned)
-        if (file_infos[i].group != NULL) {
-            printf("%-*s ", max_group_len, file_infos[i].group);
-        } else {
-            printf("%-*s ", max_group_len, "");
-        }
+void display_long_format(FileInfo *file_infos, int count, int flags) {
+    if (file_infos == NULL) {
+        return;
+    }
 
-        // Size (right-aligned)
-        if (human_readable) {
-            format_human_readable_size(file_infos[i].size, size_buffer, sizeof(size_buffer));
-            printf("%*s ", max_size_str_len, size_buffer);
-        } else {
-            printf("%*lld ", max_size_str_len, file_infos[i].size);
+    const LongRowFormatter *formatter = long_row_formatter(flags);
+    LongRowCells *cells = (LongRowCells *)malloc((count > 0 ? count : 1) * sizeof(LongRowCells));
+    if (cells == NULL) {
+        // Fallback: measure, then format every row a second time
+        LongFormatWidths widths;
+        compute_long_format_widths(file_infos, count, flags, &widths);
+        if (flags & LONG_FORMAT_BLOCKS) {
+            long long total_blocks = 0;
+            for (int i = 0; i < count; i++) {
+                total_blocks += long_format_blocks(&file_infos[i]);
+            }
+            printf("total %lld\n", total_blocks);
         }
-
-        // Date
-        if (file_infos[i].date_string != NULL) {
-            printf("%s ", file_infos[i].date_string);
-        } else {
-            printf("            ");
+        for (int i = 0; i < count; i++) {
+            print_long_row(&file_infos[i], &widths, flags);
         }
+        return;
+    }
 
-        // File name
-        if (file_infos[i].name != NULL) {
-            printf("%s", file_infos[i].name);
-        }
+    // First pass: format each row's fields once and measure the columns
+    LongFormatWidths widths;
+    memset(&widths, 0, sizeof(LongFormatWidths));
+    long long total_blocks = 0;
+    for (int i = 0; i < count; i++) {
+        cells[i].blocks_length = 0;
+        cells[i].block_count = 0;
+        formatter->fill_cells(&file_infos[i], &cells[i]);
+        fit_widths(&file_infos[i], &cells[i], &widths);
+        total_blocks += cells[i].block_count;
+    }
 
-        printf("\n");
+    // Second pass: assemble the rows from the formatted fields
+    if (flags & LONG_FORMAT_BLOCKS) {
+        printf("total %lld\n", total_blocks);
+    }
+    Writer output;
+    writer_init(&output, stdout);
+    for (int i = 0; i < count; i++) {
+        output_row(&output, formatter, &file_infos[i], &cells[i], &widths);
+    }
+    writer_flush(&output);
+    free(cells);
+}
+
+void print_long_row(const FileInfo *info, const LongFormatWidths *widths, int flags) {
+    char row[1024];
+    int length = format_long_row(info, widths, flags, row, sizeof(row));
+    if (length < 0) {
+        return;
+    }
+
+    if ((size_t)length < sizeof(row)) {
+        fwrite(row, 1, (size_t)length, stdout);
+    } else {
+        // Unusually long owner/group/name: format into a heap buffer
+        char *long_row = (char *)malloc((size_t)length + 1);
+        if (long_row != NULL) {
+            format_long_row(info, widths, flags, long_row, (size_t)length + 1);
+            fwrite(long_row, 1, (size_t)length, stdout);
+            free(long_row);
+        }
     }
+    putchar('\n');
 }
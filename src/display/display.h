@@ -1,8 +1,30 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+#include <stddef.h>
+
 #include "file_info.h"
 
+// Long-format layout flags (combine with |); each combination has its own row formatter
+#define LONG_FORMAT_HUMAN 1      // Sizes in human-readable format (-h)
+#define LONG_FORMAT_BLOCKS 2     // Size in 512-byte blocks before each row (-s)
+#define LONG_FORMAT_NUMERIC 4    // Numeric user and group IDs instead of names (-n)
+
+/**
+ * @brief Column widths shared by all rows of a long-format listing
+ */
+typedef struct {
+    int links;   // Width of the hard link count column
+    int owner;   // Width of the owner column
+    int group;   // Width of the group column
+    int size;    // Width of the size column
+    int checksum;  // Width of the checksum column (0: no checksum column)
+    int children;  // Width of the child count column (0: no child count column)
+    int blocks;  // Width of the block count column (with LONG_FORMAT_BLOCKS)
+    int marker;  // 1 if the permissions are followed by an ACL/context marker ('+' or '.')
+    int context;   // Width of the security context column (0: no context column)
+} LongFormatWidths;
+
 /**
  * @brief Display files in normal format (just names)
  * 
@@ -10,16 +32,75 @@
  * @param count Number of files
  * @param show_size If non-zero, display file size in blocks before each filename
  * @param dir_path Directory path needed to get file sizes
+ * @param stat_order Order in which to stat entries for show_size (see
+ *        directory_stat_order()), or NULL for listing order
  */
-void display_normal(const char **entries, int count, int show_size, const char *dir_path);
+void display_normal(const char **entries, int count, int show_size, const char *dir_path,
+                    const int *stat_order);
 
 /**
  * @brief Display files in long format (detailed information)
+ *
+ * Every row's numeric fields are formatted once, into fixed-size buffers,
+ * while the column widths are measured; the rows are then assembled straight
+ * into an output buffer. With LONG_FORMAT_BLOCKS a "total" line comes first.
  * 
  * @param file_infos Array of FileInfo structures
  * @param count Number of files
- * @param human_readable If non-zero, display file sizes in human-readable format
+ * @param flags LONG_FORMAT_* flags
+ */
+void display_long_format(FileInfo *file_infos, int count, int flags);
+
+/**
+ * @brief Lay out names in columns the way display_normal() does
+ *
+ * @param max_name_len Length of the longest name
+ * @param count Number of names
+ * @param column_width Receives the width of each column, padding included
+ * @param num_rows Receives the number of rows
+ * @return int Number of columns
+ */
+int compute_column_layout(int max_name_len, int count, int *column_width, int *num_rows);
+
+/**
+ * @brief Print one long-format row followed by a newline
+ *
+ * @param info File information to print
+ * @param widths Column widths
+ * @param flags LONG_FORMAT_* flags
+ */
+void print_long_row(const FileInfo *info, const LongFormatWidths *widths, int flags);
+
+/**
+ * @brief Compute the column widths needed to align a long-format listing
+ *
+ * @param file_infos Array of FileInfo structures
+ * @param count Number of files
+ * @param flags LONG_FORMAT_* flags
+ * @param widths Receives the column widths
+ */
+void compute_long_format_widths(const FileInfo *file_infos, int count, int flags,
+                                LongFormatWidths *widths);
+
+/**
+ * @brief Blocks shown for an entry by -s: 512-byte blocks of a regular file, 0 otherwise
+ *
+ * @param info File information
+ * @return long long Block count
+ */
+long long long_format_blocks(const FileInfo *info);
+
+/**
+ * @brief Format one long-format row (without the trailing newline)
+ *
+ * @param info File information to format
+ * @param widths Column widths (zero widths mean no padding)
+ * @param flags LONG_FORMAT_* flags
+ * @param buffer Destination buffer
+ * @param buffer_size Size of the destination buffer
+ * @return int Length of the full row as snprintf() reports it (may exceed buffer_size - 1)
  */
-void display_long_format(FileInfo *file_infos, int count, int human_readable);
+int format_long_row(const FileInfo *info, const LongFormatWidths *widths, int flags,
+                    char *buffer, size_t buffer_size);
 
 #endif
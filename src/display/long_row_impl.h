@@ -0,0 +1,141 @@
+/*
+ * Long-format row formatter, instantiated by display.c once per combination
+ * of LONG_FORMAT_* flags. Before each inclusion, define:
+ *
+ *   LONG_ROW_SUFFIX   Name suffix of the generated functions
+ *   LONG_ROW_HUMAN    1 for human-readable sizes
+ *   LONG_ROW_BLOCKS   1 for the block count column
+ *   LONG_ROW_NUMERIC  1 for numeric user and group IDs
+ *
+ * These three options are resolved here by the preprocessor, so the generated
+ * functions do not test them per field. The optional columns are still tested
+ * on every row, from their widths. That covers the -Z marker and context,
+ * --count-children and --checksum. Each is one branch that goes the same way
+ * for the whole listing, and specializing them too would take the 8
+ * instances to 128. All four macros are undefined at the end.
+ */
+
+#define LONG_ROW_PASTE(name, suffix) name##_##suffix
+#define LONG_ROW_EXPAND(name, suffix) LONG_ROW_PASTE(name, suffix)
+#define LONG_ROW_FUNCTION(name) LONG_ROW_EXPAND(name, LONG_ROW_SUFFIX)
+
+/**
+ * @brief Format the numeric fields of one row and pick its owner and group text
+ */
+static void LONG_ROW_FUNCTION(fill_cells)(const FileInfo *info, LongRowCells *cells) {
+    fill_children_cell(info, cells);
+    if (info->metadata_missing) {
+        fill_unknown_cells(info, cells);
+        return;
+    }
+
+    cells->links_length = format_decimal((unsigned long long)info->link_count, cells->links);
+#if LONG_ROW_HUMAN
+    cells->size_length = format_human_readable_size(info->size, cells->size, sizeof(cells->size));
+#else
+    cells->size_length = format_decimal((unsigned long long)info->size, cells->size);
+#endif
+#if LONG_ROW_BLOCKS
+    cells->block_count = long_format_blocks(info);
+    cells->blocks_length = format_decimal((unsigned long long)cells->block_count, cells->blocks);
+#endif
+#if LONG_ROW_NUMERIC
+    // Entries without metadata have no IDs; keep their (empty) names
+    if (info->owner != NULL) {
+        cells->owner_length = format_decimal((unsigned long long)info->stat_info.st_uid,
+                                             cells->owner_id);
+        cells->group_length = format_decimal((unsigned long long)info->stat_info.st_gid,
+                                             cells->group_id);
+        cells->owner = cells->owner_id;
+        cells->group = cells->group_id;
+        return;
+    }
+#endif
+    cells->owner = info->owner != NULL ? info->owner : "";
+    cells->group = info->group != NULL ? info->group : "";
+    cells->owner_length = (int)strlen(cells->owner);
+    cells->group_length = (int)strlen(cells->group);
+}
+
+/**
+ * @brief Assemble one row (without the newline) from its cells
+ *
+ * @return int Length of the full row; only buffer_size - 1 bytes are written
+ */
+static int LONG_ROW_FUNCTION(write_row)(const FileInfo *info, const LongRowCells *cells,
+                                        const LongFormatWidths *widths, char *buffer,
+                                        size_t buffer_size) {
+    RowCursor row = {buffer, buffer_size > 0 ? buffer_size - 1 : 0, 0};
+
+#if LONG_ROW_BLOCKS
+    // Block count (right-aligned) first, like ls -ls
+    row_pad(&row, widths->blocks - cells->blocks_length);
+    row_put(&row, cells->blocks, (size_t)cells->blocks_length);
+    row_put(&row, " ", 1);
+#endif
+
+    // Permissions (with the ACL/context marker), link count, owner, group and security
+    // context (left-aligned, with -Z), size and child count (right-aligned, with
+    // --count-children), date (or blanks of the same width), checksum (with --checksum)
+    // and name, with its target for a symbolic link
+    row_put(&row, info->permissions, strlen(info->permissions));
+    if (widths->marker) {
+        char marker = info->xattrs > 0 ? xattr_marker(info->xattrs) : ' ';
+        row_put(&row, &marker, 1);
+    }
+    row_put(&row, " ", 1);
+    row_pad(&row, widths->links - cells->links_length);
+    row_put(&row, cells->links, (size_t)cells->links_length);
+    row_put(&row, " ", 1);
+    row_put(&row, cells->owner, (size_t)cells->owner_length);
+    row_pad(&row, widths->owner - cells->owner_length);
+    row_put(&row, " ", 1);
+    row_put(&row, cells->group, (size_t)cells->group_length);
+    row_pad(&row, widths->group - cells->group_length);
+    row_put(&row, " ", 1);
+    if (widths->context > 0) {
+        const char *context = info->context != NULL ? info->context : "?";
+        size_t context_length = strlen(context);
+        row_put(&row, context, context_length);
+        row_pad(&row, widths->context - (int)context_length);
+        row_put(&row, " ", 1);
+    }
+    row_pad(&row, widths->size - cells->size_length);
+    row_put(&row, cells->size, (size_t)cells->size_length);
+    row_put(&row, " ", 1);
+    if (widths->children > 0) {
+        row_pad(&row, widths->children - cells->children_length);
+        row_put(&row, cells->children, (size_t)cells->children_length);
+        row_put(&row, " ", 1);
+    }
+    const char *date = info->date_string != NULL ? info->date_string : "           ";
+    row_put(&row, date, strlen(date));
+    row_put(&row, " ", 1);
+    if (widths->checksum > 0) {
+        const char *checksum = info->checksum != NULL ? info->checksum : "";
+        size_t checksum_length = strlen(checksum);
+        row_put(&row, checksum, checksum_length);
+        row_pad(&row, widths->checksum - (int)checksum_length);
+        row_put(&row, " ", 1);
+    }
+    if (info->name != NULL) {
+        row_put(&row, info->name, strlen(info->name));
+    }
+    if (info->link_target != NULL) {
+        row_put(&row, " -> ", 4);
+        row_put(&row, info->link_target, strlen(info->link_target));
+    }
+
+    if (buffer_size > 0) {
+        buffer[row.length < row.capacity ? row.length : row.capacity] = '\0';
+    }
+    return (int)row.length;
+}
+
+#undef LONG_ROW_FUNCTION
+#undef LONG_ROW_EXPAND
+#undef LONG_ROW_PASTE
+#undef LONG_ROW_SUFFIX
+#undef LONG_ROW_HUMAN
+#undef LONG_ROW_BLOCKS
+#undef LONG_ROW_NUMERIC
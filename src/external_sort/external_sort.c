@@ -0,0 +1,565 @@
+#define _POSIX_C_SOURCE 200809L
+#include "external_sort.h"
+#include "file_info.h"
+#include "filter/filter.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read buffer per run while merging, and the fan-in bounds it implies
+#define RUN_BUFFER_MIN (16 * 1024)
+#define RUN_BUFFER_MAX (1024 * 1024)
+#define MAX_FAN_IN 256
+
+// Runs kept open while reading; beyond this they are merged early to save descriptors
+#define MAX_OPEN_RUNS 512
+
+// Name bytes per entry assumed when splitting the budget between entries and names
+#define EXPECTED_NAME_BYTES 32
+
+// Global variables for qsort callback functions
+static SortMode g_external_mode = SORT_MODE_ALPHA;
+static int g_external_reverse = 0;
+
+/*
+ * Run record layout (all single bytes unless noted):
+ *   name length, DT_* type, mtime valid flag,
+ *   [int64 mtime, only when runs are sorted by time], name bytes (no terminator)
+ */
+
+/**
+ * @brief Order two entries the way sort_directory_content() does
+ *
+ * Entries whose mtime could not be read fall back to name order.
+ */
+static int compare_external(const char *name_a, int valid_a, time_t mtime_a,
+                            const char *name_b, int valid_b, time_t mtime_b,
+                            SortMode mode, int reverse) {
+    SortMode effective = (mode == SORT_MODE_MTIME && valid_a && valid_b) ? SORT_MODE_MTIME
+                                                                         : SORT_MODE_ALPHA;
+    return compare_entries(name_a, mtime_a, name_b, mtime_b, effective, reverse);
+}
+
+/**
+ * @brief Wrapper for qsort to compare buffered entries
+ */
+static int compare_keys(const void *a, const void *b) {
+    const ExternalKey *key_a = (const ExternalKey *)a;
+    const ExternalKey *key_b = (const ExternalKey *)b;
+    return compare_external(key_a->name, key_a->mtime_valid, key_a->mtime,
+                            key_b->name, key_b->mtime_valid, key_b->mtime,
+                            g_external_mode, g_external_reverse);
+}
+
+/**
+ * @brief Check whether run records carry an mtime
+ */
+static int runs_have_mtime(const ExternalSort *sorter) {
+    return sorter->mode == SORT_MODE_MTIME && !sorter->unsorted;
+}
+
+/**
+ * @brief Append one record to a run
+ *
+ * @return int 0 on success, -1 on write error
+ */
+static int write_record(SpillWriter *writer, const char *name, unsigned char type,
+                        int mtime_valid, time_t mtime, int with_mtime) {
+    size_t name_length = strlen(name);
+    unsigned char header[3];
+    header[0] = (unsigned char)name_length;
+    header[1] = type;
+    header[2] = (unsigned char)(mtime_valid != 0);
+
+    if (spill_write(writer, header, sizeof(header)) != 0) {
+        return -1;
+    }
+    if (with_mtime) {
+        int64_t stored = (int64_t)mtime;
+        if (spill_write(writer, &stored, sizeof(stored)) != 0) {
+            return -1;
+        }
+    }
+    return spill_write(writer, name, name_length);
+}
+
+/**
+ * @brief Read the next record of a run into its head
+ *
+ * @return int 1 if a record was read, 0 at the end of the run, -1 on error
+ */
+static int advance_run(ExternalRun *run, int with_mtime) {
+    unsigned char header[3];
+    size_t got = spill_read(&run->reader, header, sizeof(header));
+    if (got == 0 && !run->reader.error) {
+        run->exhausted = 1;
+        return 0;
+    }
+    if (got != sizeof(header)) {
+        return -1;
+    }
+
+    run->current.type = header[1];
+    run->current.mtime_valid = header[2];
+    run->current.mtime = 0;
+    if (with_mtime) {
+        int64_t stored;
+        if (spill_read(&run->reader, &stored, sizeof(stored)) != sizeof(stored)) {
+            return -1;
+        }
+        run->current.mtime = (time_t)stored;
+    }
+
+    size_t name_length = header[0];
+    if (spill_read(&run->reader, run->current.name, name_length) != name_length) {
+        return -1;
+    }
+    run->current.name[name_length] = '\0';
+    return 1;
+}
+
+/**
+ * @brief Check whether run a's head comes before run b's
+ *
+ * Exhausted runs sort last; ties go to the earlier run.
+ */
+static int run_before(const ExternalSort *sorter, const ExternalRun *runs, int a, int b) {
+    if (runs[a].exhausted) {
+        return 0;
+    }
+    if (runs[b].exhausted) {
+        return 1;
+    }
+
+    int result = compare_external(runs[a].current.name, runs[a].current.mtime_valid,
+                                  runs[a].current.mtime, runs[b].current.name,
+                                  runs[b].current.mtime_valid, runs[b].current.mtime,
+                                  sorter->mode, sorter->reverse);
+    return result < 0 || (result == 0 && a < b);
+}
+
+/**
+ * @brief Play the tournament below a node, recording losers on the way up
+ *
+ * Nodes 1..count-1 are internal and store the loser of their match; nodes
+ * count..2*count-1 are the runs themselves.
+ *
+ * @return int Index of the run winning this subtree
+ */
+static int build_tree(const ExternalSort *sorter, const ExternalRun *runs, int *tree, int count,
+                      int node) {
+    if (node >= count) {
+        return node - count;
+    }
+
+    int left = build_tree(sorter, runs, tree, count, 2 * node);
+    int right = build_tree(sorter, runs, tree, count, 2 * node + 1);
+    if (run_before(sorter, runs, left, right)) {
+        tree[node] = right;
+        return left;
+    }
+    tree[node] = left;
+    return right;
+}
+
+/**
+ * @brief Replay the matches on the path of a run whose head just changed
+ */
+static void replay_tree(const ExternalSort *sorter, const ExternalRun *runs, int *tree,
+                        int count, int run) {
+    int winner = run;
+    for (int node = (run + count) / 2; node >= 1; node /= 2) {
+        if (run_before(sorter, runs, tree[node], winner)) {
+            int loser = winner;
+            winner = tree[node];
+            tree[node] = loser;
+        }
+    }
+    tree[0] = winner;
+}
+
+/**
+ * @brief Open readers on a group of runs and load their first records
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int open_runs(const ExternalSort *sorter, const int *fds, int count, ExternalRun *runs) {
+    for (int i = 0; i < count; i++) {
+        runs[i].exhausted = 0;
+        if (spill_reader_init(&runs[i].reader, fds[i], 0, sorter->run_buffer_size) != 0) {
+            for (int j = 0; j < i; j++) {
+                spill_reader_close(&runs[j].reader);
+            }
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (advance_run(&runs[i], runs_have_mtime(sorter)) < 0) {
+            for (int j = 0; j < count; j++) {
+                spill_reader_close(&runs[j].reader);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Take the next entry from a group of open runs
+ *
+ * Sorted runs are merged through the loser tree; unsorted runs are
+ * concatenated in the order they were written.
+ *
+ * @return int 1 if an entry was returned, 0 at the end, -1 on error
+ */
+static int take_next(const ExternalSort *sorter, ExternalRun *runs, int *tree, int count,
+                     int *next_run, ExternalEntry *entry) {
+    if (sorter->unsorted) {
+        while (*next_run < count && runs[*next_run].exhausted) {
+            (*next_run)++;
+        }
+        if (*next_run == count) {
+            return 0;
+        }
+        *entry = runs[*next_run].current;
+        return advance_run(&runs[*next_run], 0) < 0 ? -1 : 1;
+    }
+
+    int winner = tree[0];
+    if (runs[winner].exhausted) {
+        return 0;
+    }
+    *entry = runs[winner].current;
+    if (advance_run(&runs[winner], runs_have_mtime(sorter)) < 0) {
+        return -1;
+    }
+    replay_tree(sorter, runs, tree, count, winner);
+    return 1;
+}
+
+/**
+ * @brief Merge a group of runs into one new run
+ *
+ * @return int File descriptor of the new run, or -1 on error
+ */
+static int merge_group(const ExternalSort *sorter, const int *fds, int count) {
+    ExternalRun *runs = (ExternalRun *)malloc(count * sizeof(ExternalRun));
+    int *tree = (int *)malloc(count * sizeof(int));
+    int out_fd = spill_create();
+    SpillWriter writer;
+    writer.buffer = NULL;
+    if (runs == NULL || tree == NULL || out_fd < 0 ||
+        spill_writer_init(&writer, out_fd, SPILL_BUFFER_SIZE) != 0 ||
+        open_runs(sorter, fds, count, runs) != 0) {
+        spill_writer_close(&writer);
+        if (out_fd >= 0) {
+            close(out_fd);
+        }
+        free(runs);
+        free(tree);
+        return -1;
+    }
+
+    tree[0] = build_tree(sorter, runs, tree, count, 1);
+    int next_run = 0;
+    int status;
+    ExternalEntry entry;
+    while ((status = take_next(sorter, runs, tree, count, &next_run, &entry)) == 1) {
+        if (write_record(&writer, entry.name, entry.type, entry.mtime_valid, entry.mtime,
+                         runs_have_mtime(sorter)) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    if (spill_writer_close(&writer) != 0) {
+        status = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        spill_reader_close(&runs[i].reader);
+    }
+    free(runs);
+    free(tree);
+
+    if (status != 0) {
+        close(out_fd);
+        return -1;
+    }
+    return out_fd;
+}
+
+/**
+ * @brief Merge consecutive groups of runs until at most max_runs remain
+ *
+ * Groups are consecutive so unsorted runs keep their directory order.
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int reduce_runs(ExternalSort *sorter, int max_runs) {
+    while (sorter->run_count > max_runs) {
+        int kept = 0;
+        for (int start = 0; start < sorter->run_count; start += sorter->fan_in) {
+            int group = sorter->run_count - start;
+            if (group > sorter->fan_in) {
+                group = sorter->fan_in;
+            }
+
+            if (group == 1) {
+                sorter->run_fds[kept++] = sorter->run_fds[start];
+                continue;
+            }
+
+            int merged = merge_group(sorter, sorter->run_fds + start, group);
+            if (merged < 0) {
+                return -1;
+            }
+            for (int i = start; i < start + group; i++) {
+                close(sorter->run_fds[i]);
+            }
+            sorter->run_fds[kept++] = merged;
+        }
+        sorter->run_count = kept;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sort the buffered entries and write them out as a new run
+ *
+ * Metadata filter tests and the mtime sort key are evaluated here, once per
+ * entry, using the directory descriptor.
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int spill_buffer(ExternalSort *sorter) {
+    if (sorter->run_count == sorter->run_capacity) {
+        int capacity = sorter->run_capacity > 0 ? sorter->run_capacity * 2 : 16;
+        int *fds = (int *)realloc(sorter->run_fds, capacity * sizeof(int));
+        if (fds == NULL) {
+            return -1;
+        }
+        sorter->run_fds = fds;
+        sorter->run_capacity = capacity;
+    }
+
+    // Decide metadata filters and load sort keys, compacting the buffer
+    int kept = 0;
+    for (int i = 0; i < sorter->buffer_count; i++) {
+        ExternalKey *key = &sorter->buffer[i];
+        if (filter_is_active(sorter->filter) &&
+            !filter_entry_passes(sorter->filter, sorter->dir_fd, key->name, key->type)) {
+            continue;
+        }
+
+        key->mtime_valid = 0;
+        key->mtime = 0;
+        if (runs_have_mtime(sorter)) {
+            struct stat stat_info;
+            if (fstatat(sorter->dir_fd, key->name, &stat_info, file_info_stat_flags()) == 0) {
+                key->mtime_valid = 1;
+                key->mtime = stat_info.st_mtime;
+            }
+        }
+        sorter->buffer[kept++] = *key;
+    }
+
+    if (!sorter->unsorted) {
+        g_external_mode = sorter->mode;
+        g_external_reverse = sorter->reverse;
+        qsort(sorter->buffer, kept, sizeof(ExternalKey), compare_keys);
+    }
+
+    int fd = spill_create();
+    SpillWriter writer;
+    if (fd < 0 || spill_writer_init(&writer, fd, SPILL_BUFFER_SIZE) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    int status = 0;
+    for (int i = 0; i < kept && status == 0; i++) {
+        const ExternalKey *key = &sorter->buffer[i];
+        status = write_record(&writer, key->name, key->type, key->mtime_valid, key->mtime,
+                              runs_have_mtime(sorter));
+    }
+    if (spill_writer_close(&writer) != 0 || status != 0) {
+        close(fd);
+        return -1;
+    }
+
+    sorter->run_fds[sorter->run_count++] = fd;
+    sorter->spill_count++;
+    sorter->buffer_count = 0;
+    arena_destroy(&sorter->arena);
+
+    // Keep the number of open descriptors bounded on very long listings
+    if (sorter->run_count >= MAX_OPEN_RUNS) {
+        return reduce_runs(sorter, sorter->fan_in);
+    }
+    return 0;
+}
+
+int external_sort_init(ExternalSort *sorter, const char *dir_path, const struct Filter *filter,
+                       SortMode mode, int reverse, int unsorted, size_t mem_limit) {
+    memset(sorter, 0, sizeof(ExternalSort));
+    sorter->dir_path = dir_path;
+    sorter->filter = filter;
+    sorter->mode = mode;
+    sorter->reverse = reverse;
+    sorter->unsorted = unsorted;
+    sorter->mem_limit = mem_limit;
+    arena_init(&sorter->arena);
+
+    // Split the budget once between the entry array and the names it points to
+    sorter->max_buffered = (int)(mem_limit / (sizeof(ExternalKey) + EXPECTED_NAME_BYTES));
+    if (sorter->max_buffered < 1) {
+        sorter->max_buffered = 1;
+    }
+    sorter->names_limit = mem_limit - sorter->max_buffered * sizeof(ExternalKey);
+
+    // Merge as many runs at once as fit in the budget with a useful buffer each
+    size_t fan_in = mem_limit / RUN_BUFFER_MIN;
+    if (fan_in > MAX_FAN_IN) {
+        fan_in = MAX_FAN_IN;
+    }
+    sorter->fan_in = fan_in < 2 ? 2 : (int)fan_in;
+    sorter->run_buffer_size = mem_limit / sorter->fan_in;
+    if (sorter->run_buffer_size > RUN_BUFFER_MAX) {
+        sorter->run_buffer_size = RUN_BUFFER_MAX;
+    }
+
+    sorter->dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return sorter->dir_fd >= 0 ? 0 : -1;
+}
+
+int external_sort_add(const char *name, unsigned char type, ino_t inode, void *context) {
+    ExternalSort *sorter = (ExternalSort *)context;
+
+    if (sorter->buffer_count == sorter->buffer_capacity) {
+        int capacity = sorter->buffer_capacity > 0 ? sorter->buffer_capacity * 2 : 1024;
+        if (capacity > sorter->max_buffered) {
+            capacity = sorter->max_buffered;
+        }
+        ExternalKey *buffer = (ExternalKey *)realloc(sorter->buffer,
+                                                     capacity * sizeof(ExternalKey));
+        if (buffer == NULL) {
+            return -1;
+        }
+        sorter->buffer = buffer;
+        sorter->buffer_capacity = capacity;
+    }
+
+    char *copy = arena_strdup(&sorter->arena, name);
+    if (copy == NULL) {
+        return -1;
+    }
+    ExternalKey *key = &sorter->buffer[sorter->buffer_count++];
+    key->name = copy;
+    key->type = type;
+    key->inode = inode;
+    key->mtime_valid = 0;
+    key->mtime = 0;
+
+    // Spill once the entry array or the names have used up their share
+    if (sorter->buffer_count == sorter->max_buffered ||
+        sorter->arena.bytes_allocated > sorter->names_limit) {
+        return spill_buffer(sorter);
+    }
+    return 0;
+}
+
+int external_sort_spilled(const ExternalSort *sorter) {
+    return sorter->run_count > 0;
+}
+
+DirectoryContent external_sort_content(ExternalSort *sorter) {
+    DirectoryContent content;
+    content.entries = NULL;
+    content.types = NULL;
+    content.inodes = NULL;
+    content.count = 0;
+    content.arena = &sorter->arena;
+
+    // At least one slot, so an empty listing is still non-NULL
+    size_t slots = sorter->buffer_count > 0 ? (size_t)sorter->buffer_count : 1;
+    content.entries = (char **)arena_alloc(&sorter->arena, slots * sizeof(char *));
+    content.types = (unsigned char *)arena_alloc(&sorter->arena, slots);
+    content.inodes = (ino_t *)arena_alloc(&sorter->arena, slots * sizeof(ino_t));
+    if (content.entries == NULL || content.types == NULL || content.inodes == NULL) {
+        content.entries = NULL;
+        content.types = NULL;
+        content.inodes = NULL;
+        return content;
+    }
+
+    for (int i = 0; i < sorter->buffer_count; i++) {
+        content.entries[i] = sorter->buffer[i].name;
+        content.types[i] = sorter->buffer[i].type;
+        content.inodes[i] = sorter->buffer[i].inode;
+    }
+    content.count = sorter->buffer_count;
+    return content;
+}
+
+int external_sort_finish(ExternalSort *sorter) {
+    if (sorter->buffer_count > 0 && spill_buffer(sorter) != 0) {
+        return -1;
+    }
+    // The in-memory buffer is no longer needed while merging
+    free(sorter->buffer);
+    sorter->buffer = NULL;
+    sorter->buffer_capacity = 0;
+
+    if (reduce_runs(sorter, sorter->fan_in) != 0) {
+        return -1;
+    }
+
+    int count = sorter->run_count;
+    sorter->runs = (ExternalRun *)malloc((count > 0 ? count : 1) * sizeof(ExternalRun));
+    sorter->tree = (int *)malloc((count > 0 ? count : 1) * sizeof(int));
+    if (sorter->runs == NULL || sorter->tree == NULL) {
+        return -1;
+    }
+    if (open_runs(sorter, sorter->run_fds, count, sorter->runs) != 0) {
+        return -1;
+    }
+    sorter->merge_count = count;
+    sorter->next_run = 0;
+    if (count > 0) {
+        sorter->tree[0] = build_tree(sorter, sorter->runs, sorter->tree, count, 1);
+    }
+    return 0;
+}
+
+int external_sort_next(ExternalSort *sorter, ExternalEntry *entry) {
+    if (sorter->merge_count == 0) {
+        return 0;
+    }
+    return take_next(sorter, sorter->runs, sorter->tree, sorter->merge_count,
+                     &sorter->next_run, entry);
+}
+
+void external_sort_close(ExternalSort *sorter) {
+    for (int i = 0; i < sorter->merge_count; i++) {
+        spill_reader_close(&sorter->runs[i].reader);
+    }
+    for (int i = 0; i < sorter->run_count; i++) {
+        close(sorter->run_fds[i]);
+    }
+    if (sorter->dir_fd >= 0) {
+        close(sorter->dir_fd);
+    }
+    free(sorter->runs);
+    free(sorter->tree);
+    free(sorter->run_fds);
+    free(sorter->buffer);
+    arena_destroy(&sorter->arena);
+    memset(sorter, 0, sizeof(ExternalSort));
+    sorter->dir_fd = -1;
+}
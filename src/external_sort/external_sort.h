@@ -0,0 +1,166 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "directory_reader.h"
+#include "sort/sort.h"
+#include "utils/arena.h"
+#include "utils/spill.h"
+
+struct Filter;  // Compiled entry filter (filter/filter.h)
+
+// Smallest accepted --mem-limit budget
+#define EXTERNAL_SORT_MIN_MEMORY (64 * 1024)
+
+// Longest entry name (NAME_MAX) plus the terminator
+#define EXTERNAL_NAME_SIZE 256
+
+/**
+ * @brief One entry as read back from a spilled run
+ */
+typedef struct {
+    char name[EXTERNAL_NAME_SIZE];  // Entry name
+    unsigned char type;             // DT_* type from readdir
+    int mtime_valid;                // Non-zero if mtime was obtained (SORT_MODE_MTIME only)
+    time_t mtime;                   // Modification time
+} ExternalEntry;
+
+/**
+ * @brief Entry buffered in memory until the next spill
+ */
+typedef struct {
+    char *name;              // Name, allocated from the sorter's arena
+    unsigned char type;      // DT_* type from readdir
+    ino_t inode;             // Inode number from readdir
+    int mtime_valid;         // Non-zero if stat succeeded (filled in at spill time)
+    time_t mtime;            // Modification time (SORT_MODE_MTIME only)
+} ExternalKey;
+
+/**
+ * @brief A spilled run being merged
+ */
+typedef struct {
+    SpillReader reader;      // Reader over the run's spill file
+    ExternalEntry current;   // Head of the run
+    int exhausted;           // Non-zero once every record has been consumed
+} ExternalRun;
+
+/**
+ * @brief Memory-bounded sorter for one directory listing
+ *
+ * Entries are buffered until the budget is used up, then sorted and written
+ * to a temporary file as a run of length-prefixed records. The budget is split
+ * once, up front, between the entry array (max_buffered entries) and their
+ * names, so every run holds about mem_limit / (sizeof(ExternalKey) + 32)
+ * entries. If nothing was
+ * spilled the buffered entries are handed back as an ordinary DirectoryContent;
+ * otherwise the runs are k-way merged through a loser tree.
+ */
+typedef struct {
+    const char *dir_path;         // Directory being listed
+    int dir_fd;                   // Descriptor for stat calls at spill time
+    const struct Filter *filter;  // Metadata filter applied before spilling (may be NULL)
+    SortMode mode;                // Sort order of the runs
+    int reverse;                  // Non-zero for -r
+    int unsorted;                 // Non-zero for -U: runs keep directory order and are concatenated
+    size_t mem_limit;             // Budget for buffered entries, in bytes
+
+    Arena arena;                  // Names of buffered entries
+    ExternalKey *buffer;          // Buffered entries
+    int buffer_count;
+    int buffer_capacity;          // Grows up to max_buffered
+    int max_buffered;             // Entries that fit in the array's share of the budget
+    size_t names_limit;           // Bytes of names that fit in the rest of the budget
+    int spill_count;              // Runs written from the buffer (for tests and benchmarks)
+
+    int *run_fds;                 // Spill files of the runs, in the order they were written
+    int run_count;
+    int run_capacity;
+
+    size_t run_buffer_size;       // Read buffer per run while merging
+    int fan_in;                   // Most runs merged at once within the budget
+    ExternalRun *runs;            // Runs of the final merge
+    int *tree;                    // Loser tree over runs; tree[0] holds the winner
+    int merge_count;              // Number of runs in the final merge
+    int next_run;                 // Run being drained (unsorted concatenation)
+} ExternalSort;
+
+/**
+ * @brief Prepare a sorter for one directory
+ *
+ * @param sorter Sorter to initialize
+ * @param dir_path Directory being listed
+ * @param filter Compiled filter whose metadata tests are applied to spilled entries (may be NULL)
+ * @param mode Sort mode
+ * @param reverse If non-zero, reverse the order
+ * @param unsorted If non-zero, keep directory order
+ * @param mem_limit Memory budget in bytes (at least EXTERNAL_SORT_MIN_MEMORY)
+ * @return int 0 on success, -1 if the directory cannot be opened
+ */
+int external_sort_init(ExternalSort *sorter, const char *dir_path, const struct Filter *filter,
+                       SortMode mode, int reverse, int unsorted, size_t mem_limit);
+
+/**
+ * @brief Add one entry, spilling a sorted run if the budget is exceeded
+ *
+ * Has the signature of DirectoryEntryCallback so it can be passed to
+ * read_directory_each() with the sorter as context.
+ *
+ * @param name Entry name
+ * @param type DT_* type from readdir
+ * @param inode Inode number from readdir
+ * @param context ExternalSort to add to
+ * @return int 0 on success, -1 on error
+ */
+int external_sort_add(const char *name, unsigned char type, ino_t inode, void *context);
+
+/**
+ * @brief Check whether any run was written to disk
+ *
+ * @param sorter Sorter
+ * @return int Non-zero if the entries no longer fit in memory
+ */
+int external_sort_spilled(const ExternalSort *sorter);
+
+/**
+ * @brief Hand back the buffered entries when nothing was spilled
+ *
+ * The entries are unsorted and not yet checked against metadata filters, like
+ * the result of read_directory_filtered(). They stay owned by the sorter.
+ *
+ * @param sorter Sorter with no spilled runs
+ * @return DirectoryContent Buffered entries (count 0 if there are none; entries is
+ *         NULL only if allocation fails)
+ */
+DirectoryContent external_sort_content(ExternalSort *sorter);
+
+/**
+ * @brief Spill the remaining entries and prepare the final merge
+ *
+ * Runs beyond the merge fan-in the budget allows are merged into longer runs
+ * first, so any number of runs can be handled.
+ *
+ * @param sorter Sorter with at least one spilled run
+ * @return int 0 on success, -1 on error
+ */
+int external_sort_finish(ExternalSort *sorter);
+
+/**
+ * @brief Take the next entry of the merged listing
+ *
+ * @param sorter Finished sorter
+ * @param entry Receives the entry
+ * @return int 1 if an entry was returned, 0 at the end, -1 on a read error
+ */
+int external_sort_next(ExternalSort *sorter, ExternalEntry *entry);
+
+/**
+ * @brief Release the buffer, the runs and the directory descriptor
+ *
+ * @param sorter Sorter to close
+ */
+void external_sort_close(ExternalSort *sorter);
+
+#endif
@@ -0,0 +1,339 @@
+#define _POSIX_C_SOURCE 200809L
+#include "merged_listing.h"
+#include "child_count/child_count.h"
+#include "utils/path.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Record layout, one per entry in merged order:
+ *   name length (1 byte), name bytes (no terminator), then
+ *   with show_size:   int64 block count;
+ *   with long_format: stat valid flag (1 byte), [struct stat if valid],
+ *                     [checksum length (1 byte) and hex digest, with a checksum],
+ *                     [uint16 target length and target, for a valid link],
+ *                     [XATTR_* bits (1 byte), context length (1 byte) and
+ *                      context, with xattrs],
+ *                     [int64 child count and int children_capped, with
+ *                      count_children]
+ */
+
+/**
+ * @brief Widen the listing's column widths to fit one more row
+ */
+static void widen(LongFormatWidths *widths, const LongFormatWidths *row) {
+    widths->links = row->links > widths->links ? row->links : widths->links;
+    widths->owner = row->owner > widths->owner ? row->owner : widths->owner;
+    widths->group = row->group > widths->group ? row->group : widths->group;
+    widths->size = row->size > widths->size ? row->size : widths->size;
+    widths->blocks = row->blocks > widths->blocks ? row->blocks : widths->blocks;
+    widths->children = row->children > widths->children ? row->children : widths->children;
+    widths->marker |= row->marker;
+    widths->context = row->context > widths->context ? row->context : widths->context;
+}
+
+/**
+ * @brief Gather and write the long-format part of one entry's record
+ *
+ * @return int 0 on success, non-zero on a write error
+ */
+static int record_long_entry(MergedListing *listing, const ExternalSort *sorter,
+                             const ExternalEntry *entry, char *count_buffer,
+                             SpillWriter *writer) {
+    const MergedListingConfig *config = &listing->config;
+    struct stat stat_info;
+    unsigned char valid = fstatat(sorter->dir_fd, entry->name, &stat_info,
+                                  file_info_stat_flags()) == 0;
+    int write_error = spill_write(writer, &valid, 1);
+    if (valid) {
+        write_error |= spill_write(writer, &stat_info, sizeof(stat_info));
+    }
+
+    // The checksum is hashed now so reading the record back only prints
+    if (config->checksum != CHECKSUM_NONE) {
+        char hex[CHECKSUM_HEX_SIZE] = "-";
+        if (!valid || (S_ISREG(stat_info.st_mode) &&
+                       checksum_file_at(sorter->dir_fd, entry->name,
+                                        (ChecksumAlgorithm)config->checksum, hex) != 0)) {
+            strcpy(hex, "?");
+        }
+        unsigned char hex_length = (unsigned char)strlen(hex);
+        write_error |= spill_write(writer, &hex_length, 1);
+        write_error |= spill_write(writer, hex, hex_length);
+        if (hex_length > listing->widths.checksum) {
+            listing->widths.checksum = hex_length;
+        }
+    }
+
+    FileInfo info = valid ? file_info_from_stat(&stat_info, entry->name, NULL)
+                          : file_info_unknown(entry->name, NULL);
+
+    // A link's target is recorded after the checksum
+    if (valid && S_ISLNK(stat_info.st_mode)) {
+        file_info_read_link(sorter->dir_fd, entry->name, &info, NULL);
+        unsigned short target_length =
+            info.link_target != NULL ? (unsigned short)strlen(info.link_target) : 0;
+        write_error |= spill_write(writer, &target_length, sizeof(target_length));
+        if (target_length > 0) {
+            write_error |= spill_write(writer, info.link_target, target_length);
+        }
+    }
+
+    // Then the ACL marker and security context
+    char context[XATTR_CONTEXT_SIZE] = "";
+    if (config->xattrs != 0) {
+        char path[PATH_BUFFER_SIZE];
+        int found = 0;
+        if (valid && join_path(path, sizeof(path), sorter->dir_path, entry->name) == 0) {
+            found = xattr_fetch(path, config->xattrs, file_info_stat_flags() == 0, context,
+                                sizeof(context));
+        }
+        unsigned char xattr_record[2] = {(unsigned char)found, (unsigned char)strlen(context)};
+        write_error |= spill_write(writer, xattr_record, sizeof(xattr_record));
+        if (xattr_record[1] > 0) {
+            write_error |= spill_write(writer, context, xattr_record[1]);
+        }
+        if (valid) {
+            info.xattrs = found;
+            if (config->xattrs & XATTR_CONTEXT) {
+                info.context = (found & XATTR_CONTEXT) ? context : "?";
+            }
+        }
+    }
+
+    // Subdirectories are counted now too, one at a time on this thread
+    if (config->count_children) {
+        child_count_entry(sorter->dir_fd, entry->type, config->show_all, config->count_limit,
+                          count_buffer, CHILD_COUNT_BUFFER_SIZE, &info);
+        write_error |= spill_write(writer, &info.children, sizeof(info.children));
+        write_error |= spill_write(writer, &info.children_capped, sizeof(info.children_capped));
+    }
+
+    LongFormatWidths row_widths;
+    compute_long_format_widths(&info, 1, config->long_flags, &row_widths);
+    widen(&listing->widths, &row_widths);
+    listing->total_blocks += long_format_blocks(&info);
+    free_file_info(info);
+    return write_error;
+}
+
+int merged_listing_build(MergedListing *listing, ExternalSort *sorter,
+                         const MergedListingConfig *config) {
+    memset(listing, 0, sizeof(MergedListing));
+    listing->config = *config;
+    listing->fd = spill_create();
+    SpillWriter writer;
+    if (listing->fd < 0 || spill_writer_init(&writer, listing->fd, SPILL_BUFFER_SIZE) != 0) {
+        merged_listing_close(listing);
+        return -1;
+    }
+
+    char *count_buffer = config->count_children && config->long_format
+                             ? (char *)malloc(CHILD_COUNT_BUFFER_SIZE) : NULL;
+    int write_error = 0;
+    int merge_status;
+    ExternalEntry entry;
+    while ((merge_status = external_sort_next(sorter, &entry)) == 1) {
+        unsigned char name_length = (unsigned char)strlen(entry.name);
+        write_error |= spill_write(&writer, &name_length, 1);
+        write_error |= spill_write(&writer, entry.name, name_length);
+
+        if (config->long_format) {
+            write_error |= record_long_entry(listing, sorter, &entry, count_buffer, &writer);
+        } else if (config->show_size) {
+            // Size in 512-byte blocks for regular files only, like display_normal()
+            struct stat stat_info;
+            long long blocks = 0;
+            if (fstatat(sorter->dir_fd, entry.name, &stat_info, file_info_stat_flags()) == 0 &&
+                S_ISREG(stat_info.st_mode)) {
+                blocks = (stat_info.st_size + 511) / 512;
+            }
+            listing->total_blocks += blocks;
+            write_error |= spill_write(&writer, &blocks, sizeof(blocks));
+        }
+
+        if (name_length > listing->max_name_len) {
+            listing->max_name_len = name_length;
+        }
+        listing->count++;
+    }
+    write_error |= spill_writer_close(&writer);
+    free(count_buffer);
+
+    if (merge_status < 0 || write_error) {
+        merged_listing_close(listing);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the long-format part of a record into the cursor's row
+ *
+ * @return int 0 on success, -1 on a short or malformed record
+ */
+static int read_long_entry(MergedCursor *cursor) {
+    const MergedListingConfig *config = &cursor->listing->config;
+    SpillReader *reader = &cursor->reader;
+
+    unsigned char valid;
+    struct stat stat_info;
+    if (spill_read(reader, &valid, 1) != 1 ||
+        (valid && spill_read(reader, &stat_info, sizeof(stat_info)) != sizeof(stat_info))) {
+        return -1;
+    }
+    unsigned char hex_length = 0;
+    if (config->checksum != CHECKSUM_NONE &&
+        (spill_read(reader, &hex_length, 1) != 1 || hex_length >= CHECKSUM_HEX_SIZE ||
+         spill_read(reader, cursor->checksum, hex_length) != hex_length)) {
+        return -1;
+    }
+    cursor->checksum[hex_length] = '\0';
+    unsigned short target_length = 0;
+    int is_link = valid && S_ISLNK(stat_info.st_mode);
+    if (is_link &&
+        (spill_read(reader, &target_length, sizeof(target_length)) != sizeof(target_length) ||
+         target_length >= PATH_MAX ||
+         (target_length > 0 &&
+          spill_read(reader, cursor->target, target_length) != target_length))) {
+        return -1;
+    }
+    cursor->target[target_length] = '\0';
+    unsigned char xattr_record[2] = {0, 0};
+    if (config->xattrs != 0 &&
+        (spill_read(reader, xattr_record, sizeof(xattr_record)) != sizeof(xattr_record) ||
+         (xattr_record[1] > 0 &&
+          spill_read(reader, cursor->context, xattr_record[1]) != xattr_record[1]))) {
+        return -1;
+    }
+    cursor->context[xattr_record[1]] = '\0';
+    long long children = CHILDREN_NOT_COUNTED;
+    int children_capped = 0;
+    if (config->count_children &&
+        (spill_read(reader, &children, sizeof(children)) != sizeof(children) ||
+         spill_read(reader, &children_capped, sizeof(children_capped)) !=
+             sizeof(children_capped))) {
+        return -1;
+    }
+
+    FileInfo *info = &cursor->info;
+    *info = valid ? file_info_from_stat(&stat_info, cursor->name, NULL)
+                  : file_info_unknown(cursor->name, NULL);
+    cursor->has_info = 1;
+    info->checksum = config->checksum != CHECKSUM_NONE ? cursor->checksum : NULL;
+    info->children = children;
+    info->children_capped = children_capped;
+    info->link_target = is_link && target_length > 0 ? cursor->target : NULL;
+    if (valid && config->xattrs != 0) {
+        info->xattrs = xattr_record[0];
+        if (config->xattrs & XATTR_CONTEXT) {
+            info->context = (xattr_record[0] & XATTR_CONTEXT) ? cursor->context : "?";
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Free the current row; its checksum, target and context live in the cursor
+ */
+static void release_info(MergedCursor *cursor) {
+    if (cursor->has_info) {
+        cursor->info.checksum = NULL;
+        cursor->info.link_target = NULL;
+        free_file_info(cursor->info);
+        cursor->has_info = 0;
+    }
+}
+
+int merged_cursor_next(MergedCursor *cursor) {
+    release_info(cursor);
+
+    unsigned char name_length;
+    size_t got = spill_read(&cursor->reader, &name_length, 1);
+    if (got == 0 && !cursor->reader.error) {
+        return 0;
+    }
+    if (got != 1 || spill_read(&cursor->reader, cursor->name, name_length) != name_length) {
+        return -1;
+    }
+    cursor->name[name_length] = '\0';
+
+    const MergedListingConfig *config = &cursor->listing->config;
+    if (config->long_format) {
+        return read_long_entry(cursor) == 0 ? 1 : -1;
+    }
+    if (config->show_size &&
+        spill_read(&cursor->reader, &cursor->blocks, sizeof(cursor->blocks)) !=
+            sizeof(cursor->blocks)) {
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * @brief Start a cursor at a byte offset of the listing's file
+ */
+static int open_cursor(const MergedListing *listing, off_t offset, size_t buffer_size,
+                       MergedCursor *cursor) {
+    cursor->listing = listing;
+    cursor->has_info = 0;
+    cursor->blocks = 0;
+    cursor->name[0] = '\0';
+    return spill_reader_init(&cursor->reader, listing->fd, offset, buffer_size);
+}
+
+int merged_listing_cursors(const MergedListing *listing, int stride, int cursor_count,
+                           MergedCursor *cursors) {
+    if (cursor_count == 1) {
+        return open_cursor(listing, 0, 0, &cursors[0]);
+    }
+
+    // Find where each cursor starts in one scan; the cursors share the read-ahead
+    off_t *offsets = (off_t *)malloc(cursor_count * sizeof(off_t));
+    MergedCursor *scan = (MergedCursor *)malloc(sizeof(MergedCursor));
+    if (offsets == NULL || scan == NULL || open_cursor(listing, 0, 0, scan) != 0) {
+        free(offsets);
+        free(scan);
+        return -1;
+    }
+    int status = 0;
+    for (int i = 0; i < listing->count && i / stride < cursor_count && status == 0; i++) {
+        if (i % stride == 0) {
+            offsets[i / stride] = spill_reader_tell(&scan->reader);
+        }
+        status = merged_cursor_next(scan) == 1 ? 0 : -1;
+    }
+    merged_cursor_close(scan);
+    free(scan);
+
+    int opened = 0;
+    while (status == 0 && opened < cursor_count) {
+        status = open_cursor(listing, offsets[opened], 16 * 1024, &cursors[opened]);
+        if (status == 0) {
+            opened++;
+        }
+    }
+    if (status != 0) {
+        for (int i = 0; i < opened; i++) {
+            merged_cursor_close(&cursors[i]);
+        }
+    }
+    free(offsets);
+    return status;
+}
+
+void merged_cursor_close(MergedCursor *cursor) {
+    release_info(cursor);
+    if (cursor->reader.buffer != NULL) {
+        spill_reader_close(&cursor->reader);
+    }
+}
+
+void merged_listing_close(MergedListing *listing) {
+    if (listing->fd >= 0) {
+        close(listing->fd);
+    }
+    listing->fd = -1;
+}
@@ -0,0 +1,109 @@
+#ifndef MERGED_LISTING_H
+#define MERGED_LISTING_H
+
+#include <limits.h>
+
+#include "checksum/checksum.h"
+#include "display.h"
+#include "external_sort/external_sort.h"
+#include "file_info.h"
+#include "utils/spill.h"
+#include "xattr/xattr.h"
+
+/**
+ * @brief What to record for each entry of a merged listing
+ */
+typedef struct {
+    int long_format;         // Record metadata for long-format rows
+    int show_size;           // Record block counts (-s without -l)
+    int long_flags;          // LONG_FORMAT_* flags the rows will be printed with
+    int checksum;            // ChecksumAlgorithm to hash with, or CHECKSUM_NONE
+    int xattrs;              // XATTR_* to fetch (0: none)
+    int count_children;      // Count the entries of subdirectories
+    int show_all;            // Count hidden entries too (-a)
+    long long count_limit;   // Stop counting a subdirectory at this many entries (0: no limit)
+} MergedListingConfig;
+
+/**
+ * @brief A merged listing that did not fit in memory, recorded in a spill file
+ *
+ * The merge is consumed once: each entry is stat'ed, hashed, counted and so on
+ * as configured, written to the file as one record, and measured for the
+ * column widths. Cursors then read the records back in merged order.
+ */
+typedef struct {
+    MergedListingConfig config;
+    int fd;                  // Spill file holding one record per entry
+    int count;               // Number of entries
+    int max_name_len;        // Length of the longest name
+    long long total_blocks;  // Sum of the entries' blocks, for the "total" line
+    LongFormatWidths widths; // Column widths of the long-format rows
+} MergedListing;
+
+/**
+ * @brief Reader over the records of a merged listing
+ *
+ * The fields describing the current entry stay valid until the next call to
+ * merged_cursor_next() or merged_cursor_close().
+ */
+typedef struct {
+    const MergedListing *listing;
+    SpillReader reader;
+    char name[EXTERNAL_NAME_SIZE];       // Name of the current entry
+    long long blocks;                    // Its blocks (show_size only)
+    FileInfo info;                       // Its long-format row (long_format only)
+    int has_info;                        // Non-zero while info holds allocations
+    char checksum[CHECKSUM_HEX_SIZE];    // Storage behind info.checksum
+    char target[PATH_MAX];               // Storage behind info.link_target
+    char context[XATTR_CONTEXT_SIZE];    // Storage behind info.context
+} MergedCursor;
+
+/**
+ * @brief Consume a finished external sort into a recorded merged listing
+ *
+ * @param listing Listing to fill in
+ * @param sorter Finished sorter (see external_sort_finish())
+ * @param config What to record for each entry
+ * @return int 0 on success, -1 on error (nothing to close)
+ */
+int merged_listing_build(MergedListing *listing, ExternalSort *sorter,
+                         const MergedListingConfig *config);
+
+/**
+ * @brief Open cursors at every stride-th entry: 0, stride, 2 * stride, ...
+ *
+ * Column-major output reads one cursor per column; a single cursor with any
+ * stride reads the whole listing.
+ *
+ * @param listing Recorded listing
+ * @param stride Entries between the starts of consecutive cursors
+ * @param cursor_count Number of cursors to open
+ * @param cursors Receives the cursors
+ * @return int 0 on success, -1 on error (no cursor is left open)
+ */
+int merged_listing_cursors(const MergedListing *listing, int stride, int cursor_count,
+                           MergedCursor *cursors);
+
+/**
+ * @brief Read the next entry at a cursor
+ *
+ * @param cursor Cursor to advance
+ * @return int 1 if an entry was read, 0 at the end, -1 on a read error
+ */
+int merged_cursor_next(MergedCursor *cursor);
+
+/**
+ * @brief Release a cursor and its current entry
+ *
+ * @param cursor Cursor to close
+ */
+void merged_cursor_close(MergedCursor *cursor);
+
+/**
+ * @brief Remove the recorded listing
+ *
+ * @param listing Listing to close
+ */
+void merged_listing_close(MergedListing *listing);
+
+#endif
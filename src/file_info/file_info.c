@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include "file_info.h"
+#include "utils/decimal.h"
 #include <sys/stat.h>
 #include <pwd.h>
 #include <grp.h>
@@ -8,6 +9,12 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+// Follow symbolic links (-L); set once per run before any metadata is read
+static int g_follow_links = 0;
 
 void mode_to_permissions(mode_t mode, char *perm_string) {
     if (perm_string == NULL) {
@@ -49,7 +56,147 @@ void mode_to_permissions(mode_t mode, char *perm_string) {
     perm_string[10] = '\0';
 }
 
+/**
+ * @brief Copy a string into the arena, or onto the heap when arena is NULL
+ */
+static char *copy_string(Arena *arena, const char *str) {
+    if (arena != NULL) {
+        return arena_strdup(arena, str);
+    }
+
+    char *copy = (char *)malloc((strlen(str) + 1) * sizeof(char));
+    if (copy != NULL) {
+        strcpy(copy, str);
+    }
+    return copy;
+}
+
+/**
+ * @brief Recently resolved user or group names, so a listing (or a --serve worker
+ *        across many listings) asks NSS once per ID instead of once per entry
+ */
+typedef struct {
+    unsigned int id;
+    int valid;
+    char name[ID_NAME_CACHE_NAME_SIZE];
+} IdNameSlot;
+
+static __thread IdNameSlot g_owner_names[ID_NAME_CACHE_SLOTS];
+static __thread IdNameSlot g_group_names[ID_NAME_CACHE_SLOTS];
+
+/**
+ * @brief Copy a cached name out, if the ID is in its slot
+ *
+ * @return int 1 if the name was cached, 0 if it has to be looked up
+ */
+static int id_name_cached(const IdNameSlot *slots, unsigned int id, char *buffer,
+                          size_t buffer_size) {
+    const IdNameSlot *slot = &slots[id % ID_NAME_CACHE_SLOTS];
+    if (!slot->valid || slot->id != id) {
+        return 0;
+    }
+    snprintf(buffer, buffer_size, "%s", slot->name);
+    return 1;
+}
+
+/**
+ * @brief Remember a looked-up name (names too long for a slot are not cached)
+ */
+static void id_name_store(IdNameSlot *slots, unsigned int id, const char *name) {
+    IdNameSlot *slot = &slots[id % ID_NAME_CACHE_SLOTS];
+    size_t length = strlen(name);
+    if (length >= sizeof(slot->name)) {
+        return;
+    }
+    memcpy(slot->name, name, length + 1);
+    slot->id = id;
+    slot->valid = 1;
+}
+
+void owner_name(uid_t uid, char *buffer, size_t buffer_size) {
+    if (id_name_cached(g_owner_names, (unsigned int)uid, buffer, buffer_size)) {
+        return;
+    }
+
+    struct passwd *pw = getpwuid(uid);
+    int length;
+    if (pw != NULL) {
+        length = snprintf(buffer, buffer_size, "%s", pw->pw_name);
+    } else {
+        // Fallback: convert UID to string if getpwuid fails
+        length = snprintf(buffer, buffer_size, "%u", (unsigned int)uid);
+    }
+    if (length >= 0 && (size_t)length < buffer_size) {
+        id_name_store(g_owner_names, (unsigned int)uid, buffer);
+    }
+}
+
+void group_name(gid_t gid, char *buffer, size_t buffer_size) {
+    if (id_name_cached(g_group_names, (unsigned int)gid, buffer, buffer_size)) {
+        return;
+    }
+
+    struct group *gr = getgrgid(gid);
+    int length;
+    if (gr != NULL) {
+        length = snprintf(buffer, buffer_size, "%s", gr->gr_name);
+    } else {
+        // Fallback: convert GID to string if getgrgid fails
+        length = snprintf(buffer, buffer_size, "%u", (unsigned int)gid);
+    }
+    if (length >= 0 && (size_t)length < buffer_size) {
+        id_name_store(g_group_names, (unsigned int)gid, buffer);
+    }
+}
+
+void file_info_set_follow_links(int follow) {
+    g_follow_links = follow;
+}
+
+int file_info_stat_flags(void) {
+    return g_follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+}
+
+void file_info_read_link(int dir_fd, const char *path, FileInfo *info, Arena *arena) {
+    if (info->name == NULL || !S_ISLNK(info->stat_info.st_mode)) {
+        return;
+    }
+
+    char target[PATH_MAX];
+    ssize_t length = readlinkat(dir_fd, path, target, sizeof(target) - 1);
+    if (length < 0) {
+        return;
+    }
+    target[length] = '\0';
+    info->link_target = copy_string(arena, target);
+}
+
 FileInfo get_file_info(const char *filepath, const char *filename) {
+    struct stat stat_info;
+
+    if (filepath == NULL || filename == NULL ||
+        fstatat(AT_FDCWD, filepath, &stat_info, file_info_stat_flags()) != 0) {
+        return file_info_from_stat(NULL, NULL, NULL);
+    }
+
+    FileInfo info = file_info_from_stat(&stat_info, filename, NULL);
+    file_info_read_link(AT_FDCWD, filepath, &info, NULL);
+    return info;
+}
+
+FileInfo get_file_info_at(int dir_fd, const char *filename, Arena *arena) {
+    struct stat stat_info;
+
+    if (filename == NULL || fstatat(dir_fd, filename, &stat_info, file_info_stat_flags()) != 0) {
+        return file_info_from_stat(NULL, NULL, arena);
+    }
+
+    FileInfo info = file_info_from_stat(&stat_info, filename, arena);
+    file_info_read_link(dir_fd, filename, &info, arena);
+    return info;
+}
+
+FileInfo file_info_from_stat(const struct stat *stat_info, const char *filename, Arena *arena) {
     FileInfo info;
 
     // Initialize all fields to safe defaults
@@ -62,23 +209,25 @@ FileInfo get_file_info(const char *filepath, const char *filename) {
     info.date_string = NULL;
     info.link_count = 0;
     memset(&info.stat_info, 0, sizeof(struct stat));
+    info.metadata_missing = 0;
+    info.checksum = NULL;
+    info.children = CHILDREN_NOT_COUNTED;
+    info.children_capped = 0;
+    info.link_target = NULL;
+    info.xattrs = -1;
+    info.context = NULL;
 
-    if (filepath == NULL || filename == NULL) {
+    if (stat_info == NULL || filename == NULL) {
         return info;
     }
 
-    // Get file statistics
-    if (stat(filepath, &info.stat_info) != 0) {
-        return info;
-    }
+    info.stat_info = *stat_info;
 
     // Copy filename
-    size_t name_len = strlen(filename);
-    info.name = (char *)malloc((name_len + 1) * sizeof(char));
+    info.name = copy_string(arena, filename);
     if (info.name == NULL) {
         return info;
     }
-    strcpy(info.name, filename);
 
     // Get permissions string and file type
     mode_to_permissions(info.stat_info.st_mode, info.permissions);
@@ -90,48 +239,18 @@ FileInfo get_file_info(const char *filepath, const char *filename) {
     // Get hard link count
     info.link_count = (int)info.stat_info.st_nlink;
 
-    // Get owner name from UID
-    struct passwd *pw = getpwuid(info.stat_info.st_uid);
-    if (pw != NULL) {
-        size_t owner_len = strlen(pw->pw_name);
-        info.owner = (char *)malloc((owner_len + 1) * sizeof(char));
-        if (info.owner != NULL) {
-            strcpy(info.owner, pw->pw_name);
-        }
-    } else {
-        // Fallback: convert UID to string if getpwuid fails
-        char uid_str[32];
-        snprintf(uid_str, sizeof(uid_str), "%u", info.stat_info.st_uid);
-        size_t uid_str_len = strlen(uid_str);
-        info.owner = (char *)malloc((uid_str_len + 1) * sizeof(char));
-        if (info.owner != NULL) {
-            strcpy(info.owner, uid_str);
-        }
-    }
-
-    // Get group name from GID
-    struct group *gr = getgrgid(info.stat_info.st_gid);
-    if (gr != NULL) {
-        size_t group_len = strlen(gr->gr_name);
-        info.group = (char *)malloc((group_len + 1) * sizeof(char));
-        if (info.group != NULL) {
-            strcpy(info.group, gr->gr_name);
-        }
-    } else {
-        // Fallback: convert GID to string if getgrgid fails
-        char gid_str[32];
-        snprintf(gid_str, sizeof(gid_str), "%u", info.stat_info.st_gid);
-        size_t gid_str_len = strlen(gid_str);
-        info.group = (char *)malloc((gid_str_len + 1) * sizeof(char));
-        if (info.group != NULL) {
-            strcpy(info.group, gid_str);
-        }
-    }
+    // Get owner and group names from UID and GID
+    char id_name[256];
+    owner_name(info.stat_info.st_uid, id_name, sizeof(id_name));
+    info.owner = copy_string(arena, id_name);
+    group_name(info.stat_info.st_gid, id_name, sizeof(id_name));
+    info.group = copy_string(arena, id_name);
 
     // Format modification date as "MMM DD HH:MM"
     struct tm *time_info = localtime(&info.stat_info.st_mtime);
     if (time_info != NULL) {
-        info.date_string = (char *)malloc(13 * sizeof(char));
+        info.date_string = (char *)(arena != NULL ? arena_alloc(arena, 13)
+                                                  : malloc(13 * sizeof(char)));
         if (info.date_string != NULL) {
             const char *months[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
@@ -146,6 +265,19 @@ FileInfo get_file_info(const char *filepath, const char *filename) {
     return info;
 }
 
+FileInfo file_info_unknown(const char *filename, Arena *arena) {
+    FileInfo info = file_info_from_stat(NULL, NULL, arena);
+    info.metadata_missing = 1;
+    info.type_char = '?';
+    strcpy(info.permissions, "??????????");
+    info.name = copy_string(arena, filename);
+    info.owner = copy_string(arena, "?");
+    info.group = copy_string(arena, "?");
+    // Same width as "MMM DD HH:MM"
+    info.date_string = copy_string(arena, "           ?");
+    return info;
+}
+
 void free_file_info(FileInfo info) {
     if (info.name != NULL) {
         free(info.name);
@@ -159,33 +291,64 @@ void free_file_info(FileInfo info) {
     if (info.date_string != NULL) {
         free(info.date_string);
     }
-}
-
-void format_human_readable_size(long long size, char *buffer, size_t buffer_size) {
-    if (buffer == NULL || buffer_size == 0) {
-        return;
+    if (info.checksum != NULL) {
+        free(info.checksum);
     }
-
-    const char *units[] = {"B", "K", "M", "G", "T", "P"};
-    int unit_index = 0;
-    double size_double = (double)size;
-
-    // Convert to appropriate unit (B, K, M, G, T, P)
-    while (size_double >= 1024.0 && unit_index < 5) {
-        size_double /= 1024.0;
-        unit_index++;
+    if (info.link_target != NULL) {
+        free(info.link_target);
     }
+}
+
+int format_human_readable_size(long long size, char *buffer, size_t buffer_size) {
+    static const char units[] = "BKMGTP";
+    char text[32];
+    int length;
 
-    // Format the string based on unit
-    if (unit_index == 0) {
+    if (size < 1024) {
         // Bytes: show as integer
-        snprintf(buffer, buffer_size, "%lld%s", (long long)size_double, units[unit_index]);
+        length = 0;
+        unsigned long long magnitude = (unsigned long long)size;
+        if (size < 0) {
+            text[length++] = '-';
+            magnitude = 0ULL - magnitude;
+        }
+        length += format_decimal(magnitude, text + length);
+        text[length++] = units[0];
     } else {
-        // KB and above: show with 1 decimal place if less than 10, otherwise integer
-        if (size_double < 10.0) {
-            snprintf(buffer, buffer_size, "%.1f%s", size_double, units[unit_index]);
+        // Largest unit (up to P) the size reaches, in integers only
+        int unit_index = 0;
+        unsigned long long unit = 1;
+        while (unit_index < 5 && (unsigned long long)size >= unit * 1024) {
+            unit *= 1024;
+            unit_index++;
+        }
+        unsigned long long whole = (unsigned long long)size / unit;
+        unsigned long long rest = (unsigned long long)size % unit;
+
+        // One decimal place below 10, otherwise none; ties round to even like printf
+        if (whole < 10) {
+            unsigned long long tenths = whole * 10 + rest * 10 / unit;
+            unsigned long long remainder = rest * 10 % unit;
+            if (remainder * 2 > unit || (remainder * 2 == unit && (tenths & 1))) {
+                tenths++;
+            }
+            length = format_decimal(tenths / 10, text);
+            text[length++] = '.';
+            text[length++] = (char)('0' + tenths % 10);
         } else {
-            snprintf(buffer, buffer_size, "%.0f%s", size_double, units[unit_index]);
+            if (rest * 2 > unit || (rest * 2 == unit && (whole & 1))) {
+                whole++;
+            }
+            length = format_decimal(whole, text);
         }
+        text[length++] = units[unit_index];
+    }
+    text[length] = '\0';
+
+    if (buffer != NULL && buffer_size > 0) {
+        size_t copied = (size_t)length < buffer_size ? (size_t)length : buffer_size - 1;
+        memcpy(buffer, text, copied);
+        buffer[copied] = '\0';
     }
+    return length;
 }
@@ -4,6 +4,16 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <time.h>
+#include "utils/arena.h"
+
+// FileInfo.children values that are not counts
+#define CHILDREN_NOT_COUNTED -1     // No --count-children: no column
+#define CHILDREN_NOT_DIRECTORY -2   // Not a directory (shown as '-')
+#define CHILDREN_UNKNOWN -3         // The directory could not be read (shown as '?')
+
+// Per-thread cache of user and group names (direct mapped by ID)
+#define ID_NAME_CACHE_SLOTS 64
+#define ID_NAME_CACHE_NAME_SIZE 64
 
 /**
  * @brief Structure to hold detailed file information
@@ -18,10 +28,51 @@ typedef struct {
     char *date_string;       // Last modification date string
     int link_count;          // Number of hard links
     struct stat stat_info;   // Complete stat structure
+    int metadata_missing;    // Non-zero if the metadata never arrived (shown as '?')
+    char *checksum;          // Content digest in hex for --checksum, or NULL
+    long long children;      // Entries in a subdirectory for --count-children, or CHILDREN_*
+    int children_capped;     // Non-zero if counting stopped at --count-limit
+    char *link_target;       // Contents of a symbolic link for "name -> target", or NULL
+    int xattrs;              // XATTR_* bits the file has for -Z and --acl, or -1 if not fetched
+    const char *context;     // Security context for -Z, or NULL; shared between entries
+                             // (interned), so never freed with the FileInfo
 } FileInfo;
 
+/**
+ * @brief Choose whether metadata describes symbolic links or what they point to
+ *
+ * Links are described themselves by default, like ls -l; -L follows them.
+ * Process-wide: set once per run, before any metadata is read.
+ *
+ * @param follow Non-zero to follow links
+ */
+void file_info_set_follow_links(int follow);
+
+/**
+ * @brief Flags for fstatat() matching file_info_set_follow_links()
+ *
+ * @return int AT_SYMLINK_NOFOLLOW, or 0 when links are followed
+ */
+int file_info_stat_flags(void);
+
+/**
+ * @brief Read the target of a symbolic link into info->link_target
+ *
+ * Does nothing unless info describes a link (never with -L, where the stat
+ * data is the target's). An unreadable target is left NULL.
+ *
+ * @param dir_fd Descriptor of the directory containing the link, or AT_FDCWD
+ * @param path Name of the link within the directory
+ * @param info File information to complete
+ * @param arena Arena to allocate the target from, or NULL to use the heap
+ */
+void file_info_read_link(int dir_fd, const char *path, FileInfo *info, Arena *arena);
+
 /**
  * @brief Get detailed information about a file
+ *
+ * Symbolic links are not followed unless file_info_set_follow_links() says
+ * so; their targets are read into link_target.
  * 
  * @param filepath Full path to the file
  * @param filename Name of the file (for display)
@@ -29,13 +80,74 @@ typedef struct {
  */
 FileInfo get_file_info(const char *filepath, const char *filename);
 
+/**
+ * @brief Get detailed information about a file relative to an open directory
+ *
+ * Links are handled like get_file_info() does.
+ *
+ * @param dir_fd Descriptor of the directory containing the file
+ * @param filename Name of the file within the directory
+ * @param arena Arena to allocate the strings from, or NULL to use the heap
+ * @return FileInfo Structure containing file information, or NULL fields on error
+ */
+FileInfo get_file_info_at(int dir_fd, const char *filename, Arena *arena);
+
+/**
+ * @brief Build file information from an already obtained stat structure
+ *
+ * link_target is left NULL; see file_info_read_link().
+ *
+ * @param stat_info Stat data for the file
+ * @param filename Name of the file (for display)
+ * @param arena Arena to allocate the strings from, or NULL to use the heap
+ * @return FileInfo Structure containing file information, or NULL fields if either argument is NULL
+ */
+FileInfo file_info_from_stat(const struct stat *stat_info, const char *filename, Arena *arena);
+
+/**
+ * @brief Build file information for an entry whose metadata is not available
+ *
+ * Every field is shown as '?' (see --deadline), like ls does for entries it
+ * cannot stat.
+ *
+ * @param filename Name of the file (for display)
+ * @param arena Arena to allocate the strings from, or NULL to use the heap
+ * @return FileInfo Structure with metadata_missing set
+ */
+FileInfo file_info_unknown(const char *filename, Arena *arena);
+
 /**
  * @brief Free memory allocated in FileInfo structure
+ *
+ * Only for heap-allocated information; arena-backed strings go with the arena.
  * 
  * @param info FileInfo structure to free
  */
 void free_file_info(FileInfo info);
 
+/**
+ * @brief Name of a user as the owner column shows it
+ *
+ * Names are cached per thread for the life of the process, so a change to
+ * the user database is not seen by a process that already resolved the ID.
+ *
+ * @param uid User ID
+ * @param buffer Receives the user name, or the UID in decimal if it has no name
+ * @param buffer_size Size of the buffer
+ */
+void owner_name(uid_t uid, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Name of a group as the group column shows it
+ *
+ * Cached like owner_name().
+ *
+ * @param gid Group ID
+ * @param buffer Receives the group name, or the GID in decimal if it has no name
+ * @param buffer_size Size of the buffer
+ */
+void group_name(gid_t gid, char *buffer, size_t buffer_size);
+
 /**
  * @brief Convert file mode to permission string
  * 
@@ -46,11 +158,15 @@ void mode_to_permissions(mode_t mode, char *perm_string);
 
 /**
  * @brief Format file size in human-readable format (KB, MB, GB, etc.)
+ *
+ * Uses integer arithmetic only; the result matches "%.1f" below 10 units and
+ * "%.0f" above, as printf would round it.
  * 
  * @param size File size in bytes
  * @param buffer Buffer to store formatted string (must be at least 12 chars for "XXXX.XXGiB")
  * @param buffer_size Size of the buffer
+ * @return int Length of the full string (may exceed buffer_size - 1)
  */
-void format_human_readable_size(long long size, char *buffer, size_t buffer_size);
+int format_human_readable_size(long long size, char *buffer, size_t buffer_size);
 
 #endif
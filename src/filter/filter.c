@@ -0,0 +1,709 @@
+#define _GNU_SOURCE
+#include "filter.h"
+#include "file_info.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Maximum evaluation stack depth (nesting of the compiled expression)
+#define FILTER_MAX_DEPTH 64
+
+typedef enum {
+    OP_NAME,    // Glob match on the entry name
+    OP_TYPE,    // Entry type test
+    OP_SIZE,    // Size in bytes
+    OP_AGE,     // Seconds since last modification
+    OP_LINKS,   // Hard link count
+    OP_AND,
+    OP_OR,
+    OP_NOT
+} FilterOpcode;
+
+typedef enum {
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_LE,
+    CMP_GT,
+    CMP_GE
+} FilterCompare;
+
+/**
+ * @brief Recursive-descent parser state for --where expressions
+ */
+typedef struct {
+    const char *pos;
+    Filter *filter;
+    char *error;
+    size_t error_size;
+    int failed;
+    int nesting;       // Open parentheses and '!' the parser has recursed into
+    char token[256];   // Current value token
+} Parser;
+
+static int emit(Filter *filter, unsigned char opcode, unsigned char compare, long long operand,
+                const char *pattern) {
+    if (filter->length >= filter->capacity) {
+        int new_capacity = filter->capacity > 0 ? filter->capacity * 2 : 16;
+        FilterInstruction *program = (FilterInstruction *)realloc(
+            filter->program, new_capacity * sizeof(FilterInstruction));
+        if (program == NULL) {
+            return -1;
+        }
+        filter->program = program;
+        filter->capacity = new_capacity;
+    }
+
+    FilterInstruction *instruction = &filter->program[filter->length++];
+    instruction->opcode = opcode;
+    instruction->compare = compare;
+    instruction->operand = operand;
+    instruction->pattern = pattern;
+    return 0;
+}
+
+static void parse_error(Parser *parser, const char *message) {
+    if (!parser->failed) {
+        snprintf(parser->error, parser->error_size, "%s near '%s'", message, parser->pos);
+        parser->failed = 1;
+    }
+}
+
+static void skip_spaces(Parser *parser) {
+    while (isspace((unsigned char)*parser->pos)) {
+        parser->pos++;
+    }
+}
+
+/**
+ * @brief Consume a literal token if it is next in the input
+ */
+static int accept(Parser *parser, const char *literal) {
+    skip_spaces(parser);
+    size_t length = strlen(literal);
+    if (strncmp(parser->pos, literal, length) == 0) {
+        parser->pos += length;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a value token: a quoted string or a run of non-operator characters
+ */
+static int read_value(Parser *parser) {
+    skip_spaces(parser);
+    size_t length = 0;
+    char quote = *parser->pos;
+
+    if (quote == '"' || quote == '\'') {
+        parser->pos++;
+        while (*parser->pos != '\0' && *parser->pos != quote) {
+            if (length + 1 < sizeof(parser->token)) {
+                parser->token[length++] = *parser->pos;
+            }
+            parser->pos++;
+        }
+        if (*parser->pos != quote) {
+            parse_error(parser, "unterminated string");
+            return -1;
+        }
+        parser->pos++;
+    } else {
+        while (*parser->pos != '\0' && !isspace((unsigned char)*parser->pos) &&
+               strchr("()&|!<>=", *parser->pos) == NULL) {
+            if (length + 1 < sizeof(parser->token)) {
+                parser->token[length++] = *parser->pos;
+            }
+            parser->pos++;
+        }
+    }
+
+    parser->token[length] = '\0';
+    if (length == 0) {
+        parse_error(parser, "expected a value");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse a number with an optional unit suffix
+ *
+ * @param units Accepted suffix characters
+ * @param scales Multiplier for each suffix character
+ * @param result Receives the scaled value
+ */
+static int parse_scaled(const char *text, const char *units, const long long *scales,
+                        long long *result) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value < 0) {
+        return -1;
+    }
+
+    if (*end != '\0') {
+        const char *unit = strchr(units, toupper((unsigned char)*end));
+        if (unit == NULL || end[1] != '\0') {
+            return -1;
+        }
+        value *= scales[unit - units];
+    }
+
+    *result = value;
+    return 0;
+}
+
+static int parse_compare(Parser *parser, unsigned char *compare) {
+    if (accept(parser, "==")) {
+        *compare = CMP_EQ;
+    } else if (accept(parser, "!=")) {
+        *compare = CMP_NE;
+    } else if (accept(parser, "<=")) {
+        *compare = CMP_LE;
+    } else if (accept(parser, ">=")) {
+        *compare = CMP_GE;
+    } else if (accept(parser, "<")) {
+        *compare = CMP_LT;
+    } else if (accept(parser, ">")) {
+        *compare = CMP_GT;
+    } else {
+        parse_error(parser, "expected a comparison operator");
+        return -1;
+    }
+    return 0;
+}
+
+static void parse_expression(Parser *parser);
+
+/**
+ * @brief Parse "field op value" and emit one field test
+ */
+static void parse_comparison(Parser *parser) {
+    static const char size_units[] = "BKMGTP";
+    static const long long size_scales[] = {1LL, 1LL << 10, 1LL << 20, 1LL << 30, 1LL << 40,
+                                            1LL << 50};
+    static const char age_units[] = "SMHDW";
+    static const long long age_scales[] = {1LL, 60LL, 3600LL, 86400LL, 604800LL};
+
+    skip_spaces(parser);
+    char field[16];
+    size_t length = 0;
+    while (isalpha((unsigned char)*parser->pos) && length + 1 < sizeof(field)) {
+        field[length++] = *parser->pos++;
+    }
+    field[length] = '\0';
+
+    unsigned char compare;
+    if (length == 0) {
+        parse_error(parser, "expected a field name");
+        return;
+    }
+    if (parse_compare(parser, &compare) != 0 || read_value(parser) != 0) {
+        return;
+    }
+
+    Filter *filter = parser->filter;
+    long long operand = 0;
+    int status = 0;
+
+    if (strcmp(field, "name") == 0) {
+        if (compare != CMP_EQ && compare != CMP_NE) {
+            parse_error(parser, "name only supports == and !=");
+            return;
+        }
+        char **patterns = (char **)realloc(filter->patterns,
+                                           (filter->pattern_count + 1) * sizeof(char *));
+        char *pattern = patterns != NULL ? strdup(parser->token) : NULL;
+        if (patterns != NULL) {
+            filter->patterns = patterns;
+        }
+        if (pattern == NULL) {
+            parse_error(parser, "out of memory");
+            return;
+        }
+        filter->patterns[filter->pattern_count++] = pattern;
+        status = emit(filter, OP_NAME, compare, 0, pattern);
+    } else if (strcmp(field, "type") == 0) {
+        if ((compare != CMP_EQ && compare != CMP_NE) || strlen(parser->token) != 1 ||
+            strchr("fdlpscb", parser->token[0]) == NULL) {
+            parse_error(parser, "type expects == or != and one of f d l p s c b");
+            return;
+        }
+        filter->needs_type = 1;
+        status = emit(filter, OP_TYPE, compare, parser->token[0], NULL);
+    } else if (strcmp(field, "size") == 0) {
+        if (parse_scaled(parser->token, size_units, size_scales, &operand) != 0) {
+            parse_error(parser, "invalid size");
+            return;
+        }
+        filter->statx_mask |= STATX_SIZE;
+        status = emit(filter, OP_SIZE, compare, operand, NULL);
+    } else if (strcmp(field, "mtime") == 0) {
+        if (parse_scaled(parser->token, age_units, age_scales, &operand) != 0) {
+            parse_error(parser, "invalid age");
+            return;
+        }
+        filter->statx_mask |= STATX_MTIME;
+        status = emit(filter, OP_AGE, compare, operand, NULL);
+    } else if (strcmp(field, "links") == 0) {
+        if (parse_scaled(parser->token, "", NULL, &operand) != 0) {
+            parse_error(parser, "invalid link count");
+            return;
+        }
+        filter->statx_mask |= STATX_NLINK;
+        status = emit(filter, OP_LINKS, compare, operand, NULL);
+    } else {
+        parse_error(parser, "unknown field");
+        return;
+    }
+
+    if (status != 0) {
+        parse_error(parser, "out of memory");
+    }
+}
+
+static void parse_unary(Parser *parser) {
+    if (accept(parser, "!")) {
+        // Each '!' and '(' recurses; bound it before a long expression exhausts the stack
+        if (++parser->nesting > FILTER_MAX_DEPTH) {
+            parse_error(parser, "expression is nested too deeply");
+            return;
+        }
+        parse_unary(parser);
+        if (emit(parser->filter, OP_NOT, 0, 0, NULL) != 0) {
+            parse_error(parser, "out of memory");
+        }
+        parser->nesting--;
+    } else if (accept(parser, "(")) {
+        if (++parser->nesting > FILTER_MAX_DEPTH) {
+            parse_error(parser, "expression is nested too deeply");
+            return;
+        }
+        parse_expression(parser);
+        if (!accept(parser, ")")) {
+            parse_error(parser, "expected ')'");
+        }
+        parser->nesting--;
+    } else {
+        parse_comparison(parser);
+    }
+}
+
+static void parse_term(Parser *parser) {
+    parse_unary(parser);
+    while (!parser->failed && accept(parser, "&&")) {
+        parse_unary(parser);
+        if (emit(parser->filter, OP_AND, 0, 0, NULL) != 0) {
+            parse_error(parser, "out of memory");
+        }
+    }
+}
+
+static void parse_expression(Parser *parser) {
+    parse_term(parser);
+    while (!parser->failed && accept(parser, "||")) {
+        parse_term(parser);
+        if (emit(parser->filter, OP_OR, 0, 0, NULL) != 0) {
+            parse_error(parser, "out of memory");
+        }
+    }
+}
+
+/**
+ * @brief Emit "name==p1 || name==p2 || ..." for a list of globs
+ */
+static int emit_pattern_list(Filter *filter, const char *const *patterns, int count) {
+    for (int i = 0; i < count; i++) {
+        if (emit(filter, OP_NAME, CMP_EQ, 0, patterns[i]) != 0) {
+            return -1;
+        }
+        if (i > 0 && emit(filter, OP_OR, 0, 0, NULL) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Compute the maximum evaluation stack depth of the program
+ */
+static int program_depth(const Filter *filter) {
+    int depth = 0;
+    int max_depth = 0;
+    for (int i = 0; i < filter->length; i++) {
+        unsigned char opcode = filter->program[i].opcode;
+        if (opcode == OP_AND || opcode == OP_OR) {
+            depth--;
+        } else if (opcode != OP_NOT) {
+            depth++;
+        }
+        if (depth > max_depth) {
+            max_depth = depth;
+        }
+    }
+    return max_depth;
+}
+
+int filter_compile(Filter *filter, const char *const *includes, int include_count,
+                   const char *const *excludes, int exclude_count, const char *where,
+                   char *error, size_t error_size) {
+    memset(filter, 0, sizeof(Filter));
+    filter->now = time(NULL);
+    int parts = 0;
+
+    if (include_count > 0) {
+        if (emit_pattern_list(filter, includes, include_count) != 0) {
+            snprintf(error, error_size, "out of memory");
+            filter_free(filter);
+            return -1;
+        }
+        parts++;
+    }
+
+    if (exclude_count > 0) {
+        if (emit_pattern_list(filter, excludes, exclude_count) != 0 ||
+            emit(filter, OP_NOT, 0, 0, NULL) != 0 ||
+            (parts > 0 && emit(filter, OP_AND, 0, 0, NULL) != 0)) {
+            snprintf(error, error_size, "out of memory");
+            filter_free(filter);
+            return -1;
+        }
+        parts++;
+    }
+
+    if (where != NULL) {
+        Parser parser;
+        memset(&parser, 0, sizeof(Parser));
+        parser.pos = where;
+        parser.filter = filter;
+        parser.error = error;
+        parser.error_size = error_size;
+
+        parse_expression(&parser);
+        skip_spaces(&parser);
+        if (!parser.failed && *parser.pos != '\0') {
+            parse_error(&parser, "unexpected input");
+        }
+        if (!parser.failed && parts > 0 && emit(filter, OP_AND, 0, 0, NULL) != 0) {
+            parse_error(&parser, "out of memory");
+        }
+        if (parser.failed) {
+            filter_free(filter);
+            return -1;
+        }
+    }
+
+    if (program_depth(filter) > FILTER_MAX_DEPTH) {
+        snprintf(error, error_size, "expression is nested too deeply");
+        filter_free(filter);
+        return -1;
+    }
+
+    return 0;
+}
+
+int filter_is_active(const Filter *filter) {
+    return filter != NULL && filter->length > 0;
+}
+
+/**
+ * @brief Map a readdir type to the type letter used in expressions
+ *
+ * With -L a link is described by its target, which only a stat can tell, so
+ * its readdir type is treated as unknown.
+ *
+ * @return char Type letter, or 0 if unknown
+ */
+static char type_from_dirent(unsigned char d_type) {
+    switch (d_type) {
+        case DT_REG:
+            return 'f';
+        case DT_DIR:
+            return 'd';
+        case DT_LNK:
+            return file_info_stat_flags() != 0 ? 'l' : 0;
+        case DT_FIFO:
+            return 'p';
+        case DT_SOCK:
+            return 's';
+        case DT_CHR:
+            return 'c';
+        case DT_BLK:
+            return 'b';
+        default:
+            return 0;
+    }
+}
+
+static char type_from_mode(mode_t mode) {
+    if (S_ISREG(mode)) {
+        return 'f';
+    } else if (S_ISDIR(mode)) {
+        return 'd';
+    } else if (S_ISLNK(mode)) {
+        return 'l';
+    } else if (S_ISFIFO(mode)) {
+        return 'p';
+    } else if (S_ISSOCK(mode)) {
+        return 's';
+    } else if (S_ISCHR(mode)) {
+        return 'c';
+    } else if (S_ISBLK(mode)) {
+        return 'b';
+    }
+    return 0;
+}
+
+static FilterResult compare_values(long long value, unsigned char compare, long long operand) {
+    int result;
+    switch (compare) {
+        case CMP_EQ:
+            result = value == operand;
+            break;
+        case CMP_NE:
+            result = value != operand;
+            break;
+        case CMP_LT:
+            result = value < operand;
+            break;
+        case CMP_LE:
+            result = value <= operand;
+            break;
+        case CMP_GT:
+            result = value > operand;
+            break;
+        default:
+            result = value >= operand;
+            break;
+    }
+    return result ? FILTER_ACCEPT : FILTER_REJECT;
+}
+
+/**
+ * @brief Run the program with three-valued logic
+ *
+ * Tests whose inputs are missing (type_char == 0, stx == NULL) yield
+ * FILTER_UNKNOWN; AND/OR/NOT follow Kleene logic so a definite answer is
+ * still produced whenever the known tests already decide it.
+ */
+static FilterResult evaluate(const Filter *filter, const char *name, char type_char,
+                             const struct statx *stx) {
+    FilterResult stack[FILTER_MAX_DEPTH];
+    int top = 0;
+
+    for (int i = 0; i < filter->length; i++) {
+        const FilterInstruction *instruction = &filter->program[i];
+        FilterResult result = FILTER_UNKNOWN;
+
+        switch (instruction->opcode) {
+            case OP_NAME:
+                result = fnmatch(instruction->pattern, name, 0) == 0 ? FILTER_ACCEPT : FILTER_REJECT;
+                if (instruction->compare == CMP_NE) {
+                    result = result == FILTER_ACCEPT ? FILTER_REJECT : FILTER_ACCEPT;
+                }
+                break;
+            case OP_TYPE:
+                if (type_char != 0) {
+                    result = compare_values(type_char, instruction->compare,
+                                            instruction->operand);
+                }
+                break;
+            case OP_SIZE:
+                if (stx != NULL) {
+                    result = compare_values((long long)stx->stx_size, instruction->compare,
+                                            instruction->operand);
+                }
+                break;
+            case OP_AGE:
+                if (stx != NULL) {
+                    long long age = (long long)(filter->now - stx->stx_mtime.tv_sec);
+                    result = compare_values(age, instruction->compare, instruction->operand);
+                }
+                break;
+            case OP_LINKS:
+                if (stx != NULL) {
+                    result = compare_values((long long)stx->stx_nlink, instruction->compare,
+                                            instruction->operand);
+                }
+                break;
+            case OP_NOT: {
+                FilterResult operand = stack[--top];
+                result = operand == FILTER_UNKNOWN
+                             ? FILTER_UNKNOWN
+                             : (operand == FILTER_ACCEPT ? FILTER_REJECT : FILTER_ACCEPT);
+                break;
+            }
+            case OP_AND: {
+                FilterResult right = stack[--top];
+                FilterResult left = stack[--top];
+                if (left == FILTER_REJECT || right == FILTER_REJECT) {
+                    result = FILTER_REJECT;
+                } else if (left == FILTER_UNKNOWN || right == FILTER_UNKNOWN) {
+                    result = FILTER_UNKNOWN;
+                } else {
+                    result = FILTER_ACCEPT;
+                }
+                break;
+            }
+            case OP_OR: {
+                FilterResult right = stack[--top];
+                FilterResult left = stack[--top];
+                if (left == FILTER_ACCEPT || right == FILTER_ACCEPT) {
+                    result = FILTER_ACCEPT;
+                } else if (left == FILTER_UNKNOWN || right == FILTER_UNKNOWN) {
+                    result = FILTER_UNKNOWN;
+                } else {
+                    result = FILTER_REJECT;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        stack[top++] = result;
+    }
+
+    return top > 0 ? stack[top - 1] : FILTER_ACCEPT;
+}
+
+FilterResult filter_match_name(const Filter *filter, const char *name, unsigned char d_type) {
+    if (!filter_is_active(filter) || name == NULL) {
+        return FILTER_ACCEPT;
+    }
+    return evaluate(filter, name, type_from_dirent(d_type), NULL);
+}
+
+int filter_entry_passes(const Filter *filter, int dir_fd, const char *name, unsigned char d_type) {
+    FilterResult result = filter_match_name(filter, name, d_type);
+    if (result != FILTER_UNKNOWN) {
+        return result == FILTER_ACCEPT;
+    }
+
+    // Ask only for the fields the program reads; the type comes for free
+    // with statx but is only relied on when readdir did not provide it
+    char type_char = type_from_dirent(d_type);
+    unsigned int mask = filter->statx_mask;
+    if (filter->needs_type && type_char == 0) {
+        mask |= STATX_TYPE;
+    }
+
+    // Filters describe the entry as the listing shows it: a link itself unless -L
+    struct statx stx;
+    if (statx(dir_fd, name, file_info_stat_flags() | AT_NO_AUTOMOUNT, mask, &stx) != 0) {
+        return 0;
+    }
+    if (type_char == 0 && (stx.stx_mask & STATX_TYPE)) {
+        type_char = type_from_mode(stx.stx_mode);
+    }
+
+    return evaluate(filter, name, type_char, &stx) == FILTER_ACCEPT;
+}
+
+int filter_apply_metadata(const Filter *filter, const char *dir_path, DirectoryContent *content) {
+    if (!filter_is_active(filter) || content == NULL || content->entries == NULL) {
+        return 0;
+    }
+
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        return -1;
+    }
+
+    // Evaluate in inode order, then compact in listing order
+    unsigned char *passes = (unsigned char *)malloc(content->count > 0 ? content->count : 1);
+    if (passes == NULL) {
+        close(dir_fd);
+        return -1;
+    }
+    int *order = directory_stat_order(content);
+    for (int k = 0; k < content->count; k++) {
+        int i = order != NULL ? order[k] : k;
+        unsigned char d_type = content->types != NULL ? content->types[i] : DT_UNKNOWN;
+        passes[i] = (unsigned char)filter_entry_passes(filter, dir_fd, content->entries[i], d_type);
+    }
+    if (content->arena == NULL) {
+        free(order);
+    }
+
+    int kept = 0;
+    for (int i = 0; i < content->count; i++) {
+        if (passes[i]) {
+            content->entries[kept] = content->entries[i];
+            if (content->types != NULL) {
+                content->types[kept] = content->types[i];
+            }
+            if (content->inodes != NULL) {
+                content->inodes[kept] = content->inodes[i];
+            }
+            kept++;
+        } else if (content->arena == NULL) {
+            free(content->entries[i]);
+        }
+    }
+    content->count = kept;
+
+    free(passes);
+    close(dir_fd);
+    return 0;
+}
+
+int filter_copy(Filter *copy, const Filter *filter) {
+    *copy = *filter;
+    copy->program = NULL;
+    copy->length = 0;
+    copy->capacity = 0;
+    copy->patterns = NULL;
+    copy->pattern_count = 0;
+    if (filter->length == 0) {
+        return 0;
+    }
+
+    int name_tests = 0;
+    for (int i = 0; i < filter->length; i++) {
+        name_tests += filter->program[i].pattern != NULL;
+    }
+    copy->program = (FilterInstruction *)malloc(filter->length * sizeof(FilterInstruction));
+    copy->patterns = (char **)malloc((name_tests > 0 ? name_tests : 1) * sizeof(char *));
+    if (copy->program == NULL || copy->patterns == NULL) {
+        filter_free(copy);
+        return -1;
+    }
+    copy->length = filter->length;
+    copy->capacity = filter->length;
+
+    // Every name test gets its own pattern, wherever the original's came from
+    for (int i = 0; i < filter->length; i++) {
+        copy->program[i] = filter->program[i];
+        if (filter->program[i].pattern == NULL) {
+            continue;
+        }
+        char *pattern = strdup(filter->program[i].pattern);
+        if (pattern == NULL) {
+            filter_free(copy);
+            return -1;
+        }
+        copy->patterns[copy->pattern_count++] = pattern;
+        copy->program[i].pattern = pattern;
+    }
+    return 0;
+}
+
+void filter_free(Filter *filter) {
+    if (filter == NULL) {
+        return;
+    }
+    for (int i = 0; i < filter->pattern_count; i++) {
+        free(filter->patterns[i]);
+    }
+    free(filter->patterns);
+    free(filter->program);
+    memset(filter, 0, sizeof(Filter));
+}
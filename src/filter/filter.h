@@ -0,0 +1,136 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "directory_reader.h"
+
+/**
+ * @brief Result of evaluating a filter with possibly incomplete information
+ */
+typedef enum {
+    FILTER_REJECT = 0,   // Entry is definitely filtered out
+    FILTER_ACCEPT = 1,   // Entry is definitely kept
+    FILTER_UNKNOWN = 2   // Depends on metadata that has not been fetched yet
+} FilterResult;
+
+/**
+ * @brief One bytecode instruction of a compiled filter program
+ */
+typedef struct {
+    unsigned char opcode;    // FilterOpcode (see filter.c)
+    unsigned char compare;   // Comparison operator for field tests
+    long long operand;       // Numeric operand (size in bytes, age in seconds, link count, type char)
+    const char *pattern;     // Glob pattern for name tests (not owned by the instruction)
+} FilterInstruction;
+
+/**
+ * @brief A compiled filter: --include/--exclude globs and a --where expression
+ *        combined into one postfix program
+ */
+typedef struct Filter {
+    FilterInstruction *program;  // Postfix bytecode
+    int length;                  // Number of instructions
+    int capacity;
+    char **patterns;             // Glob patterns copied out of the --where expression
+    int pattern_count;
+    unsigned int statx_mask;     // STATX_* fields the metadata tests need
+    int needs_type;              // Non-zero if the program tests the entry type
+    time_t now;                  // Reference time for age (mtime) tests
+} Filter;
+
+/**
+ * @brief Compile include/exclude globs and a --where expression into a filter
+ *
+ * An entry passes if it matches any include pattern (or there are none), matches
+ * no exclude pattern, and satisfies the expression.
+ *
+ * Expression grammar:
+ *   expr  := term ('||' term)*
+ *   term  := unary ('&&' unary)*
+ *   unary := '!' unary | '(' expr ')' | field op value
+ *   field := name | type | size | mtime | links
+ *   op    := == | != | < | <= | > | >=
+ * name takes a glob (== and != only), type one of f d l p s c b, size a byte
+ * count with optional K/M/G/T/P suffix, mtime an age with s/m/h/d/w suffix
+ * ("mtime<7d" means modified within the last 7 days), links an integer.
+ *
+ * @param filter Filter to initialize (free with filter_free)
+ * @param includes Include glob patterns
+ * @param include_count Number of include patterns
+ * @param excludes Exclude glob patterns
+ * @param exclude_count Number of exclude patterns
+ * @param where Expression to compile, or NULL
+ * @param error Buffer receiving a message on failure
+ * @param error_size Size of the error buffer
+ * @return int 0 on success, -1 on a syntax or allocation error
+ */
+int filter_compile(Filter *filter, const char *const *includes, int include_count,
+                   const char *const *excludes, int exclude_count, const char *where,
+                   char *error, size_t error_size);
+
+/**
+ * @brief Check whether a compiled filter has anything to test
+ *
+ * @param filter Filter (may be NULL)
+ * @return int Non-zero if the filter can reject entries
+ */
+int filter_is_active(const Filter *filter);
+
+/**
+ * @brief Evaluate the tests that need only the name and readdir type
+ *
+ * Runs inside the directory reader before anything is allocated or stat'ed.
+ *
+ * @param filter Compiled filter (NULL accepts everything)
+ * @param name Entry name
+ * @param d_type Entry type from readdir (DT_UNKNOWN if not provided by the filesystem)
+ * @return FilterResult FILTER_UNKNOWN if metadata is needed to decide
+ */
+FilterResult filter_match_name(const Filter *filter, const char *name, unsigned char d_type);
+
+/**
+ * @brief Decide a single entry, fetching only the statx fields the filter needs
+ *
+ * @param filter Compiled filter (NULL accepts everything)
+ * @param dir_fd Open directory the entry lives in
+ * @param name Entry name
+ * @param d_type Entry type from readdir, or DT_UNKNOWN
+ * @return int 1 if the entry passes, 0 otherwise
+ */
+int filter_entry_passes(const Filter *filter, int dir_fd, const char *name, unsigned char d_type);
+
+/**
+ * @brief Drop entries that fail the metadata tests
+ *
+ * Entries already decided by name and type are not stat'ed.
+ *
+ * @param filter Compiled filter (NULL keeps everything)
+ * @param dir_path Directory the entries belong to
+ * @param content Directory content to filter in place
+ * @return int 0 on success, -1 if the directory cannot be opened
+ */
+int filter_apply_metadata(const Filter *filter, const char *dir_path, DirectoryContent *content);
+
+/**
+ * @brief Make an independent copy of a compiled filter
+ *
+ * The copy owns its program and every glob pattern it tests, including
+ * --include and --exclude patterns that the original only points to, so it
+ * stays valid after the original and the command line are gone.
+ *
+ * @param copy Filter to initialize (free with filter_free)
+ * @param filter Filter to copy
+ * @return int 0 on success, -1 on allocation failure (copy is left empty)
+ */
+int filter_copy(Filter *copy, const Filter *filter);
+
+/**
+ * @brief Free a compiled filter
+ *
+ * @param filter Filter to free
+ */
+void filter_free(Filter *filter);
+
+#endif
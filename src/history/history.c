@@ -0,0 +1,714 @@
+#define _GNU_SOURCE
+#include "history.h"
+#include "utils/lz.h"
+#include "utils/path.h"
+#include "utils/spill.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HISTORY_MAGIC "LSTHIST"
+#define HISTORY_INDEX_MAGIC "LSTHIDX"
+#define HISTORY_VERSION 1
+#define HISTORY_INDEX_SUFFIX ".idx"
+#define HISTORY_DEFAULT_NAME ".lister_history"
+
+// Output is captured, compressed and replayed in blocks of this size
+#define HISTORY_BLOCK_SIZE LZ_MAX_BLOCK_SIZE
+
+// Longest command line a record may hold (longer ones are truncated)
+#define HISTORY_MAX_COMMAND (64 * 1024)
+
+/**
+ * @brief On-disk record header, followed by the command line and the output blocks
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t exit_code;
+    int64_t time_ns;           // When the record was appended (the index key)
+    int64_t elapsed_ns;        // Run time; the run started at time_ns - elapsed_ns
+    uint32_t command_length;
+    uint32_t reserved;
+    uint64_t output_length;    // Output bytes as printed
+    uint64_t stored_length;    // Bytes of output blocks that follow the command
+} HistoryRecordHeader;
+
+/**
+ * @brief On-disk block header; the block is LZ-compressed when stored_length < raw_length
+ */
+typedef struct {
+    uint32_t raw_length;
+    uint32_t stored_length;
+} HistoryBlockHeader;
+
+/**
+ * @brief Index file header, followed by one HistoryIndexEntry per record in log order
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} HistoryIndexHeader;
+
+/**
+ * @brief Index entry; times never decrease, so the index can be binary searched
+ */
+typedef struct {
+    int64_t time_ns;
+    uint64_t offset;   // Offset of the record in the log
+} HistoryIndexEntry;
+
+/**
+ * @brief State of the run being recorded
+ */
+typedef struct {
+    FILE *saved_stdout;
+    FILE *saved_stderr;
+    FILE *tee_stdout;
+    FILE *tee_stderr;
+    int terminal_fds[2];          // Cookies of the tee streams: where the output really goes
+    int capture_fd;               // Anonymous file holding the output blocks
+    SpillWriter capture;
+    int capture_failed;
+    unsigned char block[HISTORY_BLOCK_SIZE];       // Output not yet captured
+    size_t block_used;
+    unsigned char compressed[HISTORY_BLOCK_SIZE];  // Scratch for compressing a block
+    uint64_t output_length;
+    uint64_t stored_length;
+    int64_t started_ns;
+    char *command;
+    size_t command_length;
+    char path[PATH_BUFFER_SIZE];
+} HistoryCapture;
+
+// Only one run per process is recorded
+static HistoryCapture *g_capture = NULL;
+
+static int64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+const char *history_default_file(void) {
+    static char default_path[PATH_BUFFER_SIZE];
+
+    const char *file = getenv("LISTER_HISTORY_FILE");
+    if (file != NULL && file[0] != '\0') {
+        return file;
+    }
+
+    const char *home = getenv("HOME");
+    if (home == NULL || home[0] == '\0' ||
+        join_path(default_path, sizeof(default_path), home, HISTORY_DEFAULT_NAME) != 0) {
+        return NULL;
+    }
+    return default_path;
+}
+
+/**
+ * @brief Build the command line as a shell would show it ("lister -l 'my dir'" style)
+ *
+ * --history itself is left out. Arguments with whitespace or quotes are
+ * wrapped in double quotes, with inner double quotes escaped.
+ *
+ * @return char* Heap-allocated command line, or NULL on allocation failure
+ */
+static char *build_command(int argc, char *argv[], size_t *length) {
+    size_t capacity = sizeof("lister");
+    for (int i = 1; i < argc; i++) {
+        capacity += 2 * strlen(argv[i]) + 3;
+    }
+
+    char *command = (char *)malloc(capacity);
+    if (command == NULL) {
+        return NULL;
+    }
+    size_t used = (size_t)sprintf(command, "lister");
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--history") == 0 || strncmp(arg, "--history=", 10) == 0) {
+            continue;
+        }
+        int quote = strpbrk(arg, " \t\n\"'`") != NULL;
+        command[used++] = ' ';
+        if (quote) {
+            command[used++] = '"';
+        }
+        for (const char *c = arg; *c != '\0'; c++) {
+            if (quote && *c == '"') {
+                command[used++] = '\\';
+            }
+            command[used++] = *c;
+        }
+        if (quote) {
+            command[used++] = '"';
+        }
+    }
+    command[used] = '\0';
+
+    *length = used < HISTORY_MAX_COMMAND ? used : HISTORY_MAX_COMMAND;
+    return command;
+}
+
+/**
+ * @brief Append the pending output block to the capture file, compressed if that is smaller
+ */
+static void capture_block(HistoryCapture *capture) {
+    if (capture->block_used == 0) {
+        return;
+    }
+
+    // Compression only pays if it saves at least a byte
+    size_t stored = lz_compress(capture->block, capture->block_used, capture->compressed,
+                                capture->block_used - 1);
+    HistoryBlockHeader header;
+    header.raw_length = (uint32_t)capture->block_used;
+    header.stored_length = (uint32_t)(stored > 0 ? stored : capture->block_used);
+    if (spill_write(&capture->capture, &header, sizeof(header)) != 0 ||
+        spill_write(&capture->capture, stored > 0 ? capture->compressed : capture->block,
+                    header.stored_length) != 0) {
+        capture->capture_failed = 1;
+    }
+
+    capture->stored_length += sizeof(header) + header.stored_length;
+    capture->block_used = 0;
+}
+
+/**
+ * @brief fopencookie() write function: pass bytes to the terminal, then capture them
+ */
+static ssize_t tee_write(void *cookie, const char *data, size_t length) {
+    int fd = *(int *)cookie;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = write(fd, data + written, length - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += (size_t)result;
+    }
+
+    HistoryCapture *capture = g_capture;
+    capture->output_length += length;
+    while (length > 0) {
+        size_t chunk = HISTORY_BLOCK_SIZE - capture->block_used;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(capture->block + capture->block_used, data, chunk);
+        capture->block_used += chunk;
+        data += chunk;
+        length -= chunk;
+        if (capture->block_used == HISTORY_BLOCK_SIZE) {
+            capture_block(capture);
+        }
+    }
+
+    return written > 0 ? (ssize_t)written : -1;
+}
+
+int history_start(const char *history_file, int argc, char *argv[]) {
+    if (history_file == NULL) {
+        history_file = history_default_file();
+    }
+    if (g_capture != NULL) {
+        return -1;
+    }
+    if (history_file == NULL) {
+        fprintf(stderr, "Warning: No history file; set LISTER_HISTORY_FILE or HOME\n");
+        return -1;
+    }
+
+    HistoryCapture *capture = (HistoryCapture *)calloc(1, sizeof(HistoryCapture));
+    if (capture == NULL) {
+        fprintf(stderr, "Warning: Cannot record history: Memory allocation failed\n");
+        return -1;
+    }
+    snprintf(capture->path, sizeof(capture->path), "%s", history_file);
+    capture->terminal_fds[0] = STDOUT_FILENO;
+    capture->terminal_fds[1] = STDERR_FILENO;
+    capture->command = build_command(argc, argv, &capture->command_length);
+    capture->capture_fd = spill_create();
+    if (capture->command == NULL || capture->capture_fd < 0 ||
+        spill_writer_init(&capture->capture, capture->capture_fd, SPILL_BUFFER_SIZE) != 0) {
+        fprintf(stderr, "Warning: Cannot record history: Cannot create temporary file\n");
+        if (capture->capture_fd >= 0) {
+            close(capture->capture_fd);
+        }
+        free(capture->command);
+        free(capture);
+        return -1;
+    }
+
+    cookie_io_functions_t functions = {NULL, tee_write, NULL, NULL};
+    fflush(stdout);
+    fflush(stderr);
+    capture->tee_stdout = fopencookie(&capture->terminal_fds[0], "w", functions);
+    capture->tee_stderr = fopencookie(&capture->terminal_fds[1], "w", functions);
+    if (capture->tee_stdout == NULL || capture->tee_stderr == NULL) {
+        fprintf(stderr, "Warning: Cannot record history: Cannot capture output\n");
+        if (capture->tee_stdout != NULL) {
+            fclose(capture->tee_stdout);
+        }
+        if (capture->tee_stderr != NULL) {
+            fclose(capture->tee_stderr);
+        }
+        spill_writer_close(&capture->capture);
+        close(capture->capture_fd);
+        free(capture->command);
+        free(capture);
+        return -1;
+    }
+
+    // Same buffering as the streams they stand in for
+    setvbuf(capture->tee_stdout, NULL, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, BUFSIZ);
+    setvbuf(capture->tee_stderr, NULL, _IONBF, 0);
+
+    capture->started_ns = now_ns();
+    capture->saved_stdout = stdout;
+    capture->saved_stderr = stderr;
+    g_capture = capture;
+    stdout = capture->tee_stdout;
+    stderr = capture->tee_stderr;
+    return 0;
+}
+
+/**
+ * @brief Read and check the header of the record at an offset
+ *
+ * @return int 0 if a complete record starts there, -1 otherwise
+ */
+static int read_record_header(int log_fd, off_t offset, off_t log_size,
+                              HistoryRecordHeader *header) {
+    if (offset < 0 || log_size - offset < (off_t)sizeof(HistoryRecordHeader) ||
+        pread(log_fd, header, sizeof(*header), offset) != (ssize_t)sizeof(*header)) {
+        return -1;
+    }
+    if (memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != HISTORY_VERSION || header->command_length > HISTORY_MAX_COMMAND) {
+        return -1;
+    }
+
+    uint64_t body = (uint64_t)header->command_length + header->stored_length;
+    return body <= (uint64_t)(log_size - offset) - sizeof(*header) ? 0 : -1;
+}
+
+static off_t record_size(const HistoryRecordHeader *header) {
+    return (off_t)(sizeof(*header) + header->command_length + header->stored_length);
+}
+
+/**
+ * @brief Number of entries in an index file (0 if it is missing or not an index)
+ */
+static uint64_t index_count(int index_fd) {
+    HistoryIndexHeader header;
+    struct stat index_stat;
+    if (index_fd < 0 || fstat(index_fd, &index_stat) != 0 ||
+        pread(index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, HISTORY_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != HISTORY_VERSION) {
+        return 0;
+    }
+
+    // A trailing partial entry (from an interrupted append) does not count
+    return (uint64_t)(index_stat.st_size - (off_t)sizeof(header)) / sizeof(HistoryIndexEntry);
+}
+
+static int index_entry(int index_fd, uint64_t position, HistoryIndexEntry *entry) {
+    off_t offset = (off_t)(sizeof(HistoryIndexHeader) + position * sizeof(HistoryIndexEntry));
+    return pread(index_fd, entry, sizeof(*entry), offset) == (ssize_t)sizeof(*entry) ? 0 : -1;
+}
+
+/**
+ * @brief Offset just past the last indexed record, where unindexed records would start
+ *
+ * @return off_t 0 if nothing is indexed, log_size if the index does not match the log
+ */
+static off_t unindexed_offset(int log_fd, off_t log_size, int index_fd, uint64_t count) {
+    HistoryIndexEntry last;
+    HistoryRecordHeader header;
+    if (count == 0) {
+        return 0;
+    }
+    if (index_entry(index_fd, count - 1, &last) != 0 ||
+        read_record_header(log_fd, (off_t)last.offset, log_size, &header) != 0) {
+        return log_size;
+    }
+    return (off_t)last.offset + record_size(&header);
+}
+
+/**
+ * @brief Append an index entry (the index is created or reset if it is not valid)
+ */
+static int index_append(int index_fd, uint64_t *count, int64_t time_ns, off_t offset) {
+    if (*count == 0) {
+        HistoryIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, HISTORY_INDEX_MAGIC, sizeof(HISTORY_INDEX_MAGIC));
+        header.version = HISTORY_VERSION;
+        if (ftruncate(index_fd, 0) != 0 ||
+            pwrite(index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            return -1;
+        }
+    }
+
+    HistoryIndexEntry entry = {time_ns, (uint64_t)offset};
+    off_t position = (off_t)(sizeof(HistoryIndexHeader) + *count * sizeof(HistoryIndexEntry));
+    if (pwrite(index_fd, &entry, sizeof(entry), position) != (ssize_t)sizeof(entry)) {
+        return -1;
+    }
+    (*count)++;
+    return 0;
+}
+
+/**
+ * @brief Append the captured run to the log and the index (caller holds the lock)
+ */
+static int append_record(HistoryCapture *capture, int log_fd, int index_fd, int exit_code) {
+    off_t log_end = lseek(log_fd, 0, SEEK_END);
+    if (log_end < 0) {
+        return -1;
+    }
+
+    // Index records an interrupted run left unindexed, and never let time go backwards
+    int64_t time_ns = now_ns();
+    uint64_t count = index_count(index_fd);
+    HistoryIndexEntry last;
+    if (count > 0 && index_entry(index_fd, count - 1, &last) == 0 && last.time_ns > time_ns) {
+        time_ns = last.time_ns;
+    }
+    off_t offset = unindexed_offset(log_fd, log_end, index_fd, count);
+    HistoryRecordHeader header;
+    while (read_record_header(log_fd, offset, log_end, &header) == 0) {
+        if (index_append(index_fd, &count, header.time_ns, offset) != 0) {
+            return -1;
+        }
+        if (header.time_ns > time_ns) {
+            time_ns = header.time_ns;
+        }
+        offset += record_size(&header);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+    header.version = HISTORY_VERSION;
+    header.exit_code = exit_code;
+    header.time_ns = time_ns;
+    header.elapsed_ns = now_ns() - capture->started_ns;
+    header.command_length = (uint32_t)capture->command_length;
+    header.output_length = capture->output_length;
+    header.stored_length = capture->stored_length;
+
+    // Header, command, then the captured blocks copied as they are
+    SpillWriter writer;
+    if (spill_writer_init(&writer, log_fd, SPILL_BUFFER_SIZE) != 0) {
+        return -1;
+    }
+    int status = spill_write(&writer, &header, sizeof(header));
+    if (status == 0) {
+        status = spill_write(&writer, capture->command, capture->command_length);
+    }
+    off_t copied = 0;
+    while (status == 0 && (uint64_t)copied < capture->stored_length) {
+        ssize_t length = pread(capture->capture_fd, capture->block, sizeof(capture->block),
+                               copied);
+        if (length <= 0) {
+            status = -1;
+            break;
+        }
+        status = spill_write(&writer, capture->block, (size_t)length);
+        copied += length;
+    }
+    if (spill_writer_close(&writer) != 0 || status != 0) {
+        // Drop the partial record so the next one starts on a record boundary
+        int truncated = ftruncate(log_fd, log_end);
+        (void)truncated;
+        return -1;
+    }
+
+    return index_append(index_fd, &count, time_ns, log_end);
+}
+
+int history_finish(int exit_code) {
+    HistoryCapture *capture = g_capture;
+    if (capture == NULL) {
+        return 0;
+    }
+
+    // Put the real streams back before anything else is printed
+    fflush(stdout);
+    fflush(stderr);
+    stdout = capture->saved_stdout;
+    stderr = capture->saved_stderr;
+    fclose(capture->tee_stdout);
+    fclose(capture->tee_stderr);
+    g_capture = NULL;
+
+    capture_block(capture);
+    if (spill_writer_close(&capture->capture) != 0) {
+        capture->capture_failed = 1;
+    }
+
+    int status = -1;
+    char index_path[PATH_BUFFER_SIZE + sizeof(HISTORY_INDEX_SUFFIX)];
+    snprintf(index_path, sizeof(index_path), "%s%s", capture->path, HISTORY_INDEX_SUFFIX);
+    int log_fd = open(capture->path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    int index_fd = open(index_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (!capture->capture_failed && log_fd >= 0 && index_fd >= 0 &&
+        flock(log_fd, LOCK_EX) == 0) {
+        status = append_record(capture, log_fd, index_fd, exit_code);
+        flock(log_fd, LOCK_UN);
+    }
+    if (status != 0) {
+        fprintf(stderr, "Warning: Could not write to history file: %s\n", capture->path);
+    }
+
+    if (log_fd >= 0) {
+        close(log_fd);
+    }
+    if (index_fd >= 0) {
+        close(index_fd);
+    }
+    close(capture->capture_fd);
+    free(capture->command);
+    free(capture);
+    return status;
+}
+
+/**
+ * @brief Parse one bound of a range: an age before now or a local date and time
+ */
+static int parse_time_bound(const char *text, size_t length, int64_t now, int64_t *bound) {
+    char buffer[32];
+    if (length == 0 || length >= sizeof(buffer)) {
+        return -1;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    // Age: digits and one unit
+    static const char age_units[] = "SMHDW";
+    static const long long age_scales[] = {1LL, 60LL, 3600LL, 86400LL, 604800LL};
+    char *end;
+    long long value = strtoll(buffer, &end, 10);
+    if (end != buffer && isdigit((unsigned char)buffer[0]) && end[0] != '\0' &&
+        end[1] == '\0') {
+        const char *unit = strchr(age_units, toupper((unsigned char)end[0]));
+        if (unit == NULL || value > 100LL * 365 * 86400) {
+            return -1;
+        }
+        *bound = now - value * age_scales[unit - age_units] * 1000000000LL;
+        return 0;
+    }
+
+    // Date, optionally followed by 'T' (or a space) and HH:MM[:SS]
+    struct tm date;
+    memset(&date, 0, sizeof(date));
+    int consumed = 0;
+    if (sscanf(buffer, "%4d-%2d-%2d%n", &date.tm_year, &date.tm_mon, &date.tm_mday,
+               &consumed) != 3) {
+        return -1;
+    }
+    if (buffer[consumed] == 'T' || buffer[consumed] == ' ') {
+        int time_start = consumed + 1;
+        if (sscanf(buffer + time_start, "%2d:%2d%n", &date.tm_hour, &date.tm_min,
+                   &consumed) != 2) {
+            return -1;
+        }
+        consumed += time_start;
+        if (buffer[consumed] == ':') {
+            int seconds_start = consumed + 1;
+            if (sscanf(buffer + seconds_start, "%2d%n", &date.tm_sec, &consumed) != 1) {
+                return -1;
+            }
+            consumed += seconds_start;
+        }
+    }
+    if (buffer[consumed] != '\0' || date.tm_mon < 1 || date.tm_mon > 12 || date.tm_mday < 1 ||
+        date.tm_mday > 31 || date.tm_hour > 23 || date.tm_min > 59 || date.tm_sec > 60) {
+        return -1;
+    }
+
+    date.tm_year -= 1900;
+    date.tm_mon -= 1;
+    date.tm_isdst = -1;
+    time_t seconds = mktime(&date);
+    if (seconds == (time_t)-1) {
+        return -1;
+    }
+    *bound = (int64_t)seconds * 1000000000LL;
+    return 0;
+}
+
+int history_parse_range(const char *text, int64_t *from_ns, int64_t *to_ns) {
+    *from_ns = INT64_MIN;
+    *to_ns = INT64_MAX;
+    int64_t now = now_ns();
+
+    const char *separator = strstr(text, "..");
+    size_t from_length = separator != NULL ? (size_t)(separator - text) : strlen(text);
+    if (from_length > 0 && parse_time_bound(text, from_length, now, from_ns) != 0) {
+        return -1;
+    }
+    if (separator != NULL && separator[2] != '\0' &&
+        parse_time_bound(separator + 2, strlen(separator + 2), now, to_ns) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Print one record: its header lines, then its output block by block
+ *
+ * @return int 0 on success, -1 if the record is damaged
+ */
+static int print_record(int log_fd, off_t offset, const HistoryRecordHeader *header,
+                        unsigned char *stored, unsigned char *raw) {
+    char command[HISTORY_MAX_COMMAND + 1];
+    off_t command_offset = offset + (off_t)sizeof(*header);
+    if (pread(log_fd, command, header->command_length, command_offset) !=
+        (ssize_t)header->command_length) {
+        return -1;
+    }
+    command[header->command_length] = '\0';
+
+    time_t started = (time_t)((header->time_ns - header->elapsed_ns) / 1000000000LL);
+    struct tm local;
+    char timestamp[32];
+    localtime_r(&started, &local);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    printf("=== [%s] ===\nCommand: %s\nExit Code: %d\nResult:\n", timestamp, command,
+           header->exit_code);
+
+    SpillReader reader;
+    if (spill_reader_init(&reader, log_fd, command_offset + header->command_length,
+                          SPILL_BUFFER_SIZE) != 0) {
+        return -1;
+    }
+    int status = 0;
+    uint64_t remaining = header->stored_length;
+    unsigned char last = '\n';
+    while (status == 0 && remaining > 0) {
+        HistoryBlockHeader block;
+        if (remaining < sizeof(block) || spill_read(&reader, &block, sizeof(block)) != sizeof(block) ||
+            block.raw_length == 0 || block.raw_length > HISTORY_BLOCK_SIZE ||
+            block.stored_length > block.raw_length ||
+            block.stored_length > remaining - sizeof(block) ||
+            spill_read(&reader, stored, block.stored_length) != block.stored_length) {
+            status = -1;
+            break;
+        }
+        remaining -= sizeof(block) + block.stored_length;
+
+        const unsigned char *output = stored;
+        if (block.stored_length < block.raw_length) {
+            if (lz_decompress(stored, block.stored_length, raw, block.raw_length) != 0) {
+                status = -1;
+                break;
+            }
+            output = raw;
+        }
+        fwrite(output, 1, block.raw_length, stdout);
+        last = output[block.raw_length - 1];
+    }
+    spill_reader_close(&reader);
+
+    // Each record ends with a blank line, whether or not the output ended in a newline
+    fputs(last == '\n' ? "\n" : "\n\n", stdout);
+    return status;
+}
+
+int history_query(const char *history_file, int64_t from_ns, int64_t to_ns) {
+    if (history_file == NULL) {
+        history_file = history_default_file();
+    }
+    int log_fd = history_file != NULL ? open(history_file, O_RDONLY | O_CLOEXEC) : -1;
+    struct stat log_stat;
+    if (log_fd < 0 || fstat(log_fd, &log_stat) != 0) {
+        fprintf(stderr, "Error: Cannot read history file '%s'\n",
+                history_file != NULL ? history_file : HISTORY_DEFAULT_NAME);
+        if (log_fd >= 0) {
+            close(log_fd);
+        }
+        return 1;
+    }
+
+    unsigned char *stored = (unsigned char *)malloc(2 * HISTORY_BLOCK_SIZE);
+    if (stored == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        close(log_fd);
+        return 1;
+    }
+    unsigned char *raw = stored + HISTORY_BLOCK_SIZE;
+
+    // A shared lock keeps a record from being read while it is appended
+    flock(log_fd, LOCK_SH);
+    off_t log_size = lseek(log_fd, 0, SEEK_END);
+    char index_path[PATH_BUFFER_SIZE + sizeof(HISTORY_INDEX_SUFFIX)];
+    snprintf(index_path, sizeof(index_path), "%s%s", history_file, HISTORY_INDEX_SUFFIX);
+    int index_fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    uint64_t count = index_count(index_fd);
+
+    // Binary search for the first indexed record in range
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        HistoryIndexEntry entry;
+        if (index_entry(index_fd, middle, &entry) != 0 || entry.time_ns >= from_ns) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    int status = 0;
+    int past_end = 0;
+    HistoryRecordHeader header;
+    for (uint64_t position = low; position < count && !past_end; position++) {
+        HistoryIndexEntry entry;
+        if (index_entry(index_fd, position, &entry) != 0 ||
+            read_record_header(log_fd, (off_t)entry.offset, log_size, &header) != 0) {
+            status = 1;
+            break;
+        }
+        past_end = header.time_ns > to_ns;
+        if (!past_end && print_record(log_fd, (off_t)entry.offset, &header, stored, raw) != 0) {
+            status = 1;
+        }
+    }
+
+    // Records past the end of the index are found by scanning
+    off_t offset = unindexed_offset(log_fd, log_size, index_fd, count);
+    while (!past_end && read_record_header(log_fd, offset, log_size, &header) == 0) {
+        if (header.time_ns >= from_ns && header.time_ns <= to_ns &&
+            print_record(log_fd, offset, &header, stored, raw) != 0) {
+            status = 1;
+        }
+        offset += record_size(&header);
+    }
+    fflush(stdout);
+
+    if (status != 0) {
+        fprintf(stderr, "Error: History file '%s' is damaged\n", history_file);
+    }
+    if (index_fd >= 0) {
+        close(index_fd);
+    }
+    flock(log_fd, LOCK_UN);
+    close(log_fd);
+    free(stored);
+    return status;
+}
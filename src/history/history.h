@@ -0,0 +1,72 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+
+/**
+ * @brief Start recording this run in the history log
+ *
+ * stdout and stderr are replaced by streams that write through to the
+ * terminal immediately and also append to a capture file, in 64 KiB blocks
+ * that are compressed when that makes them smaller. The terminal still sees
+ * a TTY, so column layout is unchanged. Only one run can be recorded per
+ * process.
+ *
+ * @param history_file Log file, or NULL for history_default_file()
+ * @param argc Number of command-line arguments
+ * @param argv Command-line arguments, recorded as the command
+ * @return int 0 on success, -1 if the capture could not be set up (a warning is
+ *             printed and nothing is recorded)
+ */
+int history_start(const char *history_file, int argc, char *argv[]);
+
+/**
+ * @brief Restore stdout and stderr and append the record to the log
+ *
+ * The record (timestamp, run time, exit code, command line, output) is
+ * appended to the log and its position to the log's index under an exclusive
+ * lock, so concurrent runs do not interleave. Does nothing if
+ * history_start() was not called or failed.
+ *
+ * @param exit_code Exit status of the run
+ * @return int 0 on success, -1 if the log could not be written (a warning is printed)
+ */
+int history_finish(int exit_code);
+
+/**
+ * @brief Parse the time range of --history-query
+ *
+ * The range is FROM, FROM..TO or ..TO; an empty range selects everything.
+ * Each bound is an age before now (30s, 15m, 2h, 7d, 1w) or a local date and
+ * time (2026-10-19, 2026-10-19T14:30 or 2026-10-19T14:30:05).
+ *
+ * @param text Range text
+ * @param from_ns Receives the start in nanoseconds since the epoch (INT64_MIN: open)
+ * @param to_ns Receives the end in nanoseconds since the epoch (INT64_MAX: open)
+ * @return int 0 on success, -1 if the text is not a valid range
+ */
+int history_parse_range(const char *text, int64_t *from_ns, int64_t *to_ns);
+
+/**
+ * @brief Print the recorded runs that finished within a time range
+ *
+ * The first matching record is found by a binary search of the index, and
+ * only the records from there on are read from the log. Records appended
+ * after the last indexed one (if a run was interrupted before updating the
+ * index) are found by scanning.
+ *
+ * @param history_file Log file, or NULL for history_default_file()
+ * @param from_ns Start of the range in nanoseconds since the epoch
+ * @param to_ns End of the range in nanoseconds since the epoch
+ * @return int 0 on success, 1 if the log cannot be read
+ */
+int history_query(const char *history_file, int64_t from_ns, int64_t to_ns);
+
+/**
+ * @brief Default log file: $LISTER_HISTORY_FILE, or ~/.lister_history
+ *
+ * @return const char* Path in a static buffer, or NULL if neither is set
+ */
+const char *history_default_file(void);
+
+#endif
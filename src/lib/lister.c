@@ -0,0 +1,298 @@
+#define _DEFAULT_SOURCE
+#include "lister.h"
+#include "display.h"
+#include "file_info.h"
+#include "filter/filter.h"
+#include "sort/sort.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Entry metadata states
+#define STAT_PENDING 0
+#define STAT_LOADED 1
+#define STAT_FAILED 2
+
+struct ListerEntry {
+    char *name;
+    unsigned char type;
+    unsigned char stat_state;
+    struct stat stat_info;
+};
+
+struct ListerDir {
+    ListerAllocator allocator;
+    ListerOptions options;
+    DIR *dir;
+    Filter filter;
+
+    // Directory order: one reusable entry, no per-entry allocation
+    ListerEntry current;
+    char current_name[NAME_MAX + 1];
+
+    // Sorted orders: every entry, read up front
+    ListerEntry *entries;
+    size_t count;
+    size_t capacity;
+    size_t position;
+    int loaded;
+};
+
+static void *default_allocate(size_t size, void *context) {
+    (void)context;
+    return malloc(size);
+}
+
+static void default_release(void *ptr, void *context) {
+    (void)context;
+    free(ptr);
+}
+
+static void *dir_allocate(ListerDir *dir, size_t size) {
+    return dir->allocator.allocate(size, dir->allocator.context);
+}
+
+static void dir_release(ListerDir *dir, void *ptr) {
+    dir->allocator.release(ptr, dir->allocator.context);
+}
+
+/**
+ * @brief Read the next readdir entry that belongs in the listing
+ */
+static struct dirent *next_selected(ListerDir *dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir->dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (!dir->options.show_all && entry->d_name[0] == '.') {
+            continue;
+        }
+        if (!filter_entry_passes(&dir->filter, dirfd(dir->dir), entry->d_name, entry->d_type)) {
+            continue;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+static int load_stat(ListerDir *dir, ListerEntry *entry) {
+    if (entry->stat_state == STAT_PENDING) {
+        int found = fstatat(dirfd(dir->dir), entry->name, &entry->stat_info, 0) == 0;
+        entry->stat_state = found ? STAT_LOADED : STAT_FAILED;
+    }
+    return entry->stat_state == STAT_LOADED;
+}
+
+static int append_entry(ListerDir *dir, const struct dirent *entry) {
+    if (dir->count == dir->capacity) {
+        size_t new_capacity = dir->capacity > 0 ? dir->capacity * 2 : 64;
+        ListerEntry *entries = (ListerEntry *)dir_allocate(dir, new_capacity * sizeof(ListerEntry));
+        if (entries == NULL) {
+            return -1;
+        }
+        if (dir->entries != NULL) {
+            memcpy(entries, dir->entries, dir->count * sizeof(ListerEntry));
+            dir_release(dir, dir->entries);
+        }
+        dir->entries = entries;
+        dir->capacity = new_capacity;
+    }
+
+    size_t name_len = strlen(entry->d_name);
+    char *name = (char *)dir_allocate(dir, name_len + 1);
+    if (name == NULL) {
+        return -1;
+    }
+    memcpy(name, entry->d_name, name_len + 1);
+
+    ListerEntry *slot = &dir->entries[dir->count++];
+    slot->name = name;
+    slot->type = entry->d_type;
+    slot->stat_state = STAT_PENDING;
+    return 0;
+}
+
+// Sort parameters for the qsort callback below
+static SortMode g_lister_sort_mode = SORT_MODE_ALPHA;
+static int g_lister_reverse = 0;
+
+static int compare_lister_entries(const void *a, const void *b) {
+    const ListerEntry *entry_a = (const ListerEntry *)a;
+    const ListerEntry *entry_b = (const ListerEntry *)b;
+    time_t mtime_a = entry_a->stat_state == STAT_LOADED ? entry_a->stat_info.st_mtime : 0;
+    time_t mtime_b = entry_b->stat_state == STAT_LOADED ? entry_b->stat_info.st_mtime : 0;
+    return compare_entries(entry_a->name, mtime_a, entry_b->name, mtime_b, g_lister_sort_mode,
+                           g_lister_reverse);
+}
+
+/**
+ * @brief Read and sort the whole directory for the sorted orders
+ */
+static int load_sorted(ListerDir *dir) {
+    struct dirent *entry;
+    while ((entry = next_selected(dir)) != NULL) {
+        if (append_entry(dir, entry) != 0) {
+            return -1;
+        }
+    }
+
+    SortMode mode = SORT_MODE_ALPHA;
+    if (dir->options.order == LISTER_ORDER_MTIME) {
+        // The sort key is metadata: fetch it once per entry, not per comparison
+        mode = SORT_MODE_MTIME;
+        for (size_t i = 0; i < dir->count; i++) {
+            load_stat(dir, &dir->entries[i]);
+        }
+    }
+
+    g_lister_sort_mode = mode;
+    g_lister_reverse = dir->options.reverse;
+    qsort(dir->entries, dir->count, sizeof(ListerEntry), compare_lister_entries);
+    return 0;
+}
+
+ListerDir *lister_open(const char *path, const ListerOptions *options,
+                       const ListerAllocator *allocator) {
+    if (path == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ListerAllocator chosen;
+    if (allocator != NULL && allocator->allocate != NULL && allocator->release != NULL) {
+        chosen = *allocator;
+    } else {
+        chosen.allocate = default_allocate;
+        chosen.release = default_release;
+        chosen.context = NULL;
+    }
+
+    ListerDir *dir = (ListerDir *)chosen.allocate(sizeof(ListerDir), chosen.context);
+    if (dir == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(dir, 0, sizeof(ListerDir));
+    dir->allocator = chosen;
+    if (options != NULL) {
+        dir->options = *options;
+    }
+
+    char error[128];
+    if (filter_compile(&dir->filter, NULL, 0, NULL, 0, dir->options.where, error,
+                       sizeof(error)) != 0) {
+        dir_release(dir, dir);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    dir->dir = opendir(path);
+    if (dir->dir == NULL) {
+        int saved_errno = errno;
+        filter_free(&dir->filter);
+        dir_release(dir, dir);
+        errno = saved_errno;
+        return NULL;
+    }
+
+    return dir;
+}
+
+const ListerEntry *lister_next(ListerDir *dir) {
+    if (dir == NULL) {
+        return NULL;
+    }
+
+    if (dir->options.order == LISTER_ORDER_DIRECTORY) {
+        struct dirent *entry = next_selected(dir);
+        if (entry == NULL) {
+            return NULL;
+        }
+        // Reuse the single entry slot: streaming needs no allocation at all
+        strcpy(dir->current_name, entry->d_name);
+        dir->current.name = dir->current_name;
+        dir->current.type = entry->d_type;
+        dir->current.stat_state = STAT_PENDING;
+        return &dir->current;
+    }
+
+    if (!dir->loaded) {
+        dir->loaded = 1;
+        if (load_sorted(dir) != 0) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    if (dir->position >= dir->count) {
+        return NULL;
+    }
+    return &dir->entries[dir->position++];
+}
+
+const char *lister_entry_name(const ListerEntry *entry) {
+    return entry != NULL ? entry->name : NULL;
+}
+
+unsigned char lister_entry_type(const ListerEntry *entry) {
+    return entry != NULL ? entry->type : DT_UNKNOWN;
+}
+
+const struct stat *lister_entry_stat(ListerDir *dir, const ListerEntry *entry) {
+    if (dir == NULL || entry == NULL) {
+        return NULL;
+    }
+    // Entries are handed out as const but cache their metadata lazily
+    ListerEntry *mutable_entry = (ListerEntry *)entry;
+    return load_stat(dir, mutable_entry) ? &mutable_entry->stat_info : NULL;
+}
+
+int lister_format_long(ListerDir *dir, const ListerEntry *entry, const ListerFormat *format,
+                       char *buffer, size_t buffer_size) {
+    const struct stat *stat_info = lister_entry_stat(dir, entry);
+    if (stat_info == NULL) {
+        return -1;
+    }
+
+    LongFormatWidths widths;
+    memset(&widths, 0, sizeof(LongFormatWidths));
+    int human_readable = 0;
+    if (format != NULL) {
+        human_readable = format->human_readable;
+        widths.links = format->link_width;
+        widths.owner = format->owner_width;
+        widths.group = format->group_width;
+        widths.size = format->size_width;
+    }
+
+    FileInfo info = file_info_from_stat(stat_info, entry->name, NULL);
+    int length = format_long_row(&info, &widths, human_readable ? LONG_FORMAT_HUMAN : 0, buffer,
+                                 buffer_size);
+    free_file_info(info);
+    return length;
+}
+
+void lister_format_size(long long size, char *buffer, size_t buffer_size) {
+    format_human_readable_size(size, buffer, buffer_size);
+}
+
+void lister_close(ListerDir *dir) {
+    if (dir == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < dir->count; i++) {
+        dir_release(dir, dir->entries[i].name);
+    }
+    dir_release(dir, dir->entries);
+
+    if (dir->dir != NULL) {
+        closedir(dir->dir);
+    }
+    filter_free(&dir->filter);
+    dir_release(dir, dir);
+}
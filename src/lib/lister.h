@@ -0,0 +1,135 @@
+#ifndef LISTER_H
+#define LISTER_H
+
+/*
+ * liblister: embeddable directory listing and formatting.
+ *
+ * A ListerDir is an opendir-style cursor. Entries are yielded one at a time;
+ * metadata is only fetched when lister_entry_stat() or a formatter asks for
+ * it. The cursor and the entries it buffers are allocated through the
+ * allocator passed to lister_open() (or malloc/free if none is given), and
+ * formatters write into caller-provided buffers.
+ */
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#if defined(__GNUC__)
+#define LISTER_API __attribute__((visibility("default")))
+#else
+#define LISTER_API
+#endif
+
+/**
+ * @brief Caller-supplied memory allocator
+ */
+typedef struct {
+    void *(*allocate)(size_t size, void *context);  // Return NULL on failure
+    void (*release)(void *ptr, void *context);       // Must accept NULL
+    void *context;                                   // Passed to both callbacks
+} ListerAllocator;
+
+/**
+ * @brief Order in which a cursor yields entries
+ */
+typedef enum {
+    LISTER_ORDER_DIRECTORY,  // Directory order, streamed without buffering
+    LISTER_ORDER_NAME,       // Sorted by name (reads the whole directory first)
+    LISTER_ORDER_MTIME       // Newest first, ties by name (reads and stats the whole directory first)
+} ListerOrder;
+
+/**
+ * @brief Options for lister_open()
+ */
+typedef struct {
+    int show_all;         // Non-zero to include entries starting with '.'
+    ListerOrder order;    // Order in which entries are yielded
+    int reverse;          // Non-zero to reverse a sorted order
+    const char *where;    // Filter expression (same syntax as --where), or NULL
+} ListerOptions;
+
+/**
+ * @brief Options for lister_format_long()
+ */
+typedef struct {
+    int human_readable;   // Non-zero for sizes like "1.5K"
+    int link_width;       // Minimum column widths (0: no padding)
+    int owner_width;
+    int group_width;
+    int size_width;
+} ListerFormat;
+
+typedef struct ListerDir ListerDir;
+typedef struct ListerEntry ListerEntry;
+
+/**
+ * @brief Open a listing cursor on a directory
+ *
+ * @param path Directory path
+ * @param options Listing options (NULL for defaults: directory order, no hidden entries)
+ * @param allocator Allocator for the cursor's memory (NULL for malloc/free)
+ * @return ListerDir* Cursor, or NULL on error (errno is set)
+ */
+LISTER_API ListerDir *lister_open(const char *path, const ListerOptions *options,
+                                  const ListerAllocator *allocator);
+
+/**
+ * @brief Advance to the next entry
+ *
+ * The returned entry stays valid until the next call to lister_next() in
+ * directory order, or until lister_close() in sorted orders.
+ *
+ * @param dir Open cursor
+ * @return const ListerEntry* Next entry, or NULL at the end of the listing
+ */
+LISTER_API const ListerEntry *lister_next(ListerDir *dir);
+
+/**
+ * @brief Name of an entry
+ */
+LISTER_API const char *lister_entry_name(const ListerEntry *entry);
+
+/**
+ * @brief Type of an entry as reported by readdir (DT_* value, DT_UNKNOWN if not provided)
+ */
+LISTER_API unsigned char lister_entry_type(const ListerEntry *entry);
+
+/**
+ * @brief Metadata of an entry, fetched on first use
+ *
+ * @param dir Cursor the entry came from
+ * @param entry Entry
+ * @return const struct stat* Metadata, or NULL if the entry can no longer be stat'ed
+ */
+LISTER_API const struct stat *lister_entry_stat(ListerDir *dir, const ListerEntry *entry);
+
+/**
+ * @brief Format an entry as a long-format (ls -l style) row, without a newline
+ *
+ * @param dir Cursor the entry came from
+ * @param entry Entry
+ * @param format Formatting options (NULL for defaults)
+ * @param buffer Destination buffer
+ * @param buffer_size Size of the destination buffer
+ * @return int Length of the full row as snprintf() reports it, or -1 if the entry cannot be stat'ed
+ */
+LISTER_API int lister_format_long(ListerDir *dir, const ListerEntry *entry,
+                                  const ListerFormat *format, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Format a size the way the human-readable listing does (e.g. "4.0K")
+ *
+ * @param size Size in bytes
+ * @param buffer Destination buffer (16 bytes is always enough)
+ * @param buffer_size Size of the destination buffer
+ */
+LISTER_API void lister_format_size(long long size, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Close a cursor and release all of its memory
+ *
+ * @param dir Cursor to close (may be NULL)
+ */
+LISTER_API void lister_close(ListerDir *dir);
+
+#endif
@@ -1,38 +1,162 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
 #include <sys/stat.h>
 
+#include "cache/listing_cache.h"
+#include "checksum/checksum.h"
+#include "child_count/child_count.h"
 #include "directory_reader.h"
 #include "display.h"
+#include "external_sort/external_sort.h"
+#include "external_sort/merged_listing.h"
 #include "file_info.h"
+#include "filter/filter.h"
+#include "history/history.h"
 #include "options.h"
+#include "pagination/pagination.h"
+#include "pipeline/pipeline.h"
+#include "server/server.h"
+#include "snapshot/snapshot.h"
+#include "summary/summary.h"
+#include "tree/tree.h"
 #include "sort/sort.h"
+#include "utils/arena.h"
+#include "utils/intern.h"
 #include "utils/path.h"
+#include "utils/spill.h"
+#include "watch/watch.h"
+#include "xattr/xattr.h"
 
+static int run_command(int argc, char *argv[]);
+static int run_parsed(int argc, char *argv[], int non_option_count, const Options *options);
+static int list_directory(int argc, char *argv[], int non_option_count, const Options *options);
 static const char *resolve_directory_path(int argc, char *argv[], int non_option_count);
-static FileInfo *collect_file_infos(const char *dir_path, DirectoryContent content);
-static void free_file_info_list(FileInfo *file_infos, int count);
+static FileInfo *collect_file_infos(const char *dir_path, DirectoryContent content,
+                                    const PipelineListing *pipelined, int xattrs,
+                                    StringIntern *contexts);
+static void free_file_info_list(FileInfo *file_infos, int count, const Arena *arena);
 static int render_listing(const DirectoryContent *content, const Options *options,
-                          const char *dir_path);
+                          const char *dir_path, const ListingCache *cache,
+                          const PipelineListing *pipelined);
+static int render_page(const char *dir_path, const Options *options, const Filter *filter);
+static int render_external(const char *dir_path, const Options *options, const Filter *filter);
+static int render_merged_listing(ExternalSort *sorter, const Options *options);
 static void print_help(const char *program_name);
 
 int main(int argc, char *argv[]) {
     Options options;
     int non_option_count = parse_options(argc, argv, &options);
 
+    if (non_option_count != -1 && options.serve_socket != NULL) {
+        if (options.serve_socket[0] == '\0') {
+            fprintf(stderr, "Error: --serve needs a socket path (--serve=SOCK)\n");
+            return 1;
+        }
+        if (options.connect_socket != NULL) {
+            fprintf(stderr, "Error: --serve cannot be used with --connect\n");
+            return 1;
+        }
+
+        // Handle --serve: run the commands of --connect clients until stopped
+        return server_run(options.serve_socket, run_command);
+    }
+
+    // Handle --connect: have the server run the command, or run it here if it cannot
+    // (--watch and --history runs always stay in this process)
+    if (options.connect_socket != NULL && !options.watch && !options.history) {
+        if (options.connect_socket[0] == '\0') {
+            fprintf(stderr, "Error: --connect needs a socket path (--connect=SOCK)\n");
+            return 1;
+        }
+        int status;
+        if (server_request(options.connect_socket, argc, argv, &status) == 0) {
+            return status;
+        }
+    }
+
+    return run_parsed(argc, argv, non_option_count, &options);
+}
+
+/**
+ * @brief Run a command line: what a standalone run does, and what a --serve worker
+ *        does for each request
+ *
+ * @param argc Number of arguments
+ * @param argv Argument array
+ * @return int Exit status
+ */
+static int run_command(int argc, char *argv[]) {
+    Options options;
+    int non_option_count = parse_options(argc, argv, &options);
+    return run_parsed(argc, argv, non_option_count, &options);
+}
+
+/**
+ * @brief Run a command line whose options are already parsed
+ *
+ * @param argc Number of arguments
+ * @param argv Argument array
+ * @param non_option_count Result of parse_options()
+ * @param options Parsed options
+ * @return int Exit status
+ */
+static int run_parsed(int argc, char *argv[], int non_option_count, const Options *options) {
     // Handle --help option (parse_options returns -1 if --help was found)
     if (non_option_count == -1) {
         print_help(argv[0]);
         return 0;
     }
 
+    // Handle --history-query: print recorded runs instead of listing
+    if (options->history_query != NULL) {
+        int64_t from_ns;
+        int64_t to_ns;
+        if (history_parse_range(options->history_query, &from_ns, &to_ns) != 0) {
+            fprintf(stderr, "Error: --history-query must be FROM, FROM..TO or ..TO, where each "
+                    "is an age (2h, 7d) or a date (2026-10-19 or 2026-10-19T14:30)\n");
+            return 1;
+        }
+        return history_query(options->history_file, from_ns, to_ns);
+    }
+
+    // Handle --history: output reaches the terminal as it is printed and the run is
+    // appended to the log when it ends
+    if (options->history && options->watch) {
+        fprintf(stderr, "Error: --history cannot be used with --watch\n");
+        return 1;
+    }
+    int recording = options->history && history_start(options->history_file, argc, argv) == 0;
+    int status = list_directory(argc, argv, non_option_count, options);
+    if (recording) {
+        history_finish(status);
+    }
+    return status;
+}
+
+/**
+ * @brief List the directory named on the command line as the options ask
+ *
+ * @param argc Number of arguments
+ * @param argv Argument array
+ * @param non_option_count Number of non-option arguments
+ * @param options Parsed options
+ * @return int Exit status
+ */
+static int list_directory(int argc, char *argv[], int non_option_count, const Options *options) {
     const char *dir_path = resolve_directory_path(argc, argv, non_option_count);
 
+    // -L: metadata describes what symbolic links point to (set per run, for --serve workers)
+    file_info_set_follow_links(options->follow_links);
+
     // Handle -d option: list directories themselves, not their contents
-    if (options.list_directories) {
+    if (options->list_directories) {
         struct stat path_stat;
-        if (stat(dir_path, &path_stat) != 0) {
+        if (fstatat(AT_FDCWD, dir_path, &path_stat, file_info_stat_flags()) != 0) {
             fprintf(stderr, "Error: Cannot access '%s'\n", dir_path);
             return 1;
         }
@@ -40,6 +164,9 @@ int main(int argc, char *argv[]) {
         // Create a DirectoryContent with just the directory name
         DirectoryContent content;
         content.count = 1;
+        content.types = NULL;
+        content.inodes = NULL;
+        content.arena = NULL;
         content.entries = (char **)malloc(sizeof(char *));
         if (content.entries == NULL) {
             fprintf(stderr, "Error: Memory allocation failed\n");
@@ -67,7 +194,7 @@ int main(int argc, char *argv[]) {
         strcpy(content.entries[0], name);
 
         // Display the directory itself
-        if (render_listing(&content, &options, dir_path) != 0) {
+        if (render_listing(&content, options, dir_path, NULL, NULL) != 0) {
             free_directory_content(content);
             return 1;
         }
@@ -76,24 +203,203 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    DirectoryContent content = read_directory(dir_path, options.show_all);
-    if (content.entries == NULL) {
-        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+    if (options->mem_limit < 0 ||
+        (options->mem_limit > 0 && options->mem_limit < EXTERNAL_SORT_MIN_MEMORY)) {
+        fprintf(stderr, "Error: --mem-limit must be a size of at least %dK\n",
+                EXTERNAL_SORT_MIN_MEMORY / 1024);
+        return 1;
+    }
+    if (options->threads < PIPELINE_WORKERS_AUTO) {
+        fprintf(stderr, "Error: --threads must be a number from 0 to %d\n", PIPELINE_MAX_WORKERS);
+        return 1;
+    }
+    if (options->deadline_ms < 0) {
+        fprintf(stderr, "Error: --deadline must be a positive number of milliseconds\n");
+        return 1;
+    }
+    if (options->checksum < 0) {
+        fprintf(stderr, "Error: --checksum must be xxh64 or sha256\n");
+        return 1;
+    }
+    if (options->summary < 0) {
+        fprintf(stderr, "Error: --summary must be owner, group, ext or age\n");
+        return 1;
+    }
+    if (options->count_limit < 0) {
+        fprintf(stderr, "Error: --count-limit must be a positive number\n");
+        return 1;
+    }
+    if (options->tree_depth < 0) {
+        fprintf(stderr, "Error: --depth must be a positive number\n");
+        return 1;
+    }
+    if (options->offset < 0) {
+        fprintf(stderr, "Error: --offset must be a number of entries\n");
+        return 1;
+    }
+    if (options->limit < -1) {
+        fprintf(stderr, "Error: --limit must be a number of entries\n");
+        return 1;
+    }
+    if (options->include_count < 0 || options->exclude_count < 0) {
+        fprintf(stderr, "Error: At most %d --include and %d --exclude patterns are allowed\n",
+                MAX_FILTER_PATTERNS, MAX_FILTER_PATTERNS);
         return 1;
     }
 
-    // Determine sort mode and sort entries
-    SortMode sort_mode = options.sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
-    sort_entries(content.entries, content.count, sort_mode, dir_path, options.reverse_sort);
+    // Compile --include/--exclude/--where once, before anything is read
+    Filter filter;
+    char filter_error[256];
+    if (filter_compile(&filter, options->include_patterns, options->include_count,
+                       options->exclude_patterns, options->exclude_count, options->where,
+                       filter_error, sizeof(filter_error)) != 0) {
+        fprintf(stderr, "Error: Invalid filter: %s\n", filter_error);
+        return 1;
+    }
 
-    // Display the listing
-    if (render_listing(&content, &options, dir_path) != 0) {
-        free_directory_content(content);
+    // Handle --summary: totals per group in one streaming pass, no listing
+    if (options->summary != SUMMARY_NONE) {
+        int summary_status = summary_directory(dir_path, options->show_all, &filter,
+                                               (SummaryKey)options->summary,
+                                               options->human_readable);
+        filter_free(&filter);
+        return summary_status;
+    }
+
+    // Handle --tree: walk the subdirectories level by level
+    if (options->tree) {
+        TreeConfig tree_config;
+        tree_config.show_all = options->show_all;
+        tree_config.filter = &filter;
+        tree_config.sorted = !options->unsorted;
+        tree_config.mode = options->sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
+        tree_config.reverse = options->reverse_sort;
+        tree_config.max_depth = options->tree_depth;
+        int tree_status = tree_display(dir_path, &tree_config);
+        filter_free(&filter);
+        return tree_status;
+    }
+
+    // Handle --watch option: keep re-rendering as the directory changes
+    if (options->watch) {
+        int watch_status = watch_directory(dir_path, options, &filter);
+        filter_free(&filter);
+        return watch_status;
+    }
+
+    // Handle --offset/--limit/--cursor: only the requested page is read and rendered
+    if (options->offset > 0 || options->limit >= 0 || options->cursor != NULL) {
+        int page_status = render_page(dir_path, options, &filter);
+        filter_free(&filter);
+        return page_status;
+    }
+
+    // Handle --mem-limit: sort within the budget, spilling runs to disk if needed
+    // (snapshots still need the whole listing in memory)
+    if (options->mem_limit > 0 && options->since_file == NULL && options->snapshot_out == NULL) {
+        int external_status = render_external(dir_path, options, &filter);
+        filter_free(&filter);
+        return external_status;
+    }
+
+    // Opt-in listing cache: --cache or LISTER_CACHE, always disabled by --no-cache
+    // A filtered listing is not the directory's full listing, so it bypasses the cache
+    int use_cache = options_cache_enabled(options) && !filter_is_active(&filter);
+    ListingCache cache;
+    memset(&cache, 0, sizeof(ListingCache));
+    if (use_cache) {
+        listing_cache_open(dir_path, options->show_all, &cache);
+    }
+
+    // Names, types, sort keys and file information for the whole run come from
+    // one arena and are released together at exit
+    Arena arena;
+    arena_init(&arena);
+
+    // When there is metadata to fetch, reading, filtering, stat'ing and sorting run as
+    // overlapping stages (a snapshot must cover the whole directory, which a pipelined
+    // read cut short by --deadline would not, so snapshots read sequentially);
+    // --deadline needs the pipeline so a hung stat() can be left behind
+    int use_pipeline = (options->threads != 0 || options->deadline_ms > 0) &&
+                       options->since_file == NULL &&
+                       options->snapshot_out == NULL &&
+                       (options->long_format || (options->sort_by_time && !options->unsorted) ||
+                        filter_is_active(&filter));
+    SortMode sort_mode = options->sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
+    PipelineListing pipelined;
+    int pipelined_read = 0;
+
+    DirectoryContent content;
+    if (cache.status != CACHE_MISS && cache.count > 0) {
+        // Cache hit: the directory itself is not read
+        content = listing_cache_content(&cache, &arena);
+    } else {
+        if (use_pipeline) {
+            PipelineConfig config;
+            config.dir_path = dir_path;
+            config.show_all = options->show_all;
+            config.filter = &filter;
+            config.keep_stats = options->long_format;
+            config.stat_flags = file_info_stat_flags();
+            config.xattrs = options->xattrs;
+            config.sorted = !options->unsorted;
+            config.mode = sort_mode;
+            config.reverse = options->reverse_sort;
+            config.workers = options->threads;
+            config.deadline_ms = options->deadline_ms;
+            pipelined_read = pipeline_read_listing(&config, &arena, &pipelined) == 0;
+        }
+        content = pipelined_read ? pipelined.content
+                                 : read_directory_filtered(dir_path, options->show_all, &filter,
+                                                           &arena);
+    }
+    int timed_out = pipelined_read && pipelined.timed_out;
+    if (content.entries == NULL) {
+        fprintf(stderr, timed_out ? "Error: Timed out reading directory '%s'\n"
+                                  : "Error: Cannot read directory '%s'\n", dir_path);
+        listing_cache_close(&cache);
+        filter_free(&filter);
+        arena_destroy(&arena);
         return 1;
     }
 
-    free_directory_content(content);
-    return 0;
+    // Decide the entries whose filter result depends on metadata (the pipeline already did)
+    if (!pipelined_read) {
+        filter_apply_metadata(&filter, dir_path, &content);
+    }
+    filter_free(&filter);
+
+    // Handle --since / --snapshot-out: diff against and/or record a snapshot
+    if (options->since_file != NULL || options->snapshot_out != NULL) {
+        int snapshot_status = snapshot_process(dir_path, &content, options->since_file,
+                                               options->snapshot_out);
+        // With --since only the differences are printed
+        if (options->since_file != NULL || snapshot_status != 0) {
+            listing_cache_close(&cache);
+            arena_destroy(&arena);
+            return snapshot_status;
+        }
+    }
+
+    // Sort entries (-U keeps directory order; the pipeline sorted as it read)
+    if (!options->unsorted && !pipelined_read) {
+        sort_directory_content(&content, sort_mode, dir_path, options->reverse_sort);
+    }
+
+    // Display the listing (a listing cut short by --deadline is not cached)
+    int status = render_listing(&content, options, dir_path,
+                                use_cache && !timed_out ? &cache : NULL,
+                                pipelined_read ? &pipelined : NULL);
+    if (timed_out) {
+        fprintf(stderr, "Warning: --deadline of %ld ms passed; %d entries are shown without "
+                "metadata and unread entries are missing\n", options->deadline_ms,
+                pipelined.pending_count);
+        status = 1;
+    }
+
+    listing_cache_close(&cache);
+    arena_destroy(&arena);
+    return status;
 }
 
 /**
@@ -122,45 +428,127 @@ static const char *resolve_directory_path(int argc, char *argv[], int non_option
     return dir_path;
 }
 
+/**
+ * @brief Fetch the ACL marker and security context of each entry, one after another
+ *
+ * @param dir_path Directory path
+ * @param file_infos File information to complete
+ * @param count Number of entries
+ * @param xattrs XATTR_* to fetch
+ * @param contexts Interning table, so entries with the same context share one copy
+ */
+static void fetch_file_xattrs(const char *dir_path, FileInfo *file_infos, int count, int xattrs,
+                              StringIntern *contexts) {
+    int follow = file_info_stat_flags() == 0;
+    char path[PATH_BUFFER_SIZE];
+    char context[XATTR_CONTEXT_SIZE];
+    for (int i = 0; i < count; i++) {
+        FileInfo *info = &file_infos[i];
+        if (info->metadata_missing ||
+            join_path(path, sizeof(path), dir_path, info->name) != 0) {
+            continue;
+        }
+        info->xattrs = xattr_fetch(path, xattrs, follow, context, sizeof(context));
+        if (xattrs & XATTR_CONTEXT) {
+            info->context = (info->xattrs & XATTR_CONTEXT) ? string_intern(contexts, context)
+                                                           : NULL;
+            if (info->context == NULL) {
+                info->context = "?";
+            }
+        }
+    }
+}
+
 /**
  * @brief Collect file information for all entries in a directory
  * 
  * @param dir_path Directory path
  * @param content Directory content structure
- * @return FileInfo* Array of file information (caller must free)
+ * @param pipelined Pipelined read whose stat results, link targets and extended
+ *        attributes to use, or NULL
+ * @param xattrs XATTR_* to fetch for each entry (0: none)
+ * @param contexts Interning table for the security contexts fetched here
+ * @return FileInfo* Array of file information, allocated from content.arena when
+ *         there is one (otherwise the caller must free)
  */
-static FileInfo *collect_file_infos(const char *dir_path, DirectoryContent content) {
+static FileInfo *collect_file_infos(const char *dir_path, DirectoryContent content,
+                                    const PipelineListing *pipelined, int xattrs,
+                                    StringIntern *contexts) {
     if (content.count == 0) {
         return NULL;
     }
 
-    FileInfo *file_infos = (FileInfo *)malloc(content.count * sizeof(FileInfo));
+    size_t infos_size = content.count * sizeof(FileInfo);
+    FileInfo *file_infos = (FileInfo *)(content.arena != NULL
+                                            ? arena_alloc(content.arena, infos_size)
+                                            : malloc(infos_size));
     if (file_infos == NULL) {
         return NULL;
     }
 
-    // Collect information for each file
-    for (int i = 0; i < content.count; i++) {
+    // Metadata (with link targets and extended attributes) already fetched by the
+    // pipeline only needs formatting
+    if (pipelined != NULL && pipelined->stats != NULL) {
+        for (int i = 0; i < content.count; i++) {
+            if (pipelined->stat_valid[i] != PIPELINE_STAT_OK) {
+                file_infos[i] = file_info_unknown(content.entries[i], content.arena);
+                continue;
+            }
+            file_infos[i] = file_info_from_stat(&pipelined->stats[i], content.entries[i],
+                                                content.arena);
+            file_infos[i].link_target = pipelined->link_targets[i];
+            if (pipelined->xattrs != NULL) {
+                file_infos[i].xattrs = pipelined->xattrs[i];
+                if (xattrs & XATTR_CONTEXT) {
+                    const char *context = pipelined->contexts[i];
+                    file_infos[i].context = context[0] != '\0' ? context : "?";
+                }
+            }
+        }
+        return file_infos;
+    }
+
+    // Stat relative to the directory instead of building a path per entry
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    // Collect information for each file in inode order; results land at the
+    // entry's own index, so the display order is unchanged
+    int *order = directory_stat_order(&content);
+    for (int k = 0; k < content.count; k++) {
+        int i = order != NULL ? order[k] : k;
         memset(&file_infos[i], 0, sizeof(FileInfo));
 
-        char *full_path = construct_full_path(dir_path, content.entries[i]);
-        if (full_path != NULL) {
-            file_infos[i] = get_file_info(full_path, content.entries[i]);
-            free(full_path);
+        if (dir_fd >= 0) {
+            file_infos[i] = get_file_info_at(dir_fd, content.entries[i], content.arena);
         }
+        // Unreadable metadata (a dangling link with -L, a vanished entry) is shown as '?'
+        if (file_infos[i].name == NULL) {
+            file_infos[i] = file_info_unknown(content.entries[i], content.arena);
+        }
+    }
+
+    if (xattrs != 0) {
+        fetch_file_xattrs(dir_path, file_infos, content.count, xattrs, contexts);
     }
 
+    if (content.arena == NULL) {
+        free(order);
+    }
+    if (dir_fd >= 0) {
+        close(dir_fd);
+    }
     return file_infos;
 }
 
 /**
- * @brief Free an array of FileInfo structures
+ * @brief Free a heap-allocated array of FileInfo structures
  * 
  * @param file_infos Array of FileInfo structures
  * @param count Number of entries
+ * @param arena Arena the array came from (nothing is freed), or NULL
  */
-static void free_file_info_list(FileInfo *file_infos, int count) {
-    if (file_infos == NULL) {
+static void free_file_info_list(FileInfo *file_infos, int count, const Arena *arena) {
+    if (file_infos == NULL || arena != NULL) {
         return;
     }
 
@@ -176,30 +564,245 @@ static void free_file_info_list(FileInfo *file_infos, int count) {
  * @param content Directory content
  * @param options Display options
  * @param dir_path Directory path
+ * @param cache Listing cache to read from and refresh, or NULL if caching is disabled
+ * @param pipelined Result of a pipelined read whose stat results to reuse, or NULL
  * @return int 0 on success, 1 on error
  */
 static int render_listing(const DirectoryContent *content, const Options *options,
-                          const char *dir_path) {
+                          const char *dir_path, const ListingCache *cache,
+                          const PipelineListing *pipelined) {
     if (content == NULL || options == NULL) {
         return 1;
     }
 
+    // The record only needs rewriting if it is stale
+    int store_cache = cache != NULL && cache->status != CACHE_HIT;
+
     // Display in normal format (just filenames)
     if (!options->long_format) {
+        int *order = options->show_size ? directory_stat_order(content) : NULL;
         display_normal((const char **)content->entries, content->count, 
-                       options->show_size, dir_path);
+                       options->show_size, dir_path, order);
+        if (content->arena == NULL) {
+            free(order);
+        }
+        if (store_cache) {
+            listing_cache_store(dir_path, options->show_all, cache, content);
+        }
         return 0;
     }
 
     // Display in long format (detailed information)
-    FileInfo *file_infos = collect_file_infos(dir_path, *content);
+    StringIntern contexts;
+    string_intern_init(&contexts, content->arena);
+    FileInfo *file_infos = collect_file_infos(dir_path, *content, pipelined,
+                                              options->xattrs, &contexts);
     if (content->count > 0 && file_infos == NULL) {
         fprintf(stderr, "Error: Unable to gather file information\n");
+        string_intern_free(&contexts);
+        return 1;
+    }
+    if (options->checksum != CHECKSUM_NONE) {
+        checksum_file_infos(dir_path, file_infos, content->count,
+                            (ChecksumAlgorithm)options->checksum, options_cache_enabled(options),
+                            content->arena);
+    }
+    if (options->count_children) {
+        child_count_file_infos(dir_path, content, file_infos, options->show_all,
+                               options->count_limit);
+    }
+
+    display_long_format(file_infos, content->count, options_long_format_flags(options));
+    if (store_cache) {
+        listing_cache_store(dir_path, options->show_all, cache, content);
+    }
+    free_file_info_list(file_infos, content->count, content->arena);
+    string_intern_free(&contexts);
+    return 0;
+}
+
+/**
+ * @brief Read and render one page of the listing
+ *
+ * Unsorted (-U) pages are read straight from the directory stream and print a
+ * resume token on stderr when more entries follow; sorted pages go through a
+ * bounded selection. Either way only the page's entries are formatted.
+ *
+ * @param dir_path Directory path
+ * @param options Display and paging options
+ * @param filter Compiled entry filter
+ * @return int 0 on success, 1 on error
+ */
+static int render_page(const char *dir_path, const Options *options, const Filter *filter) {
+    PageRequest request;
+    request.offset = options->offset;
+    request.limit = options->limit;
+    request.cursor = options->cursor;
+
+    DirectoryContent page;
+    char next_cursor[PAGE_CURSOR_SIZE];
+    next_cursor[0] = '\0';
+    int status;
+
+    if (options->unsorted) {
+        status = read_directory_page(dir_path, options->show_all, filter, &request, &page,
+                                     next_cursor);
+    } else if (options->cursor != NULL) {
+        fprintf(stderr, "Error: --cursor requires unsorted mode (-U)\n");
         return 1;
+    } else {
+        SortMode sort_mode = options->sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
+        status = read_directory_window(dir_path, options->show_all, filter, sort_mode,
+                                       options->reverse_sort, &request, &page);
     }
 
-    display_long_format(file_infos, content->count, options->human_readable);
-    free_file_info_list(file_infos, content->count);
+    if (status == -2) {
+        fprintf(stderr, "Error: Invalid cursor '%s'\n", options->cursor);
+        return 1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+        return 1;
+    }
+
+    status = render_listing(&page, options, dir_path, NULL, NULL);
+    free_directory_content(page);
+
+    if (status == 0 && next_cursor[0] != '\0') {
+        fflush(stdout);
+        fprintf(stderr, "next-cursor: %s\n", next_cursor);
+    }
+    return status;
+}
+
+/**
+ * @brief Read, sort and render a listing within the --mem-limit budget
+ *
+ * A listing that fits is rendered exactly like an in-memory one; otherwise
+ * the spilled runs are merged and streamed to the output.
+ *
+ * @param dir_path Directory path
+ * @param options Display options, including the memory budget
+ * @param filter Compiled entry filter
+ * @return int 0 on success, 1 on error
+ */
+static int render_external(const char *dir_path, const Options *options, const Filter *filter) {
+    SortMode sort_mode = options->sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
+    ExternalSort sorter;
+    if (external_sort_init(&sorter, dir_path, filter, sort_mode, options->reverse_sort,
+                           options->unsorted, (size_t)options->mem_limit) != 0 ||
+        read_directory_each(dir_path, options->show_all, filter, external_sort_add,
+                            &sorter) != 0) {
+        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+        external_sort_close(&sorter);
+        return 1;
+    }
+
+    int status;
+    if (!external_sort_spilled(&sorter)) {
+        // Everything fit: continue exactly like an in-memory listing
+        DirectoryContent content = external_sort_content(&sorter);
+        if (content.entries == NULL) {
+            fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+            external_sort_close(&sorter);
+            return 1;
+        }
+        filter_apply_metadata(filter, dir_path, &content);
+        if (!options->unsorted) {
+            sort_directory_content(&content, sort_mode, dir_path, options->reverse_sort);
+        }
+        status = render_listing(&content, options, dir_path, NULL, NULL);
+    } else if (external_sort_finish(&sorter) != 0) {
+        fprintf(stderr, "Error: Cannot merge sorted runs\n");
+        status = 1;
+    } else {
+        status = render_merged_listing(&sorter, options);
+    }
+
+    external_sort_close(&sorter);
+    return status;
+}
+
+/**
+ * @brief Render a merged listing that did not fit in memory
+ *
+ * The merged entries are recorded once while the column widths (or the block
+ * total) are measured, then read back through cursors and printed.
+ *
+ * @param sorter Finished external sort
+ * @param options Display options
+ * @return int 0 on success, 1 on error
+ */
+static int render_merged_listing(ExternalSort *sorter, const Options *options) {
+    MergedListingConfig config;
+    config.long_format = options->long_format;
+    config.show_size = !options->long_format && options->show_size;
+    config.long_flags = options_long_format_flags(options);
+    config.checksum = options->checksum;
+    config.xattrs = options->xattrs;
+    config.count_children = options->count_children;
+    config.show_all = options->show_all;
+    config.count_limit = options->count_limit;
+
+    MergedListing listing;
+    if (merged_listing_build(&listing, sorter, &config) != 0) {
+        fprintf(stderr, "Error: Cannot merge sorted runs\n");
+        return 1;
+    }
+    if (listing.count == 0) {
+        merged_listing_close(&listing);
+        return 0;
+    }
+
+    // Names alone are printed column-major like display_normal(), one cursor per
+    // column; rows with metadata are read with a single cursor
+    int column_width = 0;
+    int num_rows = listing.count;
+    int num_columns = 1;
+    if (!config.long_format && !config.show_size) {
+        compute_column_layout(listing.max_name_len, listing.count, &column_width, &num_rows);
+        num_columns = (listing.count + num_rows - 1) / num_rows;  // Columns actually used
+    }
+    MergedCursor *cursors = (MergedCursor *)malloc(num_columns * sizeof(MergedCursor));
+    int opened = cursors != NULL &&
+                 merged_listing_cursors(&listing, num_rows, num_columns, cursors) == 0;
+    int status = opened ? 0 : -1;
+
+    if (opened && (config.show_size || (config.long_flags & LONG_FORMAT_BLOCKS))) {
+        printf("total %lld\n", listing.total_blocks);
+    }
+    for (int row = 0; row < num_rows && status == 0; row++) {
+        for (int col = 0; col < num_columns; col++) {
+            if (col * num_rows + row >= listing.count) {
+                continue;
+            }
+            MergedCursor *cursor = &cursors[col];
+            if (merged_cursor_next(cursor) != 1) {
+                status = -1;
+                break;
+            }
+            if (config.long_format) {
+                print_long_row(&cursor->info, &listing.widths, config.long_flags);
+            } else if (config.show_size) {
+                printf("%lld %s\n", cursor->blocks, cursor->name);
+            } else {
+                printf("%-*s", column_width, cursor->name);
+            }
+        }
+        if (!config.long_format && !config.show_size) {
+            printf("\n");
+        }
+    }
+
+    for (int col = 0; opened && col < num_columns; col++) {
+        merged_cursor_close(&cursors[col]);
+    }
+    free(cursors);
+    merged_listing_close(&listing);
+    if (status != 0) {
+        fprintf(stderr, "Error: Cannot read merged listing\n");
+        return 1;
+    }
     return 0;
 }
 
@@ -218,9 +821,54 @@ static void print_help(const char *program_name) {
     printf("  -d                     List directories themselves, not their contents\n");
     printf("  -h                     Display file sizes in human-readable format (use with -l)\n");
     printf("  -l                     Use long format (detailed information)\n");
+    printf("  -L                     Show what symbolic links point to instead of the links\n");
     printf("  -r                     Reverse the sort order\n");
+    printf("  -n                     Like -l, but show numeric user and group IDs\n");
     printf("  -s                     Display file size in blocks (512-byte blocks)\n");
     printf("  -t                     Sort by modification time instead of alphabetically\n");
+    printf("  -U                     Do not sort; list entries in directory order\n");
+    printf("  -Z                     Add a column with each entry's SELinux security context and\n");
+    printf("                         mark entries that have an ACL with '+' (implies -l)\n");
+    printf("  --watch                Keep the listing on screen and update it as the directory changes\n");
+    printf("  --cache                Use the persistent listing and checksum caches (also enabled\n");
+    printf("                         by LISTER_CACHE)\n");
+    printf("  --no-cache             Never read or write the caches\n");
+    printf("  --snapshot-out=FILE    Write a snapshot of the listing (name, inode, size, mtime, mode) to FILE\n");
+    printf("  --since=FILE           Show only entries added (+), removed (-) or modified (M) since snapshot FILE\n");
+    printf("  --include=GLOB         Only list names matching GLOB (may be repeated)\n");
+    printf("  --exclude=GLOB         Do not list names matching GLOB (may be repeated)\n");
+    printf("  --where=EXPR           Only list entries satisfying EXPR, e.g. 'size>1G && mtime<7d && type==f'\n");
+    printf("                         Fields: name, type (f d l p s c b), size, mtime (age), links\n");
+    printf("  --offset=N             Skip the first N entries of the listing\n");
+    printf("  --limit=N              List at most N entries\n");
+    printf("  --cursor=TOKEN         With -U, continue after the page that printed 'next-cursor: TOKEN'\n");
+    printf("  --mem-limit=SIZE       Keep at most SIZE bytes of entries in memory (K, M, G suffixes);\n");
+    printf("                         larger listings are sorted in runs spilled to $TMPDIR\n");
+    printf("  --threads=N            Stat entries on N worker threads while the directory is read\n");
+    printf("                         (default: chosen from the filesystem type; 0 reads, stats and\n");
+    printf("                         sorts one step at a time)\n");
+    printf("  --deadline=MS          With -l, -t or --where, stop waiting for metadata after MS\n");
+    printf("                         milliseconds and show what has not arrived as '?'; bounds\n");
+    printf("                         reading and stat'ing only (not --checksum, --count-children,\n");
+    printf("                         owner lookups, or modes that do not use the pipeline)\n");
+    printf("  --checksum[=ALGO]      Add a column with each file's content hash (implies -l);\n");
+    printf("                         ALGO is xxh64 (default) or sha256\n");
+    printf("  --summary=KEY          Print the number of entries and bytes per owner, group, ext\n");
+    printf("                         (extension) or age instead of listing them (-h for sizes)\n");
+    printf("  --tree                 Show the directory and everything below it as a tree\n");
+    printf("  --depth=N              With --tree, descend at most N levels\n");
+    printf("  --count-children       Add a column with the number of entries in each\n");
+    printf("                         subdirectory (implies -l)\n");
+    printf("  --count-limit=N        With --count-children, stop counting at N entries (shown as N+)\n");
+    printf("  --acl                  Mark entries that have an ACL with '+' after the permissions\n");
+    printf("                         (implies -l)\n");
+    printf("  --history[=FILE]       Also append the command and its output to a history log\n");
+    printf("                         (default: $LISTER_HISTORY_FILE or ~/.lister_history)\n");
+    printf("  --history-query[=RANGE]  Print the logged runs in RANGE: FROM, FROM..TO or ..TO,\n");
+    printf("                         each an age (2h, 7d) or a date (2026-10-19T14:30)\n");
+    printf("  --serve=SOCK           Serve the commands of --connect clients on Unix socket SOCK\n");
+    printf("  --connect=SOCK         Have the server on SOCK run this command (output is the same);\n");
+    printf("                         runs here if it cannot be reached\n");
     printf("  --help                 Display this help message and exit\n");
     printf("\n");
     printf("When using -l (long format), you can combine with -h for human-readable sizes:\n");
@@ -233,5 +881,7 @@ static void print_help(const char *program_name) {
     printf("  %s -d src              Show directory 'src' itself\n", program_name);
     printf("  %s -lh                 Long format with human-readable sizes\n", program_name);
     printf("  %s -rt                 Sort by time in reverse order\n", program_name);
+    printf("  %s --since=old.snap --snapshot-out=old.snap  Report and record changes\n", program_name);
+    printf("  %s -lt --watch         Live long listing, newest first\n", program_name);
     printf("\n");
 }
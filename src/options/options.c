@@ -1,4 +1,10 @@
 #include "options.h"
+#include "checksum/checksum.h"
+#include "display.h"
+#include "pipeline/pipeline.h"
+#include "summary/summary.h"
+#include "xattr/xattr.h"
+#include <stdlib.h>
 #include <string.h>
 
 void init_options(Options *options) {
@@ -12,6 +18,84 @@ void init_options(Options *options) {
     options->list_directories = 0;
     options->human_readable = 0;
     options->reverse_sort = 0;
+    options->unsorted = 0;
+    options->numeric_ids = 0;
+    options->follow_links = 0;
+    options->xattrs = 0;
+    options->watch = 0;
+    options->use_cache = 0;
+    options->no_cache = 0;
+    options->snapshot_out = NULL;
+    options->since_file = NULL;
+    options->include_count = 0;
+    options->exclude_count = 0;
+    options->where = NULL;
+    options->offset = 0;
+    options->limit = -1;
+    options->cursor = NULL;
+    options->mem_limit = 0;
+    options->threads = PIPELINE_WORKERS_AUTO;
+    options->deadline_ms = 0;
+    options->checksum = CHECKSUM_NONE;
+    options->summary = SUMMARY_NONE;
+    options->count_children = 0;
+    options->count_limit = 0;
+    options->tree = 0;
+    options->tree_depth = 0;
+    options->history = 0;
+    options->history_file = NULL;
+    options->history_query = NULL;
+    options->serve_socket = NULL;
+    options->connect_socket = NULL;
+}
+
+/**
+ * @brief Parse a size with an optional K, M or G suffix (powers of 1024)
+ *
+ * @param text Size text, e.g. "512M"
+ * @return long long Size in bytes, or -1 if the text is not a positive size
+ */
+static long long parse_size(const char *text) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value <= 0) {
+        return -1;
+    }
+
+    long long multiplier = 1;
+    if (*end == 'K' || *end == 'k') {
+        multiplier = 1024LL;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        multiplier = 1024LL * 1024;
+        end++;
+    } else if (*end == 'G' || *end == 'g') {
+        multiplier = 1024LL * 1024 * 1024;
+        end++;
+    }
+
+    if (*end != '\0' || value > (1LL << 62) / multiplier) {
+        return -1;
+    }
+    return value * multiplier;
+}
+
+int options_long_format_flags(const Options *options) {
+    int flags = 0;
+    if (options->human_readable) {
+        flags |= LONG_FORMAT_HUMAN;
+    }
+    if (options->show_size) {
+        flags |= LONG_FORMAT_BLOCKS;
+    }
+    if (options->numeric_ids) {
+        flags |= LONG_FORMAT_NUMERIC;
+    }
+    return flags;
+}
+
+int options_cache_enabled(const Options *options) {
+    return !options->no_cache && (options->use_cache || getenv("LISTER_CACHE") != NULL);
 }
 
 int parse_options(int argc, char *argv[], Options *options) {
@@ -33,6 +117,105 @@ int parse_options(int argc, char *argv[], Options *options) {
             return -1;
         }
 
+        // Other long options ("--name"); unknown ones are ignored
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (strcmp(argv[i], "--watch") == 0) {
+                options->watch = 1;
+            } else if (strcmp(argv[i], "--cache") == 0) {
+                options->use_cache = 1;
+            } else if (strcmp(argv[i], "--no-cache") == 0) {
+                options->no_cache = 1;
+            } else if (strncmp(argv[i], "--snapshot-out=", 15) == 0) {
+                options->snapshot_out = argv[i] + 15;
+            } else if (strncmp(argv[i], "--since=", 8) == 0) {
+                options->since_file = argv[i] + 8;
+            } else if (strncmp(argv[i], "--include=", 10) == 0) {
+                // -1 marks too many patterns, reported before anything is listed
+                if (options->include_count == MAX_FILTER_PATTERNS) {
+                    options->include_count = -1;
+                } else if (options->include_count >= 0) {
+                    options->include_patterns[options->include_count++] = argv[i] + 10;
+                }
+            } else if (strncmp(argv[i], "--exclude=", 10) == 0) {
+                if (options->exclude_count == MAX_FILTER_PATTERNS) {
+                    options->exclude_count = -1;
+                } else if (options->exclude_count >= 0) {
+                    options->exclude_patterns[options->exclude_count++] = argv[i] + 10;
+                }
+            } else if (strncmp(argv[i], "--where=", 8) == 0) {
+                options->where = argv[i] + 8;
+            } else if (strncmp(argv[i], "--offset=", 9) == 0) {
+                char *end;
+                long offset = strtol(argv[i] + 9, &end, 10);
+                options->offset = (end == argv[i] + 9 || *end != '\0' || offset < 0) ? -1 : offset;
+            } else if (strncmp(argv[i], "--limit=", 8) == 0) {
+                char *end;
+                long limit = strtol(argv[i] + 8, &end, 10);
+                options->limit = (end == argv[i] + 8 || *end != '\0' || limit < 0) ? -2 : limit;
+            } else if (strncmp(argv[i], "--cursor=", 9) == 0) {
+                options->cursor = argv[i] + 9;
+            } else if (strncmp(argv[i], "--mem-limit=", 12) == 0) {
+                options->mem_limit = parse_size(argv[i] + 12);
+            } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+                char *end;
+                long threads = strtol(argv[i] + 10, &end, 10);
+                options->threads = (end == argv[i] + 10 || *end != '\0' || threads < 0 ||
+                                    threads > PIPELINE_MAX_WORKERS) ? -2 : (int)threads;
+            } else if (strncmp(argv[i], "--deadline=", 11) == 0) {
+                char *end;
+                long deadline_ms = strtol(argv[i] + 11, &end, 10);
+                options->deadline_ms = (end == argv[i] + 11 || *end != '\0' || deadline_ms <= 0)
+                                           ? -1 : deadline_ms;
+            } else if (strcmp(argv[i], "--checksum") == 0) {
+                // The hash is a long-format column
+                options->checksum = CHECKSUM_XXH64;
+                options->long_format = 1;
+            } else if (strncmp(argv[i], "--checksum=", 11) == 0) {
+                options->checksum = checksum_parse(argv[i] + 11);
+                options->long_format = 1;
+            } else if (strncmp(argv[i], "--summary=", 10) == 0) {
+                options->summary = summary_parse(argv[i] + 10);
+            } else if (strcmp(argv[i], "--count-children") == 0) {
+                // The count is a long-format column
+                options->count_children = 1;
+                options->long_format = 1;
+            } else if (strcmp(argv[i], "--acl") == 0) {
+                // The marker is part of the long-format permissions
+                options->xattrs |= XATTR_ACL;
+                options->long_format = 1;
+            } else if (strncmp(argv[i], "--count-limit=", 14) == 0) {
+                char *end;
+                long long limit = strtoll(argv[i] + 14, &end, 10);
+                options->count_limit = (end == argv[i] + 14 || *end != '\0' || limit <= 0)
+                                           ? -1 : limit;
+            } else if (strcmp(argv[i], "--tree") == 0) {
+                options->tree = 1;
+            } else if (strncmp(argv[i], "--depth=", 8) == 0) {
+                char *end;
+                long depth = strtol(argv[i] + 8, &end, 10);
+                options->tree_depth = (end == argv[i] + 8 || *end != '\0' || depth <= 0 ||
+                                       depth > 100000) ? -1 : (int)depth;
+            } else if (strcmp(argv[i], "--history") == 0) {
+                options->history = 1;
+            } else if (strncmp(argv[i], "--history=", 10) == 0) {
+                options->history = 1;
+                options->history_file = argv[i][10] != '\0' ? argv[i] + 10 : NULL;
+            } else if (strcmp(argv[i], "--history-query") == 0) {
+                options->history_query = "";
+            } else if (strncmp(argv[i], "--history-query=", 16) == 0) {
+                options->history_query = argv[i] + 16;
+            } else if (strcmp(argv[i], "--serve") == 0) {
+                options->serve_socket = "";
+            } else if (strncmp(argv[i], "--serve=", 8) == 0) {
+                options->serve_socket = argv[i] + 8;
+            } else if (strcmp(argv[i], "--connect") == 0) {
+                options->connect_socket = "";
+            } else if (strncmp(argv[i], "--connect=", 10) == 0) {
+                options->connect_socket = argv[i] + 10;
+            }
+            continue;
+        }
+
         // Check if argument is an option flag (starts with '-')
         if (argv[i][0] == '-' && strlen(argv[i]) > 1) {
             // Process each character in the option string (e.g., "-al" processes 'a' and 'l')
@@ -59,6 +242,22 @@ int parse_options(int argc, char *argv[], Options *options) {
                     case 'r':
                         options->reverse_sort = 1;
                         break;
+                    case 'U':
+                        options->unsorted = 1;
+                        break;
+                    case 'n':
+                        // Like ls, -n implies -l
+                        options->numeric_ids = 1;
+                        options->long_format = 1;
+                        break;
+                    case 'L':
+                        options->follow_links = 1;
+                        break;
+                    case 'Z':
+                        // The context is a long-format column, shown with the ACL marker
+                        options->xattrs |= XATTR_ACL | XATTR_CONTEXT;
+                        options->long_format = 1;
+                        break;
                     default:
                         // Ignore unknown options
                         break;
@@ -1,6 +1,9 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
 
+// Maximum number of --include or --exclude patterns
+#define MAX_FILTER_PATTERNS 32
+
 /**
  * @brief Structure to hold parsed command-line options
  */
@@ -12,6 +15,43 @@ typedef struct {
     int list_directories;  // -d flag: list directories themselves, not their contents
     int human_readable;   // -h flag: display file sizes in human-readable format
     int reverse_sort;      // -r flag: reverse the sort order
+    int unsorted;          // -U flag: do not sort; list entries in directory order
+    int numeric_ids;       // -n flag: long format with numeric user and group IDs
+    int follow_links;      // -L flag: show what symbolic links point to instead of the links
+    int xattrs;            // -Z and --acl flags: XATTR_* bits to show (-Z: security context
+                           // column and marker, --acl: ACL marker)
+    int watch;             // --watch flag: keep the listing updated as the directory changes
+    int use_cache;         // --cache flag: use the persistent listing and checksum caches
+    int no_cache;          // --no-cache flag: never use the caches (overrides --cache and LISTER_CACHE)
+    const char *snapshot_out;  // --snapshot-out=FILE: write a snapshot of the listing to FILE
+    const char *since_file;    // --since=FILE: show only changes relative to the snapshot in FILE
+    const char *include_patterns[MAX_FILTER_PATTERNS];  // --include=GLOB: only list matching names
+    int include_count;     // -1 if more than MAX_FILTER_PATTERNS were given
+    const char *exclude_patterns[MAX_FILTER_PATTERNS];  // --exclude=GLOB: do not list matching names
+    int exclude_count;     // -1 if more than MAX_FILTER_PATTERNS were given
+    const char *where;     // --where=EXPR: only list entries satisfying the expression
+    long offset;           // --offset=N: skip the first N entries of the listing (-1: invalid)
+    long limit;            // --limit=N: list at most N entries (-1: no limit, -2: invalid)
+    const char *cursor;    // --cursor=TOKEN: resume an unsorted listing where a previous page ended
+    long long mem_limit;   // --mem-limit=SIZE: memory budget for entries in bytes (0: none, -1: invalid)
+    int threads;           // --threads=N: metadata worker threads (-1: chosen per filesystem,
+                           // 0: read sequentially, -2: invalid)
+    long deadline_ms;      // --deadline=MS: stop waiting for metadata after MS milliseconds
+                           // (0: none, -1: invalid)
+    int checksum;          // --checksum[=ALGO]: ChecksumAlgorithm of the hash column
+                           // (CHECKSUM_NONE: no column, -1: invalid)
+    int summary;           // --summary=KEY: SummaryKey to aggregate by instead of listing
+                           // (SUMMARY_NONE: list entries, -1: invalid)
+    int count_children;    // --count-children flag: add a column with each subdirectory's entry count
+    long long count_limit; // --count-limit=N: stop counting a subdirectory at N (0: no limit, -1: invalid)
+    int tree;              // --tree flag: show the directory and its subdirectories as a tree
+    int tree_depth;        // --depth=N: levels shown by --tree (0: no limit, -1: invalid)
+    int history;           // --history[=FILE] flag: record the run in the history log
+    const char *history_file;   // FILE of --history=FILE (NULL: $LISTER_HISTORY_FILE or ~/.lister_history)
+    const char *history_query;  // --history-query[=RANGE]: print recorded runs instead of listing
+                                // (NULL: not given, "": all runs)
+    const char *serve_socket;   // SOCK of --serve=SOCK: serve listings instead of listing
+    const char *connect_socket; // SOCK of --connect=SOCK: have that server run the command
 } Options;
 
 /**
@@ -24,6 +64,23 @@ typedef struct {
  */
 int parse_options(int argc, char *argv[], Options *options);
 
+/**
+ * @brief Long-format row layout selected by the options
+ *
+ * @param options Parsed options
+ * @return int LONG_FORMAT_* flags for -h, -s and -n
+ */
+int options_long_format_flags(const Options *options);
+
+/**
+ * @brief Whether the persistent caches are enabled: --cache or LISTER_CACHE,
+ *        always disabled by --no-cache
+ *
+ * @param options Parsed options
+ * @return int Non-zero if the listing and checksum caches may be used
+ */
+int options_cache_enabled(const Options *options);
+
 /**
  * @brief Initialize options structure with default values
  * 
@@ -0,0 +1,323 @@
+#define _DEFAULT_SOURCE
+#include "pagination.h"
+#include "file_info.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @brief One candidate kept by the bounded selection
+ */
+typedef struct {
+    char *name;
+    unsigned char type;
+    time_t mtime;
+} WindowEntry;
+
+/**
+ * @brief Check whether a readdir entry belongs in the listing
+ *
+ * Applies the hidden-file rule and the filter; metadata tests are only run
+ * for entries the name and type cannot decide.
+ */
+static int entry_selected(DIR *dir, const struct dirent *entry, int show_all,
+                          const Filter *filter) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        return 0;
+    }
+    if (!show_all && entry->d_name[0] == '.') {
+        return 0;
+    }
+    return filter_entry_passes(filter, dirfd(dir), entry->d_name, entry->d_type);
+}
+
+static void init_page(DirectoryContent *page) {
+    page->entries = NULL;
+    page->types = NULL;
+    page->inodes = NULL;
+    page->count = 0;
+    page->arena = NULL;
+}
+
+static int allocate_page(DirectoryContent *page, long capacity) {
+    if (capacity <= 0) {
+        return 0;
+    }
+    page->entries = (char **)malloc(capacity * sizeof(char *));
+    page->types = (unsigned char *)malloc(capacity * sizeof(unsigned char));
+    if (page->entries == NULL || page->types == NULL) {
+        free(page->entries);
+        free(page->types);
+        init_page(page);
+        return -1;
+    }
+    return 0;
+}
+
+int read_directory_page(const char *path, int show_all, const Filter *filter,
+                        const PageRequest *request, DirectoryContent *page, char *next_cursor) {
+    init_page(page);
+    next_cursor[0] = '\0';
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    struct stat dir_stat;
+    if (fstat(dirfd(dir), &dir_stat) != 0) {
+        closedir(dir);
+        return -1;
+    }
+
+    // A cursor is "<directory inode>-<telldir position>" in hex; the inode
+    // guards against replaying a token on another directory
+    if (request->cursor != NULL && request->cursor[0] != '\0') {
+        unsigned long long cursor_ino;
+        long position;
+        char trailing;
+        if (sscanf(request->cursor, "%llx-%lx%c", &cursor_ino, &position, &trailing) != 2 ||
+            cursor_ino != (unsigned long long)dir_stat.st_ino) {
+            closedir(dir);
+            return -2;
+        }
+        seekdir(dir, position);
+    }
+
+    long limit = request->limit;
+    if (allocate_page(page, limit > 0 ? limit : 64) != 0) {
+        closedir(dir);
+        return -1;
+    }
+    long capacity = limit > 0 ? limit : 64;
+
+    long skipped = 0;
+    struct dirent *entry;
+    while ((limit < 0 || page->count < limit) && (entry = readdir(dir)) != NULL) {
+        if (!entry_selected(dir, entry, show_all, filter)) {
+            continue;
+        }
+        if (skipped < request->offset) {
+            skipped++;
+            continue;
+        }
+
+        if (page->count == capacity) {
+            capacity *= 2;
+            char **entries = (char **)realloc(page->entries, capacity * sizeof(char *));
+            unsigned char *types = entries != NULL
+                ? (unsigned char *)realloc(page->types, capacity * sizeof(unsigned char))
+                : NULL;
+            if (entries != NULL) {
+                page->entries = entries;
+            }
+            if (types == NULL) {
+                free_directory_content(*page);
+                init_page(page);
+                closedir(dir);
+                return -1;
+            }
+            page->types = types;
+        }
+
+        page->entries[page->count] = strdup(entry->d_name);
+        if (page->entries[page->count] == NULL) {
+            free_directory_content(*page);
+            init_page(page);
+            closedir(dir);
+            return -1;
+        }
+        page->types[page->count] = entry->d_type;
+        page->count++;
+    }
+
+    // The page is full: hand out a cursor only if something follows it
+    if (limit >= 0 && page->count == limit) {
+        long position = telldir(dir);
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry_selected(dir, entry, show_all, filter)) {
+                snprintf(next_cursor, PAGE_CURSOR_SIZE, "%llx-%lx",
+                         (unsigned long long)dir_stat.st_ino, position);
+                break;
+            }
+            position = telldir(dir);
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+// Sort parameters for the heap comparisons below
+static SortMode g_window_mode = SORT_MODE_ALPHA;
+static int g_window_reverse = 0;
+
+static int compare_window_entries(const void *a, const void *b) {
+    const WindowEntry *entry_a = (const WindowEntry *)a;
+    const WindowEntry *entry_b = (const WindowEntry *)b;
+    return compare_entries(entry_a->name, entry_a->mtime, entry_b->name, entry_b->mtime,
+                           g_window_mode, g_window_reverse);
+}
+
+/**
+ * @brief Restore the max-heap property downwards from index
+ */
+static void sift_down(WindowEntry *heap, long count, long index) {
+    for (;;) {
+        long largest = index;
+        long left = 2 * index + 1;
+        long right = left + 1;
+        if (left < count && compare_window_entries(&heap[left], &heap[largest]) > 0) {
+            largest = left;
+        }
+        if (right < count && compare_window_entries(&heap[right], &heap[largest]) > 0) {
+            largest = right;
+        }
+        if (largest == index) {
+            return;
+        }
+        WindowEntry temp = heap[index];
+        heap[index] = heap[largest];
+        heap[largest] = temp;
+        index = largest;
+    }
+}
+
+static void sift_up(WindowEntry *heap, long index) {
+    while (index > 0) {
+        long parent = (index - 1) / 2;
+        if (compare_window_entries(&heap[index], &heap[parent]) <= 0) {
+            return;
+        }
+        WindowEntry temp = heap[index];
+        heap[index] = heap[parent];
+        heap[parent] = temp;
+        index = parent;
+    }
+}
+
+/**
+ * @brief Read, sort and drop the first offset entries (unbounded window)
+ */
+static int read_sorted_tail(const char *path, int show_all, const Filter *filter, SortMode mode,
+                            int reverse, long offset, DirectoryContent *page) {
+    DirectoryContent content = read_directory_filtered(path, show_all, filter, NULL);
+    if (content.entries == NULL) {
+        return -1;
+    }
+    filter_apply_metadata(filter, path, &content);
+    sort_directory_content(&content, mode, path, reverse);
+
+    long skip = offset < content.count ? offset : content.count;
+    for (long i = 0; i < skip; i++) {
+        free(content.entries[i]);
+    }
+    memmove(content.entries, content.entries + skip, (content.count - skip) * sizeof(char *));
+    if (content.types != NULL) {
+        memmove(content.types, content.types + skip, content.count - skip);
+    }
+    if (content.inodes != NULL) {
+        memmove(content.inodes, content.inodes + skip, (content.count - skip) * sizeof(ino_t));
+    }
+    content.count -= (int)skip;
+
+    *page = content;
+    return 0;
+}
+
+int read_directory_window(const char *path, int show_all, const Filter *filter, SortMode mode,
+                          int reverse, const PageRequest *request, DirectoryContent *page) {
+    init_page(page);
+
+    if (request->limit < 0) {
+        // No upper bound: there is nothing to gain from a heap
+        return read_sorted_tail(path, show_all, filter, mode, reverse, request->offset, page);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    // The heap keeps the offset + limit entries that sort first; its root is
+    // the worst of them, evicted whenever a better entry arrives
+    long keep = request->offset + request->limit;
+    WindowEntry *heap = keep > 0 ? (WindowEntry *)malloc(keep * sizeof(WindowEntry)) : NULL;
+    if (keep > 0 && heap == NULL) {
+        closedir(dir);
+        return -1;
+    }
+
+    g_window_mode = mode;
+    g_window_reverse = reverse;
+
+    long heap_count = 0;
+    int status = 0;
+    struct dirent *entry;
+    while (keep > 0 && (entry = readdir(dir)) != NULL) {
+        if (!entry_selected(dir, entry, show_all, filter)) {
+            continue;
+        }
+
+        WindowEntry candidate;
+        candidate.name = entry->d_name;
+        candidate.type = entry->d_type;
+        candidate.mtime = 0;
+
+        if (mode == SORT_MODE_MTIME) {
+            struct stat stat_info;
+            if (fstatat(dirfd(dir), entry->d_name, &stat_info, file_info_stat_flags()) == 0) {
+                candidate.mtime = stat_info.st_mtime;
+            }
+        }
+
+        if (heap_count == keep && compare_window_entries(&candidate, &heap[0]) >= 0) {
+            // Sorts after everything already kept: never copied
+            continue;
+        }
+
+        char *name = strdup(entry->d_name);
+        if (name == NULL) {
+            status = -1;
+            break;
+        }
+        candidate.name = name;
+
+        if (heap_count < keep) {
+            heap[heap_count] = candidate;
+            sift_up(heap, heap_count);
+            heap_count++;
+        } else {
+            free(heap[0].name);
+            heap[0] = candidate;
+            sift_down(heap, heap_count, 0);
+        }
+    }
+    closedir(dir);
+
+    if (status == 0) {
+        qsort(heap, heap_count, sizeof(WindowEntry), compare_window_entries);
+    }
+
+    long first = request->offset;
+    long available = heap_count > first ? heap_count - first : 0;
+    if (status == 0 && allocate_page(page, available) != 0) {
+        status = -1;
+    }
+
+    for (long i = 0; i < heap_count; i++) {
+        if (status == 0 && i >= first) {
+            page->entries[page->count] = heap[i].name;
+            page->types[page->count] = heap[i].type;
+            page->count++;
+        } else {
+            free(heap[i].name);
+        }
+    }
+
+    free(heap);
+    return status;
+}
@@ -0,0 +1,61 @@
+#ifndef PAGINATION_H
+#define PAGINATION_H
+
+#include <stddef.h>
+
+#include "directory_reader.h"
+#include "filter/filter.h"
+#include "sort/sort.h"
+
+// Buffer size that always fits a cursor token
+#define PAGE_CURSOR_SIZE 64
+
+/**
+ * @brief Which page of a listing to produce
+ */
+typedef struct {
+    long offset;         // Number of matching entries to skip
+    long limit;          // Maximum number of entries to return (negative: no limit)
+    const char *cursor;  // Resume token from a previous unsorted page, or NULL
+} PageRequest;
+
+/**
+ * @brief Read one page of a directory in directory (unsorted) order
+ *
+ * Reading starts at the cursor position, if any, skips offset entries and
+ * stops after limit entries, so only the page's names are ever copied. If
+ * more entries remain, next_cursor receives a token that resumes right after
+ * the page; otherwise it is set to the empty string.
+ *
+ * @param path Directory path
+ * @param show_all If non-zero, include hidden entries
+ * @param filter Compiled entry filter, or NULL
+ * @param request Page to read
+ * @param page Receives the page's entries (free with free_directory_content)
+ * @param next_cursor Receives the resume token (at least PAGE_CURSOR_SIZE bytes)
+ * @return int 0 on success, -1 if the directory cannot be read, -2 if the cursor is invalid
+ */
+int read_directory_page(const char *path, int show_all, const Filter *filter,
+                        const PageRequest *request, DirectoryContent *page, char *next_cursor);
+
+/**
+ * @brief Read one page of a directory in sorted order
+ *
+ * Entries stream through a bounded max-heap of offset + limit slots, so
+ * memory does not grow with the directory. Only SORT_MODE_MTIME needs to
+ * stat every entry (to know its sort key). Without a limit the whole
+ * directory is read and sorted, and the first offset entries are dropped.
+ *
+ * @param path Directory path
+ * @param show_all If non-zero, include hidden entries
+ * @param filter Compiled entry filter, or NULL
+ * @param mode Sorting criteria
+ * @param reverse If non-zero, reverse the sort order
+ * @param request Page to select (cursor is not supported)
+ * @param page Receives the page's entries in display order
+ * @return int 0 on success, -1 if the directory cannot be read
+ */
+int read_directory_window(const char *path, int show_all, const Filter *filter, SortMode mode,
+                          int reverse, const PageRequest *request, DirectoryContent *page);
+
+#endif
@@ -0,0 +1,819 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pipeline.h"
+#include "filter/filter.h"
+#include "utils/fs_class.h"
+#include "utils/intern.h"
+#include "utils/parallel_sort.h"
+#include "utils/path.h"
+#include "utils/spsc_ring.h"
+#include "xattr/xattr.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Most entries and name bytes per batch handed from the reader to a worker
+#define BATCH_ENTRIES 256
+#define BATCH_NAME_BYTES (16 * 1024)
+
+// Link target and security context bytes per batch; strings that do not fit are
+// copied to the heap
+#define BATCH_STRING_BYTES (16 * 1024)
+
+// Batches queued per worker, batches in flight overall, and drained batches kept for reuse
+#define RING_BATCHES 8
+#define ORDERED_BATCHES 64
+#define FREE_BATCHES 64
+
+// Global variables for the sort callback functions (set before a sort, read by its threads)
+static SortMode g_pipeline_mode = SORT_MODE_ALPHA;
+static int g_pipeline_reverse = 0;
+
+/**
+ * @brief Concurrency and batching for one class of filesystem
+ */
+typedef struct {
+    int workers;               // Metadata workers (0: stat on the reader thread)
+    int batch_entries;         // Entries per batch
+} Strategy;
+
+/**
+ * @brief Pick a strategy from the kind of filesystem being listed
+ *
+ * stat() on a memory filesystem never blocks, so extra threads only add
+ * hand-offs. Local disks block on inode reads that a few workers can overlap.
+ * Network and FUSE mounts spend most of the time waiting for round trips:
+ * many workers and small batches keep many requests in flight at once.
+ */
+static Strategy choose_strategy(FsClass fs_class) {
+    Strategy strategy;
+    switch (fs_class) {
+        case FS_CLASS_MEMORY:
+            strategy.workers = 0;
+            strategy.batch_entries = BATCH_ENTRIES;
+            break;
+        case FS_CLASS_NETWORK:
+            strategy.workers = PIPELINE_MAX_WORKERS;
+            strategy.batch_entries = 16;
+            break;
+        case FS_CLASS_FUSE:
+            strategy.workers = 8;
+            strategy.batch_entries = 32;
+            break;
+        default:
+            strategy.workers = 4;
+            strategy.batch_entries = BATCH_ENTRIES;
+            break;
+    }
+    return strategy;
+}
+
+/**
+ * @brief One directory entry travelling through the pipeline
+ */
+typedef struct {
+    int name_offset;           // Offset of the name in the batch's name buffer
+    unsigned char type;        // DT_* type from readdir
+    unsigned char passes;      // Set by the worker: entry passed the metadata filter
+    unsigned char stat_valid;  // Set by the worker: PIPELINE_STAT_OK or PIPELINE_STAT_FAILED
+    unsigned char ready;       // Set (release) once passes, stat_valid and stat_info are final
+    ino_t inode;               // Inode number from readdir
+    struct stat stat_info;     // Set by the worker
+    int target_offset;         // Set by the worker: link target in the batch's strings, or -1
+    char *target_spill;        // Set by the worker: link target that did not fit (heap), or NULL
+    int context_offset;        // Set by the worker: security context in the batch's strings, or -1
+    char *context_spill;       // Set by the worker: context that did not fit (heap), or NULL
+    unsigned char xattrs;      // Set by the worker: XATTR_* bits the entry has
+} BatchEntry;
+
+/**
+ * @brief A run of consecutive directory entries; the unit passed between stages
+ *
+ * Names are written by the reader before the batch is shared and never change,
+ * so the collector may read them while a worker is still busy with the batch.
+ * Link targets and contexts are written by the worker, each before its entry is ready.
+ */
+typedef struct Batch {
+    int count;                             // Entries in use
+    int names_used;                        // Bytes of names in use
+    int strings_used;                      // Bytes of worker strings in use (worker only)
+    int finished;                          // Set (release) by the worker after its last access
+    struct Batch *next;                    // Next batch drained after the deadline
+    BatchEntry entries[BATCH_ENTRIES];
+    char names[BATCH_NAME_BYTES];          // Names back to back, each terminated
+    char strings[BATCH_STRING_BYTES];      // Link targets and contexts back to back, each
+                                           // terminated
+} Batch;
+
+/**
+ * @brief Collected entry, ordered while batches arrive
+ */
+typedef struct {
+    char *name;                // Name, allocated from the result arena
+    char *link_target;         // Link target, allocated from the result arena, or NULL
+    const char *context;       // Interned security context (with XATTR_CONTEXT), or NULL
+    ino_t inode;               // Inode number from readdir
+    time_t mtime;              // Modification time (when stat_valid is PIPELINE_STAT_OK)
+    int index;                 // Arrival index into the collected stat results
+    unsigned char type;        // DT_* type from readdir
+    unsigned char stat_valid;  // PIPELINE_STAT_*
+    unsigned char xattrs;      // XATTR_* bits the entry has
+} Record;
+
+typedef struct Pipeline Pipeline;
+
+/**
+ * @brief A metadata worker and the ring feeding it
+ */
+typedef struct {
+    Pipeline *pipeline;
+    SpscRing input;            // Batches from the reader
+    pthread_t thread;
+} Worker;
+
+/**
+ * @brief Shared pipeline state
+ *
+ * Heap-allocated and reference-counted: when the deadline passes, the
+ * collector lets go of it and the reader thread frees it once every thread
+ * has exited. It owns copies of the filter and the directory path, since the
+ * caller's are gone by then.
+ */
+struct Pipeline {
+    PipelineConfig config;     // Points to the pipeline's own filter and dir_path
+    Filter filter;             // Copy of the caller's filter
+    char *dir_path;            // Copy of the caller's directory path
+    int references;            // Reader thread and collector (atomic)
+    int cancelled;             // Set (release) by the collector when it gives up
+    Batch *abandoned;          // Batches the collector drained after giving up
+    int need_stat;             // Workers stat every entry that passes the filter
+    int filter_active;         // Workers evaluate metadata filter tests
+    SpscRing ordered;          // Every batch in directory order, reader to collector
+    SpscRing free_batches;     // Drained batches, collector back to reader
+
+    // Set up by the reader thread, which also opens the directory: nothing
+    // that might block on a hung mount runs on the calling thread
+    int dir_fd;                // Directory for filter tests and stat calls
+    Worker workers[PIPELINE_MAX_WORKERS];
+    int worker_count;          // Workers started (0: the reader stats entries itself)
+    int batch_entries;         // Entries per batch
+    Batch *current;            // Batch being filled
+    int next_worker;           // Worker receiving the next batch
+    int read_status;           // Result of read_directory_each()
+};
+
+/**
+ * @brief Order two records the way sort_directory_content() does
+ */
+static int compare_records(const Record *a, const Record *b) {
+    SortMode effective = (g_pipeline_mode == SORT_MODE_MTIME &&
+                          a->stat_valid == PIPELINE_STAT_OK && b->stat_valid == PIPELINE_STAT_OK)
+                             ? SORT_MODE_MTIME
+                             : SORT_MODE_ALPHA;
+    return compare_entries(a->name, a->mtime, b->name, b->mtime, effective, g_pipeline_reverse);
+}
+
+/**
+ * @brief Wrapper for qsort to compare records
+ */
+static int compare_records_wrapper(const void *a, const void *b) {
+    return compare_records((const Record *)a, (const Record *)b);
+}
+
+/**
+ * @brief Keep a string the worker produced in the batch, or on the heap when the batch is full
+ *
+ * @param offset Receives the string's offset in the batch's strings
+ * @param spill Receives the heap copy instead
+ */
+static void store_string(Batch *batch, const char *text, int *offset, char **spill) {
+    int size = (int)strlen(text) + 1;
+    if (batch->strings_used + size <= BATCH_STRING_BYTES) {
+        memcpy(batch->strings + batch->strings_used, text, (size_t)size);
+        *offset = batch->strings_used;
+        batch->strings_used += size;
+    } else {
+        *spill = strdup(text);
+    }
+}
+
+/**
+ * @brief A string kept by store_string(), or NULL; a heap copy is released to the caller
+ */
+static const char *stored_string(const Batch *batch, int offset, const char *spill) {
+    if (offset >= 0) {
+        return batch->strings + offset;
+    }
+    return spill;
+}
+
+/**
+ * @brief Read the target of a symbolic link into the batch
+ */
+static void read_link_target(const Pipeline *pipeline, Batch *batch, BatchEntry *entry,
+                             const char *name) {
+    char target[PATH_MAX];
+    ssize_t length = readlinkat(pipeline->dir_fd, name, target, sizeof(target) - 1);
+    if (length < 0) {
+        return;
+    }
+    target[length] = '\0';
+    store_string(batch, target, &entry->target_offset, &entry->target_spill);
+}
+
+/**
+ * @brief Fetch the ACL marker and security context of an entry into the batch
+ */
+static void read_xattrs(const Pipeline *pipeline, Batch *batch, BatchEntry *entry,
+                        const char *name) {
+    // There are no *at() variants of the xattr calls
+    char path[PATH_BUFFER_SIZE];
+    if (join_path(path, sizeof(path), pipeline->config.dir_path, name) != 0) {
+        return;
+    }
+
+    char context[XATTR_CONTEXT_SIZE];
+    int follow = !(pipeline->config.stat_flags & AT_SYMLINK_NOFOLLOW);
+    entry->xattrs = (unsigned char)xattr_fetch(path, pipeline->config.xattrs, follow, context,
+                                               sizeof(context));
+    if (entry->xattrs & XATTR_CONTEXT) {
+        store_string(batch, context, &entry->context_offset, &entry->context_spill);
+    }
+}
+
+/**
+ * @brief Order in which to process a batch's entries (see directory_stat_order())
+ *
+ * @return int* Entry indices in ascending inode order (free with free()), or NULL
+ *         to process the batch in directory order
+ */
+static int *batch_stat_order(const Batch *batch) {
+    ino_t inodes[BATCH_ENTRIES];
+    for (int i = 0; i < batch->count; i++) {
+        inodes[i] = batch->entries[i].inode;
+    }
+
+    DirectoryContent view;
+    memset(&view, 0, sizeof(DirectoryContent));
+    view.inodes = inodes;
+    view.count = batch->count;
+    return directory_stat_order(&view);
+}
+
+/**
+ * @brief Apply the metadata filter to, stat, and read the link target and extended
+ *        attributes of each entry of a batch
+ *
+ * Entries are stat'ed in inode order within the batch; each result stays at
+ * the entry's own index. Entries left when the pipeline is cancelled are
+ * never marked ready. The batch is not touched after finished is set, so the
+ * collector may reuse it.
+ */
+static void process_batch(Pipeline *pipeline, Batch *batch) {
+    const Filter *filter = pipeline->config.filter;
+    int count = batch->count;
+    batch->strings_used = 0;
+
+    int *order = pipeline->need_stat ? batch_stat_order(batch) : NULL;
+    for (int k = 0; k < count; k++) {
+        // Nobody waits for the rest once the collector has given up
+        if (__atomic_load_n(&pipeline->cancelled, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        BatchEntry *entry = &batch->entries[order != NULL ? order[k] : k];
+        const char *name = batch->names + entry->name_offset;
+
+        entry->passes = !pipeline->filter_active ||
+                        filter_entry_passes(filter, pipeline->dir_fd, name, entry->type);
+        entry->stat_valid = entry->passes && pipeline->need_stat && pipeline->dir_fd >= 0 &&
+                                    fstatat(pipeline->dir_fd, name, &entry->stat_info,
+                                            pipeline->config.stat_flags) == 0
+                                ? PIPELINE_STAT_OK
+                                : PIPELINE_STAT_FAILED;
+        entry->target_offset = -1;
+        entry->target_spill = NULL;
+        entry->context_offset = -1;
+        entry->context_spill = NULL;
+        entry->xattrs = 0;
+        if (entry->stat_valid == PIPELINE_STAT_OK && pipeline->config.keep_stats) {
+            if (S_ISLNK(entry->stat_info.st_mode)) {
+                read_link_target(pipeline, batch, entry, name);
+            }
+            if (pipeline->config.xattrs != 0) {
+                read_xattrs(pipeline, batch, entry, name);
+            }
+        }
+        __atomic_store_n(&entry->ready, 1, __ATOMIC_RELEASE);
+    }
+    free(order);
+    __atomic_store_n(&batch->finished, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Get an empty batch, reusing a drained one when the collector has returned any
+ */
+static Batch *take_batch(Pipeline *pipeline) {
+    Batch *batch = (Batch *)spsc_ring_try_pop(&pipeline->free_batches);
+    if (batch == NULL) {
+        batch = (Batch *)malloc(sizeof(Batch));
+    }
+    if (batch != NULL) {
+        batch->count = 0;
+        batch->names_used = 0;
+        batch->finished = 0;
+    }
+    return batch;
+}
+
+/**
+ * @brief Push a batch, waiting for room unless the pipeline is cancelled first
+ *
+ * @return int 1 if the batch was pushed, 0 if the pipeline was cancelled
+ */
+static int push_batch(Pipeline *pipeline, SpscRing *ring, Batch *batch) {
+    unsigned attempts = 0;
+    while (!spsc_ring_try_push(ring, batch)) {
+        if (__atomic_load_n(&pipeline->cancelled, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+        spsc_backoff(&attempts);
+    }
+    return 1;
+}
+
+/**
+ * @brief Hand the batch being filled to the collector and the next worker (round robin)
+ *
+ * The batch goes to the collector first: from then on it is the collector's
+ * (or, once the pipeline is cancelled, freed with the pipeline), so a worker
+ * that never gets it leaves nothing behind.
+ */
+static void dispatch_batch(Pipeline *pipeline) {
+    Batch *batch = pipeline->current;
+    if (batch == NULL) {
+        return;
+    }
+    pipeline->current = NULL;
+
+    for (int i = 0; i < batch->count; i++) {
+        batch->entries[i].ready = 0;
+    }
+
+    if (pipeline->worker_count == 0) {
+        process_batch(pipeline, batch);
+    }
+    if (!push_batch(pipeline, &pipeline->ordered, batch)) {
+        free(batch);
+        return;
+    }
+    if (pipeline->worker_count > 0) {
+        push_batch(pipeline, &pipeline->workers[pipeline->next_worker].input, batch);
+        pipeline->next_worker = (pipeline->next_worker + 1) % pipeline->worker_count;
+    }
+}
+
+/**
+ * @brief DirectoryEntryCallback appending one entry to the current batch
+ */
+static int reader_add(const char *name, unsigned char type, ino_t inode, void *context) {
+    Pipeline *pipeline = (Pipeline *)context;
+    int name_size = (int)strlen(name) + 1;
+
+    // Stop reading once the collector has given up
+    if (__atomic_load_n(&pipeline->cancelled, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    Batch *batch = pipeline->current;
+    if (batch != NULL && (batch->count == pipeline->batch_entries ||
+                          batch->names_used + name_size > BATCH_NAME_BYTES)) {
+        dispatch_batch(pipeline);
+        batch = NULL;
+    }
+    if (batch == NULL) {
+        batch = take_batch(pipeline);
+        if (batch == NULL) {
+            return -1;
+        }
+        pipeline->current = batch;
+    }
+
+    BatchEntry *entry = &batch->entries[batch->count++];
+    entry->name_offset = batch->names_used;
+    entry->type = type;
+    entry->inode = inode;
+    memcpy(batch->names + batch->names_used, name, name_size);
+    batch->names_used += name_size;
+    return 0;
+}
+
+/**
+ * @brief Metadata stage: process batches until the reader closes the input
+ */
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+
+    Batch *batch;
+    while ((batch = (Batch *)spsc_ring_pop(&worker->input)) != NULL) {
+        process_batch(worker->pipeline, batch);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Start the metadata workers chosen for the directory's filesystem
+ */
+static void start_workers(Pipeline *pipeline) {
+    Strategy strategy = choose_strategy(pipeline->dir_fd >= 0 ? fs_class_of(pipeline->dir_fd)
+                                                              : FS_CLASS_LOCAL);
+    int workers = pipeline->config.workers >= 0 ? pipeline->config.workers : strategy.workers;
+    if (workers > PIPELINE_MAX_WORKERS) {
+        workers = PIPELINE_MAX_WORKERS;
+    }
+    pipeline->batch_entries = strategy.batch_entries;
+
+    // Whatever cannot be started is made up for by stat'ing on the reader thread
+    while (pipeline->worker_count < workers) {
+        Worker *worker = &pipeline->workers[pipeline->worker_count];
+        worker->pipeline = pipeline;
+        if (spsc_ring_init(&worker->input, RING_BATCHES) != 0) {
+            break;
+        }
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            spsc_ring_destroy(&worker->input);
+            break;
+        }
+        pipeline->worker_count++;
+    }
+}
+
+/**
+ * @brief Free the pipeline once every thread has exited
+ */
+static void destroy_pipeline(Pipeline *pipeline) {
+    Batch *batch;
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        spsc_ring_destroy(&pipeline->workers[i].input);
+    }
+    while ((batch = (Batch *)spsc_ring_try_pop(&pipeline->ordered)) != NULL) {
+        free(batch);
+    }
+    while ((batch = (Batch *)spsc_ring_try_pop(&pipeline->free_batches)) != NULL) {
+        free(batch);
+    }
+    while ((batch = pipeline->abandoned) != NULL) {
+        pipeline->abandoned = batch->next;
+        free(batch);
+    }
+    spsc_ring_destroy(&pipeline->ordered);
+    spsc_ring_destroy(&pipeline->free_batches);
+    if (pipeline->dir_fd >= 0) {
+        close(pipeline->dir_fd);
+    }
+    filter_free(&pipeline->filter);
+    free(pipeline->dir_path);
+    free(pipeline);
+}
+
+/**
+ * @brief Let go of the pipeline; the last of the reader thread and the collector frees it
+ */
+static void release_pipeline(Pipeline *pipeline) {
+    if (__atomic_sub_fetch(&pipeline->references, 1, __ATOMIC_ACQ_REL) == 0) {
+        destroy_pipeline(pipeline);
+    }
+}
+
+/**
+ * @brief Reader stage: start the workers, walk the directory, then shut the workers down
+ */
+static void *reader_main(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    const PipelineConfig *config = &pipeline->config;
+
+    pipeline->dir_fd = open(config->dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    start_workers(pipeline);
+
+    pipeline->read_status = read_directory_each(config->dir_path, config->show_all,
+                                                config->filter, reader_add, pipeline);
+    dispatch_batch(pipeline);
+    spsc_ring_close(&pipeline->ordered);
+
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        spsc_ring_close(&pipeline->workers[i].input);
+    }
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        pthread_join(pipeline->workers[i].thread, NULL);
+    }
+    release_pipeline(pipeline);
+    return NULL;
+}
+
+/**
+ * @brief Collected entries while the pipeline runs (heap; copied into the arena at the end)
+ */
+typedef struct {
+    Record *records;
+    struct stat *stats;        // Stat results by arrival index (keep_stats only)
+    int count;
+    int capacity;
+    int *starts;               // Start of each sorted run, plus room for the end marker
+    int run_count;
+    int run_capacity;
+    int pending_count;         // Entries collected without their metadata
+    int failed;                // Allocation failed; batches are drained and dropped
+    StringIntern contexts;     // Distinct security contexts, copied into the result arena
+} Collector;
+
+/**
+ * @brief Append the entries of a batch that passed the filter
+ *
+ * @param partial If non-zero, the worker may not be done: entries it has not
+ *        finished are collected as PIPELINE_STAT_PENDING
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int collect_batch(Collector *collector, const Batch *batch, const PipelineConfig *config,
+                         Arena *arena, int partial) {
+    if (collector->count + batch->count > collector->capacity) {
+        int capacity = collector->capacity > 0 ? collector->capacity * 2 : 1024;
+        while (capacity < collector->count + batch->count) {
+            capacity *= 2;
+        }
+        Record *records = (Record *)realloc(collector->records, capacity * sizeof(Record));
+        if (records == NULL) {
+            return -1;
+        }
+        collector->records = records;
+        if (config->keep_stats) {
+            struct stat *stats =
+                (struct stat *)realloc(collector->stats, capacity * sizeof(struct stat));
+            if (stats == NULL) {
+                return -1;
+            }
+            collector->stats = stats;
+        }
+        collector->capacity = capacity;
+    }
+    if (collector->run_count + 2 > collector->run_capacity) {
+        int run_capacity = collector->run_capacity > 0 ? collector->run_capacity * 2 : 64;
+        int *starts = (int *)realloc(collector->starts, run_capacity * sizeof(int));
+        if (starts == NULL) {
+            return -1;
+        }
+        collector->starts = starts;
+        collector->run_capacity = run_capacity;
+    }
+
+    int start = collector->count;
+    for (int i = 0; i < batch->count; i++) {
+        const BatchEntry *entry = &batch->entries[i];
+        int ready = !partial || __atomic_load_n(&entry->ready, __ATOMIC_ACQUIRE);
+        if (ready && !entry->passes) {
+            continue;
+        }
+
+        Record *record = &collector->records[collector->count];
+        record->name = arena_strdup(arena, batch->names + entry->name_offset);
+        if (record->name == NULL) {
+            return -1;
+        }
+        record->inode = entry->inode;
+        record->type = entry->type;
+        record->stat_valid = ready ? entry->stat_valid : PIPELINE_STAT_PENDING;
+        record->mtime = record->stat_valid == PIPELINE_STAT_OK ? entry->stat_info.st_mtime : 0;
+        record->index = collector->count;
+        record->link_target = NULL;
+        record->context = NULL;
+        record->xattrs = 0;
+        if (config->keep_stats && record->stat_valid == PIPELINE_STAT_OK) {
+            collector->stats[collector->count] = entry->stat_info;
+            const char *target = stored_string(batch, entry->target_offset, entry->target_spill);
+            if (target != NULL) {
+                record->link_target = arena_strdup(arena, target);
+                free(entry->target_spill);
+            }
+
+            // Most entries share a handful of contexts: each is stored once
+            record->xattrs = entry->xattrs;
+            const char *context = stored_string(batch, entry->context_offset,
+                                                entry->context_spill);
+            if (context != NULL) {
+                record->context = string_intern(&collector->contexts, context);
+                free(entry->context_spill);
+            }
+        }
+        collector->pending_count += !ready;
+        collector->count++;
+    }
+
+    // Each batch becomes a sorted run, merged once every batch is in
+    if (config->sorted && collector->count > start) {
+        qsort(collector->records + start, collector->count - start, sizeof(Record),
+              compare_records_wrapper);
+        collector->starts[collector->run_count++] = start;
+    }
+    return 0;
+}
+
+/**
+ * @brief Wait for a worker to finish a batch
+ *
+ * @param deadline Absolute deadline, or NULL to wait indefinitely
+ * @return int Non-zero once the batch is finished, 0 if the deadline passed first
+ */
+static int wait_finished(const Batch *batch, const struct timespec *deadline) {
+    unsigned attempts = 0;
+    while (!__atomic_load_n(&batch->finished, __ATOMIC_ACQUIRE)) {
+        if (spsc_deadline_passed(deadline)) {
+            return 0;
+        }
+        spsc_backoff(&attempts);
+    }
+    return 1;
+}
+
+/**
+ * @brief Copy the collected entries into the arena, in final order
+ *
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int build_listing(Collector *collector, const PipelineConfig *config, Arena *arena,
+                         PipelineListing *listing) {
+    int count = collector->count;
+    Record *records = collector->records;
+    Record *scratch = NULL;
+
+    if (config->sorted && collector->run_count > 1) {
+        scratch = (Record *)malloc(count * sizeof(Record));
+        if (scratch == NULL) {
+            return -1;
+        }
+        collector->starts[collector->run_count] = count;
+        records = (Record *)parallel_merge_runs(records, scratch, count, sizeof(Record),
+                                                collector->starts, collector->run_count,
+                                                compare_records_wrapper);
+    }
+
+    // Allocate at least one slot so an all-filtered listing is still non-NULL
+    size_t slots = count > 0 ? (size_t)count : 1;
+    DirectoryContent *content = &listing->content;
+    content->entries = (char **)arena_alloc(arena, slots * sizeof(char *));
+    content->types = (unsigned char *)arena_alloc(arena, slots);
+    content->inodes = (ino_t *)arena_alloc(arena, slots * sizeof(ino_t));
+    if (config->keep_stats) {
+        listing->stats = (struct stat *)arena_alloc(arena, slots * sizeof(struct stat));
+        listing->stat_valid = (unsigned char *)arena_alloc(arena, slots);
+        listing->link_targets = (char **)arena_alloc(arena, slots * sizeof(char *));
+    }
+    if (config->keep_stats && config->xattrs != 0) {
+        listing->xattrs = (unsigned char *)arena_alloc(arena, slots);
+        listing->contexts = (const char **)arena_alloc(arena, slots * sizeof(const char *));
+    }
+    if (content->entries == NULL || content->types == NULL || content->inodes == NULL ||
+        (config->keep_stats && (listing->stats == NULL || listing->stat_valid == NULL ||
+                                listing->link_targets == NULL)) ||
+        (config->keep_stats && config->xattrs != 0 &&
+         (listing->xattrs == NULL || listing->contexts == NULL))) {
+        free(scratch);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        content->entries[i] = records[i].name;
+        content->types[i] = records[i].type;
+        content->inodes[i] = records[i].inode;
+        if (config->keep_stats) {
+            listing->stat_valid[i] = records[i].stat_valid;
+            listing->link_targets[i] = records[i].link_target;
+            if (listing->xattrs != NULL) {
+                listing->xattrs[i] = records[i].xattrs;
+                listing->contexts[i] = records[i].context != NULL ? records[i].context : "";
+            }
+            if (records[i].stat_valid == PIPELINE_STAT_OK) {
+                listing->stats[i] = collector->stats[records[i].index];
+            } else {
+                memset(&listing->stats[i], 0, sizeof(struct stat));
+            }
+        }
+    }
+    content->count = count;
+
+    free(scratch);
+    return 0;
+}
+
+int pipeline_read_listing(const PipelineConfig *config, Arena *arena, PipelineListing *listing) {
+    memset(listing, 0, sizeof(PipelineListing));
+    listing->content.arena = arena;
+
+    Pipeline *pipeline = (Pipeline *)calloc(1, sizeof(Pipeline));
+    if (pipeline == NULL) {
+        return -1;
+    }
+    pipeline->config = *config;
+    pipeline->dir_fd = -1;
+    pipeline->references = 2;
+
+    // Threads abandoned at the deadline outlive the caller's filter and path
+    pipeline->dir_path = strdup(config->dir_path);
+    if (pipeline->dir_path == NULL ||
+        (config->filter != NULL && filter_copy(&pipeline->filter, config->filter) != 0)) {
+        destroy_pipeline(pipeline);
+        return -1;
+    }
+    pipeline->config.dir_path = pipeline->dir_path;
+    pipeline->config.filter = config->filter != NULL ? &pipeline->filter : NULL;
+    pipeline->filter_active = filter_is_active(config->filter);
+    pipeline->need_stat = config->keep_stats || (config->sorted && config->mode == SORT_MODE_MTIME);
+
+    pthread_t reader;
+    if (spsc_ring_init(&pipeline->ordered, ORDERED_BATCHES) != 0 ||
+        spsc_ring_init(&pipeline->free_batches, FREE_BATCHES) != 0 ||
+        pthread_create(&reader, NULL, reader_main, pipeline) != 0) {
+        destroy_pipeline(pipeline);
+        return -1;
+    }
+
+    struct timespec deadline;
+    const struct timespec *deadline_ptr = NULL;
+    if (config->deadline_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += config->deadline_ms / 1000;
+        deadline.tv_nsec += (config->deadline_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        deadline_ptr = &deadline;
+    }
+
+    // Collect batches in directory order as their metadata arrives
+    g_pipeline_mode = config->mode;
+    g_pipeline_reverse = config->reverse;
+    Collector collector;
+    memset(&collector, 0, sizeof(Collector));
+    string_intern_init(&collector.contexts, arena);
+    Batch *batch;
+    int popped;
+    while ((popped = spsc_ring_pop_until(&pipeline->ordered, deadline_ptr, (void **)&batch)) > 0) {
+        if (!wait_finished(batch, deadline_ptr)) {
+            // Out of time: keep what this batch has, and list the batches
+            // already read with whatever metadata they have so far; workers may
+            // still be using them, so they are freed with the pipeline
+            listing->timed_out = 1;
+            do {
+                if (!collector.failed && collect_batch(&collector, batch, config, arena, 1) != 0) {
+                    collector.failed = 1;
+                }
+                batch->next = pipeline->abandoned;
+                pipeline->abandoned = batch;
+            } while ((batch = (Batch *)spsc_ring_try_pop(&pipeline->ordered)) != NULL);
+            break;
+        }
+
+        if (!collector.failed && collect_batch(&collector, batch, config, arena, 0) != 0) {
+            collector.failed = 1;
+        }
+        if (!spsc_ring_try_push(&pipeline->free_batches, batch)) {
+            free(batch);
+        }
+    }
+    if (popped < 0) {
+        listing->timed_out = 1;
+    }
+
+    if (listing->timed_out) {
+        // Stop the reader and the workers; any blocked in the filesystem keep the
+        // pipeline until they return, and the reader frees it
+        __atomic_store_n(&pipeline->cancelled, 1, __ATOMIC_RELEASE);
+        pthread_detach(reader);
+    } else {
+        pthread_join(reader, NULL);
+    }
+
+    // Like read_directory_filtered(), only an unreadable directory has no entries;
+    // a listing cut short by the deadline keeps whatever was read
+    int read_ok = listing->timed_out || pipeline->read_status == 0;
+    if (read_ok && !collector.failed &&
+        build_listing(&collector, config, arena, listing) == 0) {
+        listing->pending_count = collector.pending_count;
+    } else {
+        listing->content.entries = NULL;
+        listing->content.count = 0;
+        listing->stats = NULL;
+        listing->stat_valid = NULL;
+        listing->link_targets = NULL;
+        listing->xattrs = NULL;
+        listing->contexts = NULL;
+    }
+
+    free(collector.records);
+    free(collector.stats);
+    free(collector.starts);
+    string_intern_free(&collector.contexts);
+    release_pipeline(pipeline);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <sys/stat.h>
+
+#include "directory_reader.h"
+#include "sort/sort.h"
+#include "utils/arena.h"
+
+struct Filter;  // Compiled entry filter (filter/filter.h)
+
+// Most metadata workers a pipeline runs
+#define PIPELINE_MAX_WORKERS 16
+
+// PipelineConfig.workers value that picks the worker count from the filesystem type
+#define PIPELINE_WORKERS_AUTO (-1)
+
+// Values of PipelineListing.stat_valid
+#define PIPELINE_STAT_FAILED 0     // stat() failed
+#define PIPELINE_STAT_OK 1         // stats[i] is valid
+#define PIPELINE_STAT_PENDING 2    // Still outstanding when the deadline passed
+
+/**
+ * @brief What a pipelined read should produce
+ */
+typedef struct {
+    const char *dir_path;          // Directory to list (copied)
+    int show_all;                  // Include hidden entries
+    const struct Filter *filter;   // Compiled filter, applied in full (copied; may be NULL)
+    int keep_stats;                // Keep each entry's stat result and link target (for -l)
+    int stat_flags;                // fstatat() flags (AT_SYMLINK_NOFOLLOW unless -L)
+    int xattrs;                    // XATTR_* to fetch for each entry, with keep_stats (0: none)
+    int sorted;                    // Sort the listing; otherwise keep directory order
+    SortMode mode;                 // Sort order when sorted
+    int reverse;                   // Reverse the sort order
+    int workers;                   // Metadata workers (up to PIPELINE_MAX_WORKERS), 0 to stat
+                                   // on the reader thread, or PIPELINE_WORKERS_AUTO
+    long deadline_ms;              // Stop waiting for entries and metadata after this many
+                                   // milliseconds (0: wait for everything)
+} PipelineConfig;
+
+/**
+ * @brief Result of a pipelined read
+ */
+typedef struct {
+    DirectoryContent content;      // Filtered (and sorted) entries, arena-backed
+    struct stat *stats;            // Stat results parallel to content.entries, or NULL
+    unsigned char *stat_valid;     // PIPELINE_STAT_* for each entry (with stats)
+    char **link_targets;           // Symbolic link targets parallel to content.entries
+                                   // (NULL for other entries), with stats
+    unsigned char *xattrs;         // XATTR_* bits each entry has, with config.xattrs (or NULL)
+    const char **contexts;         // Interned security contexts with XATTR_CONTEXT ("" for
+                                   // none), or NULL
+    int pending_count;             // Entries listed without their metadata
+    int timed_out;                 // The deadline passed; threads may still be running
+} PipelineListing;
+
+/**
+ * @brief Read, filter, stat and sort a directory as overlapping stages
+ *
+ * A reader thread walks the directory and hands batches of entries through
+ * lock-free single-producer/single-consumer rings to metadata workers, which
+ * evaluate metadata filters and stat the entries. The calling thread collects
+ * the batches in directory order as they complete; in sorted mode each batch
+ * is sorted as it arrives and the resulting runs are merged at the end. The
+ * total time approaches that of the slowest stage rather than their sum.
+ *
+ * The reader classifies the filesystem with fstatfs() before reading: memory
+ * filesystems are stat'ed on the reader thread itself, local disks get a few
+ * workers, and network and FUSE mounts get many workers fed small batches so
+ * slow replies overlap.
+ *
+ * With keep_stats, the workers also read the target of every symbolic link
+ * with readlinkat() relative to the directory, into a buffer in the batch
+ * that the collector copies into the arena along with the names. With
+ * xattrs, they fetch the ACL marker and security context the same way; the
+ * collector interns the contexts, so each distinct one is stored once.
+ *
+ * With a deadline, the listing is cut short instead of waiting for a hung
+ * mount: entries read so far are returned, those whose metadata has not
+ * arrived are marked PIPELINE_STAT_PENDING (and kept regardless of metadata
+ * filter tests), and the pipeline is cancelled: the reader stops reading and
+ * the workers stop stat'ing at their next entry. Threads blocked in the
+ * filesystem are left to return on their own. The pipeline works on its own
+ * copies of the filter and the directory path and frees them when its last
+ * thread exits, so the caller may free its own as soon as this returns.
+ *
+ * The result matches read_directory_filtered() followed by
+ * filter_apply_metadata() and, in sorted mode, sort_directory_content().
+ *
+ * @param config What to read and how (copied)
+ * @param arena Arena the result is allocated from (used by the calling thread only)
+ * @param listing Receives the listing; content.entries is NULL if the directory
+ *        cannot be read or has no entries
+ * @return int 0 on success, -1 if the pipeline could not be started (nothing was
+ *         read; fall back to read_directory_filtered())
+ */
+int pipeline_read_listing(const PipelineConfig *config, Arena *arena, PipelineListing *listing);
+
+#endif
@@ -0,0 +1,913 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include "file_info.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_REQUEST_MAGIC 0x5154534CU    // "LSTQ"
+#define SERVER_RESPONSE_MAGIC 0x5254534CU   // "LSTR"
+#define SERVER_VERSION 1
+
+// Descriptors sent with a request: working directory, stdout, stderr
+#define REQUEST_FD_COUNT 3
+
+// Connections accepted but not yet handed to a worker
+#define SERVER_MAX_PENDING 1024
+
+// Seconds a worker waits for the rest of a request
+#define SERVER_RECEIVE_TIMEOUT 5
+
+// What an epoll event is about (the upper half of its data; the lower half is an index)
+#define EVENT_LISTENER 1ULL
+#define EVENT_SIGNAL 2ULL
+#define EVENT_WORKER 3ULL
+#define EVENT_CONNECTION 4ULL
+
+/**
+ * @brief Request header, followed by length bytes of NUL-terminated strings:
+ *        argc arguments, then envc environment entries
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t fd_count;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t umask;
+    uint32_t length;
+} RequestHeader;
+
+// ResponseHeader.kind
+#define RESPONSE_DONE 0          // The command ran; status is its exit status
+#define RESPONSE_REFUSED 1       // Not run: the client should run it itself
+#define RESPONSE_BROKEN_PIPE 2   // The command ran into a closed stdout
+
+/**
+ * @brief Response: the only thing sent back, since the output went to the client's descriptors
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;
+    int32_t status;
+    uint32_t reserved;
+} ResponseHeader;
+
+/**
+ * @brief A pre-forked worker process, as the server sees it
+ */
+typedef struct {
+    pid_t pid;
+    int control_fd;   // Server's end of the socket pair connections are passed over, or -1
+    int busy;
+    int served;
+} Worker;
+
+/**
+ * @brief State of the server's event loop
+ */
+typedef struct {
+    int listen_fd;
+    int epoll_fd;
+    int signal_fd;
+    int accepting;                              // Listener is in the epoll set
+    ServerHandler handler;
+    Worker workers[SERVER_MAX_WORKERS];
+    int worker_count;
+    int connections[SERVER_MAX_PENDING];        // Accepted connections, -1 for free slots
+    int open_connections;
+    int ready[SERVER_MAX_PENDING];              // Slots whose request has arrived, oldest first
+    int ready_head;
+    int ready_count;
+} Server;
+
+// Connection of the request a worker is running, for its signal handlers (-1 between requests)
+static volatile sig_atomic_t g_connection = -1;
+
+static int send_all(int fd, const void *data, size_t length) {
+    const char *bytes = (const char *)data;
+    while (length > 0) {
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * @brief Receive exactly length bytes
+ *
+ * @return int 0 on success, -1 on error, timeout or end of stream
+ */
+static int receive_all(int fd, void *data, size_t length) {
+    char *bytes = (char *)data;
+    while (length > 0) {
+        ssize_t received = recv(fd, bytes, length, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return -1;
+        }
+        bytes += received;
+        length -= (size_t)received;
+    }
+    return 0;
+}
+
+static int socket_address(const char *socket_path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address->sun_path)) {
+        return -1;
+    }
+    strcpy(address->sun_path, socket_path);
+    return 0;
+}
+
+static int connect_socket(const char *socket_path) {
+    struct sockaddr_un address;
+    if (socket_address(socket_path, &address) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Send descriptors along with a message (SCM_RIGHTS)
+ *
+ * @return ssize_t Bytes of the message sent, or -1
+ */
+static ssize_t send_with_fds(int socket_fd, const void *data, size_t length, const int *fds,
+                             int fd_count) {
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FD_COUNT)];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov;
+    iov.iov_base = (void *)data;
+    iov.iov_len = length;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+    struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+    memcpy(CMSG_DATA(header), fds, sizeof(int) * fd_count);
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent;
+}
+
+/**
+ * @brief Receive a message and the descriptors sent with it
+ *
+ * Every descriptor that arrives is kept in fds or closed, even if the message
+ * is not valid; slots that did not get one are -1.
+ *
+ * @return ssize_t Bytes of the message received, or -1 (0 at end of stream)
+ */
+static ssize_t receive_with_fds(int socket_fd, void *data, size_t length, int *fds,
+                                int fd_count) {
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FD_COUNT)];
+        struct cmsghdr align;
+    } control;
+
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = length;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t received;
+    do {
+        received = recvmsg(socket_fd, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    for (int i = 0; i < fd_count; i++) {
+        fds[i] = -1;
+    }
+    if (received < 0) {
+        return -1;
+    }
+
+    int taken = 0;
+    for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); header != NULL;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        int count = (int)((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+            if (taken < fd_count) {
+                fds[taken++] = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+    return received;
+}
+
+static void close_fds(int *fds, int count) {
+    for (int i = 0; i < count; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+
+static int is_connect_argument(const char *arg) {
+    return strcmp(arg, "--connect") == 0 || strncmp(arg, "--connect=", 10) == 0;
+}
+
+int server_request(const char *socket_path, int argc, char *argv[], int *status) {
+    // The run writes straight to these; without them it has to run here
+    if (fcntl(STDOUT_FILENO, F_GETFD) < 0 || fcntl(STDERR_FILENO, F_GETFD) < 0) {
+        return -1;
+    }
+
+    // Arguments (without --connect), then the environment
+    size_t length = 0;
+    uint32_t sent_argc = 0;
+    uint32_t envc = 0;
+    for (int i = 0; i < argc; i++) {
+        if (i == 0 || !is_connect_argument(argv[i])) {
+            length += strlen(argv[i]) + 1;
+            sent_argc++;
+        }
+    }
+    for (char **entry = environ; entry != NULL && *entry != NULL; entry++) {
+        length += strlen(*entry) + 1;
+        envc++;
+    }
+    if (length > SERVER_MAX_REQUEST) {
+        return -1;
+    }
+
+    char *message = (char *)malloc(sizeof(RequestHeader) + length);
+    if (message == NULL) {
+        return -1;
+    }
+    char *strings = message + sizeof(RequestHeader);
+    for (int i = 0; i < argc; i++) {
+        if (i == 0 || !is_connect_argument(argv[i])) {
+            size_t size = strlen(argv[i]) + 1;
+            memcpy(strings, argv[i], size);
+            strings += size;
+        }
+    }
+    for (char **entry = environ; entry != NULL && *entry != NULL; entry++) {
+        size_t size = strlen(*entry) + 1;
+        memcpy(strings, *entry, size);
+        strings += size;
+    }
+
+    mode_t mask = umask(0);
+    umask(mask);
+
+    RequestHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SERVER_REQUEST_MAGIC;
+    header.version = SERVER_VERSION;
+    header.fd_count = REQUEST_FD_COUNT;
+    header.argc = sent_argc;
+    header.envc = envc;
+    header.umask = (uint32_t)mask;
+    header.length = (uint32_t)length;
+    memcpy(message, &header, sizeof(header));
+
+    int fds[REQUEST_FD_COUNT];
+    fds[0] = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    fds[1] = STDOUT_FILENO;
+    fds[2] = STDERR_FILENO;
+    int fd = fds[0] >= 0 ? connect_socket(socket_path) : -1;
+    if (fd < 0) {
+        if (fds[0] >= 0) {
+            close(fds[0]);
+        }
+        free(message);
+        return -1;
+    }
+
+    // The descriptors travel with the first bytes of the request
+    size_t total = sizeof(RequestHeader) + length;
+    ssize_t sent = send_with_fds(fd, message, total, fds, REQUEST_FD_COUNT);
+    close(fds[0]);
+
+    int result = -1;
+    if (sent > 0 && send_all(fd, message + sent, total - (size_t)sent) == 0) {
+        ResponseHeader response;
+        if (receive_all(fd, &response, sizeof(response)) != 0 ||
+            response.magic != SERVER_RESPONSE_MAGIC) {
+            // Part of the output may already be out, so the command is not run again
+            fprintf(stderr, "Error: Lost connection to the lister server\n");
+            *status = 1;
+            result = 0;
+        } else if (response.kind != RESPONSE_REFUSED) {
+            *status = response.status;
+            result = 0;
+            if (response.kind == RESPONSE_BROKEN_PIPE) {
+                // End the way the standalone run would have
+                signal(SIGPIPE, SIG_DFL);
+                raise(SIGPIPE);
+            }
+        }
+    }
+
+    close(fd);
+    free(message);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Worker
+// ---------------------------------------------------------------------------
+
+static void send_response(int connection, uint32_t kind, int status) {
+    ResponseHeader response;
+    memset(&response, 0, sizeof(response));
+    response.magic = SERVER_RESPONSE_MAGIC;
+    response.kind = kind;
+    response.status = status;
+    send_all(connection, &response, sizeof(response));
+}
+
+/**
+ * @brief SIGPIPE in a worker: the run wrote to a closed stdout
+ *
+ * A standalone run dies here, so the request ends the same way instead of
+ * formatting the rest of the listing into a dead pipe: the client is told,
+ * and the worker exits (the server starts a fresh one in its place).
+ */
+static void stop_broken_request(int signal_number) {
+    (void)signal_number;
+    int connection = g_connection;
+    if (connection < 0) {
+        return;
+    }
+    ResponseHeader response = {SERVER_RESPONSE_MAGIC, RESPONSE_BROKEN_PIPE, 1, 0};
+    send_all(connection, &response, sizeof(response));
+    _exit(0);
+}
+
+/**
+ * @brief SIGIO in a worker: the connection turned readable, which during a run
+ *        means the client hung up (it sends nothing after its request)
+ */
+static void stop_abandoned_request(int signal_number) {
+    (void)signal_number;
+    int saved_errno = errno;
+    int connection = g_connection;
+    char byte;
+    if (connection >= 0 && recv(connection, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+        _exit(0);
+    }
+    errno = saved_errno;
+}
+
+/**
+ * @brief Point a vector at count consecutive NUL-terminated strings
+ *
+ * @return char* Just past the last string, or NULL if there are fewer than count
+ */
+static char *split_strings(char *data, const char *end, uint32_t count, char **vector) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (data >= end) {
+            return NULL;
+        }
+        vector[i] = data;
+        data += strlen(data) + 1;
+    }
+    vector[count] = NULL;
+    return data;
+}
+
+/**
+ * @brief Receive a request: its header, descriptors and strings
+ *
+ * @return char* Heap-allocated strings (NUL-terminated past length as well),
+ *               or NULL if the request is not valid
+ */
+static char *receive_request(int connection, RequestHeader *header, int *fds) {
+    ssize_t received = receive_with_fds(connection, header, sizeof(*header), fds,
+                                        REQUEST_FD_COUNT);
+    if (received <= 0 || ((size_t)received < sizeof(*header) &&
+                          receive_all(connection, (char *)header + received,
+                                      sizeof(*header) - (size_t)received) != 0)) {
+        return NULL;
+    }
+
+    // Every string is at least its terminator, which bounds the counts
+    if (header->magic != SERVER_REQUEST_MAGIC || header->version != SERVER_VERSION ||
+        header->fd_count != REQUEST_FD_COUNT || fds[REQUEST_FD_COUNT - 1] < 0 ||
+        header->argc == 0 || header->length > SERVER_MAX_REQUEST ||
+        (uint64_t)header->argc + header->envc > header->length) {
+        return NULL;
+    }
+
+    char *strings = (char *)malloc((size_t)header->length + 1);
+    if (strings == NULL || receive_all(connection, strings, header->length) != 0) {
+        free(strings);
+        return NULL;
+    }
+    strings[header->length] = '\0';
+    return strings;
+}
+
+/**
+ * @brief Run one request in the client's context and put the worker's own back
+ *
+ * @param saved_fds The worker's own stdout and stderr
+ * @param home_fd The worker's own working directory
+ * @return int Exit status of the run
+ */
+static int run_request(ServerHandler handler, const RequestHeader *header, const int *fds,
+                       char **argv, char **env, const int *saved_fds, int home_fd) {
+    char **saved_environ = environ;
+    mode_t saved_umask = umask((mode_t)header->umask & 0777);
+    environ = env;
+    tzset();
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(fds[1], STDOUT_FILENO);
+    dup2(fds[2], STDERR_FILENO);
+
+    // Buffered the way a standalone run's streams would be
+    setvbuf(stdout, NULL, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, BUFSIZ);
+    setvbuf(stderr, NULL, _IONBF, 0);
+
+    int status = handler((int)header->argc, argv);
+    fflush(stdout);
+    fflush(stderr);
+    clearerr(stdout);
+    clearerr(stderr);
+
+    dup2(saved_fds[0], STDOUT_FILENO);
+    dup2(saved_fds[1], STDERR_FILENO);
+    environ = saved_environ;
+    umask(saved_umask);
+    // Nothing depends on the worker's own directory, so a failure is harmless
+    int restored = fchdir(home_fd);
+    (void)restored;
+    return status;
+}
+
+/**
+ * @brief Serve one connection handed over by the server
+ */
+static void serve_connection(int connection, ServerHandler handler, const int *saved_fds,
+                             int home_fd) {
+    // Only the server's own user is served: the run has the server's permissions
+    struct ucred peer;
+    socklen_t peer_length = sizeof(peer);
+    if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) != 0 ||
+        peer.uid != geteuid()) {
+        send_response(connection, RESPONSE_REFUSED, 0);
+        return;
+    }
+
+    // The server accepted it non-blocking; the worker reads it with a timeout
+    int flags = fcntl(connection, F_GETFL);
+    fcntl(connection, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval timeout = {SERVER_RECEIVE_TIMEOUT, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    RequestHeader header;
+    int fds[REQUEST_FD_COUNT];
+    char *strings = receive_request(connection, &header, fds);
+    char **argv = NULL;
+    char **env = NULL;
+    if (strings != NULL) {
+        argv = (char **)malloc(((size_t)header.argc + 1) * sizeof(char *));
+        env = (char **)malloc(((size_t)header.envc + 1) * sizeof(char *));
+    }
+
+    const char *end = strings != NULL ? strings + header.length : NULL;
+    char *rest = argv != NULL && env != NULL
+                     ? split_strings(strings, end, header.argc, argv) : NULL;
+    if (rest == NULL || split_strings(rest, end, header.envc, env) == NULL ||
+        fchdir(fds[0]) != 0) {
+        send_response(connection, RESPONSE_REFUSED, 0);
+    } else {
+        // While the run goes on, SIGIO reports the client hanging up, and SIGPIPE a
+        // closed stdout; either stops it
+        g_connection = connection;
+        fcntl(connection, F_SETOWN, getpid());
+        fcntl(connection, F_SETFL, (flags & ~O_NONBLOCK) | O_ASYNC);
+        char byte;
+        if (recv(connection, &byte, 1, MSG_PEEK | MSG_DONTWAIT) != 0) {
+            int status = run_request(handler, &header, fds, argv, env, saved_fds, home_fd);
+            send_response(connection, RESPONSE_DONE, status);
+        }
+        fcntl(connection, F_SETFL, flags & ~O_NONBLOCK);
+        g_connection = -1;
+    }
+
+    close_fds(fds, REQUEST_FD_COUNT);
+    free(env);
+    free(argv);
+    free(strings);
+}
+
+/**
+ * @brief Worker process: serve the connections the server passes until it closes the pair
+ */
+static void worker_main(int control_fd, ServerHandler handler) {
+    int saved_fds[2] = {dup(STDOUT_FILENO), dup(STDERR_FILENO)};
+    int home_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+    // A closed stdout or a client that hung up ends the request, not silently the worker
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_broken_request;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPIPE, &action, NULL);
+    action.sa_handler = stop_abandoned_request;
+    sigaction(SIGIO, &action, NULL);
+
+    for (;;) {
+        char byte;
+        int connection;
+        if (receive_with_fds(control_fd, &byte, 1, &connection, 1) <= 0 || connection < 0) {
+            break;
+        }
+        serve_connection(connection, handler, saved_fds, home_fd);
+        close(connection);
+
+        char ready = 'r';
+        if (write(control_fd, &ready, 1) != 1) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+static int epoll_watch(Server *server, int operation, int fd, uint32_t events, uint64_t kind,
+                       int index) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.u64 = kind << 32 | (uint32_t)index;
+    return epoll_ctl(server->epoll_fd, operation, fd, &event);
+}
+
+/**
+ * @brief Fork the worker for a slot
+ *
+ * @return int 0 on success, -1 if it could not be started (the slot stays empty)
+ */
+static int spawn_worker(Server *server, int index) {
+    Worker *worker = &server->workers[index];
+    worker->pid = -1;
+    worker->control_fd = -1;
+    worker->busy = 0;
+    worker->served = 0;
+
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pair[0]);
+        close(pair[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        // Keep nothing of the server's, or a worker could not tell when it closes a pair
+        close(pair[0]);
+        close(server->listen_fd);
+        close(server->epoll_fd);
+        close(server->signal_fd);
+        for (int i = 0; i < server->worker_count; i++) {
+            if (server->workers[i].control_fd >= 0) {
+                close(server->workers[i].control_fd);
+            }
+        }
+        close_fds(server->connections, SERVER_MAX_PENDING);
+        worker_main(pair[1], server->handler);
+    }
+
+    close(pair[1]);
+    worker->pid = pid;
+    worker->control_fd = pair[0];
+    if (epoll_watch(server, EPOLL_CTL_ADD, pair[0], EPOLLIN, EVENT_WORKER, index) != 0) {
+        close(pair[0]);
+        worker->control_fd = -1;
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Close a worker's pair (it exits once idle) and wait for it
+ */
+static void stop_worker(Server *server, int index) {
+    Worker *worker = &server->workers[index];
+    if (worker->control_fd < 0) {
+        return;
+    }
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, worker->control_fd, NULL);
+    close(worker->control_fd);
+    worker->control_fd = -1;
+    waitpid(worker->pid, NULL, 0);
+}
+
+/**
+ * @brief A worker finished a request, or exited
+ */
+static void worker_event(Server *server, int index) {
+    Worker *worker = &server->workers[index];
+    char ready;
+    ssize_t received = read(worker->control_fd, &ready, 1);
+    if (received == 1 && worker->served < SERVER_REQUESTS_PER_WORKER) {
+        worker->busy = 0;
+        return;
+    }
+
+    // Retired after its share of requests, or gone: start a fresh one in its place
+    stop_worker(server, index);
+    if (spawn_worker(server, index) != 0) {
+        fprintf(stderr, "Warning: Cannot start a lister server worker\n");
+    }
+}
+
+static void set_accepting(Server *server, int accepting) {
+    if (server->accepting != accepting &&
+        epoll_watch(server, EPOLL_CTL_MOD, server->listen_fd, accepting ? EPOLLIN : 0,
+                    EVENT_LISTENER, 0) == 0) {
+        server->accepting = accepting;
+    }
+}
+
+/**
+ * @brief Accept every waiting connection and wait for its request
+ */
+static void accept_connections(Server *server) {
+    int slot = 0;
+    while (server->open_connections < SERVER_MAX_PENDING) {
+        int connection = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (connection < 0) {
+            return;
+        }
+
+        while (server->connections[slot] >= 0) {
+            slot++;
+        }
+        if (epoll_watch(server, EPOLL_CTL_ADD, connection, EPOLLIN, EVENT_CONNECTION, slot) != 0) {
+            close(connection);
+            continue;
+        }
+        server->connections[slot] = connection;
+        server->open_connections++;
+    }
+
+    // Full: the rest wait in the listen backlog
+    set_accepting(server, 0);
+}
+
+/**
+ * @brief A connection's request has arrived (or it hung up): queue it for a worker
+ */
+static void connection_ready(Server *server, int slot) {
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, server->connections[slot], NULL);
+    server->ready[(server->ready_head + server->ready_count) % SERVER_MAX_PENDING] = slot;
+    server->ready_count++;
+}
+
+/**
+ * @brief Hand queued connections to idle workers
+ */
+static void dispatch(Server *server) {
+    for (int i = 0; i < server->worker_count && server->ready_count > 0; i++) {
+        Worker *worker = &server->workers[i];
+        if (worker->control_fd < 0 || worker->busy) {
+            continue;
+        }
+
+        int slot = server->ready[server->ready_head];
+        server->ready_head = (server->ready_head + 1) % SERVER_MAX_PENDING;
+        server->ready_count--;
+
+        // If the worker is gone the client sees the connection close; its exit is handled
+        // as an event of its own
+        char byte = 'c';
+        if (send_with_fds(worker->control_fd, &byte, 1, &server->connections[slot], 1) == 1) {
+            worker->busy = 1;
+            worker->served++;
+        }
+        close(server->connections[slot]);
+        server->connections[slot] = -1;
+        server->open_connections--;
+    }
+
+    if (server->open_connections < SERVER_MAX_PENDING) {
+        set_accepting(server, 1);
+    }
+}
+
+/**
+ * @brief Create the listening socket, replacing a stale one left by a server that is gone
+ *
+ * @return int Socket, or -1 (an error is printed)
+ */
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un address;
+    if (socket_address(socket_path, &address) != 0) {
+        fprintf(stderr, "Error: Socket path '%s' is too long\n", socket_path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create socket\n");
+        return -1;
+    }
+
+    // Only the owner can connect (clients are also checked when served)
+    mode_t mask = umask(0177);
+    int bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    if (bound != 0 && errno == EADDRINUSE) {
+        struct stat socket_stat;
+        int live = connect_socket(socket_path);
+        if (live >= 0) {
+            close(live);
+            fprintf(stderr, "Error: A server is already listening on '%s'\n", socket_path);
+        } else if (lstat(socket_path, &socket_stat) == 0 && S_ISSOCK(socket_stat.st_mode) &&
+                   unlink(socket_path) == 0) {
+            bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+        }
+        if (live >= 0) {
+            umask(mask);
+            close(fd);
+            return -1;
+        }
+    }
+    umask(mask);
+
+    if (bound != 0 || listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "Error: Cannot listen on '%s'\n", socket_path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Load what every run needs once, so each worker starts with it
+ */
+static void warm_up(void) {
+    // Time zone data, NSS modules and the server user's own names
+    char name[256];
+    tzset();
+    owner_name(geteuid(), name, sizeof(name));
+    group_name(getegid(), name, sizeof(name));
+}
+
+int server_run(const char *socket_path, ServerHandler handler) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.handler = handler;
+    server.signal_fd = -1;
+    server.epoll_fd = -1;
+    for (int i = 0; i < SERVER_MAX_PENDING; i++) {
+        server.connections[i] = -1;
+    }
+
+    server.listen_fd = open_listener(socket_path);
+    if (server.listen_fd < 0) {
+        return 1;
+    }
+
+    // SIGINT and SIGTERM are read from the event loop; workers inherit them blocked
+    // and exit when the server closes their pairs
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server.signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (server.signal_fd < 0 || server.epoll_fd < 0 ||
+        epoll_watch(&server, EPOLL_CTL_ADD, server.listen_fd, EPOLLIN, EVENT_LISTENER, 0) != 0 ||
+        epoll_watch(&server, EPOLL_CTL_ADD, server.signal_fd, EPOLLIN, EVENT_SIGNAL, 0) != 0) {
+        fprintf(stderr, "Error: Cannot set up the event loop\n");
+        close(server.listen_fd);
+        unlink(socket_path);
+        return 1;
+    }
+    server.accepting = 1;
+
+    warm_up();
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    server.worker_count = cpus > 0 ? (int)cpus : 1;
+    if (server.worker_count > SERVER_MAX_WORKERS) {
+        server.worker_count = SERVER_MAX_WORKERS;
+    }
+    int started = 0;
+    for (int i = 0; i < server.worker_count; i++) {
+        started += spawn_worker(&server, i) == 0;
+    }
+
+    int running = started > 0;
+    if (!running) {
+        fprintf(stderr, "Error: Cannot start the lister server workers\n");
+    }
+    while (running) {
+        struct epoll_event events[64];
+        int count = epoll_wait(server.epoll_fd, events, 64, -1);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint64_t kind = events[i].data.u64 >> 32;
+            int index = (int)(uint32_t)events[i].data.u64;
+            if (kind == EVENT_LISTENER) {
+                accept_connections(&server);
+            } else if (kind == EVENT_SIGNAL) {
+                running = 0;
+            } else if (kind == EVENT_WORKER) {
+                worker_event(&server, index);
+            } else if (kind == EVENT_CONNECTION) {
+                connection_ready(&server, index);
+            }
+        }
+        dispatch(&server);
+    }
+
+    // Busy workers finish their request before they see the pair close
+    close(server.listen_fd);
+    unlink(socket_path);
+    for (int i = 0; i < server.worker_count; i++) {
+        stop_worker(&server, i);
+    }
+    close_fds(server.connections, SERVER_MAX_PENDING);
+    close(server.epoll_fd);
+    close(server.signal_fd);
+    return started > 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// Workers in the --serve pool (one per CPU, at most this many)
+#define SERVER_MAX_WORKERS 16
+
+// A worker is replaced after serving this many requests, which bounds what
+// it can accumulate (leaks, names cached from an old user database)
+#define SERVER_REQUESTS_PER_WORKER 1000
+
+// Largest request (arguments and environment) a server accepts
+#define SERVER_MAX_REQUEST (1024 * 1024)
+
+/**
+ * @brief Runs one request: the same entry point a standalone run uses
+ *
+ * @param argc Number of arguments
+ * @param argv Arguments, as the client was started with them
+ * @return int Exit status
+ */
+typedef int (*ServerHandler)(int argc, char *argv[]);
+
+/**
+ * @brief Serve listing requests on a Unix socket until SIGINT or SIGTERM
+ *
+ * An epoll loop accepts connections and hands each one, once its request
+ * has arrived, to a pool of pre-forked worker processes. Workers live across
+ * requests, so what a run warms up (NSS modules, the user and group name
+ * caches, time zone data, the page cache behind --cache) stays warm. Each
+ * request carries the client's arguments, environment, umask and file
+ * descriptors for its working directory, stdout and stderr; the worker runs
+ * the handler on those descriptors, so the output is the same bytes a
+ * standalone run would write, terminal width included. A run that writes to
+ * a closed stdout, or whose client hangs up, is stopped by ending its worker,
+ * which the server replaces. Only clients running as the server's own user
+ * are served; others are told to run themselves.
+ *
+ * @param socket_path Path to create the socket at (a stale socket is replaced)
+ * @param handler Runs one request
+ * @return int Exit status: 0 after a signal, 1 if the socket cannot be set up
+ */
+int server_run(const char *socket_path, ServerHandler handler);
+
+/**
+ * @brief Have a --serve process run this command (the --connect client)
+ *
+ * The arguments (except --connect) are sent with the environment, umask and
+ * descriptors for the working directory, stdout and stderr, and the call
+ * waits for the exit status. If the server cannot be reached or will not
+ * serve this client, nothing has been written and the caller should run the
+ * command itself.
+ *
+ * @param socket_path Socket of the server
+ * @param argc Number of arguments
+ * @param argv Arguments
+ * @param status Receives the exit status of the run
+ * @return int 0 if the server ran the command, -1 if it should be run locally
+ */
+int server_request(const char *socket_path, int argc, char *argv[], int *status);
+
+#endif
@@ -0,0 +1,296 @@
+#define _POSIX_C_SOURCE 200809L
+#include "snapshot.h"
+#include "file_info.h"
+#include "sort/sort.h"
+#include "utils/path.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "LSTSNAP"
+#define SNAPSHOT_VERSION 1
+
+/**
+ * @brief On-disk header, followed by count records and names_size bytes of names
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t names_size;
+} SnapshotHeader;
+
+/**
+ * @brief On-disk entry record, stored in strcmp order of the names
+ */
+typedef struct {
+    uint32_t name_offset;
+    uint16_t name_length;
+    uint16_t reserved;
+    uint32_t mode;
+    uint32_t reserved2;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_ns;
+} SnapshotRecord;
+
+/**
+ * @brief A memory-mapped snapshot opened for reading
+ */
+typedef struct {
+    void *map;
+    size_t map_size;
+    const SnapshotRecord *records;
+    const char *names;
+    uint32_t count;
+} Snapshot;
+
+/**
+ * @brief Check every record before the merge trusts it
+ *
+ * Each name must lie inside the names section and be NUL-terminated with no
+ * NUL inside it, and the names must be in strictly increasing strcmp order,
+ * which the merge relies on.
+ */
+static int records_valid(const SnapshotRecord *records, uint32_t count, const char *names,
+                         uint64_t names_size) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t end = (uint64_t)records[i].name_offset + records[i].name_length;
+        if (records[i].name_length == 0 || end >= names_size || names[end] != '\0' ||
+            memchr(names + records[i].name_offset, '\0', records[i].name_length) != NULL) {
+            return 0;
+        }
+        if (i > 0 && strcmp(names + records[i - 1].name_offset,
+                            names + records[i].name_offset) >= 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Map a snapshot file, rejecting it unless the header and every record are valid
+ */
+static int open_snapshot(const char *path, Snapshot *snapshot) {
+    memset(snapshot, 0, sizeof(Snapshot));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t map_size = (size_t)file_stat.st_size;
+    void *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const SnapshotHeader *header = (const SnapshotHeader *)map;
+    size_t records_size = (size_t)header->count * sizeof(SnapshotRecord);
+    const SnapshotRecord *records =
+        (const SnapshotRecord *)((const char *)map + sizeof(SnapshotHeader));
+    const char *names = (const char *)map + sizeof(SnapshotHeader) + records_size;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->names_size > map_size ||
+        sizeof(SnapshotHeader) + records_size + header->names_size != map_size ||
+        !records_valid(records, header->count, names, header->names_size)) {
+        munmap(map, map_size);
+        return -1;
+    }
+
+    // Let the kernel read ahead: the merge walks the file front to back once
+    posix_madvise(map, map_size, POSIX_MADV_SEQUENTIAL);
+
+    snapshot->map = map;
+    snapshot->map_size = map_size;
+    snapshot->records = records;
+    snapshot->names = names;
+    snapshot->count = header->count;
+    return 0;
+}
+
+static void close_snapshot(Snapshot *snapshot) {
+    if (snapshot->map != NULL) {
+        munmap(snapshot->map, snapshot->map_size);
+    }
+    memset(snapshot, 0, sizeof(Snapshot));
+}
+
+static int records_differ(const SnapshotRecord *a, const SnapshotRecord *b) {
+    return a->ino != b->ino || a->size != b->size || a->mtime_ns != b->mtime_ns ||
+           a->mode != b->mode;
+}
+
+/**
+ * @brief Write the gathered records and names as a snapshot file
+ *
+ * The file is written under a temporary name and renamed into place, so a
+ * snapshot can be refreshed in the same run that diffs against it.
+ */
+static int write_snapshot(const char *path, const SnapshotRecord *records, uint32_t count,
+                          char *const *names, uint64_t names_size) {
+    char temp_path[4096];
+    int written = snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    if (written < 0 || (size_t)written >= sizeof(temp_path)) {
+        return -1;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(SnapshotHeader));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.count = count;
+    header.names_size = names_size;
+
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    int status = 0;
+    if (fwrite(&header, sizeof(SnapshotHeader), 1, file) != 1) {
+        status = -1;
+    }
+    if (status == 0 && count > 0 &&
+        fwrite(records, sizeof(SnapshotRecord), count, file) != count) {
+        status = -1;
+    }
+    for (uint32_t i = 0; status == 0 && i < count; i++) {
+        if (fwrite(names[i], 1, (size_t)records[i].name_length + 1, file) !=
+            (size_t)records[i].name_length + 1) {
+            status = -1;
+        }
+    }
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+
+    if (status == 0 && rename(temp_path, path) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        unlink(temp_path);
+    }
+    return status;
+}
+
+int snapshot_process(const char *dir_path, DirectoryContent *content, const char *since_file,
+                     const char *out_file) {
+    if (dir_path == NULL || content == NULL) {
+        return 1;
+    }
+
+    Snapshot since;
+    memset(&since, 0, sizeof(Snapshot));
+    if (since_file != NULL && open_snapshot(since_file, &since) != 0) {
+        fprintf(stderr, "Error: Cannot read snapshot '%s'\n", since_file);
+        return 1;
+    }
+
+    int count = content->entries != NULL ? content->count : 0;
+
+    // Both sides of the merge must use the same order: plain strcmp. The names are
+    // sorted in a private array, so the caller's listing keeps its own order
+    char **sorted = (char **)malloc((count > 0 ? count : 1) * sizeof(char *));
+    SnapshotRecord *records = NULL;
+    char **names = NULL;
+    if (out_file != NULL && count > 0) {
+        records = (SnapshotRecord *)calloc(count, sizeof(SnapshotRecord));
+        names = (char **)malloc(count * sizeof(char *));
+    }
+    if (sorted == NULL || (out_file != NULL && count > 0 && (records == NULL || names == NULL))) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(sorted);
+        free(records);
+        free(names);
+        close_snapshot(&since);
+        return 1;
+    }
+    if (count > 0) {
+        memcpy(sorted, content->entries, count * sizeof(char *));
+    }
+    sort_entries(sorted, count, SORT_MODE_ALPHA, dir_path, 0);
+
+    uint32_t written = 0;
+    uint64_t names_size = 0;
+    uint32_t old_index = 0;
+
+    // Single pass: stat each current entry, merge it against the snapshot
+    // cursor and append it to the new snapshot
+    for (int i = 0; i < count; i++) {
+        const char *name = sorted[i];
+        char full_path[PATH_BUFFER_SIZE];
+        struct stat stat_info;
+        if (join_path(full_path, sizeof(full_path), dir_path, name) != 0 ||
+            fstatat(AT_FDCWD, full_path, &stat_info, file_info_stat_flags()) != 0) {
+            // Vanished since it was read: treat as absent
+            continue;
+        }
+
+        SnapshotRecord current;
+        memset(&current, 0, sizeof(SnapshotRecord));
+        current.name_offset = (uint32_t)names_size;
+        current.name_length = (uint16_t)strlen(name);
+        current.mode = (uint32_t)stat_info.st_mode;
+        current.ino = (uint64_t)stat_info.st_ino;
+        current.size = (int64_t)stat_info.st_size;
+        current.mtime_ns = (int64_t)stat_info.st_mtim.tv_sec * 1000000000LL +
+                           stat_info.st_mtim.tv_nsec;
+
+        if (since.map != NULL) {
+            // Everything in the snapshot that sorts before this name is gone
+            while (old_index < since.count &&
+                   strcmp(since.names + since.records[old_index].name_offset, name) < 0) {
+                printf("- %s\n", since.names + since.records[old_index].name_offset);
+                old_index++;
+            }
+
+            if (old_index < since.count &&
+                strcmp(since.names + since.records[old_index].name_offset, name) == 0) {
+                if (records_differ(&since.records[old_index], &current)) {
+                    printf("M %s\n", name);
+                }
+                old_index++;
+            } else {
+                printf("+ %s\n", name);
+            }
+        }
+
+        if (records != NULL) {
+            records[written] = current;
+            names[written] = sorted[i];
+            written++;
+            names_size += current.name_length + 1;
+        }
+    }
+
+    // Whatever remains in the snapshot sorts after every current entry
+    while (since.map != NULL && old_index < since.count) {
+        printf("- %s\n", since.names + since.records[old_index].name_offset);
+        old_index++;
+    }
+
+    int status = 0;
+    if (out_file != NULL && write_snapshot(out_file, records, written, names, names_size) != 0) {
+        fprintf(stderr, "Error: Cannot write snapshot '%s'\n", out_file);
+        status = 1;
+    }
+
+    free(sorted);
+    free(records);
+    free(names);
+    close_snapshot(&since);
+    return status;
+}
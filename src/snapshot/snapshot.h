@@ -0,0 +1,25 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "directory_reader.h"
+
+/**
+ * @brief Compare a directory against a snapshot and/or write a new snapshot
+ *
+ * The entries are stat'ed once each in name order, without reordering content. In the same pass the
+ * current listing is merged against the memory-mapped snapshot in since_file
+ * (also sorted by name) and each difference is printed as one line:
+ *   "+ name" for an added entry, "- name" for a removed entry,
+ *   "M name" for an entry whose inode, size, mtime or mode changed.
+ * The records gathered in the pass are written to out_file.
+ *
+ * @param dir_path Directory the entries belong to
+ * @param content Entries to process (left in their order; may be empty)
+ * @param since_file Snapshot to compare against, or NULL to skip the diff
+ * @param out_file Snapshot file to write, or NULL to skip writing
+ * @return int 0 on success, 1 on error
+ */
+int snapshot_process(const char *dir_path, DirectoryContent *content, const char *since_file,
+                     const char *out_file);
+
+#endif
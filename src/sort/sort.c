@@ -1,10 +1,15 @@
+#define _DEFAULT_SOURCE
 #include "sort.h"
+#include "file_info.h"
+#include "utils/parallel_sort.h"
 #include "utils/path.h"
+#include <dirent.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 
-// Global variables for qsort callback functions
+// Global variables for the sort callback functions (set before a sort, read by its threads)
 static const char *g_time_sort_dir = NULL;
 static int g_reverse_sort = 0;
 
@@ -53,16 +58,11 @@ static int compare_by_time_internal(const char *str_a, const char *str_b,
     struct stat stat_b;
     int result = 0;
 
-    if (stat(path_a, &stat_a) == 0 && stat(path_b, &stat_b) == 0) {
-        // Compare by modification time (newer files first)
-        if (stat_a.st_mtime > stat_b.st_mtime) {
-            result = -1;
-        } else if (stat_a.st_mtime < stat_b.st_mtime) {
-            result = 1;
-        } else {
-            // If times are equal, compare alphabetically
-            result = strcmp(str_a, str_b);
-        }
+    int flags = file_info_stat_flags();
+    if (fstatat(AT_FDCWD, path_a, &stat_a, flags) == 0 &&
+        fstatat(AT_FDCWD, path_b, &stat_b, flags) == 0) {
+        result = compare_entries(str_a, stat_a.st_mtime, str_b, stat_b.st_mtime,
+                                 SORT_MODE_MTIME, 0);
     } else {
         // If stat fails, fall back to alphabetical comparison
         result = strcmp(str_a, str_b);
@@ -89,6 +89,27 @@ static int compare_strings_wrapper(const void *a, const void *b) {
     return compare_strings(a, b, g_reverse_sort);
 }
 
+int compare_entries(const char *name_a, time_t mtime_a, const char *name_b, time_t mtime_b,
+                    SortMode mode, int reverse) {
+    int result = 0;
+
+    if (mode == SORT_MODE_MTIME) {
+        // Compare by modification time (newer files first)
+        if (mtime_a > mtime_b) {
+            result = -1;
+        } else if (mtime_a < mtime_b) {
+            result = 1;
+        }
+    }
+
+    if (result == 0) {
+        // If times are equal (or sorting alphabetically), compare by name
+        result = strcmp(name_a, name_b);
+    }
+
+    return reverse ? -result : result;
+}
+
 void sort_entries(char **entries, int count, SortMode mode, const char *dir_path, int reverse) {
     if (entries == NULL || count <= 1) {
         return;
@@ -97,12 +118,126 @@ void sort_entries(char **entries, int count, SortMode mode, const char *dir_path
     g_reverse_sort = reverse;
 
     if (mode == SORT_MODE_ALPHA) {
-        qsort(entries, count, sizeof(char *), compare_strings_wrapper);
+        parallel_sort(entries, count, sizeof(char *), compare_strings_wrapper);
         return;
     }
 
     // Sort by modification time
     g_time_sort_dir = dir_path;
-    qsort(entries, count, sizeof(char *), compare_by_time);
+    parallel_sort(entries, count, sizeof(char *), compare_by_time);
     g_time_sort_dir = NULL;
 }
+
+/**
+ * @brief Entry with its sort key computed once up front; name must stay the
+ *        first member so the char ** comparators above can read it through a
+ *        pointer to the struct
+ */
+typedef struct {
+    char *name;
+    unsigned char type;
+    ino_t inode;
+    int mtime_valid;         // Non-zero if stat succeeded
+    time_t mtime;            // Modification time (SORT_MODE_MTIME only)
+} SortKey;
+
+/**
+ * @brief Wrapper for qsort to compare precomputed modification times
+ */
+static int compare_sort_keys(const void *a, const void *b) {
+    const SortKey *key_a = (const SortKey *)a;
+    const SortKey *key_b = (const SortKey *)b;
+    int result;
+
+    if (key_a->mtime_valid && key_b->mtime_valid) {
+        result = compare_entries(key_a->name, key_a->mtime, key_b->name, key_b->mtime,
+                                 SORT_MODE_MTIME, 0);
+    } else {
+        // If stat failed, fall back to alphabetical comparison
+        result = strcmp(key_a->name, key_b->name);
+    }
+
+    return g_reverse_sort ? -result : result;
+}
+
+/**
+ * @brief Stat every entry once, relative to an open directory descriptor
+ *
+ * @param order Indices in the order to stat them (see directory_stat_order()), or NULL
+ */
+static void load_mtimes(SortKey *keys, int count, const char *dir_path, const int *order) {
+    DIR *dir = dir_path != NULL ? opendir(dir_path) : NULL;
+    int dir_fd = dir != NULL ? dirfd(dir) : -1;
+    int flags = file_info_stat_flags();
+
+    for (int k = 0; k < count; k++) {
+        int i = order != NULL ? order[k] : k;
+        struct stat stat_info;
+        keys[i].mtime_valid = dir_fd >= 0 &&
+                              fstatat(dir_fd, keys[i].name, &stat_info, flags) == 0;
+        keys[i].mtime = keys[i].mtime_valid ? stat_info.st_mtime : 0;
+    }
+
+    if (dir != NULL) {
+        closedir(dir);
+    }
+}
+
+void sort_directory_content(DirectoryContent *content, SortMode mode, const char *dir_path,
+                            int reverse) {
+    if (content == NULL || content->entries == NULL || content->count <= 1) {
+        return;
+    }
+
+    if (content->types == NULL && content->inodes == NULL && mode == SORT_MODE_ALPHA) {
+        sort_entries(content->entries, content->count, mode, dir_path, reverse);
+        return;
+    }
+
+    // Keys live as long as the listing when it is arena-backed
+    size_t keys_size = content->count * sizeof(SortKey);
+    SortKey *keys = (SortKey *)(content->arena != NULL ? arena_alloc(content->arena, keys_size)
+                                                       : malloc(keys_size));
+    if (keys == NULL) {
+        // Fall back to sorting names only; the types are no longer meaningful
+        sort_entries(content->entries, content->count, mode, dir_path, reverse);
+        if (content->arena == NULL) {
+            free(content->types);
+            free(content->inodes);
+        }
+        content->types = NULL;
+        content->inodes = NULL;
+        return;
+    }
+
+    for (int i = 0; i < content->count; i++) {
+        keys[i].name = content->entries[i];
+        keys[i].type = content->types != NULL ? content->types[i] : DT_UNKNOWN;
+        keys[i].inode = content->inodes != NULL ? content->inodes[i] : 0;
+    }
+
+    g_reverse_sort = reverse;
+    if (mode == SORT_MODE_ALPHA || dir_path == NULL) {
+        parallel_sort(keys, content->count, sizeof(SortKey), compare_strings_wrapper);
+    } else {
+        int *order = directory_stat_order(content);
+        load_mtimes(keys, content->count, dir_path, order);
+        if (content->arena == NULL) {
+            free(order);
+        }
+        parallel_sort(keys, content->count, sizeof(SortKey), compare_sort_keys);
+    }
+
+    for (int i = 0; i < content->count; i++) {
+        content->entries[i] = keys[i].name;
+        if (content->types != NULL) {
+            content->types[i] = keys[i].type;
+        }
+        if (content->inodes != NULL) {
+            content->inodes[i] = keys[i].inode;
+        }
+    }
+    if (content->arena == NULL) {
+        free(keys);
+    }
+}
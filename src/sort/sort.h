@@ -1,6 +1,10 @@
 #ifndef SORT_H
 #define SORT_H
 
+#include <time.h>
+
+#include "directory_reader.h"
+
 typedef enum {
     SORT_MODE_ALPHA,
     SORT_MODE_MTIME
@@ -17,4 +21,29 @@ typedef enum {
  */
 void sort_entries(char **entries, int count, SortMode mode, const char *dir_path, int reverse);
 
+/**
+ * @brief Compare two entries using the ordering applied by sort_entries().
+ *
+ * @param name_a Name of the first entry.
+ * @param mtime_a Modification time of the first entry (ignored for SORT_MODE_ALPHA).
+ * @param name_b Name of the second entry.
+ * @param mtime_b Modification time of the second entry (ignored for SORT_MODE_ALPHA).
+ * @param mode Sorting criteria.
+ * @param reverse If non-zero, reverse the comparison result.
+ * @return int Negative if a sorts before b, positive if after, zero if equal.
+ */
+int compare_entries(const char *name_a, time_t mtime_a, const char *name_b, time_t mtime_b,
+                    SortMode mode, int reverse);
+
+/**
+ * @brief Sort directory content, keeping entry types aligned with their names.
+ *
+ * @param content Directory content to sort in place.
+ * @param mode Sorting criteria.
+ * @param dir_path Directory path needed for time-based sorting.
+ * @param reverse If non-zero, reverse the sort order.
+ */
+void sort_directory_content(DirectoryContent *content, SortMode mode, const char *dir_path,
+                            int reverse);
+
 #endif
@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 200809L
+#include "summary.h"
+#include "directory_reader.h"
+#include "file_info.h"
+#include "filter/filter.h"
+#include "utils/arena.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INITIAL_CAPACITY 64
+
+// Group label of entries whose metadata could not be read
+#define UNKNOWN_LABEL "?"
+#define NO_EXTENSION_LABEL "(none)"
+
+/**
+ * @brief Age buckets of --summary=age, newest first
+ */
+static const struct {
+    long long max_age;   // Upper bound in seconds (exclusive)
+    const char *label;
+} g_age_buckets[] = {
+    {24LL * 3600, "<1d"},
+    {7LL * 24 * 3600, "1d-7d"},
+    {30LL * 24 * 3600, "7d-30d"},
+    {90LL * 24 * 3600, "30d-90d"},
+    {365LL * 24 * 3600, "90d-1y"},
+    {LLONG_MAX, ">1y"}
+};
+#define AGE_BUCKET_COUNT ((int)(sizeof(g_age_buckets) / sizeof(g_age_buckets[0])))
+
+/**
+ * @brief Running totals of one group
+ */
+typedef struct {
+    uint64_t hash;       // Hash of the key (0: empty slot)
+    uint64_t id;         // UID, GID or age bucket
+    const char *name;    // Extension (SUMMARY_EXT only), arena-backed
+    long long count;     // Entries in the group
+    long long bytes;     // Sum of their sizes
+} SummaryGroup;
+
+/**
+ * @brief Open-addressing hash table of groups
+ */
+typedef struct {
+    SummaryGroup *slots;
+    size_t capacity;     // Power of two
+    size_t used;
+    Arena names;         // Extension strings
+} SummaryTable;
+
+/**
+ * @brief State of one summary pass
+ */
+typedef struct {
+    int dir_fd;
+    const Filter *filter;
+    SummaryKey key;
+    time_t now;
+    SummaryTable table;
+    long long unknown_count;   // Entries that could not be stat'ed
+    int error;                 // Non-zero once memory ran out
+} SummaryContext;
+
+int summary_parse(const char *name) {
+    if (strcmp(name, "owner") == 0) {
+        return SUMMARY_OWNER;
+    }
+    if (strcmp(name, "group") == 0) {
+        return SUMMARY_GROUP;
+    }
+    if (strcmp(name, "ext") == 0) {
+        return SUMMARY_EXT;
+    }
+    if (strcmp(name, "age") == 0) {
+        return SUMMARY_AGE;
+    }
+    return -1;
+}
+
+/**
+ * @brief Mix a 64-bit value into a hash that is never 0
+ */
+static uint64_t hash_id(uint64_t id) {
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+    return id | 1;
+}
+
+/**
+ * @brief FNV-1a hash of a string, never 0
+ */
+static uint64_t hash_name(const char *name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)name; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Double the table and reinsert every group
+ *
+ * @return int 0 on success, -1 if memory ran out
+ */
+static int grow_table(SummaryTable *table) {
+    size_t capacity = table->capacity * 2;
+    SummaryGroup *slots = (SummaryGroup *)calloc(capacity, sizeof(SummaryGroup));
+    if (slots == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].hash == 0) {
+            continue;
+        }
+        size_t slot = table->slots[i].hash & (capacity - 1);
+        while (slots[slot].hash != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = table->slots[i];
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Find a group, adding it if it is new
+ *
+ * @param name Extension to look up (SUMMARY_EXT), or NULL to look up id
+ * @return SummaryGroup* The group, or NULL if memory ran out
+ */
+static SummaryGroup *find_group(SummaryTable *table, uint64_t id, const char *name) {
+    // Keep the load factor under 3/4 so probe sequences stay short
+    if ((table->used + 1) * 4 > table->capacity * 3 && grow_table(table) != 0) {
+        return NULL;
+    }
+
+    uint64_t hash = name != NULL ? hash_name(name) : hash_id(id);
+    size_t slot = hash & (table->capacity - 1);
+    while (table->slots[slot].hash != 0) {
+        SummaryGroup *group = &table->slots[slot];
+        if (group->hash == hash &&
+            (name != NULL ? strcmp(group->name, name) == 0 : group->id == id)) {
+            return group;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    SummaryGroup *group = &table->slots[slot];
+    group->hash = hash;
+    group->id = id;
+    group->name = NULL;
+    if (name != NULL) {
+        group->name = arena_strdup(&table->names, name);
+        if (group->name == NULL) {
+            group->hash = 0;
+            return NULL;
+        }
+    }
+    table->used++;
+    return group;
+}
+
+/**
+ * @brief Extension of a name, or NULL if it has none
+ */
+static const char *name_extension(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (dot == NULL || dot == name || dot[1] == '\0') {
+        return NULL;
+    }
+    return dot;
+}
+
+/**
+ * @brief Index into g_age_buckets for a modification time
+ */
+static int age_bucket(time_t now, time_t mtime) {
+    long long age = (long long)now - (long long)mtime;
+    int bucket = 0;
+    while (bucket < AGE_BUCKET_COUNT - 1 && age >= g_age_buckets[bucket].max_age) {
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @brief read_directory_each() callback: add one entry to its group
+ */
+static int summarize_entry(const char *name, unsigned char type, ino_t inode, void *context) {
+    (void)inode;
+    SummaryContext *summary = (SummaryContext *)context;
+
+    // Tests the reader could not decide from the name and type need metadata
+    if (summary->filter != NULL &&
+        filter_match_name(summary->filter, name, type) == FILTER_UNKNOWN &&
+        !filter_entry_passes(summary->filter, summary->dir_fd, name, type)) {
+        return 0;
+    }
+
+    struct stat stat_info;
+    if (fstatat(summary->dir_fd, name, &stat_info, file_info_stat_flags()) != 0) {
+        summary->unknown_count++;
+        return 0;
+    }
+
+    SummaryGroup *group = NULL;
+    switch (summary->key) {
+        case SUMMARY_OWNER:
+            group = find_group(&summary->table, (uint64_t)stat_info.st_uid, NULL);
+            break;
+        case SUMMARY_GROUP:
+            group = find_group(&summary->table, (uint64_t)stat_info.st_gid, NULL);
+            break;
+        case SUMMARY_EXT: {
+            const char *extension = name_extension(name);
+            group = find_group(&summary->table, 0,
+                               extension != NULL ? extension : NO_EXTENSION_LABEL);
+            break;
+        }
+        default:
+            group = find_group(&summary->table,
+                               (uint64_t)age_bucket(summary->now, stat_info.st_mtime), NULL);
+            break;
+    }
+    if (group == NULL) {
+        summary->error = 1;
+        return 1;
+    }
+
+    group->count++;
+    group->bytes += (long long)stat_info.st_size;
+    return 0;
+}
+
+/**
+ * @brief One printed row of the summary
+ */
+typedef struct {
+    char label[256];
+    long long count;
+    long long bytes;
+    int order;           // Age bucket, for --summary=age
+} SummaryRow;
+
+/**
+ * @brief Wrapper for qsort: age buckets in order, other groups by bytes, largest first
+ */
+static int compare_rows(const void *a, const void *b) {
+    const SummaryRow *row_a = (const SummaryRow *)a;
+    const SummaryRow *row_b = (const SummaryRow *)b;
+    if (row_a->order != row_b->order) {
+        return row_a->order - row_b->order;
+    }
+    if (row_a->bytes != row_b->bytes) {
+        return row_a->bytes > row_b->bytes ? -1 : 1;
+    }
+    return strcmp(row_a->label, row_b->label);
+}
+
+/**
+ * @brief Format a byte total like the size column
+ */
+static void format_bytes(long long bytes, int human_readable, char *buffer, size_t buffer_size) {
+    if (human_readable) {
+        format_human_readable_size(bytes, buffer, buffer_size);
+    } else {
+        snprintf(buffer, buffer_size, "%lld", bytes);
+    }
+}
+
+/**
+ * @brief Print the groups as an aligned table with a total row
+ */
+static int print_summary(const SummaryContext *summary, int human_readable) {
+    static const char *headers[] = {"", "OWNER", "GROUP", "EXT", "AGE"};
+
+    int row_count = (int)summary->table.used + (summary->unknown_count > 0 ? 1 : 0);
+    SummaryRow *rows = (SummaryRow *)malloc((row_count > 0 ? row_count : 1) * sizeof(SummaryRow));
+    if (rows == NULL) {
+        return -1;
+    }
+
+    int index = 0;
+    for (size_t i = 0; i < summary->table.capacity; i++) {
+        const SummaryGroup *group = &summary->table.slots[i];
+        if (group->hash == 0) {
+            continue;
+        }
+
+        SummaryRow *row = &rows[index++];
+        row->count = group->count;
+        row->bytes = group->bytes;
+        row->order = 0;
+        switch (summary->key) {
+            case SUMMARY_OWNER:
+                owner_name((uid_t)group->id, row->label, sizeof(row->label));
+                break;
+            case SUMMARY_GROUP:
+                group_name((gid_t)group->id, row->label, sizeof(row->label));
+                break;
+            case SUMMARY_EXT:
+                snprintf(row->label, sizeof(row->label), "%s", group->name);
+                break;
+            default:
+                snprintf(row->label, sizeof(row->label), "%s", g_age_buckets[group->id].label);
+                row->order = (int)group->id;
+                break;
+        }
+    }
+    if (summary->unknown_count > 0) {
+        SummaryRow *row = &rows[index++];
+        snprintf(row->label, sizeof(row->label), "%s", UNKNOWN_LABEL);
+        row->count = summary->unknown_count;
+        row->bytes = 0;
+        row->order = AGE_BUCKET_COUNT;   // After every real group
+    }
+    qsort(rows, row_count, sizeof(SummaryRow), compare_rows);
+
+    // Column widths, including the header and the total row
+    long long total_count = 0;
+    long long total_bytes = 0;
+    int label_width = (int)strlen("total");
+    int count_width = (int)strlen("FILES");
+    int bytes_width = (int)strlen("SIZE");
+    char number[32];
+    for (int i = 0; i <= row_count; i++) {
+        const char *label = i < row_count ? rows[i].label : headers[summary->key];
+        long long count = i < row_count ? rows[i].count : total_count;
+        long long bytes = i < row_count ? rows[i].bytes : total_bytes;
+        if ((int)strlen(label) > label_width) {
+            label_width = (int)strlen(label);
+        }
+        int count_len = snprintf(number, sizeof(number), "%lld", count);
+        if (count_len > count_width) {
+            count_width = count_len;
+        }
+        format_bytes(bytes, human_readable, number, sizeof(number));
+        if ((int)strlen(number) > bytes_width) {
+            bytes_width = (int)strlen(number);
+        }
+        if (i < row_count) {
+            total_count += rows[i].count;
+            total_bytes += rows[i].bytes;
+        }
+    }
+
+    printf("%-*s %*s %*s\n", label_width, headers[summary->key], count_width, "FILES",
+           bytes_width, "SIZE");
+    for (int i = 0; i < row_count; i++) {
+        format_bytes(rows[i].bytes, human_readable, number, sizeof(number));
+        printf("%-*s %*lld %*s\n", label_width, rows[i].label, count_width, rows[i].count,
+               bytes_width, number);
+    }
+    format_bytes(total_bytes, human_readable, number, sizeof(number));
+    printf("%-*s %*lld %*s\n", label_width, "total", count_width, total_count, bytes_width,
+           number);
+
+    free(rows);
+    return 0;
+}
+
+int summary_directory(const char *dir_path, int show_all, const Filter *filter,
+                      SummaryKey key, int human_readable) {
+    SummaryContext summary;
+    memset(&summary, 0, sizeof(SummaryContext));
+    summary.filter = filter_is_active(filter) ? filter : NULL;
+    summary.key = key;
+    summary.now = time(NULL);
+    arena_init(&summary.table.names);
+    summary.table.capacity = INITIAL_CAPACITY;
+    summary.table.slots = (SummaryGroup *)calloc(INITIAL_CAPACITY, sizeof(SummaryGroup));
+
+    summary.dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int status = 0;
+    if (summary.table.slots == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        status = 1;
+    } else if (summary.dir_fd < 0 ||
+               read_directory_each(dir_path, show_all, summary.filter, summarize_entry,
+                                   &summary) < 0) {
+        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+        status = 1;
+    } else if (summary.error || print_summary(&summary, human_readable) != 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        status = 1;
+    }
+
+    if (summary.dir_fd >= 0) {
+        close(summary.dir_fd);
+    }
+    free(summary.table.slots);
+    arena_destroy(&summary.table.names);
+    return status;
+}
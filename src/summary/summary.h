@@ -0,0 +1,44 @@
+#ifndef SUMMARY_H
+#define SUMMARY_H
+
+struct Filter;  // Compiled entry filter (filter/filter.h)
+
+/**
+ * @brief What --summary groups entries by
+ */
+typedef enum {
+    SUMMARY_NONE,
+    SUMMARY_OWNER,   // Owner name (as the owner column shows it)
+    SUMMARY_GROUP,   // Group name
+    SUMMARY_EXT,     // Name extension: text after the last '.', not counting a leading one
+    SUMMARY_AGE      // Time since the last modification, in fixed buckets
+} SummaryKey;
+
+/**
+ * @brief Look up a summary key by name
+ *
+ * @param name "owner", "group", "ext" or "age"
+ * @return int The SummaryKey, or -1 if the name is unknown
+ */
+int summary_parse(const char *name);
+
+/**
+ * @brief Print the number of entries and bytes per group of a directory
+ *
+ * Entries are streamed from the directory and stat'ed one at a time; only
+ * the running totals of each group are kept, in a hash table, so memory grows
+ * with the number of groups rather than the number of entries. Groups are
+ * printed largest first (age buckets from newest to oldest), followed by a
+ * total. Entries whose metadata cannot be read are counted under "?".
+ *
+ * @param dir_path Directory to summarize
+ * @param show_all Include hidden entries
+ * @param filter Compiled filter deciding which entries count (may be NULL)
+ * @param key What to group by
+ * @param human_readable If non-zero, show byte totals in human-readable format
+ * @return int 0 on success, 1 on error
+ */
+int summary_directory(const char *dir_path, int show_all, const struct Filter *filter,
+                      SummaryKey key, int human_readable);
+
+#endif
@@ -0,0 +1,244 @@
+#define _DEFAULT_SOURCE
+#include "tree.h"
+#include "directory_reader.h"
+#include "filter/filter.h"
+#include "utils/path.h"
+#include "utils/writer.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Connectors drawn before each name
+#define TREE_BRANCH "├── "
+#define TREE_LAST_BRANCH "└── "
+#define TREE_VERTICAL "│   "
+#define TREE_SPACE "    "
+
+#define TREE_ERROR_SUFFIX " [error opening dir]"
+
+#define INITIAL_STACK_DEPTH 16
+
+/**
+ * @brief One directory on the path from the root to the entry being shown
+ */
+typedef struct {
+    DirectoryContent content;   // Its (sorted) children, heap-allocated
+    int next;                   // Index of the next child to show
+    size_t path_length;         // Length of its path in TreeWalk.path
+} TreeFrame;
+
+/**
+ * @brief State of a tree walk
+ */
+typedef struct {
+    const TreeConfig *config;
+    TreeFrame *frames;          // Explicit stack; frames[0] holds the root's children
+    int depth;                  // Frames in use
+    int capacity;
+    char path[PATH_BUFFER_SIZE];  // Path of the entry being shown
+    size_t path_length;
+    long long directories;
+    long long files;
+    Writer writer;
+} TreeWalk;
+
+/**
+ * @brief Append "/name" to the walk's path
+ *
+ * @return int 0 on success, -1 if the path would not fit (the path is unchanged)
+ */
+static int enter_name(TreeWalk *walk, const char *name) {
+    size_t name_length = strlen(name);
+    int separator = walk->path_length > 0 && walk->path[walk->path_length - 1] != '/';
+    if (walk->path_length + separator + name_length + 1 > sizeof(walk->path)) {
+        return -1;
+    }
+
+    if (separator) {
+        walk->path[walk->path_length++] = '/';
+    }
+    memcpy(walk->path + walk->path_length, name, name_length + 1);
+    walk->path_length += name_length;
+    return 0;
+}
+
+/**
+ * @brief Cut the walk's path back to a directory's length
+ */
+static void leave_to(TreeWalk *walk, size_t path_length) {
+    walk->path_length = path_length;
+    walk->path[path_length] = '\0';
+}
+
+/**
+ * @brief Read, filter and sort the directory at the walk's path
+ *
+ * @param content Receives the children
+ * @return int 0 on success, -1 if the directory cannot be read
+ */
+static int read_level(TreeWalk *walk, DirectoryContent *content) {
+    const TreeConfig *config = walk->config;
+    *content = read_directory_filtered(walk->path, config->show_all, config->filter, NULL);
+    if (content->entries == NULL) {
+        return -1;
+    }
+
+    filter_apply_metadata(config->filter, walk->path, content);
+    if (config->sorted) {
+        sort_directory_content(content, config->mode, walk->path, config->reverse);
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether the entry at the walk's path is a directory (links are not followed)
+ */
+static int is_directory(const TreeWalk *walk, unsigned char type) {
+    if (type != DT_UNKNOWN) {
+        return type == DT_DIR;
+    }
+
+    struct stat stat_info;
+    return lstat(walk->path, &stat_info) == 0 && S_ISDIR(stat_info.st_mode);
+}
+
+/**
+ * @brief Push a directory's children onto the stack
+ *
+ * @return int 0 on success, -1 if memory ran out (the content is freed)
+ */
+static int push_frame(TreeWalk *walk, DirectoryContent content) {
+    if (walk->depth == walk->capacity) {
+        int capacity = walk->capacity * 2;
+        TreeFrame *frames = (TreeFrame *)realloc(walk->frames, capacity * sizeof(TreeFrame));
+        if (frames == NULL) {
+            free_directory_content(content);
+            return -1;
+        }
+        walk->frames = frames;
+        walk->capacity = capacity;
+    }
+
+    TreeFrame *frame = &walk->frames[walk->depth++];
+    frame->content = content;
+    frame->next = 0;
+    frame->path_length = walk->path_length;
+    return 0;
+}
+
+/**
+ * @brief Show the next entry of the deepest directory, descending into it if needed
+ */
+static void show_next_entry(TreeWalk *walk) {
+    TreeFrame *frame = &walk->frames[walk->depth - 1];
+    int index = frame->next++;
+    const char *name = frame->content.entries[index];
+    unsigned char type = frame->content.types != NULL ? frame->content.types[index] : DT_UNKNOWN;
+
+    // One column per ancestor: a line while it still has children to come
+    for (int level = 0; level < walk->depth - 1; level++) {
+        const TreeFrame *ancestor = &walk->frames[level];
+        writer_put(&walk->writer,
+                   ancestor->next < ancestor->content.count ? TREE_VERTICAL : TREE_SPACE,
+                   ancestor->next < ancestor->content.count ? sizeof(TREE_VERTICAL) - 1
+                                                            : sizeof(TREE_SPACE) - 1);
+    }
+    if (frame->next < frame->content.count) {
+        writer_put(&walk->writer, TREE_BRANCH, sizeof(TREE_BRANCH) - 1);
+    } else {
+        writer_put(&walk->writer, TREE_LAST_BRANCH, sizeof(TREE_LAST_BRANCH) - 1);
+    }
+    writer_put(&walk->writer, name, strlen(name));
+
+    DirectoryContent children;
+    int opened = 0;
+    int descend = 0;
+    if (enter_name(walk, name) != 0) {
+        // Too deep to name: shown, but neither classified nor entered
+        walk->files++;
+    } else if (!is_directory(walk, type)) {
+        walk->files++;
+    } else {
+        walk->directories++;
+        int max_depth = walk->config->max_depth;
+        if (max_depth == 0 || walk->depth < max_depth) {
+            if (read_level(walk, &children) == 0) {
+                opened = 1;
+                descend = children.count > 0;
+            } else {
+                writer_put(&walk->writer, TREE_ERROR_SUFFIX, sizeof(TREE_ERROR_SUFFIX) - 1);
+            }
+        }
+    }
+    writer_put(&walk->writer, "\n", 1);
+
+    // Continue inside a directory with children; otherwise back to this level
+    if (descend && push_frame(walk, children) == 0) {
+        return;
+    }
+    if (opened && !descend) {
+        free_directory_content(children);
+    }
+    leave_to(walk, frame->path_length);
+}
+
+int tree_display(const char *dir_path, const TreeConfig *config) {
+    TreeWalk *walk = (TreeWalk *)malloc(sizeof(TreeWalk));
+    if (walk == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    walk->config = config;
+    walk->depth = 0;
+    walk->capacity = INITIAL_STACK_DEPTH;
+    walk->frames = (TreeFrame *)malloc(walk->capacity * sizeof(TreeFrame));
+    walk->directories = 0;
+    walk->files = 0;
+    walk->path_length = 0;
+    walk->path[0] = '\0';
+    writer_init(&walk->writer, stdout);
+
+    DirectoryContent root;
+    if (walk->frames == NULL || enter_name(walk, dir_path) != 0 || read_level(walk, &root) != 0) {
+        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+        free(walk->frames);
+        free(walk);
+        return 1;
+    }
+
+    writer_put(&walk->writer, dir_path, strlen(dir_path));
+    writer_put(&walk->writer, "\n", 1);
+    if (root.count > 0) {
+        push_frame(walk, root);
+    } else {
+        free_directory_content(root);
+    }
+
+    // Depth-first walk: show the deepest directory's next child, or pop it when done
+    while (walk->depth > 0) {
+        TreeFrame *frame = &walk->frames[walk->depth - 1];
+        if (frame->next < frame->content.count) {
+            show_next_entry(walk);
+            continue;
+        }
+
+        free_directory_content(frame->content);
+        walk->depth--;
+        if (walk->depth > 0) {
+            leave_to(walk, walk->frames[walk->depth - 1].path_length);
+        }
+    }
+
+    char counts[96];
+    int length = snprintf(counts, sizeof(counts), "\n%lld director%s, %lld file%s\n",
+                          walk->directories, walk->directories == 1 ? "y" : "ies",
+                          walk->files, walk->files == 1 ? "" : "s");
+    writer_put(&walk->writer, counts, (size_t)length);
+    writer_flush(&walk->writer);
+
+    free(walk->frames);
+    free(walk);
+    return 0;
+}
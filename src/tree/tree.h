@@ -0,0 +1,36 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include "sort/sort.h"
+
+struct Filter;  // Compiled entry filter (filter/filter.h)
+
+/**
+ * @brief What a tree view shows
+ */
+typedef struct {
+    int show_all;                  // Include hidden entries
+    const struct Filter *filter;   // Compiled filter applied to every entry (may be NULL)
+    int sorted;                    // Sort each directory; otherwise keep directory order
+    SortMode mode;                 // Sort order when sorted
+    int reverse;                   // Reverse the sort order
+    int max_depth;                 // Levels below the root to show (0: no limit)
+} TreeConfig;
+
+/**
+ * @brief Print a directory and everything below it as an indented tree
+ *
+ * Each directory is read (and sorted) only when the walk reaches it, and its
+ * listing is freed when the walk leaves it. The walk keeps an explicit stack
+ * with one sibling list per level, so memory is bounded by the depth times
+ * the largest directory rather than by the size of the tree. Lines are
+ * streamed through a buffered writer, followed by a count of the directories
+ * and files shown. Symbolic links to directories are not followed.
+ *
+ * @param dir_path Root directory
+ * @param config What to show
+ * @return int 0 on success, 1 if the root cannot be read
+ */
+int tree_display(const char *dir_path, const TreeConfig *config);
+
+#endif
@@ -0,0 +1,98 @@
+#define _DEFAULT_SOURCE
+#include "arena.h"
+#include <string.h>
+#include <sys/mman.h>
+
+// Size of the first mapping; later mappings double up to ARENA_MAX_BLOCK_SIZE
+#define ARENA_INITIAL_BLOCK_SIZE (256 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (64 * 1024 * 1024)
+#define ARENA_ALIGNMENT 16
+
+// Header size rounded so allocations after it stay aligned
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+void arena_init(Arena *arena) {
+    arena->head = NULL;
+    arena->next_block_size = ARENA_INITIAL_BLOCK_SIZE;
+    arena->block_count = 0;
+    arena->bytes_allocated = 0;
+}
+
+/**
+ * @brief Map a new block big enough for at least min_size bytes
+ */
+static ArenaBlock *new_block(Arena *arena, size_t min_size) {
+    size_t size = arena->next_block_size;
+    while (size - ARENA_HEADER_SIZE < min_size) {
+        size *= 2;
+    }
+
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+
+    ArenaBlock *block = (ArenaBlock *)memory;
+    block->next = arena->head;
+    block->size = size - ARENA_HEADER_SIZE;
+    block->used = 0;
+    arena->head = block;
+    arena->block_count++;
+
+    if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+        arena->next_block_size *= 2;
+    }
+    return block;
+}
+
+/**
+ * @brief Carve size bytes with the given alignment out of the current block
+ */
+static void *allocate(Arena *arena, size_t size, size_t alignment) {
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    ArenaBlock *block = arena->head;
+    size_t offset = block != NULL ? (block->used + alignment - 1) & ~(alignment - 1) : 0;
+    if (block == NULL || offset > block->size || block->size - offset < size) {
+        block = new_block(arena, size);
+        if (block == NULL) {
+            return NULL;
+        }
+        offset = 0;
+    }
+
+    void *ptr = (char *)block + ARENA_HEADER_SIZE + offset;
+    block->used = offset + size;
+    arena->bytes_allocated += size;
+    return ptr;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    return allocate(arena, size > 0 ? size : 1, ARENA_ALIGNMENT);
+}
+
+char *arena_strdup(Arena *arena, const char *str) {
+    // Strings need no alignment, so names pack back to back
+    size_t length = strlen(str);
+    char *copy = (char *)allocate(arena, length + 1, 1);
+    if (copy != NULL) {
+        memcpy(copy, str, length + 1);
+    }
+    return copy;
+}
+
+void arena_destroy(Arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    ArenaBlock *block = arena->head;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        munmap(block, block->size + ARENA_HEADER_SIZE);
+        block = next;
+    }
+    arena_init(arena);
+}
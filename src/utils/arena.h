@@ -0,0 +1,63 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief One mapping owned by an arena
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;  // Previously filled block
+    size_t size;              // Usable bytes after the header
+    size_t used;              // Bytes handed out so far
+} ArenaBlock;
+
+/**
+ * @brief Region allocator: many small allocations, released all at once
+ *
+ * Memory comes from a few large anonymous mappings whose size doubles as the
+ * arena grows, so a whole listing costs a handful of mmap calls instead of
+ * several malloc/free pairs per entry. Individual allocations are never freed.
+ */
+typedef struct {
+    ArenaBlock *head;          // Block currently being filled
+    size_t next_block_size;    // Size of the next mapping to create
+    size_t block_count;        // Number of mappings created (for benchmarks)
+    size_t bytes_allocated;    // Bytes handed out (for benchmarks)
+} Arena;
+
+/**
+ * @brief Initialize an empty arena (no memory is mapped until first use)
+ *
+ * @param arena Arena to initialize
+ */
+void arena_init(Arena *arena);
+
+/**
+ * @brief Allocate memory from the arena
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @return void* Uninitialized memory aligned to 16 bytes, or NULL on failure
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copy a string into the arena
+ *
+ * @param arena Arena to allocate from
+ * @param str String to copy
+ * @return char* Copy of the string, or NULL on failure
+ */
+char *arena_strdup(Arena *arena, const char *str);
+
+/**
+ * @brief Release every allocation made from the arena
+ *
+ * The arena can be reused afterwards.
+ *
+ * @param arena Arena to release
+ */
+void arena_destroy(Arena *arena);
+
+#endif
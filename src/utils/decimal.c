@@ -0,0 +1,42 @@
+#include "decimal.h"
+#include <string.h>
+
+// "00" "01" ... "99": two digits per table entry
+static const char g_digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int format_decimal(unsigned long long value, char *buffer) {
+    char digits[DECIMAL_BUFFER_SIZE];
+    char *end = digits + sizeof(digits);
+    char *start = end;
+
+    while (value >= 100) {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        start -= 2;
+        start[0] = g_digit_pairs[pair];
+        start[1] = g_digit_pairs[pair + 1];
+    }
+    if (value >= 10) {
+        unsigned int pair = (unsigned int)value * 2;
+        start -= 2;
+        start[0] = g_digit_pairs[pair];
+        start[1] = g_digit_pairs[pair + 1];
+    } else {
+        *--start = (char)('0' + value);
+    }
+
+    int length = (int)(end - start);
+    memcpy(buffer, start, (size_t)length);
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,20 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+/**
+ * @brief Size of a buffer large enough for any value format_decimal() writes
+ */
+#define DECIMAL_BUFFER_SIZE 21
+
+/**
+ * @brief Write an unsigned integer in decimal without going through printf
+ *
+ * Digits are produced two at a time from a lookup table, right to left.
+ *
+ * @param value Value to format
+ * @param buffer Destination (at least DECIMAL_BUFFER_SIZE bytes); NUL-terminated
+ * @return int Number of digits written
+ */
+int format_decimal(unsigned long long value, char *buffer);
+
+#endif
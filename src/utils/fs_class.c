@@ -0,0 +1,51 @@
+#include "fs_class.h"
+#include <stddef.h>
+#include <sys/vfs.h>
+
+/**
+ * @brief Filesystem magic number (statfs f_type) and its class
+ */
+typedef struct {
+    unsigned long magic;
+    FsClass fs_class;
+} FsMagic;
+
+// Magic numbers from <linux/magic.h>, listed here so older headers are enough
+static const FsMagic FS_MAGICS[] = {
+    {0x01021994UL, FS_CLASS_MEMORY},   // tmpfs
+    {0x858458f6UL, FS_CLASS_MEMORY},   // ramfs
+    {0x00009fa0UL, FS_CLASS_MEMORY},   // proc
+    {0x62656572UL, FS_CLASS_MEMORY},   // sysfs
+    {0x64626720UL, FS_CLASS_MEMORY},   // debugfs
+    {0x00001cd1UL, FS_CLASS_MEMORY},   // devpts
+    {0x0027e0ebUL, FS_CLASS_MEMORY},   // cgroup
+    {0x63677270UL, FS_CLASS_MEMORY},   // cgroup2
+    {0x00006969UL, FS_CLASS_NETWORK},  // NFS
+    {0x0000517bUL, FS_CLASS_NETWORK},  // SMB
+    {0xff534d42UL, FS_CLASS_NETWORK},  // CIFS
+    {0xfe534d42UL, FS_CLASS_NETWORK},  // SMB2
+    {0x00c36400UL, FS_CLASS_NETWORK},  // Ceph
+    {0x5346414fUL, FS_CLASS_NETWORK},  // AFS
+    {0x6b414653UL, FS_CLASS_NETWORK},  // kAFS
+    {0x73757245UL, FS_CLASS_NETWORK},  // Coda
+    {0x01021997UL, FS_CLASS_NETWORK},  // 9p
+    {0x0bd00bd0UL, FS_CLASS_NETWORK},  // Lustre
+    {0x65735546UL, FS_CLASS_FUSE},     // FUSE
+};
+
+FsClass fs_class_of(int fd) {
+    struct statfs fs_info;
+    if (fstatfs(fd, &fs_info) != 0) {
+        return FS_CLASS_LOCAL;
+    }
+
+    // f_type is signed on some architectures; compare the low 32 bits
+    unsigned long magic = (unsigned long)fs_info.f_type & 0xffffffffUL;
+    for (size_t i = 0; i < sizeof(FS_MAGICS) / sizeof(FS_MAGICS[0]); i++) {
+        if (FS_MAGICS[i].magic == magic) {
+            return FS_MAGICS[i].fs_class;
+        }
+    }
+    return FS_CLASS_LOCAL;
+}
+
@@ -0,0 +1,22 @@
+#ifndef FS_CLASS_H
+#define FS_CLASS_H
+
+/**
+ * @brief Broad kind of filesystem, as far as metadata latency is concerned
+ */
+typedef enum {
+    FS_CLASS_LOCAL,    // Block-device filesystem (ext4, XFS, btrfs...), or unknown
+    FS_CLASS_MEMORY,   // Served from memory (tmpfs, ramfs, proc, sysfs...)
+    FS_CLASS_NETWORK,  // Remote (NFS, SMB/CIFS, Ceph, AFS, 9p...)
+    FS_CLASS_FUSE      // Userspace filesystem; latency depends on the daemon
+} FsClass;
+
+/**
+ * @brief Classify the filesystem an open file or directory lives on
+ *
+ * @param fd Open descriptor
+ * @return FsClass Class from the fstatfs() magic number (FS_CLASS_LOCAL if unknown)
+ */
+FsClass fs_class_of(int fd);
+
+#endif
@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 200809L
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Slots allocated when the first string is interned
+#define INTERN_INITIAL_CAPACITY 64
+
+/**
+ * @brief FNV-1a hash of a string, never 0
+ */
+static uint64_t hash_text(const char *text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Resize the table to capacity slots and reinsert every string
+ *
+ * @return int 0 on success, -1 if memory ran out
+ */
+static int resize_table(StringIntern *intern, size_t capacity) {
+    InternSlot *slots = (InternSlot *)calloc(capacity, sizeof(InternSlot));
+    if (slots == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < intern->capacity; i++) {
+        if (intern->slots[i].hash == 0) {
+            continue;
+        }
+        size_t slot = intern->slots[i].hash & (capacity - 1);
+        while (slots[slot].hash != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = intern->slots[i];
+    }
+
+    free(intern->slots);
+    intern->slots = slots;
+    intern->capacity = capacity;
+    return 0;
+}
+
+void string_intern_init(StringIntern *intern, Arena *arena) {
+    memset(intern, 0, sizeof(StringIntern));
+    intern->arena = arena;
+}
+
+const char *string_intern(StringIntern *intern, const char *text) {
+    // Keep the load factor under 3/4 so probe sequences stay short
+    if ((intern->used + 1) * 4 > intern->capacity * 3 &&
+        resize_table(intern, intern->capacity > 0 ? intern->capacity * 2
+                                                  : INTERN_INITIAL_CAPACITY) != 0) {
+        return NULL;
+    }
+
+    uint64_t hash = hash_text(text);
+    size_t slot = hash & (intern->capacity - 1);
+    while (intern->slots[slot].hash != 0) {
+        if (intern->slots[slot].hash == hash && strcmp(intern->slots[slot].text, text) == 0) {
+            return intern->slots[slot].text;
+        }
+        slot = (slot + 1) & (intern->capacity - 1);
+    }
+
+    char *copy = intern->arena != NULL ? arena_strdup(intern->arena, text) : strdup(text);
+    if (copy == NULL) {
+        return NULL;
+    }
+    intern->slots[slot].hash = hash;
+    intern->slots[slot].text = copy;
+    intern->used++;
+    return copy;
+}
+
+void string_intern_free(StringIntern *intern) {
+    if (intern->arena == NULL) {
+        for (size_t i = 0; i < intern->capacity; i++) {
+            if (intern->slots[i].hash != 0) {
+                free((char *)intern->slots[i].text);
+            }
+        }
+    }
+    free(intern->slots);
+    intern->slots = NULL;
+    intern->capacity = 0;
+    intern->used = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/arena.h"
+
+/**
+ * @brief One string in the table (hash 0 marks an empty slot)
+ */
+typedef struct {
+    uint64_t hash;
+    const char *text;
+} InternSlot;
+
+/**
+ * @brief Set of distinct strings, so a value repeated across a listing is stored once
+ *
+ * Meant for values most entries share, such as security contexts: the
+ * listing keeps one copy of each and every entry points at it. Not thread
+ * safe; one thread interns.
+ */
+typedef struct {
+    Arena *arena;              // Holds the strings, or NULL for heap copies
+    InternSlot *slots;         // Open addressing, capacity a power of two
+    size_t capacity;
+    size_t used;
+} StringIntern;
+
+/**
+ * @brief Set up an empty table
+ *
+ * @param intern Table to initialize
+ * @param arena Arena the strings are copied into (they outlive the table), or
+ *        NULL to copy them onto the heap (freed by string_intern_free())
+ */
+void string_intern_init(StringIntern *intern, Arena *arena);
+
+/**
+ * @brief The table's copy of a string, added if it is new
+ *
+ * @param intern Table
+ * @param text String to look up
+ * @return const char* Shared copy, or NULL if memory ran out
+ */
+const char *string_intern(StringIntern *intern, const char *text);
+
+/**
+ * @brief Free the table (and the strings, unless they live in an arena)
+ *
+ * @param intern Table
+ */
+void string_intern_free(StringIntern *intern);
+
+#endif
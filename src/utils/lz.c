@@ -0,0 +1,187 @@
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+// Shortest match worth a sequence, and the hash table over 4-byte prefixes
+#define MIN_MATCH 4
+#define HASH_BITS 12
+#define LENGTH_CODE_MAX 15
+
+static uint32_t read32(const unsigned char *bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 |
+           (uint32_t)bytes[3] << 24;
+}
+
+static uint32_t hash4(uint32_t value) {
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Bounded output of the compressor
+ */
+typedef struct {
+    unsigned char *data;
+    size_t used;
+    size_t capacity;
+    int overflow;   // Set once anything did not fit
+} LzOutput;
+
+static void put_bytes(LzOutput *output, const unsigned char *bytes, size_t length) {
+    if (length > output->capacity - output->used) {
+        output->overflow = 1;
+        return;
+    }
+    memcpy(output->data + output->used, bytes, length);
+    output->used += length;
+}
+
+static void put_byte(LzOutput *output, unsigned char byte) {
+    put_bytes(output, &byte, 1);
+}
+
+/**
+ * @brief Write the part of a length beyond its 4-bit code as 255-steps
+ */
+static void put_length(LzOutput *output, size_t extra) {
+    while (extra >= 255) {
+        put_byte(output, 255);
+        extra -= 255;
+    }
+    put_byte(output, (unsigned char)extra);
+}
+
+/**
+ * @brief Write literals followed by a match (match_length 0: final literals only)
+ */
+static void put_sequence(LzOutput *output, const unsigned char *literals, size_t literal_length,
+                         size_t offset, size_t match_length) {
+    size_t literal_code = literal_length < LENGTH_CODE_MAX ? literal_length : LENGTH_CODE_MAX;
+    size_t match_code = 0;
+    if (match_length > 0) {
+        match_code = match_length - MIN_MATCH < LENGTH_CODE_MAX ? match_length - MIN_MATCH
+                                                                : LENGTH_CODE_MAX;
+    }
+
+    put_byte(output, (unsigned char)(literal_code << 4 | match_code));
+    if (literal_code == LENGTH_CODE_MAX) {
+        put_length(output, literal_length - LENGTH_CODE_MAX);
+    }
+    put_bytes(output, literals, literal_length);
+    if (match_length == 0) {
+        return;
+    }
+
+    put_byte(output, (unsigned char)(offset & 0xFF));
+    put_byte(output, (unsigned char)(offset >> 8));
+    if (match_code == LENGTH_CODE_MAX) {
+        put_length(output, match_length - MIN_MATCH - LENGTH_CODE_MAX);
+    }
+}
+
+size_t lz_compress(const unsigned char *source, size_t length, unsigned char *output,
+                   size_t capacity) {
+    if (length > LZ_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+
+    // Last position (plus one) each 4-byte prefix was seen at; 0 = never
+    uint32_t table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    LzOutput out = {output, 0, capacity, 0};
+    size_t anchor = 0;  // Start of the pending literals
+    size_t position = 0;
+    while (position + MIN_MATCH <= length && !out.overflow) {
+        uint32_t prefix = read32(source + position);
+        uint32_t slot = hash4(prefix);
+        size_t candidate = table[slot];
+        table[slot] = (uint32_t)position + 1;
+
+        if (candidate == 0 || read32(source + candidate - 1) != prefix) {
+            position++;
+            continue;
+        }
+        candidate--;
+
+        // Extend the match as far as it goes
+        size_t match_length = MIN_MATCH;
+        while (position + match_length < length &&
+               source[candidate + match_length] == source[position + match_length]) {
+            match_length++;
+        }
+
+        put_sequence(&out, source + anchor, position - anchor, position - candidate,
+                     match_length);
+        position += match_length;
+        anchor = position;
+    }
+
+    put_sequence(&out, source + anchor, length - anchor, 0, 0);
+    return out.overflow ? 0 : out.used;
+}
+
+/**
+ * @brief Read the part of a length beyond its 4-bit code
+ *
+ * @return int 0 on success, -1 if the input ends first
+ */
+static int read_length(const unsigned char **input, const unsigned char *end, size_t *length) {
+    unsigned char byte;
+    do {
+        if (*input == end) {
+            return -1;
+        }
+        byte = *(*input)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int lz_decompress(const unsigned char *source, size_t length, unsigned char *output,
+                  size_t raw_length) {
+    const unsigned char *input = source;
+    const unsigned char *end = source + length;
+    size_t produced = 0;
+
+    while (input < end) {
+        unsigned char token = *input++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == LENGTH_CODE_MAX && read_length(&input, end, &literal_length) != 0) {
+            return -1;
+        }
+        if (literal_length > (size_t)(end - input) || literal_length > raw_length - produced) {
+            return -1;
+        }
+        memcpy(output + produced, input, literal_length);
+        input += literal_length;
+        produced += literal_length;
+
+        // The final sequence has literals only
+        if (input == end) {
+            break;
+        }
+
+        if (end - input < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)input[0] | (size_t)input[1] << 8;
+        input += 2;
+        size_t match_length = (size_t)(token & 0x0F) + MIN_MATCH;
+        if ((token & 0x0F) == LENGTH_CODE_MAX && read_length(&input, end, &match_length) != 0) {
+            return -1;
+        }
+        if (offset == 0 || offset > produced || match_length > raw_length - produced) {
+            return -1;
+        }
+
+        // Byte by byte: the match may overlap the bytes it produces
+        const unsigned char *match = output + produced - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            output[produced + i] = match[i];
+        }
+        produced += match_length;
+    }
+
+    return produced == raw_length ? 0 : -1;
+}
@@ -0,0 +1,38 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+
+// Largest block lz_compress() accepts (match offsets are 16 bits)
+#define LZ_MAX_BLOCK_SIZE (64 * 1024)
+
+/**
+ * @brief Compress one block with a small LZ77 coder
+ *
+ * The output is a sequence of (literals, match) pairs in the LZ4 block
+ * layout: a token byte with the literal and match lengths, the literals, and
+ * a two-byte offset back to the match. It is fast and suits the repetitive
+ * text of listings; it is not compatible with any file format.
+ *
+ * @param source Bytes to compress
+ * @param length Number of bytes (at most LZ_MAX_BLOCK_SIZE)
+ * @param output Destination
+ * @param capacity Size of the destination
+ * @return size_t Compressed size, or 0 if it would not fit in capacity
+ */
+size_t lz_compress(const unsigned char *source, size_t length, unsigned char *output,
+                   size_t capacity);
+
+/**
+ * @brief Decompress a block produced by lz_compress()
+ *
+ * @param source Compressed bytes
+ * @param length Number of compressed bytes
+ * @param output Destination
+ * @param raw_length Exact size of the decompressed block
+ * @return int 0 on success, -1 if the block is corrupt
+ */
+int lz_decompress(const unsigned char *source, size_t length, unsigned char *output,
+                  size_t raw_length);
+
+#endif
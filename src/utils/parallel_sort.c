@@ -0,0 +1,239 @@
+#define _POSIX_C_SOURCE 200809L
+#include "parallel_sort.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief One piece of a merge round: output positions [begin, end) of merging a and b
+ */
+typedef struct {
+    const char *a;
+    int a_length;
+    const char *b;
+    int b_length;
+    char *out;                 // Output of the whole pair
+    int begin;
+    int end;
+} MergeJob;
+
+/**
+ * @brief One chunk to sort with qsort()
+ */
+typedef struct {
+    char *base;
+    int count;
+} SortJob;
+
+/**
+ * @brief Jobs shared by a pool of threads; each thread claims the next one until none are left
+ */
+typedef struct {
+    void *jobs;
+    int job_count;
+    int next;                  // Next job to claim (atomic)
+    size_t size;
+    SortCompare compare;
+    void (*run)(const void *pool, int index);
+} JobPool;
+
+/**
+ * @brief Threads worth using for this many elements
+ */
+static int sort_workers(int count) {
+    if (count < PARALLEL_SORT_THRESHOLD) {
+        return 1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cpus > 0 ? (int)cpus : 1;
+    if (workers > PARALLEL_SORT_MAX_WORKERS) {
+        workers = PARALLEL_SORT_MAX_WORKERS;
+    }
+    if (workers > count / PARALLEL_SORT_MIN_CHUNK) {
+        workers = count / PARALLEL_SORT_MIN_CHUNK;
+    }
+    return workers > 1 ? workers : 1;
+}
+
+static void *pool_worker(void *arg) {
+    JobPool *pool = (JobPool *)arg;
+    for (;;) {
+        int claimed = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (claimed >= pool->job_count) {
+            break;
+        }
+        pool->run(pool, claimed);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run the jobs on up to workers threads, the calling thread included
+ */
+static void run_jobs(JobPool *pool, int workers) {
+    if (workers > pool->job_count) {
+        workers = pool->job_count;
+    }
+
+    pthread_t threads[PARALLEL_SORT_MAX_WORKERS];
+    int started = 0;
+    while (started < workers - 1 &&
+           pthread_create(&threads[started], NULL, pool_worker, pool) == 0) {
+        started++;
+    }
+
+    // The calling thread always takes part, so the jobs get done even without threads
+    pool_worker(pool);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static void run_sort_job(const void *arg, int index) {
+    const JobPool *pool = (const JobPool *)arg;
+    const SortJob *job = &((const SortJob *)pool->jobs)[index];
+    qsort(job->base, job->count, pool->size, pool->compare);
+}
+
+/**
+ * @brief Elements of a among the first diagonal outputs of merging a and b
+ *
+ * The merge takes b[j] before a[i] only if b[j] < a[i], so the split is the
+ * smallest i for which a[i] sorts after b[diagonal - i - 1].
+ */
+static int merge_path(const char *a, int a_length, const char *b, int b_length, int diagonal,
+                      size_t size, SortCompare compare) {
+    int low = diagonal > b_length ? diagonal - b_length : 0;
+    int high = diagonal < a_length ? diagonal : a_length;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (compare(a + (size_t)middle * size, b + (size_t)(diagonal - middle - 1) * size) > 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+static void run_merge_job(const void *arg, int index) {
+    const JobPool *pool = (const JobPool *)arg;
+    const MergeJob *job = &((const MergeJob *)pool->jobs)[index];
+    size_t size = pool->size;
+
+    int i = merge_path(job->a, job->a_length, job->b, job->b_length, job->begin, size,
+                       pool->compare);
+    int j = job->begin - i;
+    int i_end = merge_path(job->a, job->a_length, job->b, job->b_length, job->end, size,
+                           pool->compare);
+    int j_end = job->end - i_end;
+
+    char *out = job->out + (size_t)job->begin * size;
+    while (i < i_end && j < j_end) {
+        // Ties keep the earlier run first
+        const char *b_next = job->b + (size_t)j * size;
+        const char *a_next = job->a + (size_t)i * size;
+        if (pool->compare(b_next, a_next) < 0) {
+            memcpy(out, b_next, size);
+            j++;
+        } else {
+            memcpy(out, a_next, size);
+            i++;
+        }
+        out += size;
+    }
+    memcpy(out, job->a + (size_t)i * size, (size_t)(i_end - i) * size);
+    out += (size_t)(i_end - i) * size;
+    memcpy(out, job->b + (size_t)j * size, (size_t)(j_end - j) * size);
+}
+
+void *parallel_merge_runs(void *base, void *scratch, int count, size_t size, int *starts,
+                          int run_count, SortCompare compare) {
+    char *records = (char *)base;
+    char *target = (char *)scratch;
+    int workers = sort_workers(count);
+
+    // Every pair is cut into pieces of about this many outputs
+    int piece = count / workers + 1;
+    MergeJob *jobs = (MergeJob *)malloc(((size_t)run_count / 2 + 1 + (size_t)workers) *
+                                        sizeof(MergeJob));
+    if (jobs == NULL) {
+        // One piece per pair, merged here
+        piece = count + 1;
+        workers = 1;
+    }
+
+    MergeJob single;
+    while (run_count > 1) {
+        int merged = 0;
+        int job_count = 0;
+        for (int r = 0; r < run_count; r += 2) {
+            // An odd run out is copied as is (middle is then the end marker)
+            int left = starts[r];
+            int middle = starts[r + 1];
+            int right = r + 1 < run_count ? starts[r + 2] : middle;
+
+            for (int begin = 0; begin < right - left || begin == 0; begin += piece) {
+                MergeJob *job = jobs != NULL ? &jobs[job_count++] : &single;
+                job->a = records + (size_t)left * size;
+                job->a_length = middle - left;
+                job->b = records + (size_t)middle * size;
+                job->b_length = right - middle;
+                job->out = target + (size_t)left * size;
+                job->begin = begin;
+                job->end = right - left - begin > piece ? begin + piece : right - left;
+
+                if (jobs == NULL) {
+                    JobPool pool = {&single, 1, 0, size, compare, run_merge_job};
+                    run_merge_job(&pool, 0);
+                }
+            }
+            starts[merged++] = left;
+        }
+        starts[merged] = starts[run_count];
+        run_count = merged;
+
+        if (jobs != NULL) {
+            JobPool pool = {jobs, job_count, 0, size, compare, run_merge_job};
+            run_jobs(&pool, workers);
+        }
+
+        char *swap = records;
+        records = target;
+        target = swap;
+    }
+
+    free(jobs);
+    return records;
+}
+
+void parallel_sort(void *base, int count, size_t size, SortCompare compare) {
+    int workers = sort_workers(count);
+    void *scratch = workers > 1 ? malloc((size_t)count * size) : NULL;
+    if (scratch == NULL) {
+        qsort(base, count, size, compare);
+        return;
+    }
+
+    // One chunk per thread, sorted concurrently
+    SortJob jobs[PARALLEL_SORT_MAX_WORKERS];
+    int starts[PARALLEL_SORT_MAX_WORKERS + 1];
+    for (int w = 0; w < workers; w++) {
+        starts[w] = (int)((long long)count * w / workers);
+        jobs[w].base = (char *)base + (size_t)starts[w] * size;
+        jobs[w].count = (int)((long long)count * (w + 1) / workers) - starts[w];
+    }
+    starts[workers] = count;
+
+    JobPool pool = {jobs, workers, 0, size, compare, run_sort_job};
+    run_jobs(&pool, workers);
+
+    // Then merged pairwise, every round on all threads
+    void *sorted = parallel_merge_runs(base, scratch, count, size, starts, workers, compare);
+    if (sorted != base) {
+        memcpy(base, sorted, (size_t)count * size);
+    }
+    free(scratch);
+}
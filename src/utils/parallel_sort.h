@@ -0,0 +1,57 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <stddef.h>
+
+// Arrays shorter than this are sorted with qsort() on the calling thread
+#define PARALLEL_SORT_THRESHOLD (64 * 1024)
+
+// Fewest elements worth a thread of their own, and the most threads used
+#define PARALLEL_SORT_MIN_CHUNK (32 * 1024)
+#define PARALLEL_SORT_MAX_WORKERS 64
+
+/**
+ * @brief qsort()-style comparator
+ *
+ * It is called from several threads at once, so any state it reads (sort
+ * mode globals and the like) must be set before the sort and not change.
+ */
+typedef int (*SortCompare)(const void *a, const void *b);
+
+/**
+ * @brief Sort an array on all CPUs, or with qsort() when it is small
+ *
+ * The array is cut into one chunk per thread, the chunks are sorted with
+ * qsort() concurrently, and the sorted chunks are merged pairwise by
+ * parallel_merge_runs(). Needs a scratch copy of the array; if that cannot
+ * be allocated the array is sorted with qsort() instead.
+ *
+ * @param base Array to sort in place
+ * @param count Number of elements
+ * @param size Size of an element
+ * @param compare Comparator; must be a total order for the result to match qsort()'s
+ */
+void parallel_sort(void *base, int count, size_t size, SortCompare compare);
+
+/**
+ * @brief Merge adjacent sorted runs pairwise until one run is left
+ *
+ * Each round splits every pair into segments of equal output length at
+ * merge-path boundaries (found by a binary search along the diagonal), so
+ * all threads get the same amount of work however uneven the runs are, and
+ * merge the segments concurrently. Ties keep the earlier run first. Small
+ * inputs are merged on the calling thread.
+ *
+ * @param base Elements holding the runs
+ * @param scratch Buffer of the same size
+ * @param count Number of elements
+ * @param size Size of an element
+ * @param starts Start index of each run followed by count; updated in place
+ * @param run_count Number of runs
+ * @param compare Comparator
+ * @return void* Whichever of base and scratch holds the merged result
+ */
+void *parallel_merge_runs(void *base, void *scratch, int count, size_t size, int *starts,
+                          int run_count, SortCompare compare);
+
+#endif
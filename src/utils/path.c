@@ -2,32 +2,41 @@
 #include <stdlib.h>
 #include <string.h>
 
+int join_path(char *buffer, size_t buffer_size, const char *base_path, const char *filename) {
+    if (buffer == NULL || base_path == NULL || filename == NULL) {
+        return -1;
+    }
+
+    size_t base_len = strlen(base_path);
+    size_t file_len = strlen(filename);
+
+    // Add '/' separator if base_path doesn't end with one
+    size_t separator = (base_len > 0 && base_path[base_len - 1] != '/') ? 1 : 0;
+    if (base_len + separator + file_len + 1 > buffer_size) {
+        return -1;
+    }
+
+    memcpy(buffer, base_path, base_len);
+    if (separator) {
+        buffer[base_len] = '/';
+    }
+    memcpy(buffer + base_len + separator, filename, file_len + 1);
+    return 0;
+}
+
 char *construct_full_path(const char *base_path, const char *filename) {
     if (base_path == NULL || filename == NULL) {
         return NULL;
     }
 
-    size_t base_len = strlen(base_path);
-    size_t file_len = strlen(filename);
     // +2 for '/' separator and null terminator
-    size_t total_len = base_len + file_len + 2;
+    size_t total_len = strlen(base_path) + strlen(filename) + 2;
 
     char *full_path = (char *)malloc(total_len * sizeof(char));
     if (full_path == NULL) {
         return NULL;
     }
 
-    strcpy(full_path, base_path);
-
-    // Add '/' separator if base_path doesn't end with one
-    if (base_len > 0 && base_path[base_len - 1] != '/') {
-        full_path[base_len] = '/';
-        full_path[base_len + 1] = '\0';
-        strcat(full_path, filename);
-    } else {
-        strcat(full_path, filename);
-    }
-
+    join_path(full_path, total_len, base_path, filename);
     return full_path;
 }
-
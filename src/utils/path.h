@@ -1,6 +1,24 @@
 #ifndef PATH_H
 #define PATH_H
 
+#include <stddef.h>
+
+/**
+ * @brief Size of a stack buffer large enough for any path join_path() accepts
+ */
+#define PATH_BUFFER_SIZE 4096
+
+/**
+ * @brief Join base directory and filename into a caller-provided buffer
+ *
+ * @param buffer Destination buffer
+ * @param buffer_size Size of the destination buffer
+ * @param base_path Base directory path
+ * @param filename Filename
+ * @return int 0 on success, -1 if an argument is NULL or the path does not fit
+ */
+int join_path(char *buffer, size_t buffer_size, const char *base_path, const char *filename);
+
 /**
  * @brief Construct full path from base directory and filename
  *
@@ -11,4 +29,3 @@
 char *construct_full_path(const char *base_path, const char *filename);
 
 #endif
-
@@ -0,0 +1,44 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of a SHA-256 digest in bytes
+#define SHA256_DIGEST_SIZE 32
+
+/**
+ * @brief Incremental SHA-256 state (FIPS 180-4)
+ */
+typedef struct {
+    uint32_t state[8];       // Intermediate hash value
+    uint64_t length;         // Bytes hashed so far
+    uint8_t block[64];       // Pending partial block
+    size_t block_used;       // Bytes in block
+} Sha256;
+
+/**
+ * @brief Start a new hash
+ *
+ * @param sha Hash state
+ */
+void sha256_init(Sha256 *sha);
+
+/**
+ * @brief Add bytes to the hash
+ *
+ * @param sha Hash state
+ * @param data Bytes to add
+ * @param size Number of bytes
+ */
+void sha256_update(Sha256 *sha, const void *data, size_t size);
+
+/**
+ * @brief Finish the hash
+ *
+ * @param sha Hash state (not reusable afterwards without sha256_init)
+ * @param digest Receives SHA256_DIGEST_SIZE bytes
+ */
+void sha256_final(Sha256 *sha, uint8_t *digest);
+
+#endif
@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L
+#include "spill.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int spill_create(void) {
+    const char *tmp_dir = getenv("TMPDIR");
+    if (tmp_dir == NULL || tmp_dir[0] == '\0') {
+        tmp_dir = "/tmp";
+    }
+
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/lister-spill-XXXXXX", tmp_dir) >= (int)sizeof(path)) {
+        return -1;
+    }
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Nobody else needs the name; the space is reclaimed when fd is closed
+    unlink(path);
+    return fd;
+}
+
+int spill_writer_init(SpillWriter *writer, int fd, size_t capacity) {
+    writer->fd = fd;
+    writer->offset = lseek(fd, 0, SEEK_END);
+    writer->length = 0;
+    writer->capacity = capacity > 0 ? capacity : SPILL_BUFFER_SIZE;
+    writer->buffer = (unsigned char *)malloc(writer->capacity);
+    if (writer->offset < 0 || writer->buffer == NULL) {
+        free(writer->buffer);
+        writer->buffer = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int spill_writer_flush(SpillWriter *writer) {
+    size_t written = 0;
+    while (written < writer->length) {
+        ssize_t result = pwrite(writer->fd, writer->buffer + written, writer->length - written,
+                                writer->offset);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        written += (size_t)result;
+        writer->offset += result;
+    }
+    writer->length = 0;
+    return 0;
+}
+
+int spill_write(SpillWriter *writer, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    while (size > 0) {
+        if (writer->length == writer->capacity && spill_writer_flush(writer) != 0) {
+            return -1;
+        }
+
+        size_t chunk = writer->capacity - writer->length;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(writer->buffer + writer->length, bytes, chunk);
+        writer->length += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+int spill_writer_close(SpillWriter *writer) {
+    int status = writer->buffer != NULL ? spill_writer_flush(writer) : 0;
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return status;
+}
+
+int spill_reader_init(SpillReader *reader, int fd, off_t offset, size_t capacity) {
+    reader->fd = fd;
+    reader->offset = offset;
+    reader->length = 0;
+    reader->position = 0;
+    reader->error = 0;
+    reader->capacity = capacity > 0 ? capacity : SPILL_BUFFER_SIZE;
+    reader->buffer = (unsigned char *)malloc(reader->capacity);
+    return reader->buffer != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Refill the buffer from the file
+ *
+ * @return size_t Number of bytes now available, 0 at end of file or on error
+ */
+static size_t refill(SpillReader *reader) {
+    ssize_t result;
+    do {
+        result = pread(reader->fd, reader->buffer, reader->capacity, reader->offset);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        reader->error = 1;
+        result = 0;
+    }
+    reader->offset += result;
+    reader->length = (size_t)result;
+    reader->position = 0;
+    return reader->length;
+}
+
+size_t spill_read(SpillReader *reader, void *data, size_t size) {
+    unsigned char *bytes = (unsigned char *)data;
+    size_t copied = 0;
+    while (copied < size) {
+        if (reader->position == reader->length && refill(reader) == 0) {
+            break;
+        }
+
+        size_t chunk = reader->length - reader->position;
+        if (chunk > size - copied) {
+            chunk = size - copied;
+        }
+        memcpy(bytes + copied, reader->buffer + reader->position, chunk);
+        reader->position += chunk;
+        copied += chunk;
+    }
+    return copied;
+}
+
+off_t spill_reader_tell(const SpillReader *reader) {
+    return reader->offset - (off_t)(reader->length - reader->position);
+}
+
+void spill_reader_close(SpillReader *reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
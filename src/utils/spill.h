@@ -0,0 +1,118 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Default buffer size for spill writers and readers
+#define SPILL_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Buffered appender for a spill file
+ */
+typedef struct {
+    int fd;                  // Spill file
+    off_t offset;            // File offset the buffer will be written at
+    unsigned char *buffer;   // Pending bytes
+    size_t length;           // Number of pending bytes
+    size_t capacity;         // Buffer size
+} SpillWriter;
+
+/**
+ * @brief Buffered reader over a spill file
+ *
+ * Readers use pread() and keep their own offset, so any number of them can
+ * read the same file at different positions.
+ */
+typedef struct {
+    int fd;                  // Spill file
+    off_t offset;            // File offset of buffer[length]
+    unsigned char *buffer;   // Bytes read ahead
+    size_t length;           // Number of valid bytes in the buffer
+    size_t position;         // Next byte to hand out
+    size_t capacity;         // Buffer size
+    int error;               // Non-zero after a failed read
+} SpillReader;
+
+/**
+ * @brief Create an anonymous temporary file in $TMPDIR (or /tmp)
+ *
+ * The file is unlinked immediately and disappears when the descriptor is closed.
+ *
+ * @return int File descriptor, or -1 on error
+ */
+int spill_create(void);
+
+/**
+ * @brief Prepare a writer appending at the current end of a spill file
+ *
+ * @param writer Writer to initialize
+ * @param fd Spill file
+ * @param capacity Buffer size in bytes
+ * @return int 0 on success, -1 on allocation failure
+ */
+int spill_writer_init(SpillWriter *writer, int fd, size_t capacity);
+
+/**
+ * @brief Append bytes to a spill file
+ *
+ * @param writer Writer
+ * @param data Bytes to append
+ * @param size Number of bytes
+ * @return int 0 on success, -1 on write error
+ */
+int spill_write(SpillWriter *writer, const void *data, size_t size);
+
+/**
+ * @brief Write out pending bytes
+ *
+ * @param writer Writer
+ * @return int 0 on success, -1 on write error
+ */
+int spill_writer_flush(SpillWriter *writer);
+
+/**
+ * @brief Flush and release a writer (the file stays open)
+ *
+ * @param writer Writer
+ * @return int 0 on success, -1 if the final flush failed
+ */
+int spill_writer_close(SpillWriter *writer);
+
+/**
+ * @brief Prepare a reader starting at a given offset
+ *
+ * @param reader Reader to initialize
+ * @param fd Spill file
+ * @param offset Offset of the first byte to read
+ * @param capacity Buffer size in bytes
+ * @return int 0 on success, -1 on allocation failure
+ */
+int spill_reader_init(SpillReader *reader, int fd, off_t offset, size_t capacity);
+
+/**
+ * @brief Read bytes from a spill file
+ *
+ * @param reader Reader
+ * @param data Destination buffer
+ * @param size Number of bytes wanted
+ * @return size_t Number of bytes read; less than size at end of file or on error
+ */
+size_t spill_read(SpillReader *reader, void *data, size_t size);
+
+/**
+ * @brief Offset of the next byte spill_read() will return
+ *
+ * @param reader Reader
+ * @return off_t File offset
+ */
+off_t spill_reader_tell(const SpillReader *reader);
+
+/**
+ * @brief Release a reader's buffer (the file stays open)
+ *
+ * @param reader Reader
+ */
+void spill_reader_close(SpillReader *reader);
+
+#endif
@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#include "spsc_ring.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Waiting strategy: spin, then yield the CPU, then sleep
+#define SPIN_LIMIT 64
+#define YIELD_LIMIT 128
+#define SLEEP_NANOSECONDS 50000
+
+int spsc_ring_init(SpscRing *ring, size_t capacity) {
+    size_t slots = 2;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    ring->slots = (void **)malloc(slots * sizeof(void *));
+    ring->mask = slots - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->closed = 0;
+    return ring->slots != NULL ? 0 : -1;
+}
+
+void spsc_backoff(unsigned *attempts) {
+    unsigned attempt = (*attempts)++;
+    if (attempt < SPIN_LIMIT) {
+        return;
+    }
+    if (attempt < YIELD_LIMIT) {
+        sched_yield();
+        return;
+    }
+
+    struct timespec pause = {0, SLEEP_NANOSECONDS};
+    nanosleep(&pause, NULL);
+}
+
+int spsc_ring_try_push(SpscRing *ring, void *item) {
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (tail - head > ring->mask) {
+        return 0;
+    }
+
+    ring->slots[tail & ring->mask] = item;
+    // Publish the slot before the new tail
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void spsc_ring_push(SpscRing *ring, void *item) {
+    unsigned attempts = 0;
+    while (!spsc_ring_try_push(ring, item)) {
+        spsc_backoff(&attempts);
+    }
+}
+
+void *spsc_ring_try_pop(SpscRing *ring) {
+    size_t head = ring->head;
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return NULL;
+    }
+
+    void *item = ring->slots[head & ring->mask];
+    // Hand the slot back to the producer only after it has been read
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+void *spsc_ring_pop(SpscRing *ring) {
+    void *item;
+    spsc_ring_pop_until(ring, NULL, &item);
+    return item;
+}
+
+int spsc_ring_pop_until(SpscRing *ring, const struct timespec *deadline, void **item) {
+    unsigned attempts = 0;
+    for (;;) {
+        *item = spsc_ring_try_pop(ring);
+        if (*item != NULL) {
+            return 1;
+        }
+
+        // Items pushed before the close are visible once the close is
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+            *item = spsc_ring_try_pop(ring);
+            return *item != NULL ? 1 : 0;
+        }
+        if (spsc_deadline_passed(deadline)) {
+            return -1;
+        }
+        spsc_backoff(&attempts);
+    }
+}
+
+int spsc_deadline_passed(const struct timespec *deadline) {
+    if (deadline == NULL) {
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+void spsc_ring_close(SpscRing *ring) {
+    __atomic_store_n(&ring->closed, 1, __ATOMIC_RELEASE);
+}
+
+void spsc_ring_destroy(SpscRing *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
@@ -0,0 +1,114 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Assumed cache line size; the producer and consumer indices live on separate lines
+#define SPSC_CACHE_LINE 64
+
+/**
+ * @brief Bounded single-producer, single-consumer queue of pointers
+ *
+ * Exactly one thread pushes and exactly one thread pops. Neither side takes a
+ * lock: each index is written by one side only and published with
+ * release/acquire ordering. A side that finds the ring full (or empty) spins
+ * briefly, then yields, then sleeps, so a stalled stage does not burn the CPU
+ * the other stages need.
+ */
+typedef struct {
+    void **slots;                              // Capacity slots (a power of two)
+    size_t mask;                               // Capacity - 1
+    char pad_head[SPSC_CACHE_LINE];
+    size_t head;                               // Next slot to pop; written by the consumer
+    char pad_tail[SPSC_CACHE_LINE];
+    size_t tail;                               // Next slot to push; written by the producer
+    int closed;                                // Set by the producer after its last push
+    char pad_end[SPSC_CACHE_LINE];
+} SpscRing;
+
+/**
+ * @brief Prepare an empty ring
+ *
+ * @param ring Ring to initialize
+ * @param capacity Number of slots, rounded up to a power of two
+ * @return int 0 on success, -1 on allocation failure
+ */
+int spsc_ring_init(SpscRing *ring, size_t capacity);
+
+/**
+ * @brief Push an item if there is room (producer only)
+ *
+ * @param ring Ring
+ * @param item Item to push
+ * @return int 1 if pushed, 0 if the ring is full
+ */
+int spsc_ring_try_push(SpscRing *ring, void *item);
+
+/**
+ * @brief Push an item, waiting for room (producer only)
+ *
+ * @param ring Ring
+ * @param item Item to push
+ */
+void spsc_ring_push(SpscRing *ring, void *item);
+
+/**
+ * @brief Pop an item if one is queued (consumer only)
+ *
+ * @param ring Ring
+ * @return void* The item, or NULL if the ring is empty
+ */
+void *spsc_ring_try_pop(SpscRing *ring);
+
+/**
+ * @brief Pop an item, waiting until one arrives or the ring is closed (consumer only)
+ *
+ * @param ring Ring
+ * @return void* The item, or NULL once the ring is closed and drained
+ */
+void *spsc_ring_pop(SpscRing *ring);
+
+/**
+ * @brief Pop an item, giving up at a deadline (consumer only)
+ *
+ * @param ring Ring
+ * @param deadline Absolute CLOCK_MONOTONIC time to give up at, or NULL to wait indefinitely
+ * @param item Receives the item
+ * @return int 1 if an item was popped, 0 once the ring is closed and drained,
+ *         -1 if the deadline passed first
+ */
+int spsc_ring_pop_until(SpscRing *ring, const struct timespec *deadline, void **item);
+
+/**
+ * @brief Wait a little longer on each call: spin, then yield, then sleep
+ *
+ * For callers polling some other condition the way the ring waits for room or items.
+ *
+ * @param attempts Number of failed attempts so far (start at 0), incremented here
+ */
+void spsc_backoff(unsigned *attempts);
+
+/**
+ * @brief Check whether a CLOCK_MONOTONIC deadline has passed
+ *
+ * @param deadline Absolute deadline, or NULL for none
+ * @return int Non-zero if the deadline has passed
+ */
+int spsc_deadline_passed(const struct timespec *deadline);
+
+/**
+ * @brief Mark the end of the stream (producer only)
+ *
+ * @param ring Ring
+ */
+void spsc_ring_close(SpscRing *ring);
+
+/**
+ * @brief Release the slots; items still queued are not freed
+ *
+ * @param ring Ring
+ */
+void spsc_ring_destroy(SpscRing *ring);
+
+#endif
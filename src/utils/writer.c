@@ -0,0 +1,35 @@
+#include "writer.h"
+#include <string.h>
+
+void writer_init(Writer *writer, FILE *stream) {
+    writer->stream = stream;
+    writer->used = 0;
+}
+
+void writer_put(Writer *writer, const char *data, size_t length) {
+    if (length > WRITER_BUFFER_SIZE - writer->used) {
+        writer_flush(writer);
+        if (length > WRITER_BUFFER_SIZE) {
+            fwrite(data, 1, length, writer->stream);
+            return;
+        }
+    }
+    memcpy(writer->data + writer->used, data, length);
+    writer->used += length;
+}
+
+char *writer_space(Writer *writer, size_t *room) {
+    *room = WRITER_BUFFER_SIZE - writer->used;
+    return writer->data + writer->used;
+}
+
+void writer_commit(Writer *writer, size_t length) {
+    writer->used += length;
+}
+
+void writer_flush(Writer *writer) {
+    if (writer->used > 0) {
+        fwrite(writer->data, 1, writer->used, writer->stream);
+        writer->used = 0;
+    }
+}
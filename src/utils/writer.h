@@ -0,0 +1,62 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Output is collected in a buffer of this size and written when it fills
+#define WRITER_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Buffered output: many small pieces become one large fwrite()
+ */
+typedef struct {
+    FILE *stream;
+    size_t used;
+    char data[WRITER_BUFFER_SIZE];
+} Writer;
+
+/**
+ * @brief Start writing to a stream
+ *
+ * @param writer Writer to initialize (typically on the stack)
+ * @param stream Stream the buffered output goes to
+ */
+void writer_init(Writer *writer, FILE *stream);
+
+/**
+ * @brief Append bytes, flushing first if they do not fit
+ *
+ * @param writer Writer
+ * @param data Bytes to append
+ * @param length Number of bytes (larger than the buffer goes straight to the stream)
+ */
+void writer_put(Writer *writer, const char *data, size_t length);
+
+/**
+ * @brief Free space at the end of the buffer, for formatting in place
+ *
+ * Write at most *room bytes, then call writer_commit() with the number used.
+ *
+ * @param writer Writer
+ * @param room Receives the number of bytes available
+ * @return char* Start of the free space
+ */
+char *writer_space(Writer *writer, size_t *room);
+
+/**
+ * @brief Keep bytes written into the space returned by writer_space()
+ *
+ * @param writer Writer
+ * @param length Number of bytes written
+ */
+void writer_commit(Writer *writer, size_t length);
+
+/**
+ * @brief Write out everything buffered so far
+ *
+ * @param writer Writer
+ */
+void writer_flush(Writer *writer);
+
+#endif
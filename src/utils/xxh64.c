@@ -0,0 +1,132 @@
+#include "xxh64.h"
+#include <string.h>
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t read64(const uint8_t *bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static uint32_t read32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 |
+           (uint32_t)bytes[3] << 24;
+}
+
+static uint64_t round64(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME1;
+}
+
+static uint64_t merge_round(uint64_t accumulator, uint64_t lane) {
+    accumulator ^= round64(0, lane);
+    return accumulator * PRIME1 + PRIME4;
+}
+
+/**
+ * @brief Consume one 32-byte stripe
+ */
+static void consume_stripe(uint64_t *lanes, const uint8_t *stripe) {
+    lanes[0] = round64(lanes[0], read64(stripe));
+    lanes[1] = round64(lanes[1], read64(stripe + 8));
+    lanes[2] = round64(lanes[2], read64(stripe + 16));
+    lanes[3] = round64(lanes[3], read64(stripe + 24));
+}
+
+void xxh64_init(Xxh64 *xxh) {
+    xxh->lanes[0] = PRIME1 + PRIME2;
+    xxh->lanes[1] = PRIME2;
+    xxh->lanes[2] = 0;
+    xxh->lanes[3] = 0 - PRIME1;
+    xxh->length = 0;
+    xxh->stripe_used = 0;
+}
+
+void xxh64_update(Xxh64 *xxh, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    xxh->length += size;
+
+    // Top up a pending partial stripe first
+    if (xxh->stripe_used > 0) {
+        size_t chunk = 32 - xxh->stripe_used;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(xxh->stripe + xxh->stripe_used, bytes, chunk);
+        xxh->stripe_used += chunk;
+        bytes += chunk;
+        size -= chunk;
+        if (xxh->stripe_used < 32) {
+            return;
+        }
+        consume_stripe(xxh->lanes, xxh->stripe);
+        xxh->stripe_used = 0;
+    }
+
+    // Whole stripes straight from the input
+    while (size >= 32) {
+        consume_stripe(xxh->lanes, bytes);
+        bytes += 32;
+        size -= 32;
+    }
+
+    memcpy(xxh->stripe, bytes, size);
+    xxh->stripe_used = size;
+}
+
+uint64_t xxh64_final(const Xxh64 *xxh) {
+    uint64_t hash;
+    if (xxh->length >= 32) {
+        hash = rotate_left(xxh->lanes[0], 1) + rotate_left(xxh->lanes[1], 7) +
+               rotate_left(xxh->lanes[2], 12) + rotate_left(xxh->lanes[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = merge_round(hash, xxh->lanes[i]);
+        }
+    } else {
+        // Short input: only the seed (0) and the tail contribute
+        hash = PRIME5;
+    }
+    hash += xxh->length;
+
+    // Tail: the bytes of the last partial stripe
+    const uint8_t *tail = xxh->stripe;
+    size_t remaining = xxh->stripe_used;
+    while (remaining >= 8) {
+        hash ^= round64(0, read64(tail));
+        hash = rotate_left(hash, 27) * PRIME1 + PRIME4;
+        tail += 8;
+        remaining -= 8;
+    }
+    if (remaining >= 4) {
+        hash ^= (uint64_t)read32(tail) * PRIME1;
+        hash = rotate_left(hash, 23) * PRIME2 + PRIME3;
+        tail += 4;
+        remaining -= 4;
+    }
+    while (remaining > 0) {
+        hash ^= (uint64_t)(*tail) * PRIME5;
+        hash = rotate_left(hash, 11) * PRIME1;
+        tail++;
+        remaining--;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,44 @@
+#ifndef XXH64_H
+#define XXH64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of an XXH64 digest in bytes (written big-endian, as xxhsum prints it)
+#define XXH64_DIGEST_SIZE 8
+
+/**
+ * @brief Incremental XXH64 state (seed 0)
+ */
+typedef struct {
+    uint64_t lanes[4];       // Accumulators for the four 8-byte lanes
+    uint64_t length;         // Bytes hashed so far
+    uint8_t stripe[32];      // Pending partial stripe
+    size_t stripe_used;      // Bytes in stripe
+} Xxh64;
+
+/**
+ * @brief Start a new hash
+ *
+ * @param xxh Hash state
+ */
+void xxh64_init(Xxh64 *xxh);
+
+/**
+ * @brief Add bytes to the hash
+ *
+ * @param xxh Hash state
+ * @param data Bytes to add
+ * @param size Number of bytes
+ */
+void xxh64_update(Xxh64 *xxh, const void *data, size_t size);
+
+/**
+ * @brief Finish the hash
+ *
+ * @param xxh Hash state
+ * @return uint64_t The 64-bit hash
+ */
+uint64_t xxh64_final(const Xxh64 *xxh);
+
+#endif
@@ -0,0 +1,585 @@
+#define _DEFAULT_SOURCE
+#include "watch.h"
+#include "directory_reader.h"
+#include "display.h"
+#include "file_info.h"
+#include "sort/sort.h"
+#include "utils/path.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Events that can change which entries exist or what they look like
+#define WATCH_EVENT_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                          IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+// How long to wait for follow-up events before re-rendering a burst
+#define WATCH_COALESCE_MS 50
+
+// Longest a burst is coalesced for, so continuous writes still re-render
+#define WATCH_COALESCE_MAX_MS (10 * WATCH_COALESCE_MS)
+
+// How often to check, while no events arrive, whether the directory was removed
+#define WATCH_REMOVED_CHECK_MS 1000
+
+// Room for a burst of events, each with a maximum-length name
+#define WATCH_BUFFER_SIZE (64 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+
+/**
+ * @brief Milliseconds elapsed on CLOCK_MONOTONIC since start
+ */
+static long elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000L + (now.tv_nsec - start->tv_nsec) / 1000000L;
+}
+
+/**
+ * @brief Name lookup key: maps a name to the mtime it is currently sorted under
+ */
+typedef struct {
+    char *name;    // Shared with the display arrays, not owned
+    time_t mtime;  // Modification time the entry is currently sorted by
+} NameKey;
+
+/**
+ * @brief In-memory sorted listing kept in sync with the directory
+ *
+ * names/infos/mtimes are parallel arrays in display order. by_name holds the
+ * same entries in strcmp order so an entry can be located from the bare name
+ * an inotify event carries, even when the display order is by time.
+ */
+typedef struct {
+    const char *dir_path;
+    const Options *options;
+    const Filter *filter;
+    int dir_fd;          // Open directory, for filter metadata lookups
+    SortMode sort_mode;
+    int need_stat;       // Non-zero if entries need metadata (-l or -t)
+    char **names;        // Entry names in display order (owned)
+    FileInfo *infos;     // File information in display order (-l only)
+    time_t *mtimes;      // Modification times in display order
+    NameKey *by_name;    // Entries sorted by name
+    int count;
+    int capacity;
+} WatchListing;
+
+static int compare_name_keys(const void *a, const void *b) {
+    return strcmp(((const NameKey *)a)->name, ((const NameKey *)b)->name);
+}
+
+/**
+ * @brief Find a name in the by_name index
+ *
+ * @return int Index in by_name if found, otherwise -(insertion point) - 1
+ */
+static int find_by_name(const WatchListing *listing, const char *name) {
+    int low = 0;
+    int high = listing->count - 1;
+
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int cmp = strcmp(listing->by_name[mid].name, name);
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return -low - 1;
+}
+
+/**
+ * @brief Find the display position of an entry with the given sort key
+ *
+ * @return int Index in display order if found, otherwise -(insertion point) - 1
+ */
+static int find_display_index(const WatchListing *listing, const char *name, time_t mtime) {
+    int reverse = listing->options->reverse_sort;
+    int low = 0;
+    int high = listing->count - 1;
+
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int cmp = compare_entries(listing->names[mid], listing->mtimes[mid], name, mtime,
+                                  listing->sort_mode, reverse);
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return -low - 1;
+}
+
+static int ensure_capacity(WatchListing *listing, int needed) {
+    if (needed <= listing->capacity) {
+        return 0;
+    }
+
+    int new_capacity = listing->capacity > 0 ? listing->capacity * 2 : 64;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    char **names = (char **)realloc(listing->names, new_capacity * sizeof(char *));
+    if (names == NULL) {
+        return -1;
+    }
+    listing->names = names;
+
+    time_t *mtimes = (time_t *)realloc(listing->mtimes, new_capacity * sizeof(time_t));
+    if (mtimes == NULL) {
+        return -1;
+    }
+    listing->mtimes = mtimes;
+
+    NameKey *by_name = (NameKey *)realloc(listing->by_name, new_capacity * sizeof(NameKey));
+    if (by_name == NULL) {
+        return -1;
+    }
+    listing->by_name = by_name;
+
+    if (listing->options->long_format) {
+        FileInfo *infos = (FileInfo *)realloc(listing->infos, new_capacity * sizeof(FileInfo));
+        if (infos == NULL) {
+            return -1;
+        }
+        listing->infos = infos;
+    }
+
+    listing->capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief Fetch the metadata an entry needs for sorting and display
+ *
+ * Nothing is stat'ed unless the listing shows or sorts on metadata.
+ *
+ * @param mtime Receives the modification time (0 if not needed)
+ * @param info Receives the file information (zeroed unless long format)
+ * @return int 1 if the entry exists, 0 if it could not be stat'ed
+ */
+static int load_entry(const WatchListing *listing, const char *name, time_t *mtime,
+                      FileInfo *info) {
+    memset(info, 0, sizeof(FileInfo));
+    *mtime = 0;
+
+    if (!listing->need_stat) {
+        return 1;
+    }
+
+    char *full_path = construct_full_path(listing->dir_path, name);
+    if (full_path == NULL) {
+        return 0;
+    }
+
+    int found;
+    if (listing->options->long_format) {
+        *info = get_file_info(full_path, name);
+        found = info->name != NULL;
+        *mtime = info->stat_info.st_mtime;
+    } else {
+        struct stat stat_info;
+        found = fstatat(AT_FDCWD, full_path, &stat_info, file_info_stat_flags()) == 0;
+        if (found) {
+            *mtime = stat_info.st_mtime;
+        }
+    }
+    free(full_path);
+
+    return found;
+}
+
+/**
+ * @brief Remove an entry from the listing by name
+ */
+static void remove_entry(WatchListing *listing, const char *name) {
+    int key_index = find_by_name(listing, name);
+    if (key_index < 0) {
+        return;
+    }
+
+    int index = find_display_index(listing, name, listing->by_name[key_index].mtime);
+    if (index < 0) {
+        return;
+    }
+
+    int tail = listing->count - index - 1;
+    free(listing->names[index]);
+    memmove(&listing->names[index], &listing->names[index + 1], tail * sizeof(char *));
+    memmove(&listing->mtimes[index], &listing->mtimes[index + 1], tail * sizeof(time_t));
+    if (listing->infos != NULL) {
+        free_file_info(listing->infos[index]);
+        memmove(&listing->infos[index], &listing->infos[index + 1], tail * sizeof(FileInfo));
+    }
+
+    int key_tail = listing->count - key_index - 1;
+    memmove(&listing->by_name[key_index], &listing->by_name[key_index + 1],
+            key_tail * sizeof(NameKey));
+
+    listing->count--;
+}
+
+/**
+ * @brief Re-read one entry and put it at its sorted position
+ *
+ * The entry is removed first if already present, since its sort key may have
+ * changed. If it can no longer be stat'ed it simply stays removed.
+ *
+ * @return int 0 on success, -1 on allocation failure
+ */
+static int refresh_entry(WatchListing *listing, const char *name) {
+    remove_entry(listing, name);
+
+    if (!filter_entry_passes(listing->filter, listing->dir_fd, name, DT_UNKNOWN)) {
+        return 0;
+    }
+
+    FileInfo info;
+    time_t mtime;
+    if (!load_entry(listing, name, &mtime, &info)) {
+        return 0;
+    }
+
+    if (ensure_capacity(listing, listing->count + 1) != 0) {
+        free_file_info(info);
+        return -1;
+    }
+
+    size_t name_len = strlen(name);
+    char *name_copy = (char *)malloc((name_len + 1) * sizeof(char));
+    if (name_copy == NULL) {
+        free_file_info(info);
+        return -1;
+    }
+    strcpy(name_copy, name);
+
+    int index = -find_display_index(listing, name, mtime) - 1;
+    int tail = listing->count - index;
+    memmove(&listing->names[index + 1], &listing->names[index], tail * sizeof(char *));
+    memmove(&listing->mtimes[index + 1], &listing->mtimes[index], tail * sizeof(time_t));
+    listing->names[index] = name_copy;
+    listing->mtimes[index] = mtime;
+    if (listing->infos != NULL) {
+        memmove(&listing->infos[index + 1], &listing->infos[index], tail * sizeof(FileInfo));
+        listing->infos[index] = info;
+    }
+
+    int key_index = -find_by_name(listing, name) - 1;
+    int key_tail = listing->count - key_index;
+    memmove(&listing->by_name[key_index + 1], &listing->by_name[key_index],
+            key_tail * sizeof(NameKey));
+    listing->by_name[key_index].name = name_copy;
+    listing->by_name[key_index].mtime = mtime;
+
+    listing->count++;
+    return 0;
+}
+
+static void clear_listing(WatchListing *listing) {
+    for (int i = 0; i < listing->count; i++) {
+        free(listing->names[i]);
+        if (listing->infos != NULL) {
+            free_file_info(listing->infos[i]);
+        }
+    }
+    listing->count = 0;
+}
+
+static void free_listing(WatchListing *listing) {
+    clear_listing(listing);
+    free(listing->names);
+    free(listing->infos);
+    free(listing->mtimes);
+    free(listing->by_name);
+}
+
+/**
+ * @brief One entry collected by the initial scan, before it is split into
+ *        the parallel display arrays
+ */
+typedef struct {
+    char *name;
+    time_t mtime;
+    FileInfo info;
+} ScannedEntry;
+
+// Sort parameters for the qsort callback below
+static SortMode g_scan_sort_mode = SORT_MODE_ALPHA;
+static int g_scan_reverse = 0;
+
+static int compare_scanned_entries(const void *a, const void *b) {
+    const ScannedEntry *entry_a = (const ScannedEntry *)a;
+    const ScannedEntry *entry_b = (const ScannedEntry *)b;
+    return compare_entries(entry_a->name, entry_a->mtime, entry_b->name, entry_b->mtime,
+                           g_scan_sort_mode, g_scan_reverse);
+}
+
+/**
+ * @brief Full scan: read and stat every entry once, then sort
+ *
+ * Entries are stat'ed exactly once and sorted on the collected mtimes, so the
+ * stored sort keys always match the display order.
+ *
+ * @return int 0 on success, -1 on error
+ */
+static int load_listing(WatchListing *listing) {
+    clear_listing(listing);
+
+    DirectoryContent content = read_directory_filtered(listing->dir_path,
+                                                       listing->options->show_all,
+                                                       listing->filter, NULL);
+    if (content.entries == NULL) {
+        return -1;
+    }
+    filter_apply_metadata(listing->filter, listing->dir_path, &content);
+
+    size_t slots = content.count > 0 ? (size_t)content.count : 1;
+    ScannedEntry *scanned = (ScannedEntry *)malloc(slots * sizeof(ScannedEntry));
+    if (scanned == NULL || ensure_capacity(listing, content.count) != 0) {
+        free(scanned);
+        free_directory_content(content);
+        return -1;
+    }
+
+    // Take ownership of the names; entries that vanished since readdir are skipped
+    int scanned_count = 0;
+    for (int i = 0; i < content.count; i++) {
+        char *name = content.entries[i];
+        time_t mtime;
+        FileInfo info;
+        if (!load_entry(listing, name, &mtime, &info)) {
+            free(name);
+            continue;
+        }
+
+        scanned[scanned_count].name = name;
+        scanned[scanned_count].mtime = mtime;
+        scanned[scanned_count].info = info;
+        scanned_count++;
+    }
+    free(content.entries);
+    free(content.types);
+    free(content.inodes);
+
+    g_scan_sort_mode = listing->sort_mode;
+    g_scan_reverse = listing->options->reverse_sort;
+    qsort(scanned, scanned_count, sizeof(ScannedEntry), compare_scanned_entries);
+
+    for (int i = 0; i < scanned_count; i++) {
+        listing->names[i] = scanned[i].name;
+        listing->mtimes[i] = scanned[i].mtime;
+        if (listing->infos != NULL) {
+            listing->infos[i] = scanned[i].info;
+        }
+        listing->by_name[i].name = scanned[i].name;
+        listing->by_name[i].mtime = scanned[i].mtime;
+    }
+    listing->count = scanned_count;
+    free(scanned);
+
+    if (listing->count > 1) {
+        qsort(listing->by_name, listing->count, sizeof(NameKey), compare_name_keys);
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether the watched directory has been removed
+ *
+ * The descriptor watch_directory() keeps open holds the removed directory's
+ * inode, and the kernel only reports IN_DELETE_SELF once the inode is
+ * released, so removal is detected from its link count instead.
+ */
+static int directory_removed(int dir_fd) {
+    struct stat dir_stat;
+    return fstat(dir_fd, &dir_stat) == 0 && dir_stat.st_nlink == 0;
+}
+
+static void render(const WatchListing *listing) {
+    if (isatty(STDOUT_FILENO)) {
+        // Move the cursor home and clear the screen
+        printf("\033[H\033[2J");
+    }
+
+    if (listing->options->long_format) {
+        display_long_format(listing->infos, listing->count,
+                            options_long_format_flags(listing->options));
+    } else {
+        display_normal((const char **)listing->names, listing->count,
+                       listing->options->show_size, listing->dir_path, NULL);
+    }
+
+    fflush(stdout);
+}
+
+int watch_directory(const char *dir_path, const Options *options, const Filter *filter) {
+    if (dir_path == NULL || options == NULL) {
+        return 1;
+    }
+
+    WatchListing listing;
+    memset(&listing, 0, sizeof(WatchListing));
+    listing.dir_path = dir_path;
+    listing.options = options;
+    listing.filter = filter;
+    listing.sort_mode = options->sort_by_time ? SORT_MODE_MTIME : SORT_MODE_ALPHA;
+    listing.need_stat = options->long_format || options->sort_by_time;
+
+    // Subscribe before the initial scan so no change slips in between
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        fprintf(stderr, "Error: Cannot initialize inotify\n");
+        return 1;
+    }
+    if (inotify_add_watch(inotify_fd, dir_path, WATCH_EVENT_MASK | IN_ONLYDIR) < 0) {
+        fprintf(stderr, "Error: Cannot watch directory '%s'\n", dir_path);
+        close(inotify_fd);
+        return 1;
+    }
+
+    listing.dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (listing.dir_fd < 0 || load_listing(&listing) != 0) {
+        fprintf(stderr, "Error: Cannot read directory '%s'\n", dir_path);
+        if (listing.dir_fd >= 0) {
+            close(listing.dir_fd);
+        }
+        free_listing(&listing);
+        close(inotify_fd);
+        return 1;
+    }
+    render(&listing);
+
+    char *buffer = (char *)malloc(WATCH_BUFFER_SIZE);
+    if (buffer == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free_listing(&listing);
+        close(listing.dir_fd);
+        close(inotify_fd);
+        return 1;
+    }
+
+    int status = 0;
+    int running = 1;
+    while (running) {
+        struct pollfd idle = {inotify_fd, POLLIN, 0};
+        int ready = poll(&idle, 1, WATCH_REMOVED_CHECK_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            running = !directory_removed(listing.dir_fd);
+            continue;
+        }
+        ssize_t length = ready > 0 ? read(inotify_fd, buffer, WATCH_BUFFER_SIZE) : -1;
+        if (length <= 0) {
+            status = 1;
+            break;
+        }
+
+        int changed = 0;
+        int rescan = 0;
+        struct timespec burst_start;
+        clock_gettime(CLOCK_MONOTONIC, &burst_start);
+
+        // Drain everything that arrives in quick succession so a burst renders once,
+        // but render at least every WATCH_COALESCE_MAX_MS while events keep coming
+        for (;;) {
+            for (char *ptr = buffer; ptr < buffer + length;) {
+                const struct inotify_event *event = (const struct inotify_event *)ptr;
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    running = 0;
+                    break;
+                }
+                if (event->mask & IN_Q_OVERFLOW) {
+                    rescan = 1;
+                    continue;
+                }
+                if (event->len == 0 || rescan) {
+                    continue;
+                }
+
+                const char *name = event->name;
+                if (!options->show_all && name[0] == '.') {
+                    continue;
+                }
+
+                if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    remove_entry(&listing, name);
+                    changed = 1;
+                } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    if (refresh_entry(&listing, name) != 0) {
+                        running = 0;
+                        status = 1;
+                        break;
+                    }
+                    changed = 1;
+                } else if (listing.need_stat) {
+                    // Attribute or content change: only matters if metadata is shown or sorted on
+                    if (refresh_entry(&listing, name) != 0) {
+                        running = 0;
+                        status = 1;
+                        break;
+                    }
+                    changed = 1;
+                }
+            }
+
+            long remaining = WATCH_COALESCE_MAX_MS - elapsed_ms(&burst_start);
+            int timeout = remaining < WATCH_COALESCE_MS ? (int)remaining : WATCH_COALESCE_MS;
+            struct pollfd pfd = {inotify_fd, POLLIN, 0};
+            if (!running || timeout <= 0 || poll(&pfd, 1, timeout) <= 0) {
+                break;
+            }
+            length = read(inotify_fd, buffer, WATCH_BUFFER_SIZE);
+            if (length <= 0) {
+                break;
+            }
+        }
+
+        if (running && directory_removed(listing.dir_fd)) {
+            running = 0;
+        }
+
+        if (rescan && running) {
+            // The kernel dropped events; fall back to a full scan
+            if (load_listing(&listing) != 0) {
+                status = 1;
+                break;
+            }
+            changed = 1;
+        }
+
+        if (changed && running) {
+            render(&listing);
+        }
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Error: Lost track of directory '%s'\n", dir_path);
+    }
+
+    free(buffer);
+    free_listing(&listing);
+    close(listing.dir_fd);
+    close(inotify_fd);
+    return status;
+}
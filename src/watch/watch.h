@@ -0,0 +1,22 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "filter/filter.h"
+#include "options.h"
+
+/**
+ * @brief List a directory, then keep the listing up to date from inotify events
+ *
+ * The directory is read and stat'ed once. After that only the entries named
+ * by inotify events are re-stat'ed and inserted into (or removed from) the
+ * sorted in-memory listing, which is then re-rendered. Runs until the
+ * directory is deleted or moved, or the process is interrupted.
+ *
+ * @param dir_path Directory to watch
+ * @param options Display and sort options
+ * @param filter Compiled entry filter, or NULL to show every entry
+ * @return int 0 when the watched directory goes away, 1 on error
+ */
+int watch_directory(const char *dir_path, const Options *options, const Filter *filter);
+
+#endif
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include "xattr.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+
+// Attributes behind the '+' marker and the -Z column
+#define ACL_ACCESS_NAME "system.posix_acl_access"
+#define ACL_DEFAULT_NAME "system.posix_acl_default"
+#define CONTEXT_NAME "security.selinux"
+
+// Room for the attribute names of a typical file; longer lists are probed name by name
+#define XATTR_LIST_SIZE 1024
+
+static ssize_t list_names(const char *path, int follow, char *names, size_t size) {
+    return follow ? listxattr(path, names, size) : llistxattr(path, names, size);
+}
+
+static ssize_t get_value(const char *path, int follow, const char *name, void *value,
+                         size_t size) {
+    return follow ? getxattr(path, name, value, size) : lgetxattr(path, name, value, size);
+}
+
+/**
+ * @brief Whether a name is in a list returned by llistxattr()
+ */
+static int has_name(const char *names, ssize_t length, const char *name) {
+    for (ssize_t offset = 0; offset < length;) {
+        const char *current = names + offset;
+        if (strcmp(current, name) == 0) {
+            return 1;
+        }
+        offset += (ssize_t)strlen(current) + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether a file has an attribute: from its list, or by asking if the list was too long
+ */
+static int has_attribute(const char *path, int follow, const char *names, ssize_t length,
+                         const char *name) {
+    if (length >= 0) {
+        return has_name(names, length, name);
+    }
+    return get_value(path, follow, name, NULL, 0) >= 0;
+}
+
+int xattr_fetch(const char *path, int wanted, int follow, char *context, size_t context_size) {
+    if (context != NULL && context_size > 0) {
+        context[0] = '\0';
+    }
+
+    char names[XATTR_LIST_SIZE];
+    ssize_t length = list_names(path, follow, names, sizeof(names));
+    if (length < 0 && errno != ERANGE) {
+        // No extended attributes here (or the file is gone)
+        return 0;
+    }
+
+    int found = 0;
+    if ((wanted & XATTR_ACL) &&
+        (has_attribute(path, follow, names, length, ACL_ACCESS_NAME) ||
+         has_attribute(path, follow, names, length, ACL_DEFAULT_NAME))) {
+        found |= XATTR_ACL;
+    }
+
+    // The context is only read when the list says it is there
+    if ((wanted & XATTR_CONTEXT) && context != NULL && context_size > 1 &&
+        (length < 0 || has_name(names, length, CONTEXT_NAME))) {
+        ssize_t size = get_value(path, follow, CONTEXT_NAME, context, context_size - 1);
+        if (size > 0 && context[size - 1] == '\0') {
+            // Stored with its terminator
+            size--;
+        }
+        if (size > 0) {
+            context[size] = '\0';
+            found |= XATTR_CONTEXT;
+        } else {
+            context[0] = '\0';
+        }
+    }
+    return found;
+}
+
+char xattr_marker(int found) {
+    if (found & XATTR_ACL) {
+        return '+';
+    }
+    return (found & XATTR_CONTEXT) ? '.' : ' ';
+}
@@ -0,0 +1,38 @@
+#ifndef XATTR_H
+#define XATTR_H
+
+#include <stddef.h>
+
+// Extended attributes to fetch, and found (combine with |)
+#define XATTR_ACL 1        // A POSIX ACL is set: '+' after the permissions (--acl, -Z)
+#define XATTR_CONTEXT 2    // SELinux security context column (-Z)
+
+// Room for a security context and its terminator
+#define XATTR_CONTEXT_SIZE 256
+
+/**
+ * @brief Fetch the requested extended attributes of a file
+ *
+ * One llistxattr() call tells which attributes the file has, so files
+ * without an ACL or a context cost nothing more; lgetxattr() is only called
+ * to read a context that is there. Filesystems without extended attributes
+ * report nothing.
+ *
+ * @param path Path to the file
+ * @param wanted XATTR_* bits to fetch
+ * @param follow Non-zero to describe what a symbolic link points to (-L)
+ * @param context Receives the security context with XATTR_CONTEXT ("" if it has none)
+ * @param context_size Size of the context buffer
+ * @return int XATTR_* bits the file has, out of those wanted
+ */
+int xattr_fetch(const char *path, int wanted, int follow, char *context, size_t context_size);
+
+/**
+ * @brief Character ls -l shows after the permissions for what was found
+ *
+ * @param found XATTR_* bits from xattr_fetch()
+ * @return char '+' for an ACL, '.' for a security context only, ' ' otherwise
+ */
+char xattr_marker(int found);
+
+#endif
@@ -0,0 +1,84 @@
+#!/bin/bash
+#
+# Shared setup for the tests, sourced by each tests/test_*.sh.
+#
+# Provides LISTER (the built bin/lister), WORK (an empty directory removed when
+# the test exits) and the helpers below. A test calls `finish` last; it exits
+# non-zero if any check failed.
+
+set -euo pipefail
+
+LISTER=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)/bin/lister
+TEST_NAME=$(basename "$0")
+TEST_ROOT=$(mktemp -d "${TMPDIR:-/tmp}/lister-test-XXXXXX")
+WORK=$TEST_ROOT/work
+FAILED=0
+
+if [ ! -x "$LISTER" ]; then
+    echo "Error: Build lister first (make)" >&2
+    exit 1
+fi
+
+trap 'rm -rf "$TEST_ROOT"' EXIT
+mkdir "$WORK"
+
+# run ARGS...: run lister, leaving its exit status in STATUS, stdout in OUT and
+# stderr in ERR
+run() {
+    STATUS=0
+    "$LISTER" "$@" > "$TEST_ROOT/stdout" 2> "$TEST_ROOT/stderr" || STATUS=$?
+    OUT=$(cat "$TEST_ROOT/stdout")
+    ERR=$(cat "$TEST_ROOT/stderr")
+}
+
+# words TEXT: TEXT with each run of spaces and newlines collapsed to one space
+words() {
+    printf '%s' "$1" | tr -s ' \n' ' ' | sed 's/^ //; s/ $//'
+}
+
+# fail MESSAGE: record a failed check
+fail() {
+    echo "FAIL: $TEST_NAME: $1"
+    FAILED=1
+}
+
+# expect_eq WHAT EXPECTED ACTUAL
+expect_eq() {
+    if [ "$2" != "$3" ]; then
+        fail "$1: got '$3', expected '$2'"
+    fi
+}
+
+# expect_match WHAT REGEX TEXT: TEXT has a line matching the extended regex
+expect_match() {
+    if ! printf '%s\n' "$3" | grep -qE -- "$2"; then
+        fail "$1: no line matches '$2' in: $3"
+    fi
+}
+
+# expect_listing EXPECTED ARGS...: lister ARGS succeeds and prints exactly the
+# names in EXPECTED (compared with whitespace collapsed)
+expect_listing() {
+    local expected=$1
+    shift
+    run "$@"
+    expect_eq "lister $* exit status" 0 "$STATUS"
+    expect_eq "lister $*" "$expected" "$(words "$OUT")"
+}
+
+# expect_error REGEX ARGS...: lister ARGS exits 1 with a matching message on stderr
+expect_error() {
+    local pattern=$1
+    shift
+    run "$@"
+    expect_eq "lister $* exit status" 1 "$STATUS"
+    expect_match "lister $* stderr" "$pattern" "$ERR"
+}
+
+# finish: report the result of the test
+finish() {
+    if [ "$FAILED" -ne 0 ]; then
+        exit 1
+    fi
+    echo "PASS: $TEST_NAME"
+}
@@ -0,0 +1,128 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/arena.h"
+
+/*
+ * Arena allocator test.
+ *
+ * Makes a listing's worth of small allocations and string copies, then checks
+ * that every block is aligned, that nothing handed out overlaps (each block
+ * still holds the pattern written into it), that the mappings grow
+ * geometrically instead of one per allocation, and that an arena can be
+ * destroyed and reused.
+ */
+
+#define ALLOCATION_COUNT 500000
+
+static int g_failed = 0;
+
+#define CHECK(condition, ...)                          \
+    do {                                               \
+        if (!(condition)) {                            \
+            printf("FAIL: test_arena: " __VA_ARGS__);  \
+            printf("\n");                              \
+            g_failed = 1;                              \
+        }                                              \
+    } while (0)
+
+/**
+ * @brief Fill an arena with ALLOCATION_COUNT records and names and check them
+ */
+static void check_listing_sized(Arena *arena) {
+    uint32_t **records = (uint32_t **)calloc(ALLOCATION_COUNT, sizeof(uint32_t *));
+    char **names = (char **)calloc(ALLOCATION_COUNT, sizeof(char *));
+    if (records == NULL || names == NULL) {
+        CHECK(0, "out of memory");
+        free(records);
+        free(names);
+        return;
+    }
+
+    int misaligned = 0;
+    for (int i = 0; i < ALLOCATION_COUNT; i++) {
+        // Record sizes of 4 to 64 bytes, as FileInfo-like structures vary
+        size_t words = 1 + (size_t)(i % 16);
+        records[i] = (uint32_t *)arena_alloc(arena, words * sizeof(uint32_t));
+        if (records[i] == NULL) {
+            CHECK(0, "arena_alloc failed at %d", i);
+            break;
+        }
+        misaligned |= ((uintptr_t)records[i] % 16) != 0;
+        for (size_t w = 0; w < words; w++) {
+            records[i][w] = (uint32_t)i;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "entry_%d.txt", i);
+        names[i] = arena_strdup(arena, name);
+        if (names[i] == NULL) {
+            CHECK(0, "arena_strdup failed at %d", i);
+            break;
+        }
+    }
+    CHECK(!misaligned, "an allocation is not aligned to 16 bytes");
+
+    int damaged = 0;
+    for (int i = 0; i < ALLOCATION_COUNT && records[i] != NULL && names[i] != NULL; i++) {
+        size_t words = 1 + (size_t)(i % 16);
+        for (size_t w = 0; w < words; w++) {
+            damaged |= records[i][w] != (uint32_t)i;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "entry_%d.txt", i);
+        damaged |= strcmp(names[i], name) != 0;
+    }
+    CHECK(!damaged, "allocations overlap");
+
+    // Mappings double from 256 KiB, so some 30 MB take a handful of them
+    CHECK(arena->block_count >= 2 && arena->block_count <= 12,
+          "%zu mappings for %d allocations", arena->block_count, 2 * ALLOCATION_COUNT);
+    CHECK(arena->bytes_allocated > (size_t)ALLOCATION_COUNT * 8,
+          "bytes_allocated is %zu", arena->bytes_allocated);
+
+    free(records);
+    free(names);
+}
+
+int main(void) {
+    Arena arena;
+    arena_init(&arena);
+    CHECK(arena.block_count == 0, "a new arena has mappings");
+
+    check_listing_sized(&arena);
+
+    // An allocation larger than any block gets a mapping of its own
+    size_t large_size = 100 * 1024 * 1024;
+    char *large = (char *)arena_alloc(&arena, large_size);
+    CHECK(large != NULL, "a 100 MB allocation failed");
+    if (large != NULL) {
+        memset(large, 0xab, large_size);
+        CHECK(large[0] == (char)0xab && large[large_size - 1] == (char)0xab,
+              "the large allocation is not writable");
+    }
+
+    // Empty allocations are distinct and usable
+    void *empty_a = arena_alloc(&arena, 0);
+    void *empty_b = arena_alloc(&arena, 0);
+    CHECK(empty_a != NULL && empty_b != NULL && empty_a != empty_b,
+          "empty allocations are not distinct");
+
+    // Destroyed arenas start over and can be used again
+    arena_destroy(&arena);
+    CHECK(arena.head == NULL && arena.block_count == 0 && arena.bytes_allocated == 0,
+          "arena_destroy left state behind");
+    check_listing_sized(&arena);
+    arena_destroy(&arena);
+    arena_destroy(&arena);
+
+    CHECK(arena_alloc(NULL, 16) == NULL, "arena_alloc(NULL) did not fail");
+
+    if (g_failed) {
+        return 1;
+    }
+    printf("PASS: test_arena\n");
+    return 0;
+}
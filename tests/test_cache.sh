@@ -0,0 +1,69 @@
+#!/bin/bash
+#
+# Checks the listing cache: it is only used with --cache or LISTER_CACHE, a
+# changed directory mtime invalidates the record, names come from the record
+# while the mtime matches, metadata is always fresh, and a damaged cache file
+# is a miss.
+
+source "$(dirname "$0")/common.sh"
+
+export XDG_CACHE_HOME=$TEST_ROOT/cache
+unset LISTER_CACHE
+mkdir "$WORK/d"
+cd "$WORK/d"
+touch a b .hidden
+
+# cache_files: number of listing cache files
+cache_files() {
+    find "$XDG_CACHE_HOME" -name '*.cache' 2>/dev/null | wc -l
+}
+
+# Opt-in only, and filtered listings bypass it
+expect_listing "a b" .
+expect_listing "a b" --no-cache .
+LISTER_CACHE=1 expect_listing "a" --no-cache --include='a*' .
+LISTER_CACHE=1 expect_listing "a" --include='a*' .
+expect_eq "cache files without --cache" 0 "$(cache_files)"
+expect_listing "a b" --cache .
+expect_eq "cache files with --cache" 1 "$(cache_files)"
+
+# A hit lists the same entries; -a is not served from a record without them
+expect_listing "a b" --cache .
+LISTER_CACHE=1 expect_listing "a b" .
+expect_listing ".hidden a b" --cache -a .
+expect_listing "a b" --cache .
+
+# A new entry changes the directory mtime, so the record is replaced
+touch c
+expect_listing "a b c" --cache .
+rm c
+expect_listing "a b" --cache .
+
+# While the mtime matches, the names come from the record without reading the
+# directory: an entry slipped in behind a restored mtime is not seen
+touch -r . "$TEST_ROOT/dir.time"
+touch hidden_by_cache
+touch -r "$TEST_ROOT/dir.time" .
+expect_listing "a b" --cache .
+expect_listing "a b hidden_by_cache" .
+rm hidden_by_cache
+
+# Metadata is never cached: a file rewritten in place shows its new size
+expect_listing "a b" --cache .
+printf 'twelve bytes' > a
+run -l --cache .
+expect_match "-l after a rewrite" "^-.* 12 .* a\$" "$OUT"
+
+# A truncated cache file is a miss even while the mtime matches, so the
+# directory is read again
+for file in "$XDG_CACHE_HOME"/lister/*.cache; do
+    head -c 24 "$file" > "$TEST_ROOT/truncated"
+    cat "$TEST_ROOT/truncated" > "$file"
+done
+touch -r . "$TEST_ROOT/dir.time"
+touch d
+touch -r "$TEST_ROOT/dir.time" .
+expect_listing "a b d" --cache .
+expect_listing "a b d" --cache .
+
+finish
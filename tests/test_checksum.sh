@@ -0,0 +1,51 @@
+#!/bin/bash
+#
+# Checks --checksum: xxh64 and sha256 digests, '-' for non-regular entries,
+# the same column under --mem-limit, and a digest cache that is only used with
+# --cache or LISTER_CACHE and notices rewritten files.
+
+source "$(dirname "$0")/common.sh"
+
+export XDG_CACHE_HOME=$TEST_ROOT/cache
+unset LISTER_CACHE
+mkdir "$WORK/d" "$WORK/d/sub"
+cd "$WORK/d"
+printf hello > a
+printf world > b
+ln -s a link
+
+# checksum_column ARGS...: "digest name" for each row of lister ARGS, joined by '|'
+checksum_column() {
+    "$LISTER" "$@" . | sed 's/ -> .*//' | awk '{ print $(NF - 1), $NF }' | paste -sd '|'
+}
+
+SHA_A=$(sha256sum a | cut -d ' ' -f 1)
+SHA_B=$(sha256sum b | cut -d ' ' -f 1)
+expect_eq "sha256" "$SHA_A a|$SHA_B b|- link|- sub" "$(checksum_column --checksum=sha256)"
+expect_eq "xxh64" "26c7827d889f6da3 a|e778fbfe66ee51ef b|- link|- sub" \
+    "$(checksum_column --checksum)"
+expect_eq "--checksum under --mem-limit" "$(checksum_column --checksum)" \
+    "$(checksum_column --checksum --mem-limit=64K)"
+expect_error "--checksum must be xxh64 or sha256" --checksum=md5 .
+
+# Without --cache or LISTER_CACHE nothing is cached
+checksum_column --checksum > /dev/null
+checksum_column --checksum --no-cache > /dev/null
+expect_eq "cache files without --cache" "" "$(find "$XDG_CACHE_HOME" -name '*.sums' 2>/dev/null)"
+
+# --cache and LISTER_CACHE keep one digest file per directory and algorithm
+checksum_column --checksum --cache > /dev/null
+LISTER_CACHE=1 checksum_column --checksum=sha256 > /dev/null
+expect_eq "digest files" 2 "$(find "$XDG_CACHE_HOME" -name '*.sums' | wc -l)"
+
+# A file rewritten in place, with its size and mtime unchanged, is hashed again
+touch -r a "$TEST_ROOT/a.time"
+printf jello > a
+touch -r "$TEST_ROOT/a.time" a
+SHA_A=$(sha256sum a | cut -d ' ' -f 1)
+expect_match "rewritten file with --cache" "^$SHA_A a\$" \
+    "$(checksum_column --checksum=sha256 --cache | tr '|' '\n')"
+LISTER_CACHE=1 run --checksum=sha256 --no-cache .
+expect_match "--no-cache overrides LISTER_CACHE" " $SHA_A a\$" "$OUT"
+
+finish
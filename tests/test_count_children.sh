@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Checks --count-children: the count column for subdirectories, '-' for
+# everything else, hidden entries only with -a, links followed only with -L,
+# --count-limit, and the same counts on every code path.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+mkdir empty three many
+touch three/a three/b three/.hidden file
+touch $(seq -f 'many/m%.0f' 1 500)
+ln -s three link
+# Enough subdirectories to keep every counting thread busy
+for i in $(seq 1 200); do
+    mkdir "sub$i"
+    if [ $(( i % 7 )) -gt 0 ]; then
+        touch $(seq -f "sub$i/e%.0f" 1 $(( i % 7 )))
+    fi
+done
+
+# counts ARGS...: "name count" for the named entries of lister ARGS, joined by '|'
+counts() {
+    run --count-children "$@" .
+    expect_eq "lister --count-children $* exit status" 0 "$STATUS"
+    printf '%s\n' "$OUT" | sed 's/ -> .*//' | \
+        awk '$NF ~ /^(empty|three|many|file|link|sub7|sub13)$/ { print $NF, $(NF - 4) }' | \
+        paste -sd '|'
+}
+
+expect_eq "counts" "empty 0|file -|link -|many 500|sub13 6|sub7 0|three 2" "$(counts)"
+expect_eq "counts with -a" "empty 0|file -|link -|many 500|sub13 6|sub7 0|three 3" "$(counts -a)"
+expect_eq "counts with -L" "empty 0|file -|link 2|many 500|sub13 6|sub7 0|three 2" "$(counts -L)"
+expect_eq "--count-limit" "empty 0|file -|link -|many 100+|sub13 6|sub7 0|three 2" \
+    "$(counts --count-limit=100)"
+
+# Every subdirectory is counted, whichever thread reads it
+run --count-children .
+for i in $(seq 1 200); do
+    expected=$(( i % 7 ))
+    actual=$(printf '%s\n' "$OUT" | awk -v name="sub$i" '$NF == name { print $(NF - 4) }')
+    if [ "$actual" != "$expected" ]; then
+        fail "sub$i: got '$actual', expected '$expected'"
+    fi
+done
+
+# The same column on the serial, pipelined and --mem-limit paths
+SERIAL=$(run --count-children --threads=0 .; printf '%s' "$OUT")
+expect_eq "pipelined" "$SERIAL" "$(run --count-children --threads=4 .; printf '%s' "$OUT")"
+expect_eq "--mem-limit" "$SERIAL" "$(run --count-children --mem-limit=64K .; printf '%s' "$OUT")"
+
+# An unreadable subdirectory shows '?' (root reads everything, so only as a user)
+if [ "$(id -u)" -ne 0 ]; then
+    chmod 000 empty
+    expect_eq "unreadable" "empty ?" "$(counts | tr '|' '\n' | grep '^empty ')"
+    chmod 755 empty
+fi
+
+expect_error "--count-limit" --count-children --count-limit=-5 .
+
+finish
@@ -0,0 +1,99 @@
+#!/bin/bash
+#
+# Checks --deadline against a stat() that hangs: the listing comes back on time
+# with the late entries shown as '?', a warning and exit status 1, while a
+# deadline that is not reached changes nothing. The hang is simulated by an
+# LD_PRELOAD shim that delays fstatat() and statx() on names starting with
+# "slow".
+
+source "$(dirname "$0")/common.sh"
+
+cat > "$TEST_ROOT/slow_stat.c" << 'EOF'
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void delay(const char *path) {
+    const char *name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+    if (strncmp(name, "slow", 4) == 0) {
+        sleep(3);
+    }
+}
+
+int fstatat(int dir_fd, const char *path, struct stat *stat_info, int flags) {
+    static int (*real_fstatat)(int, const char *, struct stat *, int);
+    if (real_fstatat == NULL) {
+        real_fstatat = (int (*)(int, const char *, struct stat *, int))dlsym(RTLD_NEXT, "fstatat");
+    }
+    delay(path);
+    return real_fstatat(dir_fd, path, stat_info, flags);
+}
+
+int statx(int dir_fd, const char *path, int flags, unsigned int mask, struct statx *stx) {
+    static int (*real_statx)(int, const char *, int, unsigned int, struct statx *);
+    if (real_statx == NULL) {
+        real_statx = (int (*)(int, const char *, int, unsigned int, struct statx *))dlsym(
+            RTLD_NEXT, "statx");
+    }
+    delay(path);
+    return real_statx(dir_fd, path, flags, mask, stx);
+}
+EOF
+if ! "${CC:-cc}" -shared -fPIC -o "$TEST_ROOT/slow_stat.so" "$TEST_ROOT/slow_stat.c" -ldl; then
+    echo "Error: Cannot build the fstatat shim" >&2
+    exit 1
+fi
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+printf 'hello' > a
+printf 'world' > b
+printf 'late' > slow
+
+# now_ms: wall-clock time in milliseconds
+now_ms() {
+    date +%s%3N
+}
+
+# A deadline that is not reached leaves the listing as it is
+expect_listing "a b slow" --deadline=5000 .
+run -l .
+FULL=$OUT
+run -l --deadline=5000 .
+expect_eq "--deadline not reached exit status" 0 "$STATUS"
+expect_eq "--deadline not reached" "$FULL" "$OUT"
+
+# A hung stat is left behind: every entry is listed, the late one with '?'
+START=$(now_ms)
+STATUS=0
+LD_PRELOAD=$TEST_ROOT/slow_stat.so "$LISTER" -l --deadline=300 . \
+    > "$TEST_ROOT/stdout" 2> "$TEST_ROOT/stderr" || STATUS=$?
+ELAPSED=$(( $(now_ms) - START ))
+OUT=$(cat "$TEST_ROOT/stdout")
+ERR=$(cat "$TEST_ROOT/stderr")
+expect_eq "--deadline passed exit status" 1 "$STATUS"
+expect_match "--deadline warning" "^Warning: --deadline of 300 ms passed; [1-3] entries" "$ERR"
+expect_eq "rows past the deadline" 3 "$(printf '%s\n' "$OUT" | wc -l)"
+expect_match "entry after the deadline" "^\\?+ .* slow\$" "$OUT"
+# Entries queued behind the hung stat on the same worker may be late too, but
+# none that arrived is shown as '?'
+expect_eq "entries shown with metadata" "" \
+    "$(printf '%s\n' "$OUT" | grep -v '^-rw-r--r-- .* 5 .* [ab]$' | grep -v '^?' || true)"
+if [ "$ELAPSED" -ge 2500 ]; then
+    fail "--deadline=300 took $ELAPSED ms against a 3 s stat"
+fi
+
+# A --where test that needs late metadata keeps the entry rather than guess
+# (entries queued behind the hung stat on the same worker are kept too)
+STATUS=0
+LD_PRELOAD=$TEST_ROOT/slow_stat.so "$LISTER" --where='size>100' --deadline=300 . \
+    > "$TEST_ROOT/stdout" 2> /dev/null || STATUS=$?
+expect_eq "--where past the deadline exit status" 1 "$STATUS"
+expect_match "--where past the deadline" "(^| )slow\$" "$(words "$(cat "$TEST_ROOT/stdout")")"
+
+expect_error "--deadline must be a positive number" --deadline=0 -l .
+expect_error "--deadline must be a positive number" --deadline=soon -l .
+
+finish
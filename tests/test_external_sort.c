@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "external_sort/external_sort.h"
+
+/*
+ * External sort test.
+ *
+ * Feeds N synthetic names through an ExternalSort under small --mem-limit
+ * budgets and checks that the number of spilled runs follows the budget
+ * (about N / entries-per-budget, not one run per entry), and that the merged
+ * output holds every name exactly once, in order.
+ */
+
+#define ENTRY_COUNT 100000
+
+static int g_failed = 0;
+
+#define CHECK(condition, ...)                                  \
+    do {                                                       \
+        if (!(condition)) {                                    \
+            printf("FAIL: test_external_sort: " __VA_ARGS__);  \
+            printf("\n");                                      \
+            g_failed = 1;                                      \
+        }                                                      \
+    } while (0)
+
+/**
+ * @brief Sort ENTRY_COUNT names in a scrambled order within a budget
+ *
+ * @param dir_path Directory the sorter stats in (empty; nothing is stat'ed)
+ * @param mem_limit Budget in bytes
+ * @param unsorted Keep insertion order (-U) instead of sorting
+ * @param max_spills Most runs the budget should need
+ */
+static void check_budget(const char *dir_path, size_t mem_limit, int unsorted, int max_spills) {
+    ExternalSort sorter;
+    if (external_sort_init(&sorter, dir_path, NULL, SORT_MODE_ALPHA, 0, unsorted,
+                           mem_limit) != 0) {
+        CHECK(0, "external_sort_init(%zu) failed", mem_limit);
+        return;
+    }
+
+    // Multiplying by a number coprime with ENTRY_COUNT visits every index once
+    char name[32];
+    int add_status = 0;
+    for (long i = 0; i < ENTRY_COUNT && add_status == 0; i++) {
+        long scrambled = unsorted ? i : (i * 7919) % ENTRY_COUNT;
+        snprintf(name, sizeof(name), "entry-%06ld", scrambled);
+        add_status = external_sort_add(name, 0, (ino_t)(i + 1), &sorter);
+    }
+    CHECK(add_status == 0, "external_sort_add failed under %zu bytes", mem_limit);
+    CHECK(external_sort_finish(&sorter) == 0, "external_sort_finish failed");
+
+    // Runs are written only when a budget's worth of entries is buffered
+    CHECK(sorter.spill_count >= 2 && sorter.spill_count <= max_spills,
+          "%d runs for %d entries under %zu bytes, expected 2 to %d", sorter.spill_count,
+          ENTRY_COUNT, mem_limit, max_spills);
+
+    ExternalEntry entry;
+    char expected[32];
+    long count = 0;
+    int status;
+    while ((status = external_sort_next(&sorter, &entry)) == 1) {
+        snprintf(expected, sizeof(expected), "entry-%06ld", count);
+        if (strcmp(entry.name, expected) != 0) {
+            break;
+        }
+        count++;
+    }
+    CHECK(status >= 0, "merge failed after %ld entries", count);
+    CHECK(status != 1, "entry %ld is %s, expected %s (budget %zu)", count, entry.name,
+          expected, mem_limit);
+    CHECK(status != 0 || count == ENTRY_COUNT, "merged %ld entries, expected %d", count,
+          ENTRY_COUNT);
+    external_sort_close(&sorter);
+}
+
+int main(void) {
+    char dir_path[] = "/tmp/lister-external-sort-XXXXXX";
+    if (mkdtemp(dir_path) == NULL) {
+        printf("FAIL: test_external_sort: cannot create a temporary directory\n");
+        return 1;
+    }
+
+    // ~72 bytes per entry: 64K holds ~900 entries per run, 1M ~14500
+    check_budget(dir_path, 64 * 1024, 0, ENTRY_COUNT / 500);
+    check_budget(dir_path, 1024 * 1024, 0, 10);
+    check_budget(dir_path, 64 * 1024, 1, ENTRY_COUNT / 500);
+
+    rmdir(dir_path);
+    if (g_failed) {
+        return 1;
+    }
+    printf("PASS: test_external_sort\n");
+    return 0;
+}
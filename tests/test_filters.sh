@@ -0,0 +1,55 @@
+#!/bin/bash
+#
+# Checks --include, --exclude and --where, including filters that match
+# nothing: those print an empty listing and succeed, on the pipelined,
+# serial, paged, --mem-limit and -l paths alike.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/dir"
+echo small > "$WORK/a.log"
+head -c 5000 /dev/zero > "$WORK/b.log"
+echo text > "$WORK/c.txt"
+echo hidden > "$WORK/.h.log"
+
+for mode in --threads=2 --threads=0 --limit=10 --mem-limit=64K; do
+    expect_listing "a.log b.log" "$mode" --include='*.log' "$WORK"
+    expect_listing "a.log c.txt dir" "$mode" --exclude='b*' "$WORK"
+    expect_listing "a.log" "$mode" --include='*.log' --exclude='b*' "$WORK"
+    expect_listing "b.log" "$mode" --where='size>1K && type==f' "$WORK"
+    expect_listing "c.txt dir" "$mode" --where='!(name=="*.log")' "$WORK"
+    expect_listing "dir" "$mode" --where='type==d || name=="zzz"' "$WORK"
+
+    # Nothing matches: an empty listing, not an error
+    expect_listing "" "$mode" --include='zzz*' "$WORK"
+    expect_listing "" "$mode" --where='name=="zzz"' "$WORK"
+    expect_listing "" "$mode" --where='type==p' "$WORK"
+    expect_listing "" "$mode" --where='size>1G' "$WORK"
+done
+
+# -l prints rows only for the entries that pass, and nothing when none do
+run -l --include='*.txt' "$WORK"
+expect_eq "lister -l --include exit status" 0 "$STATUS"
+expect_match "lister -l --include" '^-.* c\.txt$' "$OUT"
+expect_eq "lister -l --include rows" 1 "$(printf '%s\n' "$OUT" | wc -l)"
+for filter in --include='zzz*' --where='type==p' --where='size>1G'; do
+    expect_listing "" -l "$filter" "$WORK"
+    expect_listing "" -U --limit=10 "$filter" "$WORK"
+done
+
+# An empty directory is an empty listing too; a missing one is an error
+mkdir "$WORK/dir/empty"
+expect_listing "" "$WORK/dir/empty"
+expect_listing "" -l "$WORK/dir/empty"
+expect_error "Cannot read directory" "$WORK/missing"
+
+# Malformed and oversized filters are rejected before anything is read
+expect_error "Invalid filter" --where='size>' "$WORK"
+expect_error "nested too deeply" --where="$(printf '!%.0s' $(seq 70))type==f" "$WORK"
+includes=()
+for i in $(seq 33); do
+    includes+=("--include=p$i")
+done
+expect_error "At most 32 --include" "${includes[@]}" "$WORK"
+
+finish
@@ -0,0 +1,59 @@
+#!/bin/bash
+#
+# Checks --history and --history-query, and that the lister_history.sh wrapper
+# records one-off listings but leaves --watch, --connect and --history-query
+# runs alone.
+
+source "$(dirname "$0")/common.sh"
+
+LOG=$TEST_ROOT/history.log
+mkdir "$WORK/d"
+touch "$WORK/d/a" "$WORK/d/b"
+
+# A recorded run still prints its listing, and the log holds the command, the
+# exit code and the output
+expect_listing "a b" --history="$LOG" "$WORK/d"
+expect_error "Cannot read directory" --history="$LOG" "$WORK/missing"
+run --history-query --history="$LOG"
+expect_eq "--history-query exit status" 0 "$STATUS"
+expect_eq "recorded runs" 2 "$(printf '%s\n' "$OUT" | grep -c '^=== \[')"
+expect_match "first command" "^Command: lister $WORK/d\$" "$OUT"
+expect_match "failed run" "^Exit Code: 1\$" "$OUT"
+expect_match "recorded output" "^a +b *\$" "$OUT"
+
+# Ranges select by finish time
+run --history-query=..1d --history="$LOG"
+expect_eq "runs older than a day" "" "$OUT"
+expect_error "--history-query must be" --history-query=yesterday --history="$LOG"
+expect_error "--history cannot be used with --watch" --history="$LOG" --watch "$WORK/d"
+
+# The wrapper, pointed at this build and a log of its own
+WRAPPER_LOG=$TEST_ROOT/wrapper.log
+export LISTER_HISTORY_DIR=$(dirname "$(dirname "$LISTER")")
+export LISTER_BIN=$LISTER
+export LISTER_HISTORY_FILE=$WRAPPER_LOG
+source "$LISTER_HISTORY_DIR/lister_history.sh"
+
+expect_eq "wrapped listing" "a b" "$(words "$(lister "$WORK/d")")"
+expect_eq "wrapped --connect without a server" "a b" \
+    "$(words "$(lister --connect="$TEST_ROOT/none.sock" "$WORK/d")")"
+
+# --history-query reads the wrapper's log and is not recorded itself
+QUERY=$(lister --history-query)
+expect_eq "runs recorded by the wrapper" 1 "$(printf '%s\n' "$QUERY" | grep -c '^=== \[')"
+expect_match "wrapped command" "^Command: lister $WORK/d\$" "$QUERY"
+expect_eq "runs after a query" 1 "$(lister --history-query | grep -c '^=== \[')"
+
+# --watch keeps running under the wrapper instead of failing on --history (the
+# function runs in a subshell, so the watch itself is that subshell's child)
+lister --watch "$WORK/d" > "$TEST_ROOT/watch.out" 2>&1 &
+WATCH_PID=$!
+sleep 0.5
+if kill -0 "$WATCH_PID" 2>/dev/null; then
+    pkill -P "$WATCH_PID" || true
+    wait "$WATCH_PID" 2>/dev/null || true
+else
+    fail "wrapped --watch exited: $(cat "$TEST_ROOT/watch.out")"
+fi
+
+finish
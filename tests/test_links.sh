@@ -0,0 +1,87 @@
+#!/bin/bash
+#
+# Checks how symbolic links are described: by default a link is shown as
+# itself, type l with its own size and "name -> target" in -l; with -L it is
+# shown as its target, and a link that cannot be followed gets a '?' row.
+# Link targets must come out the same, entry for entry, through the pipelined
+# reader, serially and under --mem-limit.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+printf 'abc' > f
+mkdir dir
+ln -s f lf
+ln -s dir ldir
+ln -s lf chain
+ln -s nowhere dangling
+ln -s loop loop
+LONG_TARGET=$(printf 'x%.0s' $(seq 1 300))
+ln -s "$LONG_TARGET" longlink
+ln -s "../d/f" relative
+
+# rows ARGS...: "mode size name" for every row of lister -l ARGS, joined by '|';
+# '?' rows are kept as they are
+rows() {
+    run -l "$@" .
+    expect_eq "lister -l $* exit status" 0 "$STATUS"
+    printf '%s\n' "$OUT" | awk '
+        $2 == "?" { print $1, $NF; next }
+        {
+            name = $0
+            for (i = 0; i < 8; i++) sub(/^[^ ]+ +/, "", name)
+            print $1, $5, name
+        }' | paste -sd '|'
+}
+
+expect_eq "-l" "lrwxrwxrwx 2 chain -> lf|lrwxrwxrwx 7 dangling -> nowhere|drwxr-xr-x $(stat -c %s dir) dir|-rw-r--r-- 3 f|lrwxrwxrwx 3 ldir -> dir|lrwxrwxrwx 1 lf -> f|lrwxrwxrwx 300 longlink -> $LONG_TARGET|lrwxrwxrwx 4 loop -> loop|lrwxrwxrwx 6 relative -> ../d/f" \
+    "$(rows)"
+expect_eq "-lL" "-rw-r--r-- 3 chain|?????????? dangling|drwxr-xr-x $(stat -c %s dir) dir|-rw-r--r-- 3 f|drwxr-xr-x $(stat -c %s dir) ldir|-rw-r--r-- 3 lf|?????????? longlink|?????????? loop|-rw-r--r-- 3 relative" \
+    "$(rows -L)"
+
+# Links are sorted by their own time without -L and by their target's with it
+mkdir "$WORK/t"
+printf 'abc' > "$WORK/t/f"
+ln -s f "$WORK/t/lf"
+touch -d '2020-01-01' "$WORK/t/f"
+touch -h -d '2024-01-01' "$WORK/t/lf"
+run -lt "$WORK/t"
+expect_eq "-lt" "lf f" "$(printf '%s\n' "$OUT" | awk '{ print $9 }' | paste -sd ' ')"
+run -ltL "$WORK/t"
+expect_eq "-ltL" "f lf" "$(printf '%s\n' "$OUT" | awk '{ print $9 }' | paste -sd ' ')"
+
+# Without -l a link is listed by name either way, dangling or not
+for args in "" "-L"; do
+    # shellcheck disable=SC2086
+    run $args .
+    expect_eq "lister $args exit status" 0 "$STATUS"
+    expect_eq "lister $args names" "chain dangling dir f ldir lf longlink loop relative" \
+        "$(words "$OUT" | tr ' ' '\n' | LC_ALL=C sort | paste -sd ' ')"
+done
+
+# A link-heavy directory: every row keeps its own target on every path
+mkdir "$WORK/many"
+cd "$WORK/many"
+for i in $(seq 1 3000); do
+    ln -s "target_$i" "link_$i"
+done
+cd "$WORK/d"
+run -l --threads=0 "$WORK/many"
+SERIAL=$OUT
+BAD=$(printf '%s\n' "$SERIAL" | awk '{ n = $(NF - 2); t = $NF; sub(/^link_/, "", n); sub(/^target_/, "", t); if (n != t) print }' | wc -l)
+expect_eq "link targets" 0 "$BAD"
+expect_eq "link rows" 3000 "$(printf '%s\n' "$SERIAL" | grep -c -- ' -> target_')"
+for args in "--threads=1" "--threads=8" "--mem-limit=64K"; do
+    run -l "$args" "$WORK/many"
+    if [ "$OUT" != "$SERIAL" ]; then
+        fail "lister -l $args differs from --threads=0"
+    fi
+done
+run -lL --threads=0 "$WORK/many"
+SERIAL=$OUT
+expect_eq "-lL dangling rows" 3000 "$(printf '%s\n' "$SERIAL" | grep -c '^??????????')"
+run -lL --threads=8 "$WORK/many"
+expect_eq "-lL pipelined" "$SERIAL" "$OUT"
+
+finish
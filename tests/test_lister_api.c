@@ -0,0 +1,210 @@
+#define _DEFAULT_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lister.h"
+
+/*
+ * liblister API test.
+ *
+ * Linked against lib/liblister.so with only lister.h on the include path, so
+ * it sees exactly what an embedding program sees. Drives lister_open(),
+ * lister_next() and lister_close() over a small directory in every order,
+ * with filters and a counting allocator, and checks the entries, their
+ * metadata and the rows lister_format_long() produces.
+ */
+
+static int g_failed = 0;
+
+#define CHECK(condition, ...)                               \
+    do {                                                    \
+        if (!(condition)) {                                 \
+            printf("FAIL: test_lister_api: " __VA_ARGS__);  \
+            printf("\n");                                   \
+            g_failed = 1;                                   \
+        }                                                   \
+    } while (0)
+
+/**
+ * @brief Allocator that counts the blocks it has handed out and not taken back
+ */
+static void *counting_allocate(size_t size, void *context) {
+    (*(long *)context)++;
+    return malloc(size);
+}
+
+static void counting_release(void *ptr, void *context) {
+    if (ptr != NULL) {
+        (*(long *)context)--;
+    }
+    free(ptr);
+}
+
+/**
+ * @brief Create a file of the given size, mode and modification time
+ */
+static void make_file(const char *dir_path, const char *name, size_t size, time_t mtime) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir_path, name);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        CHECK(0, "cannot create %s", path);
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        fputc('x', file);
+    }
+    fclose(file);
+    chmod(path, 0644);
+    struct timespec times[2] = {{mtime, 0}, {mtime, 0}};
+    utimensat(AT_FDCWD, path, times, 0);
+}
+
+/**
+ * @brief List a directory and join the names with spaces
+ *
+ * @return int Number of entries, or -1 if lister_open() failed
+ */
+static int list_names(const char *dir_path, const ListerOptions *options, char *names,
+                      size_t names_size) {
+    names[0] = '\0';
+    ListerDir *dir = lister_open(dir_path, options, NULL);
+    if (dir == NULL) {
+        return -1;
+    }
+    int count = 0;
+    const ListerEntry *entry;
+    while ((entry = lister_next(dir)) != NULL) {
+        if (count > 0) {
+            strncat(names, " ", names_size - strlen(names) - 1);
+        }
+        strncat(names, lister_entry_name(entry), names_size - strlen(names) - 1);
+        count++;
+    }
+    lister_close(dir);
+    return count;
+}
+
+static void check_names(const char *dir_path, ListerOrder order, int reverse, int show_all,
+                        const char *where, const char *expected) {
+    ListerOptions options = {show_all, order, reverse, where};
+    char names[1024];
+    int count = list_names(dir_path, &options, names, sizeof(names));
+    CHECK(count >= 0, "lister_open(order %d, where %s) failed", (int)order,
+          where != NULL ? where : "-");
+    CHECK(strcmp(names, expected) == 0, "order %d reverse %d all %d where %s: got '%s', "
+          "expected '%s'", (int)order, reverse, show_all, where != NULL ? where : "-", names,
+          expected);
+}
+
+int main(void) {
+    char dir_path[] = "/tmp/lister-api-XXXXXX";
+    if (mkdtemp(dir_path) == NULL) {
+        printf("FAIL: test_lister_api: cannot create a temporary directory\n");
+        return 1;
+    }
+
+    make_file(dir_path, "b.txt", 100, 1500000000);
+    make_file(dir_path, "a.txt", 5000, 1600000000);
+    make_file(dir_path, "c.log", 0, 1400000000);
+    make_file(dir_path, ".hidden", 1, 1300000000);
+    char sub_path[4096];
+    snprintf(sub_path, sizeof(sub_path), "%s/sub", dir_path);
+    mkdir(sub_path, 0755);
+    struct timespec sub_times[2] = {{1700000000, 0}, {1700000000, 0}};
+    utimensat(AT_FDCWD, sub_path, sub_times, 0);
+
+    // Orders, hidden entries and filters
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 0, NULL, "a.txt b.txt c.log sub");
+    check_names(dir_path, LISTER_ORDER_NAME, 1, 0, NULL, "sub c.log b.txt a.txt");
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 1, NULL, ".hidden a.txt b.txt c.log sub");
+    check_names(dir_path, LISTER_ORDER_MTIME, 0, 0, NULL, "sub a.txt b.txt c.log");
+    check_names(dir_path, LISTER_ORDER_MTIME, 1, 0, NULL, "c.log b.txt a.txt sub");
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 0, "type==f", "a.txt b.txt c.log");
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 0, "size>1K && type==f", "a.txt");
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 0, "name==\"*.txt\" && size<1K", "b.txt");
+    check_names(dir_path, LISTER_ORDER_NAME, 0, 0, "type==p", "");
+
+    // Directory order yields the same entries, one reused slot at a time
+    ListerOptions streamed = {0, LISTER_ORDER_DIRECTORY, 0, NULL};
+    char names[1024];
+    CHECK(list_names(dir_path, &streamed, names, sizeof(names)) == 4,
+          "directory order yielded '%s', expected 4 entries", names);
+
+    // Metadata and long-format rows
+    ListerOptions by_name = {0, LISTER_ORDER_NAME, 0, NULL};
+    long outstanding = 0;
+    ListerAllocator allocator = {counting_allocate, counting_release, &outstanding};
+    ListerDir *dir = lister_open(dir_path, &by_name, &allocator);
+    CHECK(dir != NULL, "lister_open with an allocator failed");
+    const ListerEntry *entry = dir != NULL ? lister_next(dir) : NULL;
+    CHECK(entry != NULL && strcmp(lister_entry_name(entry), "a.txt") == 0,
+          "first entry is not a.txt");
+    if (entry != NULL) {
+        CHECK(lister_entry_type(entry) == DT_REG || lister_entry_type(entry) == DT_UNKNOWN,
+              "a.txt has type %d", lister_entry_type(entry));
+        const struct stat *stat_info = lister_entry_stat(dir, entry);
+        CHECK(stat_info != NULL && stat_info->st_size == 5000 &&
+              stat_info->st_mtime == 1600000000, "a.txt metadata is wrong");
+
+        char row[512];
+        int length = lister_format_long(dir, entry, NULL, row, sizeof(row));
+        CHECK(length == (int)strlen(row), "row length %d for '%s'", length, row);
+        CHECK(strncmp(row, "-rw-r--r-- 1 ", 13) == 0, "row '%s' has the wrong mode or links",
+              row);
+        CHECK(strstr(row, " 5000 ") != NULL, "row '%s' has no size", row);
+        CHECK(length >= 6 && strcmp(row + length - 6, " a.txt") == 0,
+              "row '%s' does not end with the name", row);
+
+        ListerFormat format = {1, 3, 0, 0, 6};
+        lister_format_long(dir, entry, &format, row, sizeof(row));
+        CHECK(strncmp(row, "-rw-r--r--   1 ", 15) == 0, "padded row '%s'", row);
+        CHECK(strstr(row, "   4.9K ") != NULL, "human-readable row '%s'", row);
+
+        char small[8];
+        length = lister_format_long(dir, entry, NULL, small, sizeof(small));
+        CHECK(length > (int)sizeof(small) && strlen(small) == sizeof(small) - 1,
+              "truncated row returned %d", length);
+    }
+    while (dir != NULL && lister_next(dir) != NULL) {
+    }
+    lister_close(dir);
+    CHECK(outstanding == 0, "%ld allocations were not released", outstanding);
+
+    char size[16];
+    lister_format_size(1536, size, sizeof(size));
+    CHECK(strcmp(size, "1.5K") == 0, "lister_format_size(1536) is '%s'", size);
+
+    // Errors
+    char missing[4096];
+    snprintf(missing, sizeof(missing), "%s/missing", dir_path);
+    errno = 0;
+    CHECK(lister_open(missing, NULL, NULL) == NULL && errno == ENOENT,
+          "opening a missing directory did not fail with ENOENT");
+    ListerOptions bad_filter = {0, LISTER_ORDER_NAME, 0, "size>"};
+    errno = 0;
+    CHECK(lister_open(dir_path, &bad_filter, NULL) == NULL && errno == EINVAL,
+          "a malformed filter did not fail with EINVAL");
+
+    const char *names_to_remove[] = {"a.txt", "b.txt", "c.log", ".hidden"};
+    for (size_t i = 0; i < sizeof(names_to_remove) / sizeof(names_to_remove[0]); i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, names_to_remove[i]);
+        unlink(path);
+    }
+    rmdir(sub_path);
+    rmdir(dir_path);
+
+    if (g_failed) {
+        return 1;
+    }
+    printf("PASS: test_lister_api\n");
+    return 0;
+}
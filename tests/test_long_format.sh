@@ -0,0 +1,71 @@
+#!/bin/bash
+#
+# Checks the long-format rows for every combination of -h, -s and -n: the
+# columns, their alignment, the "total" line and symbolic link targets, plus
+# the optional --count-children and -Z columns.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+head -c 1536 /dev/zero > a
+head -c 2000000 /dev/zero > big
+ln -s a link
+touch -d '2020-01-02 03:04' a big
+touch -h -d '2020-01-02 03:04' link
+
+OWNER=$(id -un)
+GROUP=$(id -gn)
+OWNER_ID=$(id -u)
+GROUP_ID=$(id -g)
+DATE="Jan  2 03:04"
+
+# rows ARGS...: the rows of lister ARGS joined by '|'
+rows() {
+    run "$@" .
+    expect_eq "lister $* exit status" 0 "$STATUS"
+    printf '%s\n' "$OUT" | paste -sd '|'
+}
+
+# blocks NAME: size of regular file NAME in 512-byte blocks, as -s shows it
+blocks() {
+    echo $(( ($(stat -c %s "$1") + 511) / 512 ))
+}
+
+expect_eq "-l" "-rw-r--r-- 1 $OWNER $GROUP    1536 $DATE a|-rw-r--r-- 1 $OWNER $GROUP 2000000 $DATE big|lrwxrwxrwx 1 $OWNER $GROUP       1 $DATE link -> a" \
+    "$(rows -l)"
+expect_eq "-lh" "-rw-r--r-- 1 $OWNER $GROUP 1.5K $DATE a|-rw-r--r-- 1 $OWNER $GROUP 1.9M $DATE big|lrwxrwxrwx 1 $OWNER $GROUP   1B $DATE link -> a" \
+    "$(rows -lh)"
+expect_eq "-n" "$(rows -l | sed "s/ $OWNER $GROUP / $OWNER_ID $GROUP_ID /g")" "$(rows -n)"
+expect_eq "-lhn" "$(rows -lh | sed "s/ $OWNER $GROUP / $OWNER_ID $GROUP_ID /g")" "$(rows -lhn)"
+
+# -s puts the block counts first, right-aligned, after a total line; links and
+# directories count 0
+BLOCKS_A=$(blocks a)
+BLOCKS_BIG=$(blocks big)
+BLOCKS_LINK=0
+WIDTH=${#BLOCKS_BIG}
+for flags in -ls -lhs -lns -lhns; do
+    plain=${flags/s/}
+    expected=$(run "$plain" .; printf '%s\n' "$OUT" | paste - <(printf '%s\n' \
+        "$BLOCKS_A" "$BLOCKS_BIG" "$BLOCKS_LINK") | \
+        awk -F '\t' -v width="$WIDTH" '{ printf "%*s %s\n", width, $2, $1 }' | paste -sd '|')
+    expect_eq "$flags" "total $(( BLOCKS_A + BLOCKS_BIG + BLOCKS_LINK ))|$expected" "$(rows "$flags")"
+done
+
+# Optional columns sit between the size and the date, or after the group
+mkdir sub
+touch sub/x sub/y
+touch -d '2020-01-02 03:04' sub
+run -l --count-children .
+expect_match "--count-children file" "^-rw-r--r-- .* 1536 - $DATE a\$" "$OUT"
+expect_match "--count-children directory" "^drwxr-xr-x .* [0-9]+ 2 $DATE sub\$" "$OUT"
+run -lZ .
+expect_match "-Z" "^-rw-r--r--[+.]? 1 $OWNER $GROUP [^ ]+ +1536 $DATE a\$" "$OUT"
+
+# Every row of a listing lines up: the names start in the same column
+run -lhs --count-children .
+expect_eq "name column" 1 "$(printf '%s\n' "$OUT" | tail -n +2 | \
+    sed 's/ -> .*//' | awk '{ print length($0) - length($NF) }' | sort -u | wc -l)"
+
+finish
@@ -0,0 +1,34 @@
+#!/bin/bash
+#
+# Checks --mem-limit: a listing too large for the budget is spilled, merged
+# and rendered exactly like the same listing sorted in memory, for names in
+# columns, -s blocks and long-format rows with every optional column.
+
+source "$(dirname "$0")/common.sh"
+
+# 3000 entries need several 64K runs
+cd "$WORK"
+for i in $(seq -w 1 3000); do
+    echo "$i" > "f$i"
+done
+touch -d '2020-01-01' f0042
+mkdir d1 d2
+touch d1/a d1/b
+ln -s f0001 link
+ln -s nowhere dangling
+
+for mode in "" -l -s -ls -t -lt -ltr -U -lU -lh -ln -L "-l -L" "-l --checksum" \
+            "-l --count-children" "-l --acl" "--where=size<5" "-l --include=f00*"; do
+    run $mode .
+    expected=$OUT
+    run $mode --mem-limit=64K .
+    expect_eq "lister $mode --mem-limit=64K exit status" 0 "$STATUS"
+    if [ "$OUT" != "$expected" ]; then
+        fail "lister $mode --mem-limit=64K differs from the in-memory listing"
+    fi
+done
+
+expect_error "--mem-limit must be a size" --mem-limit=1K .
+expect_error "--mem-limit must be a size" --mem-limit=lots .
+
+finish
@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+# Checks --offset, --limit and --cursor: sorted pages in every order, pages
+# past the end, and -U pages chained through next-cursor tokens that together
+# list every entry exactly once.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d" "$WORK/other"
+cd "$WORK/d"
+touch $(seq -f 'f%03.0f' 1 25)
+# Modification times descending with the name, so -t lists f025 last
+for i in $(seq 1 25); do
+    touch -d "@$(( 1600000000 - i * 3600 ))" "$(printf 'f%03d' "$i")"
+done
+
+# Sorted pages
+expect_listing "f006 f007 f008" --offset=5 --limit=3 .
+expect_listing "f025 f024" -r --limit=2 .
+expect_listing "f001 f002" -t --limit=2 .
+expect_listing "f024 f025" -t --offset=23 .
+expect_listing "f006 f005" -tr --offset=19 --limit=2 .
+expect_listing "f025" --offset=24 --limit=10 .
+expect_listing "" --offset=30 .
+expect_listing "" --limit=0 .
+expect_listing "f006 f007 f008 f009" --include='f00*' --offset=5 .
+run -l --offset=1 --limit=1 .
+expect_match "-l page" "^-.* f002\$" "$OUT"
+expect_eq "-l page rows" 1 "$(printf '%s\n' "$OUT" | wc -l)"
+
+# -U pages chained through cursors cover the directory exactly once
+PAGES=""
+CURSOR=""
+for page in 1 2 3 4; do
+    run -U --limit=10 ${CURSOR:+--cursor="$CURSOR"} .
+    expect_eq "page $page exit status" 0 "$STATUS"
+    PAGES="$PAGES $OUT"
+    CURSOR=$(printf '%s\n' "$ERR" | sed -n 's/^next-cursor: //p')
+    if [ -z "$CURSOR" ]; then
+        break
+    fi
+done
+expect_eq "pages needed" 3 "$page"
+expect_eq "entries over all pages" "$(seq -f 'f%03.0f' 1 25 | paste -sd ' ')" \
+    "$(words "$PAGES" | tr ' ' '\n' | sort | paste -sd ' ')"
+
+# The first page's cursor resumes after its own entries
+run -U --limit=10 .
+FIRST=$(words "$OUT")
+CURSOR=$(printf '%s\n' "$ERR" | sed -n 's/^next-cursor: //p')
+run -U --limit=10 --cursor="$CURSOR" .
+for name in $OUT; do
+    case " $FIRST " in
+        *" $name "*) fail "entry $name repeated on the second page" ;;
+    esac
+done
+
+# Errors
+expect_error "Invalid cursor 'garbage'" -U --limit=2 --cursor=garbage .
+expect_error "--cursor requires unsorted mode" --limit=2 --cursor="$CURSOR" .
+expect_error "--offset must be a number of entries" --offset=-1 .
+run -U --limit=10 --cursor="$CURSOR" "$WORK/other"
+expect_eq "cursor for another directory exit status" 1 "$STATUS"
+
+finish
@@ -0,0 +1,255 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+#include "utils/parallel_sort.h"
+
+/*
+ * Parallel sort test.
+ *
+ * Sorts arrays on both sides of PARALLEL_SORT_THRESHOLD, with many duplicate
+ * keys, already sorted and reversed input, and strings, and checks each
+ * result against qsort(), as well as large name sorts through sort_entries(),
+ * forwards and reversed. Then merges uneven runs with parallel_merge_runs()
+ * and checks that ties keep the earlier run first.
+ */
+
+#define LARGE_COUNT (PARALLEL_SORT_THRESHOLD * 5 + 12345)
+
+static int g_failed = 0;
+
+#define CHECK(condition, ...)                                 \
+    do {                                                      \
+        if (!(condition)) {                                   \
+            printf("FAIL: test_parallel_sort: " __VA_ARGS__); \
+            printf("\n");                                     \
+            g_failed = 1;                                     \
+        }                                                     \
+    } while (0)
+
+typedef struct {
+    uint32_t key;
+    uint32_t origin;
+} Record;
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_uint32_reverse(const void *a, const void *b) {
+    return compare_uint32(b, a);
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int compare_strings_reverse(const void *a, const void *b) {
+    return compare_strings(b, a);
+}
+
+static int compare_record_keys(const void *a, const void *b) {
+    return compare_uint32(&((const Record *)a)->key, &((const Record *)b)->key);
+}
+
+static uint32_t g_seed = 12345;
+
+static uint32_t next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+/**
+ * @brief Sort a copy of values with parallel_sort() and one with qsort(), and compare
+ */
+static void check_against_qsort(const char *what, const uint32_t *values, int count,
+                                SortCompare compare) {
+    uint32_t *expected = (uint32_t *)malloc((size_t)count * sizeof(uint32_t) + 1);
+    uint32_t *actual = (uint32_t *)malloc((size_t)count * sizeof(uint32_t) + 1);
+    if (expected == NULL || actual == NULL) {
+        CHECK(0, "out of memory");
+        free(expected);
+        free(actual);
+        return;
+    }
+    memcpy(expected, values, (size_t)count * sizeof(uint32_t));
+    memcpy(actual, values, (size_t)count * sizeof(uint32_t));
+    qsort(expected, (size_t)count, sizeof(uint32_t), compare);
+    parallel_sort(actual, count, sizeof(uint32_t), compare);
+    CHECK(memcmp(expected, actual, (size_t)count * sizeof(uint32_t)) == 0,
+          "%s (%d elements) differs from qsort()", what, count);
+    free(expected);
+    free(actual);
+}
+
+static void check_integers(void) {
+    uint32_t *values = (uint32_t *)malloc((size_t)LARGE_COUNT * sizeof(uint32_t));
+    if (values == NULL) {
+        CHECK(0, "out of memory");
+        return;
+    }
+
+    const int counts[] = {0, 1, 2, 1000, PARALLEL_SORT_THRESHOLD - 1, PARALLEL_SORT_THRESHOLD,
+                          PARALLEL_SORT_THRESHOLD + 1, LARGE_COUNT};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        for (int i = 0; i < counts[c]; i++) {
+            values[i] = next_random();
+        }
+        check_against_qsort("random", values, counts[c], compare_uint32);
+        check_against_qsort("random, reversed", values, counts[c], compare_uint32_reverse);
+    }
+
+    // Few distinct keys, as in a time sort of files touched together
+    for (int i = 0; i < LARGE_COUNT; i++) {
+        values[i] = next_random() % 7;
+    }
+    check_against_qsort("duplicates", values, LARGE_COUNT, compare_uint32);
+
+    for (int i = 0; i < LARGE_COUNT; i++) {
+        values[i] = (uint32_t)i;
+    }
+    check_against_qsort("sorted", values, LARGE_COUNT, compare_uint32);
+    check_against_qsort("sorted, reversed", values, LARGE_COUNT, compare_uint32_reverse);
+
+    free(values);
+}
+
+static void check_strings(void) {
+    char **names = (char **)malloc((size_t)LARGE_COUNT * sizeof(char *));
+    char *storage = (char *)malloc((size_t)LARGE_COUNT * 16);
+    if (names == NULL || storage == NULL) {
+        CHECK(0, "out of memory");
+        free(names);
+        free(storage);
+        return;
+    }
+    for (int i = 0; i < LARGE_COUNT; i++) {
+        names[i] = storage + (size_t)i * 16;
+        snprintf(names[i], 16, "file_%u", next_random() % 100000);
+    }
+    parallel_sort(names, LARGE_COUNT, sizeof(char *), compare_strings);
+
+    int out_of_order = 0;
+    for (int i = 1; i < LARGE_COUNT; i++) {
+        out_of_order += strcmp(names[i - 1], names[i]) > 0;
+    }
+    CHECK(out_of_order == 0, "%d names out of order", out_of_order);
+
+    // Every name is still there once: the storage slots are a permutation
+    char *seen = (char *)calloc((size_t)LARGE_COUNT, 1);
+    int lost = seen == NULL;
+    for (int i = 0; seen != NULL && i < LARGE_COUNT; i++) {
+        size_t slot = (size_t)(names[i] - storage) / 16;
+        lost |= slot >= (size_t)LARGE_COUNT || seen[slot];
+        if (slot < (size_t)LARGE_COUNT) {
+            seen[slot] = 1;
+        }
+    }
+    CHECK(!lost, "names were lost or duplicated");
+
+    free(seen);
+
+    // sort_entries() orders a large listing as the serial sort would, -r included
+    for (int reverse = 0; reverse <= 1; reverse++) {
+        for (int i = 0; i < LARGE_COUNT; i++) {
+            names[i] = storage + (size_t)(next_random() % LARGE_COUNT) * 16;
+        }
+        char **expected = (char **)malloc((size_t)LARGE_COUNT * sizeof(char *));
+        if (expected == NULL) {
+            CHECK(0, "out of memory");
+            break;
+        }
+        memcpy(expected, names, (size_t)LARGE_COUNT * sizeof(char *));
+        qsort(expected, LARGE_COUNT, sizeof(char *),
+              reverse ? compare_strings_reverse : compare_strings);
+        sort_entries(names, LARGE_COUNT, SORT_MODE_ALPHA, NULL, reverse);
+        int differing = 0;
+        for (int i = 0; i < LARGE_COUNT; i++) {
+            differing += strcmp(names[i], expected[i]) != 0;
+        }
+        CHECK(differing == 0, "sort_entries(reverse=%d) differs from qsort() at %d entries",
+              reverse, differing);
+        free(expected);
+    }
+
+    free(names);
+    free(storage);
+}
+
+static void check_merge_runs(void) {
+    // Runs of very different lengths, with keys shared across runs
+    const int lengths[] = {10, LARGE_COUNT / 2, 1, 0, LARGE_COUNT / 3, 77};
+    const int run_count = (int)(sizeof(lengths) / sizeof(lengths[0]));
+    int starts[sizeof(lengths) / sizeof(lengths[0]) + 1];
+    int count = 0;
+    for (int r = 0; r < run_count; r++) {
+        starts[r] = count;
+        count += lengths[r];
+    }
+    starts[run_count] = count;
+
+    Record *records = (Record *)malloc((size_t)count * sizeof(Record));
+    Record *scratch = (Record *)malloc((size_t)count * sizeof(Record));
+    if (records == NULL || scratch == NULL) {
+        CHECK(0, "out of memory");
+        free(records);
+        free(scratch);
+        return;
+    }
+    for (int r = 0; r < run_count; r++) {
+        for (int i = starts[r]; i < starts[r + 1]; i++) {
+            records[i].key = next_random() % 1000;
+            records[i].origin = (uint32_t)i;
+        }
+        qsort(records + starts[r], (size_t)lengths[r], sizeof(Record), compare_record_keys);
+        // Within a run, equal keys keep their original order too
+        for (int i = starts[r]; i < starts[r + 1]; i++) {
+            records[i].origin = (uint32_t)i;
+        }
+    }
+
+    Record *merged = (Record *)parallel_merge_runs(records, scratch, count, sizeof(Record),
+                                                   starts, run_count, compare_record_keys);
+    CHECK(merged == records || merged == scratch, "the result is in neither buffer");
+
+    int out_of_order = 0;
+    int unstable = 0;
+    char *seen = (char *)calloc((size_t)count, 1);
+    int lost = seen == NULL;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            out_of_order += merged[i - 1].key > merged[i].key;
+            unstable += merged[i - 1].key == merged[i].key &&
+                        merged[i - 1].origin > merged[i].origin;
+        }
+        if (seen != NULL) {
+            lost |= merged[i].origin >= (uint32_t)count || seen[merged[i].origin];
+            if (merged[i].origin < (uint32_t)count) {
+                seen[merged[i].origin] = 1;
+            }
+        }
+    }
+    CHECK(out_of_order == 0, "%d merged records out of order", out_of_order);
+    CHECK(unstable == 0, "%d ties do not keep the earlier run first", unstable);
+    CHECK(!lost, "records were lost or duplicated by the merge");
+
+    free(seen);
+    free(records);
+    free(scratch);
+}
+
+int main(void) {
+    check_integers();
+    check_strings();
+    check_merge_runs();
+
+    if (g_failed) {
+        return 1;
+    }
+    printf("PASS: test_parallel_sort\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# Checks the pipelined reader against the serial one: on a directory spanning
+# many batches, every worker count prints exactly what --threads=0 prints, for
+# long, time-sorted, filtered, reversed and linked listings.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+# 3000 entries of varied size and age, plus links, directories and a hidden file
+for i in $(seq 1 3000); do
+    printf "%$(( i % 97 ))s" "" > "f$i"
+done
+for age in $(seq 0 59); do
+    touch -d "@$(( 1500000000 + age * 7919 % 60 * 3600 ))" $(seq -f 'f%.0f' $(( age + 1 )) 60 3000)
+done
+for i in $(seq 1 50); do
+    ln -s "f$i" "link$i"
+    mkdir "dir$i"
+done
+ln -s missing dangling
+touch .hidden
+
+MODES=(
+    "-l"
+    "-lt"
+    "-ltr"
+    "-la"
+    "-lh"
+    "-ls"
+    "-t"
+    "-lL"
+    "--where=size>50&&type==f"
+    "-l --where=mtime>1d"
+    "-lt --include=f1* --exclude=*0"
+)
+
+# Modes are split into words unquoted; keep their globs away from pathname expansion
+set -f
+for mode in "${MODES[@]}"; do
+    # shellcheck disable=SC2086
+    run $mode --threads=0 .
+    expect_eq "lister $mode --threads=0 exit status" 0 "$STATUS"
+    SERIAL=$OUT
+    for threads in 1 2 16; do
+        # shellcheck disable=SC2086
+        run $mode --threads="$threads" .
+        expect_eq "lister $mode --threads=$threads exit status" 0 "$STATUS"
+        if [ "$OUT" != "$SERIAL" ]; then
+            fail "lister $mode --threads=$threads differs from --threads=0"
+        fi
+    done
+    # shellcheck disable=SC2086
+    run $mode .
+    if [ "$OUT" != "$SERIAL" ]; then
+        fail "lister $mode (automatic workers) differs from --threads=0"
+    fi
+done
+set +f
+
+expect_error "--threads" --threads=17 .
+expect_error "--threads" --threads=-1 .
+expect_error "Cannot read directory" -l --threads=4 "$WORK/missing"
+
+finish
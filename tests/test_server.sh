@@ -0,0 +1,118 @@
+#!/bin/bash
+#
+# Checks --serve and --connect: a served run prints what a standalone run
+# prints, with the client's working directory, environment and exit status;
+# the client does no listing work itself while the server is up and falls
+# back to a local run when it is not; a run whose reader goes away ends with
+# SIGPIPE; and SIGTERM stops the server and removes its socket. Client-side
+# stat calls are recorded by an LD_PRELOAD shim.
+
+source "$(dirname "$0")/common.sh"
+
+cat > "$TEST_ROOT/log_stat.c" << 'EOF'
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int fstatat(int dir_fd, const char *path, struct stat *stat_info, int flags) {
+    static int (*real_fstatat)(int, const char *, struct stat *, int);
+    if (real_fstatat == NULL) {
+        real_fstatat = (int (*)(int, const char *, struct stat *, int))dlsym(RTLD_NEXT, "fstatat");
+    }
+    const char *log_path = getenv("STAT_LOG");
+    int fd = log_path != NULL ? open(log_path, O_WRONLY | O_APPEND | O_CREAT, 0600) : -1;
+    if (fd >= 0) {
+        ssize_t written = write(fd, "stat\n", 5);
+        (void)written;
+        close(fd);
+    }
+    return real_fstatat(dir_fd, path, stat_info, flags);
+}
+EOF
+if ! "${CC:-cc}" -shared -fPIC -o "$TEST_ROOT/log_stat.so" "$TEST_ROOT/log_stat.c" -ldl; then
+    echo "Error: Cannot build the stat logging shim" >&2
+    exit 1
+fi
+
+SOCK=$TEST_ROOT/lister.sock
+"$LISTER" --serve="$SOCK" 2> "$TEST_ROOT/server.err" &
+SERVER_PID=$!
+trap 'kill "$SERVER_PID" 2>/dev/null || true; wait "$SERVER_PID" 2>/dev/null || true; rm -rf "$TEST_ROOT"' EXIT
+for _ in $(seq 1 50); do
+    [ -S "$SOCK" ] && break
+    sleep 0.1
+done
+if [ ! -S "$SOCK" ]; then
+    fail "the server did not create $SOCK: $(cat "$TEST_ROOT/server.err")"
+    finish
+fi
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+touch -d '2020-06-01 12:00 UTC' a b
+mkdir sub
+touch $(seq -f 'sub/f%.0f' 1 5000)
+
+# expect_served WHAT ARGS...: lister --connect ARGS prints and exits exactly as
+# lister ARGS, and the client stats nothing itself
+expect_served() {
+    local what=$1
+    shift
+    run "$@"
+    local status=$STATUS out=$OUT err=$ERR
+    rm -f "$TEST_ROOT/stat.log"
+    STATUS=0
+    STAT_LOG=$TEST_ROOT/stat.log LD_PRELOAD=$TEST_ROOT/log_stat.so \
+        "$LISTER" --connect="$SOCK" "$@" > "$TEST_ROOT/stdout" 2> "$TEST_ROOT/stderr" || STATUS=$?
+    expect_eq "$what exit status" "$status" "$STATUS"
+    expect_eq "$what stdout" "$out" "$(cat "$TEST_ROOT/stdout")"
+    expect_eq "$what stderr" "$err" "$(cat "$TEST_ROOT/stderr")"
+    if [ -s "$TEST_ROOT/stat.log" ]; then
+        fail "$what: the client stat'ed entries itself"
+    fi
+}
+
+expect_served "relative listing" -l .
+expect_served "time sort" -lt
+expect_served "filtered listing" -l --where='type==d' .
+expect_served "large listing" -U sub
+expect_served "summary" --summary=ext sub
+expect_served "missing directory" -l missing
+expect_served "bad option value" --threads=99 .
+
+# The client's environment decides, not the server's
+TZ=UTC expect_served "TZ=UTC" -l .
+TZ=Asia/Tokyo expect_served "TZ=Asia/Tokyo" -l .
+expect_match "client time zone" "Jun  1 21:00 a\$" "$(TZ=Asia/Tokyo "$LISTER" --connect="$SOCK" -l .)"
+
+# A reader that goes away ends the run with SIGPIPE, as it would standalone
+"$LISTER" --connect="$SOCK" -lU sub | head -n 1 > /dev/null && STATUS=0 || STATUS=${PIPESTATUS[0]}
+expect_eq "closed pipe exit status" 141 "$STATUS"
+expect_served "after a closed pipe" -l .
+
+# SIGTERM stops the server and removes the socket
+kill -TERM "$SERVER_PID"
+STATUS=0
+wait "$SERVER_PID" || STATUS=$?
+expect_eq "server exit status" 0 "$STATUS"
+if [ -e "$SOCK" ]; then
+    fail "the socket was left behind"
+fi
+
+# Without a server the client lists on its own
+rm -f "$TEST_ROOT/stat.log"
+OUT=$(STAT_LOG=$TEST_ROOT/stat.log LD_PRELOAD=$TEST_ROOT/log_stat.so \
+    "$LISTER" --connect="$SOCK" -l .)
+expect_eq "fallback listing" "$("$LISTER" -l .)" "$OUT"
+if [ ! -s "$TEST_ROOT/stat.log" ]; then
+    fail "the fallback run did not stat anything"
+fi
+
+expect_error "--serve needs a socket path" --serve= .
+expect_error "--serve cannot be used with --connect" --serve="$SOCK" --connect="$SOCK" .
+
+finish
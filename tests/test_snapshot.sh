@@ -0,0 +1,56 @@
+#!/bin/bash
+#
+# Checks --snapshot-out and --since: added, removed and modified entries are
+# reported, also when the directory has been emptied or filtered to nothing,
+# and writing a snapshot leaves the listing in its own (-U or -t) order.
+
+source "$(dirname "$0")/common.sh"
+
+SNAP=$TEST_ROOT/listing.snap
+mkdir "$WORK/d"
+cd "$WORK/d"
+echo a > a
+echo b > b
+echo c > c
+touch -d '2020-01-01' a
+touch -d '2021-01-01' c
+touch -d '2022-01-01' b
+
+# Writing a snapshot still prints the listing, in the order asked for
+expect_listing "a b c" --snapshot-out="$SNAP" .
+run -U .
+expect_listing "$(words "$OUT")" -U --snapshot-out="$SNAP" .
+expect_listing "b c a" -t --snapshot-out="$SNAP" .
+expect_listing "a c b" -tr --snapshot-out="$SNAP" .
+
+# Only the differences are printed against a snapshot
+rm a
+echo more >> b
+echo d > d
+run --since="$SNAP" .
+expect_eq "--since exit status" 0 "$STATUS"
+expect_eq "--since" "- a|M b|+ d" "$(printf '%s\n' "$OUT" | paste -sd '|')"
+
+# Diffing and refreshing in one run; afterwards there are no differences
+expect_listing "- a M b + d" --since="$SNAP" --snapshot-out="$SNAP" .
+expect_listing "" --since="$SNAP" .
+
+# Filtered to nothing or emptied: every recorded entry is reported removed
+run --since="$SNAP" --include='zzz*' .
+expect_eq "--since filtered to nothing" "- b|- c|- d" "$(printf '%s\n' "$OUT" | paste -sd '|')"
+rm b c d
+run --since="$SNAP" .
+expect_eq "--since exit status after emptying" 0 "$STATUS"
+expect_eq "--since after emptying" "- b|- c|- d" "$(printf '%s\n' "$OUT" | paste -sd '|')"
+
+# An empty directory makes a valid, empty snapshot
+expect_listing "" --snapshot-out="$SNAP" .
+echo e > e
+expect_listing "+ e" --since="$SNAP" .
+
+# Missing and corrupt snapshots are rejected
+expect_error "Cannot read snapshot" --since="$TEST_ROOT/missing.snap" .
+head -c 20 "$SNAP" > "$TEST_ROOT/short.snap"
+expect_error "Cannot read snapshot" --since="$TEST_ROOT/short.snap" .
+
+finish
@@ -0,0 +1,99 @@
+#!/bin/bash
+#
+# Checks that metadata passes stat entries in ascending inode order, serially
+# and on the pipeline, that LISTER_STAT_ORDER=readdir keeps listing order,
+# and that the order never changes the output. The stat calls are recorded by
+# an LD_PRELOAD shim that logs the names given to fstatat() and statx().
+
+source "$(dirname "$0")/common.sh"
+
+cat > "$TEST_ROOT/log_stat.c" << 'EOF'
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void log_name(const char *path) {
+    const char *log_path = getenv("STAT_LOG");
+    if (log_path == NULL || path[0] == '\0' || path[0] == '/' || strcmp(path, ".") == 0) {
+        return;
+    }
+    int fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (fd >= 0) {
+        char line[4096];
+        size_t length = strlen(path) < sizeof(line) - 1 ? strlen(path) : sizeof(line) - 2;
+        memcpy(line, path, length);
+        line[length] = '\n';
+        ssize_t written = write(fd, line, length + 1);
+        (void)written;
+        close(fd);
+    }
+}
+
+int fstatat(int dir_fd, const char *path, struct stat *stat_info, int flags) {
+    static int (*real_fstatat)(int, const char *, struct stat *, int);
+    if (real_fstatat == NULL) {
+        real_fstatat = (int (*)(int, const char *, struct stat *, int))dlsym(RTLD_NEXT, "fstatat");
+    }
+    log_name(path);
+    return real_fstatat(dir_fd, path, stat_info, flags);
+}
+
+int statx(int dir_fd, const char *path, int flags, unsigned int mask, struct statx *stx) {
+    static int (*real_statx)(int, const char *, int, unsigned int, struct statx *);
+    if (real_statx == NULL) {
+        real_statx = (int (*)(int, const char *, int, unsigned int, struct statx *))dlsym(
+            RTLD_NEXT, "statx");
+    }
+    log_name(path);
+    return real_statx(dir_fd, path, flags, mask, stx);
+}
+EOF
+if ! "${CC:-cc}" -shared -fPIC -o "$TEST_ROOT/log_stat.so" "$TEST_ROOT/log_stat.c" -ldl; then
+    echo "Error: Cannot build the stat logging shim" >&2
+    exit 1
+fi
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+touch $(seq -f 'f%03.0f' 1 100)
+
+INODE_ORDER=$(ls -i | sort -n | awk '{ print $2 }' | paste -sd ' ')
+READDIR_ORDER=$("$LISTER" -lU . | awk '{ print $NF }' | paste -sd ' ')
+if [ "$INODE_ORDER" = "$READDIR_ORDER" ]; then
+    echo "Warning: readdir order is inode order here; only the output is compared" >&2
+fi
+
+# stat_order ARGS...: names stat'ed by lister ARGS, in order (each name once)
+stat_order() {
+    rm -f "$TEST_ROOT/stat.log"
+    STAT_LOG=$TEST_ROOT/stat.log LD_PRELOAD=$TEST_ROOT/log_stat.so "$LISTER" "$@" . > /dev/null
+    awk '!seen[$0]++' "$TEST_ROOT/stat.log" | paste -sd ' '
+}
+
+expect_eq "-l --threads=0" "$INODE_ORDER" "$(stat_order -l --threads=0)"
+expect_eq "-t --threads=0" "$INODE_ORDER" "$(stat_order -t --threads=0)"
+expect_eq "--where --threads=0" "$INODE_ORDER" "$(stat_order --where='size<1' --threads=0)"
+expect_eq "-l --threads=1" "$INODE_ORDER" "$(stat_order -l --threads=1)"
+expect_eq "-lU --threads=0" "$INODE_ORDER" "$(stat_order -lU --threads=0)"
+
+# LISTER_STAT_ORDER=readdir stats in listing order: directory order with -U
+expect_eq "LISTER_STAT_ORDER=readdir -lU" "$READDIR_ORDER" \
+    "$(LISTER_STAT_ORDER=readdir stat_order -lU --threads=0)"
+expect_eq "LISTER_STAT_ORDER=readdir -l" "$(seq -f 'f%03.0f' 1 100 | paste -sd ' ')" \
+    "$(LISTER_STAT_ORDER=readdir stat_order -l --threads=0)"
+
+# The order only changes when entries are stat'ed, never what is printed
+for flags in -l -lt -ls; do
+    run "$flags" --threads=0 .
+    INODE_OUT=$OUT
+    LISTER_STAT_ORDER=readdir run "$flags" --threads=0 .
+    expect_eq "lister $flags in either order" "$INODE_OUT" "$OUT"
+    run "$flags" .
+    expect_eq "lister $flags pipelined" "$INODE_OUT" "$OUT"
+done
+
+finish
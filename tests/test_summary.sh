@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# Checks --summary: entry counts and byte totals per owner, group, extension
+# and age bucket, the order of the groups, the total line, -h, and the
+# options that decide which entries count.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+printf '%100s' '' > a.txt
+printf '%200s' '' > b.txt
+printf '%5000s' '' > c.log
+printf '%7s' '' > archive.tar.gz
+printf '%3s' '' > noext
+printf '%1s' '' > .hidden
+NOW=$(date +%s)
+touch -d "@$(( NOW - 2 * 86400 ))" b.txt
+touch -d "@$(( NOW - 10 * 86400 ))" c.log
+touch -d "@$(( NOW - 60 * 86400 ))" archive.tar.gz
+touch -d "@$(( NOW - 200 * 86400 ))" noext
+touch -d "@$(( NOW - 800 * 86400 ))" .hidden
+
+# rows ARGS...: the summary printed by lister --summary ARGS, one "label count
+# size" row per group joined by '|'
+rows() {
+    run "$@" .
+    expect_eq "lister $* exit status" 0 "$STATUS"
+    printf '%s\n' "$OUT" | tail -n +2 | awk '{ print $1, $2, $3 }' | paste -sd '|'
+}
+
+OWNER=$(id -un)
+GROUP=$(id -gn)
+expect_eq "owner" "$OWNER 5 5310|total 5 5310" "$(rows --summary=owner)"
+expect_eq "group" "$GROUP 5 5310|total 5 5310" "$(rows --summary=group)"
+expect_eq "ext" ".log 1 5000|.txt 2 300|.gz 1 7|(none) 1 3|total 5 5310" "$(rows --summary=ext)"
+expect_eq "ext with -a" ".log 1 5000|.txt 2 300|.gz 1 7|(none) 2 4|total 6 5311" \
+    "$(rows --summary=ext -a)"
+expect_eq "age" "<1d 1 100|1d-7d 1 200|7d-30d 1 5000|30d-90d 1 7|90d-1y 1 3|total 5 5310" \
+    "$(rows --summary=age)"
+expect_eq "age with -a" "<1d 1 100|1d-7d 1 200|7d-30d 1 5000|30d-90d 1 7|90d-1y 1 3|>1y 1 1|total 6 5311" \
+    "$(rows --summary=age -a)"
+
+# Header and alignment
+run --summary=ext .
+expect_eq "ext header" "EXT    FILES SIZE" "$(printf '%s\n' "$OUT" | head -n 1)"
+expect_eq "ext total row" "total      5 5310" "$(printf '%s\n' "$OUT" | tail -n 1)"
+expect_eq "-h" ".log 1 4.9K|.txt 2 300B|.gz 1 7B|(none) 1 3B|total 5 5.2K" \
+    "$(rows --summary=ext -h)"
+
+# Filters decide which entries count; an empty result is an empty summary
+expect_eq "--include" ".txt 2 300|total 2 300" "$(rows --summary=ext --include='*.txt')"
+expect_eq "--where" ".log 1 5000|.txt 1 200|total 2 5200" \
+    "$(rows --summary=ext --where='size>150')"
+expect_eq "nothing matches" "total 0 0" "$(rows --summary=owner --include='zzz*')"
+
+# Subdirectories count with their own size
+mkdir sub
+SUB_SIZE=$(stat -c %s sub)
+expect_eq "directory" "(none) 2 $(( SUB_SIZE + 3 ))" \
+    "$(rows --summary=ext | tr '|' '\n' | grep '^(none)')"
+
+expect_error "--summary must be owner, group, ext or age" --summary=size .
+expect_error "Cannot read directory" --summary=owner "$WORK/missing"
+
+finish
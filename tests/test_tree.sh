@@ -0,0 +1,112 @@
+#!/bin/bash
+#
+# Checks --tree: the connectors and nesting, the directory and file counts,
+# --depth, the listing options applied at every level, links to directories
+# shown but not followed, and a deep chain of directories.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir -p "$WORK/r/a/b/c" "$WORK/r/z"
+cd "$WORK/r"
+touch f1 a/f2 a/b/f3 a/b/c/f4 .hidden z/.hidden_too
+ln -s a linkdir
+
+expect_tree() {
+    local what=$1
+    local expected=$2
+    shift 2
+    run --tree "$@" .
+    expect_eq "lister --tree $what exit status" 0 "$STATUS"
+    expect_eq "lister --tree $what" "$expected" "$OUT"
+}
+
+expect_tree "" ".
+├── a
+│   ├── b
+│   │   ├── c
+│   │   │   └── f4
+│   │   └── f3
+│   └── f2
+├── f1
+├── linkdir
+└── z
+
+4 directories, 5 files"
+
+expect_tree "--depth=2" ".
+├── a
+│   ├── b
+│   └── f2
+├── f1
+├── linkdir
+└── z
+
+3 directories, 3 files" --depth=2
+
+expect_tree "-a --depth=1" ".
+├── .hidden
+├── a
+├── f1
+├── linkdir
+└── z
+
+2 directories, 3 files" -a --depth=1
+
+expect_tree "-r --depth=2" ".
+├── z
+├── linkdir
+├── f1
+└── a
+    ├── f2
+    └── b
+
+3 directories, 3 files" -r --depth=2
+
+# -a reaches hidden entries below the top level too
+run --tree -a .
+expect_match "-a nested" "^    └── \\.hidden_too\$" "$OUT"
+
+# Filters apply at every level, directories included
+expect_tree "--include" ".
+└── f1
+
+0 directories, 1 file" --include='f*'
+expect_tree "--where" ".
+├── a
+│   └── b
+│       └── c
+└── z
+
+4 directories, 0 files" --where='type==d'
+
+# -t orders each level by modification time
+touch -d '2020-01-01' f1
+touch -d '2021-01-01' z
+touch -h -d '2022-01-01' linkdir
+touch -d '2023-01-01' a
+expect_tree "-t --depth=1" ".
+├── a
+├── linkdir
+├── z
+└── f1
+
+2 directories, 2 files" -t --depth=1
+
+# A deep chain is walked to the bottom
+DEEP=$WORK/deep
+path=$DEEP
+for _ in $(seq 1 150); do
+    path=$path/d
+done
+mkdir -p "$path"
+touch "$path/leaf"
+run --tree "$DEEP"
+expect_eq "deep tree exit status" 0 "$STATUS"
+expect_eq "deep tree lines" 154 "$(printf '%s\n' "$OUT" | wc -l)"
+expect_eq "deep tree leaf" 1 "$(printf '%s\n' "$OUT" | grep -cE '^ {600}└── leaf$')"
+expect_match "deep tree count" "^150 directories, 1 file\$" "$OUT"
+
+expect_error "--depth must be a positive number" --tree --depth=0 .
+expect_error "Cannot read directory" --tree "$WORK/missing"
+
+finish
@@ -0,0 +1,87 @@
+#!/bin/bash
+#
+# Checks --watch: the listing is printed once, a burst of changes is coalesced
+# into one re-render, later changes update only the affected entries, and
+# removing the directory ends the watch with status 0.
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+touch "$WORK/d/a"
+WATCH_OUT=$TEST_ROOT/watch.out
+
+"$LISTER" -l --watch "$WORK/d" > "$WATCH_OUT" 2> "$TEST_ROOT/watch.err" &
+WATCH_PID=$!
+trap 'kill "$WATCH_PID" 2>/dev/null || true; rm -rf "$TEST_ROOT"' EXIT
+
+# wait_for_lines COUNT: wait up to 5 s for the watch output to reach COUNT lines
+wait_for_lines() {
+    for _ in $(seq 1 50); do
+        if [ "$(wc -l < "$WATCH_OUT")" -ge "$1" ]; then
+            return
+        fi
+        sleep 0.1
+    done
+}
+
+# render N: the Nth rendering of the listing, as "name|name|..."; -l prints
+# one row per entry, so renders are told apart by the running line counts
+# passed as RENDER_ENDS
+render() {
+    local first=$(( ${RENDER_ENDS[$1 - 1]} + 1 ))
+    local last=${RENDER_ENDS[$1]}
+    sed -n "${first},${last}p" "$WATCH_OUT" | awk '{ print $NF }' | paste -sd '|'
+}
+
+wait_for_lines 1
+RENDER_ENDS=(0 1)
+expect_eq "initial listing" "a" "$(render 1)"
+
+# One burst of 100 creations is rendered once, with every entry
+(cd "$WORK/d" && touch $(seq -f 'f%03.0f' 1 100))
+wait_for_lines 102
+sleep 0.3
+expect_eq "lines after a burst" 102 "$(wc -l < "$WATCH_OUT")"
+RENDER_ENDS+=(102)
+expect_eq "burst render" "a|$(seq -f 'f%03.0f' 1 100 | paste -sd '|')" "$(render 2)"
+
+# A removal and a rewrite are picked up
+rm "$WORK/d/a"
+wait_for_lines 202
+sleep 0.3
+RENDER_ENDS+=(202)
+expect_eq "lines after a removal" 202 "$(wc -l < "$WATCH_OUT")"
+expect_eq "render after a removal" "f001" "$(render 3 | cut -d '|' -f 1)"
+printf 'twelve bytes' > "$WORK/d/f050"
+wait_for_lines 302
+expect_match "rewritten entry" "^-.* 12 .* f050\$" "$(tail -n 100 "$WATCH_OUT")"
+
+# expect_watch_ends WHAT: the watch in WATCH_PID exits 0 within 3 s
+expect_watch_ends() {
+    for _ in $(seq 1 30); do
+        kill -0 "$WATCH_PID" 2>/dev/null || break
+        sleep 0.1
+    done
+    if kill -0 "$WATCH_PID" 2>/dev/null; then
+        fail "--watch kept running after $1"
+        kill "$WATCH_PID"
+        return
+    fi
+    STATUS=0
+    wait "$WATCH_PID" || STATUS=$?
+    expect_eq "--watch exit status after $1" 0 "$STATUS"
+}
+
+# Removing the directory ends the watch, also when no entry event announces it
+rm -rf "$WORK/d"
+expect_watch_ends "its directory was removed"
+mkdir "$WORK/empty"
+"$LISTER" --watch "$WORK/empty" > /dev/null 2>&1 &
+WATCH_PID=$!
+sleep 0.2
+rmdir "$WORK/empty"
+expect_watch_ends "its empty directory was removed"
+
+expect_error "Cannot watch directory" --watch "$WORK/missing"
+
+finish
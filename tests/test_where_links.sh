@@ -0,0 +1,27 @@
+#!/bin/bash
+#
+# Checks --where type tests on symbolic links.
+#
+# Without -L a link is type l; with -L it has the type of its target, so a
+# link to a directory passes type==d and a dangling link passes nothing. Each
+# case runs through the pipelined reader and serially (--threads=0).
+
+source "$(dirname "$0")/common.sh"
+
+mkdir "$WORK/d"
+echo data > "$WORK/f"
+ln -s d "$WORK/ld"
+ln -s f "$WORK/lf"
+ln -s nowhere "$WORK/dangling"
+
+for threads in --threads=2 --threads=0; do
+    expect_listing "d" "$threads" --where='type==d' "$WORK"
+    expect_listing "dangling ld lf" "$threads" --where='type==l' "$WORK"
+    expect_listing "f" "$threads" --where='type==f' "$WORK"
+    expect_listing "d ld" "$threads" -L --where='type==d' "$WORK"
+    expect_listing "f lf" "$threads" -L --where='type==f' "$WORK"
+    expect_listing "" "$threads" -L --where='type==l' "$WORK"
+    expect_listing "ld" "$threads" -L --where='type==d && name=="l*"' "$WORK"
+done
+
+finish
@@ -0,0 +1,138 @@
+#!/bin/bash
+#
+# Checks -Z and --acl: the '+' marker for access and default ACLs, the '.'
+# marker and the context column for a security context, '?' for an entry
+# without one, attribute lists too long for the first llistxattr() buffer,
+# links described as themselves or (with -L) their target, and the same rows
+# from the serial and pipelined fetches. Attributes are set with python3;
+# the parts the filesystem (or a non-root user) cannot set are skipped.
+
+source "$(dirname "$0")/common.sh"
+
+if ! command -v python3 > /dev/null; then
+    echo "Skipped: test_xattr.sh needs python3 to set extended attributes"
+    exit 0
+fi
+
+mkdir "$WORK/d"
+cd "$WORK/d"
+touch plain acl context both many
+mkdir default_acl
+ln -s acl link
+CONTEXT=system_u:object_r:tmp_t:s0
+
+# set_xattrs: sets the attributes, printing which kinds could be set
+set_xattrs() {
+    python3 - "$CONTEXT" << 'EOF'
+import os
+import struct
+import sys
+
+def acl(entries):
+    return struct.pack("<I", 2) + b"".join(struct.pack("<HHI", *entry) for entry in entries)
+
+# user::rw-, user:1000:r--, group::r--, mask::r--, other::r--
+ACL = acl([(1, 6, 0xffffffff), (2, 4, 1000), (4, 4, 0xffffffff), (0x10, 4, 0xffffffff),
+           (0x20, 4, 0xffffffff)])
+kinds = set()
+def try_set(path, name, value, kind):
+    try:
+        os.setxattr(path, name, value, follow_symlinks=False)
+        kinds.add(kind)
+    except OSError:
+        pass
+
+try_set("plain", "user.note", b"not an ACL", "user")
+# More names than the first llistxattr() buffer holds
+for i in range(60):
+    try_set("many", "user." + "n" * 30 + str(i), b"v", "user")
+for path in ("acl", "both", "many"):
+    try_set(path, "system.posix_acl_access", ACL, "acl")
+try_set("default_acl", "system.posix_acl_default", ACL, "acl")
+for path in ("context", "both"):
+    try_set(path, "security.selinux", sys.argv[1].encode() + b"\0", "context")
+print(" ".join(sorted(kinds)))
+EOF
+}
+
+KINDS=$(set_xattrs)
+if [ -z "$KINDS" ]; then
+    echo "Skipped: test_xattr.sh: no extended attributes can be set in $TEST_ROOT"
+    finish
+fi
+
+has_kind() {
+    case " $KINDS " in
+        *" $1 "*) return 0 ;;
+        *) return 1 ;;
+    esac
+}
+
+# row ARGS... NAME: "permissions context" (or just the permissions without -Z)
+# of NAME in lister ARGS .
+row() {
+    local name=${*: -1}
+    run "${@:1:$#-1}" .
+    expect_eq "lister ${*:1:$#-1} exit status" 0 "$STATUS"
+    printf '%s\n' "$OUT" | sed 's/ -> .*//' | awk -v name="$name" -v context="${Z_COLUMN:-0}" '
+        $NF == name { print context ? $1 " " $5 : $1 }'
+}
+
+if has_kind acl; then
+    expect_eq "--acl access ACL" "-rw-r--r--+" "$(row --acl acl)"
+    expect_eq "--acl default ACL" "drwxr-xr-x+" "$(row --acl default_acl)"
+    expect_eq "--acl long attribute list" "-rw-r--r--+" "$(row --acl many)"
+    expect_eq "--acl link" "lrwxrwxrwx" "$(row --acl link)"
+    expect_eq "--acl -L link" "-rw-r--r--+" "$(row --acl -L link)"
+fi
+expect_eq "--acl user attribute only" "-rw-r--r--" "$(row --acl plain)"
+expect_eq "-l has no marker" "-rw-r--r--" "$(row -l acl)"
+
+export Z_COLUMN=1
+expect_eq "-Z no context" "-rw-r--r-- ?" "$(row -Z plain)"
+if has_kind context; then
+    expect_eq "-Z context" "-rw-r--r--. $CONTEXT" "$(row -Z context)"
+    # Without -Z the context alone leaves no marker
+    expect_eq "--acl context only" "-rw-r--r--" "$(Z_COLUMN=0 row --acl context)"
+    if has_kind acl; then
+        expect_eq "-Z ACL and context" "-rw-r--r--+ $CONTEXT" "$(row -Z both)"
+    fi
+fi
+if has_kind acl; then
+    expect_eq "-Z ACL only" "-rw-r--r--+ ?" "$(row -Z acl)"
+fi
+unset Z_COLUMN
+
+# Many entries sharing one context: every fetch path prints the same rows
+mkdir "$WORK/many"
+cd "$WORK/many"
+touch $(seq -f 'f%.0f' 1 2000)
+python3 - "$CONTEXT" << 'EOF' || true
+import os
+import sys
+
+for i in range(1, 2001):
+    name = "f%d" % i
+    try:
+        if i % 3 == 0:
+            os.setxattr(name, "security.selinux", sys.argv[1].encode() + b"\0")
+        if i % 5 == 0:
+            os.setxattr(name, "system.posix_acl_access",
+                        os.getxattr("../d/acl", "system.posix_acl_access"))
+    except OSError:
+        pass
+EOF
+run -lZ --threads=0 .
+expect_eq "serial exit status" 0 "$STATUS"
+SERIAL=$OUT
+for args in "--threads=1" "--threads=8" "--mem-limit=64K"; do
+    run -lZ "$args" .
+    if [ "$OUT" != "$SERIAL" ]; then
+        fail "lister -lZ $args differs from --threads=0"
+    fi
+done
+if has_kind context; then
+    expect_eq "shared contexts" 666 "$(printf '%s\n' "$SERIAL" | grep -c " $CONTEXT ")"
+fi
+
+finish